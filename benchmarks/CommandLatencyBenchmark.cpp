@@ -0,0 +1,288 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <opencv2/opencv.hpp>
+
+#include "LeagueClientSimulator.hpp"
+#include "SyntheticFrames.hpp"
+#include "../core/RumbleLeague.hpp"
+#include "../input/InputQueue.hpp"
+#include "../input/MockInputBackend.hpp"
+#include "../logger/RumbleLogger.hpp"
+#include "../window_capture/ImageSequenceSource.hpp"
+
+/**
+* End to end benchmark of RumbleLeague::play().
+*
+* Drives the API with realistic command scripts (the queue flow, champ select and navbar hopping). The frames come
+* from a synthetic client frame with the buttons of the script, or from a folder of recorded client frames
+* (--recorded_frames=<dir>), and every click goes through an InputQueue to a MockInputBackend that timestamps it.
+*
+* Reports the command -> click latency distribution (p50 / p90 / p99 / max, in microseconds), the commands that didn't
+* produce any click, and the sustained commands per second.
+*
+* The "simulated" ones runs against a LeagueClientSimulator instead, a fake client that changes its screen with every
+* click. So the click verification stays on, and the scripts walks through the real screens, in a loop:
+*     ./command_latency_benchmark --benchmark_out=latency.json --benchmark_out_format=json
+*/
+
+namespace {
+
+	// A voice command and the needle that it's expected to be clicked in response
+	struct Step
+	{
+		const char* command;
+		const char* needle;
+	};
+
+	struct CommandScript
+	{
+		const char* name;
+		std::vector<Step> steps;
+	};
+
+	const CommandScript command_scripts[] {
+		{ "queue_flow", {
+			{ "play", "play_button" }, { "summoners", "summoners_rift" }, { "blind", "blind_pick" },
+			{ "go", "confirm_button" }, { "find", "find_game" }, { "accept", "accept_match" },
+		} },
+		{ "champ_select", {
+			{ "finder", "search_bar" }, { "editor", "runes_editor" }, { "picker", "runes_picker" }, { "lock", "lock_in" },
+		} },
+		{ "navbar_hopping", {
+			{ "home", "home_button" }, { "profile", "profile_button" }, { "collection", "collection_button" },
+			{ "loot", "loot_button" }, { "store", "store_button" }, { "clash", "clash_button" },
+			{ "play", "play_button" }, { "home", "home_button" },
+		} },
+	};
+
+	// Scripts that ends on the screen where they starts, so the simulated client can run them over and over
+	const CommandScript simulated_scripts[] {
+		{ "queue_cycle", {
+			{ "play", "play_button" }, { "summoners", "summoners_rift" }, { "blind", "blind_pick" },
+			{ "go", "confirm_button" }, { "find", "find_game" }, { "cancel", "cancel_button" }, { "cancel", "cancel_button" },
+		} },
+		{ "navbar_hopping", command_scripts[ 2 ].steps },
+	};
+
+	// Folder of recorded frames, if it's provided through the command line
+	std::string recorded_frames_dir;
+
+	/**
+	* Places every needle of the script on a synthetic client frame, row by row.
+	* The needles that don't fit on the frame are left out, so their commands will count as misses.
+	*/
+	cv::Mat script_frame(const CommandScript& script, const SyntheticFrames::Resolution& resolution)
+	{
+		constexpr int margin = 12;
+
+		cv::Mat frame = SyntheticFrames::client_frame(resolution);
+		cv::Point cursor{ margin, margin };
+		int row_height = 0;
+		std::vector<std::string> placed_needles;
+
+		for (const Step& step : script.steps)
+		{
+			if (std::find(placed_needles.begin(), placed_needles.end(), step.needle) != placed_needles.end())
+				continue;
+
+			const cv::Mat needle = cv::imread(std::string{ RLE_ASSETS_DIR "/EN/" } + step.needle + ".jpg", cv::IMREAD_COLOR);
+			if (needle.empty())
+				continue;
+
+			if (cursor.x + needle.cols + margin > frame.cols)
+			{
+				cursor = cv::Point{ margin, cursor.y + row_height + margin };
+				row_height = 0;
+			}
+			if (cursor.y + needle.rows + margin > frame.rows)
+				break;
+
+			SyntheticFrames::composite(frame, needle, cursor);
+			placed_needles.push_back(step.needle);
+			cursor.x += needle.cols + margin;
+			row_height = std::max(row_height, needle.rows);
+		}
+
+		return frame;
+	}
+
+	double percentile(std::vector<double>& values, const double p)
+	{
+		if (values.empty())
+			return 0.0;
+
+		const size_t index = static_cast<size_t>(p * (values.size() - 1) + 0.5);
+		std::nth_element(values.begin(), values.begin() + index, values.end());
+		return values[ index ];
+	}
+
+	void BM_play(benchmark::State& state, const CommandScript& script, const SyntheticFrames::Resolution resolution)
+	{
+		std::unique_ptr<ImageSequenceSource> frame_source = recorded_frames_dir.empty()
+			? std::make_unique<ImageSequenceSource>(std::vector<cv::Mat>{ script_frame(script, resolution) })
+			: std::make_unique<ImageSequenceSource>(ImageSequenceSource::from_directory(recorded_frames_dir));
+		MockInputBackend input_backend;
+		InputQueue input_queue{ &input_backend };
+
+		std::vector<double> latencies_us;
+		int64_t commands = 0;
+		int64_t misses = 0;
+
+		{
+			// Autoaccept disabled, so every command of the script produces (at most) one click
+			RumbleLeague rumble_league{ 1, false, false, frame_source.get(), &input_queue };
+			// The replayed frames never react to the clicks, so confirming them would only measure the latency budget
+			rumble_league.set_click_verification(false);
+
+			for (auto _ : state)
+			{
+				for (const Step& step : script.steps)
+				{
+					input_backend.clear();
+
+					const auto start = std::chrono::steady_clock::now();
+					rumble_league.play(step.command);
+					const auto events = input_backend.get_events();
+
+					const auto click = std::find_if(events.begin(), events.end(), [](const MockInputBackend::RecordedEvent& recorded) {
+						return recorded.event.type == InputEvent::Type::LeftDown;
+					});
+
+					if (click != events.end())
+						latencies_us.push_back(std::chrono::duration<double, std::micro>(click->timestamp - start).count());
+					else
+						++misses;
+					++commands;
+				}
+			}
+		}
+
+		state.counters["p50_us"] = percentile(latencies_us, 0.50);
+		state.counters["p90_us"] = percentile(latencies_us, 0.90);
+		state.counters["p99_us"] = percentile(latencies_us, 0.99);
+		state.counters["max_us"] = latencies_us.empty() ? 0.0 : *std::max_element(latencies_us.begin(), latencies_us.end());
+		state.counters["misses"] = static_cast<double>(misses);
+		state.counters["commands_per_second"] = benchmark::Counter(static_cast<double>(commands), benchmark::Counter::kIsRate);
+	}
+
+	// Time between two partial transcripts of the speech recognition
+	constexpr std::chrono::milliseconds partial_interval{ 30 };
+
+	/**
+	* Runs the script on the simulated client. When it's speculative, every command it's first spoken: its partial
+	* transcripts (a few more characters each time) are sent to play_partial, and only the final play it's timed
+	*/
+	void BM_play_simulated(
+		benchmark::State& state, const CommandScript& script, const SyntheticFrames::Resolution resolution, const bool speculative
+	) {
+		LeagueClientSimulator::Options options;
+		options.resolution = resolution;
+		// The queue cycle cancels the search, so the match never has to be found
+		options.queue_frames = -1;
+		LeagueClientSimulator simulator{ Language::English, options };
+		InputQueue input_queue{ &simulator };
+
+		std::vector<double> latencies_us;
+		int64_t commands = 0;
+
+		{
+			RumbleLeague rumble_league{ 1, false, false, &simulator, &input_queue };
+
+			for (auto _ : state)
+			{
+				for (const Step& step : script.steps)
+				{
+					const std::string command{ step.command };
+					if (speculative)
+						for (size_t length = 3; length < command.size(); length += 3)
+						{
+							rumble_league.play_partial(command.substr(0, length));
+							std::this_thread::sleep_for(partial_interval);
+						}
+
+					const auto start = std::chrono::steady_clock::now();
+					rumble_league.play(step.command);
+					latencies_us.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+					++commands;
+				}
+			}
+		}
+
+		// Every command clicks one button, so the clicks that missed, or didn't happen, are the commands that failed
+		const LeagueClientSimulator::Statistics statistics = simulator.get_statistics();
+		state.counters["p50_us"] = percentile(latencies_us, 0.50);
+		state.counters["p99_us"] = percentile(latencies_us, 0.99);
+		state.counters["max_us"] = latencies_us.empty() ? 0.0 : *std::max_element(latencies_us.begin(), latencies_us.end());
+		state.counters["misses"] = static_cast<double>(commands - static_cast<int64_t>(statistics.clicks - statistics.missed_clicks));
+		state.counters["frames_per_command"] = commands > 0 ? static_cast<double>(statistics.frames) / commands : 0.0;
+		state.counters["commands_per_second"] = benchmark::Counter(static_cast<double>(commands), benchmark::Counter::kIsRate);
+	}
+}
+
+
+int main(int argc, char** argv)
+{
+	// Extracts our own option before handing the rest of them to Google Benchmark
+	const char* recorded_frames_flag = "--recorded_frames=";
+	int remaining_args = 0;
+	for (int i = 0; i < argc; i++)
+	{
+		if (std::strncmp(argv[ i ], recorded_frames_flag, std::strlen(recorded_frames_flag)) == 0)
+			recorded_frames_dir = argv[ i ] + std::strlen(recorded_frames_flag);
+		else
+			argv[ remaining_args++ ] = argv[ i ];
+	}
+	argc = remaining_args;
+
+	// Keeps the benchmark output readable. The log calls below the level are still paid (a relaxed atomic load)
+	RumbleLogger::set_level(RumbleLogger::Level::Warning);
+
+	// Absolute assets root, so the benchmark runs from any working directory
+	ClientButton::set_assets_root(RLE_ASSETS_DIR);
+
+	for (const auto& script : command_scripts)
+		for (const auto& resolution : SyntheticFrames::client_resolutions)
+		{
+			const std::string name = std::string{ "play/" } + script.name
+				+ "/" + std::to_string(resolution.width) + "x" + std::to_string(resolution.height);
+
+			benchmark::RegisterBenchmark(name.c_str(), BM_play, std::cref(script), resolution)
+				->Unit(benchmark::kMillisecond);
+
+			// The recorded frames have their own resolution
+			if (!recorded_frames_dir.empty())
+				break;
+		}
+
+	for (const auto& script : simulated_scripts)
+		for (const auto& resolution : SyntheticFrames::client_resolutions)
+		{
+			const std::string name = std::string{ "play_simulated/" } + script.name
+				+ "/" + std::to_string(resolution.width) + "x" + std::to_string(resolution.height);
+
+			benchmark::RegisterBenchmark(name.c_str(), BM_play_simulated, std::cref(script), resolution, false)
+				->Unit(benchmark::kMillisecond);
+
+			const std::string speculative_name = std::string{ "play_speculative/" } + script.name
+				+ "/" + std::to_string(resolution.width) + "x" + std::to_string(resolution.height);
+
+			benchmark::RegisterBenchmark(speculative_name.c_str(), BM_play_simulated, std::cref(script), resolution, true)
+				->Unit(benchmark::kMillisecond);
+		}
+
+	benchmark::Initialize(&argc, argv);
+	if (benchmark::ReportUnrecognizedArguments(argc, argv))
+		return 1;
+	benchmark::RunSpecifiedBenchmarks();
+	benchmark::Shutdown();
+	RumbleLogger::shutdown();
+
+	return 0;
+}
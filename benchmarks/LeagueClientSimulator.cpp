@@ -0,0 +1,411 @@
+#include <algorithm>
+#include <iterator>
+
+#include "LeagueClientSimulator.hpp"
+#include "../data/API_buttons.hpp"
+#include "../tracing/RumbleTrace.hpp"
+
+
+namespace {
+
+	constexpr int margin = 12;
+
+	// On top of every screen, but the champ select and the modals
+	const char* const navbar_needles[] {
+		"home_button", "play_button", "tft_button", "clash_button", "profile_button",
+		"collection_button", "loot_button", "store_button", "your_store_button",
+	};
+
+	const char* const role_needles[] {
+		"primary", "secondary", "top_role", "jungle_role", "mid_role", "bottom_role", "support_role", "autofill_role",
+	};
+
+	bool has_navbar(const LeagueClientScreenIdentifier screen, const bool match_found)
+	{
+		switch (screen)
+		{
+			case LeagueClientScreenIdentifier::ChampSelect:
+			case LeagueClientScreenIdentifier::ClientClosed:
+				return false;
+			case LeagueClientScreenIdentifier::AcceptDecline:
+				return !match_found;
+			default:
+				return true;
+		}
+	}
+
+	/**
+	* The buttons of the content area of every screen. The API doesn't know which buttons belongs to which screen,
+	* so this is the simulator own (reduced) picture of the client. The smaller ones goes first, so they fit on the
+	* lower resolutions. Needles that doesn't fit on the frame are left out
+	*/
+	std::vector<const char*> content_needles(const LeagueClientScreenIdentifier screen, const bool match_found)
+	{
+		switch (screen)
+		{
+			case LeagueClientScreenIdentifier::ChooseGame:
+				return {
+					"confirm_button", "blind_pick", "draft_pick", "ranked_solo_duo", "flex", "tft_normal", "tft_hyper_roll",
+					"training", "summoners_rift", "aram", "teamfight_tactics", "urf", "tutorial", "practice", "tft_ranked",
+				};
+
+			case LeagueClientScreenIdentifier::SummonersDraftLobby:
+			case LeagueClientScreenIdentifier::SummonersRankedLobby:
+			case LeagueClientScreenIdentifier::SummonersFlexLobby:
+			{
+				std::vector<const char*> lobby_needles{ "find_game", "cancel_button" };
+				lobby_needles.insert(lobby_needles.end(), std::begin(role_needles), std::end(role_needles));
+				return lobby_needles;
+			}
+
+			case LeagueClientScreenIdentifier::SummonersBlindLobby:
+			case LeagueClientScreenIdentifier::AramLobby:
+			case LeagueClientScreenIdentifier::TFT_NormalLobby:
+			case LeagueClientScreenIdentifier::TFT_RankedLobby:
+			case LeagueClientScreenIdentifier::TFT_HyperRollLobby:
+			case LeagueClientScreenIdentifier::UrfLobby:
+				return { "find_game", "cancel_button" };
+
+			case LeagueClientScreenIdentifier::TutorialLobby:
+			case LeagueClientScreenIdentifier::PracticeTool:
+				return { "start", "join_game", "cancel_button" };
+
+			case LeagueClientScreenIdentifier::AcceptDecline:
+				if (match_found)
+					return { "accept_match", "decline_match" };
+				return { "cancel_button" };
+
+			case LeagueClientScreenIdentifier::ChampSelect:
+				return { "lock_in", "search_bar", "runes_editor", "runes_picker" };
+
+			default:
+				return {};
+		}
+	}
+}
+
+
+LeagueClientSimulator::LeagueClientSimulator(const Language language)
+	: LeagueClientSimulator{ language, Options{} } {}
+
+LeagueClientSimulator::LeagueClientSimulator(const Language language, const Options& options)
+	: options{ options },
+	screen{ LeagueClientScreenIdentifier::MainScreen },
+	lobby_candidate{ LeagueClientScreenIdentifier::SummonersBlindLobby },
+	queue_countdown{ 0 },
+	left_pressed{ false },
+	rendered_frame_stale{ true },
+	rendered_hover{ nullptr },
+	statistics{ 0, 0, 0, 0 }
+{
+	for (SyntheticFrames::Needle& needle : SyntheticFrames::load_needles(ClientButton::assets_directory(language)))
+	{
+		cv::Mat bgra_needle;
+		cv::cvtColor(needle.image, bgra_needle, cv::COLOR_BGR2BGRA);
+		this->needles.emplace(needle.name, bgra_needle);
+	}
+
+	// The same buttons, and so the same transitions, that the API uses for the language
+	for (ClientButton* client_button : RLE_data::get_buttons(language))
+	{
+		this->transitions.emplace(client_button->image_name, Transition{ client_button->next_screen, client_button->lobby });
+		delete client_button;
+	}
+
+	this->background = SyntheticFrames::client_frame(this->options.resolution, this->options.seed);
+
+	if (this->options.noise_sigma > 0.0)
+	{
+		cv::RNG rng{ this->options.seed + 1 };
+		for (int i = 0; i < LeagueClientSimulator::noise_frames_count; i++)
+		{
+			cv::Mat noise{ this->background.size(), CV_16SC4 };
+			rng.fill(noise, cv::RNG::NORMAL, 0, this->options.noise_sigma);
+			// The alpha channel isn't noisy on a real capture
+			std::vector<cv::Mat> channels;
+			cv::split(noise, channels);
+			channels[ 3 ].setTo(0);
+			cv::merge(channels, noise);
+
+			cv::Mat positive, negative;
+			cv::max(noise, 0, positive);
+			cv::max(-noise, 0, negative);
+			positive.convertTo(positive, CV_8UC4);
+			negative.convertTo(negative, CV_8UC4);
+			this->positive_noise.push_back(positive);
+			this->negative_noise.push_back(negative);
+		}
+	}
+}
+
+
+/**
+* FrameSource
+*/
+
+cv::Mat LeagueClientSimulator::get_video_source()
+{
+	RUMBLE_TRACE_SCOPE("capture");
+
+	std::lock_guard<std::mutex> lock{ this->simulator_mutex };
+
+	// The queue goes on while the client it's being looked at
+	if (this->screen == LeagueClientScreenIdentifier::AcceptDecline && this->queue_countdown > 0)
+	{
+		if (--this->queue_countdown == 0)
+			this->rendered_frame_stale = true;
+	}
+
+	this->render();
+	const uint64_t frame_index = this->statistics.frames++;
+
+	if (this->positive_noise.empty())
+		return this->rendered_frame;
+
+	// A new buffer every frame, since the previous ones can still be in use
+	const size_t noise_index = frame_index % this->positive_noise.size();
+	cv::Mat frame;
+	cv::add(this->rendered_frame, this->positive_noise[ noise_index ], frame);
+	cv::subtract(frame, this->negative_noise[ noise_index ], frame);
+	return frame;
+}
+
+cv::Point LeagueClientSimulator::client_to_screen(const cv::Point& client_point)
+{
+	return client_point + this->options.screen_offset;
+}
+
+
+/**
+* InputBackend
+*/
+
+void LeagueClientSimulator::inject(const InputEvent* events, const size_t count)
+{
+	std::lock_guard<std::mutex> lock{ this->simulator_mutex };
+
+	for (size_t i = 0; i < count; i++)
+	{
+		const InputEvent& event = events[ i ];
+		switch (event.type)
+		{
+			case InputEvent::Type::MouseMove:
+				this->cursor = cv::Point{ event.x, event.y };
+				break;
+			case InputEvent::Type::LeftDown:
+				this->left_pressed = true;
+				break;
+			case InputEvent::Type::LeftUp:
+				// The client reacts when the button it's released
+				if (this->left_pressed)
+					this->click(this->cursor);
+				this->left_pressed = false;
+				break;
+			case InputEvent::Type::KeyDown:
+				this->typed_text.push_back(event.key);
+				break;
+			case InputEvent::Type::KeyUp:
+				break;
+		}
+	}
+}
+
+
+/**
+* Simulation
+*/
+
+bool LeagueClientSimulator::match_found() const
+{
+	return this->screen == LeagueClientScreenIdentifier::AcceptDecline && this->queue_countdown == 0;
+}
+
+/**
+* The navbar it's a row at the top of the client, and the content of the screen fills the rest of it, row by row,
+* from the upper left corner
+*/
+const std::vector<LeagueClientSimulator::PlacedNeedle>& LeagueClientSimulator::current_layout()
+{
+	const bool match_found = this->match_found();
+	const auto key = std::make_pair(this->screen, match_found);
+
+	const auto layout = this->layouts.find(key);
+	if (layout != this->layouts.end())
+		return layout->second;
+
+	std::vector<PlacedNeedle> placed_needles;
+	const cv::Size frame_size = this->background.size();
+	cv::Point cursor{ margin, margin };
+	int row_height = 0;
+
+	const auto place = [&](const char* needle_id) {
+		const auto needle = this->needles.find(needle_id);
+		if (needle == this->needles.end())
+			return;
+
+		const cv::Size needle_size = needle->second.size();
+		if (cursor.x + needle_size.width + margin > frame_size.width)
+		{
+			cursor = cv::Point{ margin, cursor.y + row_height + margin };
+			row_height = 0;
+		}
+		if (cursor.x + needle_size.width + margin > frame_size.width || cursor.y + needle_size.height + margin > frame_size.height)
+			return;
+
+		placed_needles.push_back(PlacedNeedle{ needle_id, cv::Rect{ cursor, needle_size } });
+		cursor.x += needle_size.width + margin;
+		row_height = std::max(row_height, needle_size.height);
+	};
+
+	if (has_navbar(this->screen, match_found))
+	{
+		for (const char* needle_id : navbar_needles)
+			place(needle_id);
+
+		// The content starts below the navbar
+		cursor = cv::Point{ margin, cursor.y + row_height + 4 * margin };
+		row_height = 0;
+	}
+
+	for (const char* needle_id : content_needles(this->screen, match_found))
+		place(needle_id);
+
+	return this->layouts.emplace(key, std::move(placed_needles)).first->second;
+}
+
+const LeagueClientSimulator::PlacedNeedle* LeagueClientSimulator::needle_at(const cv::Point& client_point)
+{
+	for (const PlacedNeedle& placed_needle : this->current_layout())
+		if (placed_needle.bounds.contains(client_point))
+			return &placed_needle;
+
+	return nullptr;
+}
+
+void LeagueClientSimulator::render()
+{
+	const PlacedNeedle* hover = this->options.hover_states
+		? this->needle_at(this->cursor - this->options.screen_offset)
+		: nullptr;
+
+	if (!this->rendered_frame_stale && hover == this->rendered_hover)
+		return;
+
+	// The previous frame can still be in use by the API, so it's rendered on a new buffer
+	cv::Mat frame = this->background.clone();
+
+	// The accept modal dims the client behind it
+	if (this->match_found())
+		frame.convertTo(frame, -1, 0.4);
+
+	for (const PlacedNeedle& placed_needle : this->current_layout())
+	{
+		cv::Mat region = frame(placed_needle.bounds);
+		this->needles[ placed_needle.needle_id ].copyTo(region);
+
+		if (&placed_needle == hover)
+			cv::add(region, cv::Scalar(hover_boost, hover_boost, hover_boost, 0), region);
+	}
+
+	this->rendered_frame = frame;
+	this->rendered_frame_stale = false;
+	this->rendered_hover = hover;
+}
+
+void LeagueClientSimulator::click(const cv::Point& screen_point)
+{
+	++this->statistics.clicks;
+
+	const PlacedNeedle* clicked_needle = this->needle_at(screen_point - this->options.screen_offset);
+	if (clicked_needle == nullptr)
+	{
+		++this->statistics.missed_clicks;
+		return;
+	}
+
+	const auto transition = this->transitions.find(clicked_needle->needle_id);
+	if (transition == this->transitions.end())
+		return;
+
+	// The same rules that the API follows to know where the client goes
+	switch (transition->second.next_screen)
+	{
+		case LeagueClientScreenIdentifier::ChooseGame:
+			if (transition->second.lobby != LeagueClientScreenIdentifier::NoLobby)
+				this->lobby_candidate = transition->second.lobby;
+			this->change_screen(LeagueClientScreenIdentifier::ChooseGame);
+			break;
+
+		case LeagueClientScreenIdentifier::GameLobby:
+			this->change_screen(this->lobby_candidate);
+			break;
+
+		case LeagueClientScreenIdentifier::CancelAction:
+			this->change_screen(this->screen == LeagueClientScreenIdentifier::AcceptDecline
+				? this->lobby_candidate
+				: LeagueClientScreenIdentifier::MainScreen);
+			break;
+
+		default:
+			this->change_screen(transition->second.next_screen);
+	}
+}
+
+void LeagueClientSimulator::change_screen(const LeagueClientScreenIdentifier next_screen)
+{
+	if (next_screen == LeagueClientScreenIdentifier::AcceptDecline)
+		this->queue_countdown = (this->options.queue_frames >= 0) ? this->options.queue_frames : -1;
+
+	if (next_screen != this->screen)
+		++this->statistics.screen_changes;
+
+	this->screen = next_screen;
+	this->rendered_frame_stale = true;
+}
+
+
+/**
+* Getters and setters
+*/
+
+LeagueClientScreenIdentifier LeagueClientSimulator::get_screen()
+{
+	std::lock_guard<std::mutex> lock{ this->simulator_mutex };
+	return this->screen;
+}
+
+void LeagueClientSimulator::set_screen(const LeagueClientScreenIdentifier screen)
+{
+	std::lock_guard<std::mutex> lock{ this->simulator_mutex };
+	this->change_screen(screen);
+}
+
+cv::Rect LeagueClientSimulator::get_needle_bounds(const std::string& needle_id)
+{
+	std::lock_guard<std::mutex> lock{ this->simulator_mutex };
+
+	for (const PlacedNeedle& placed_needle : this->current_layout())
+		if (placed_needle.needle_id == needle_id)
+			return placed_needle.bounds;
+
+	return cv::Rect{};
+}
+
+std::string LeagueClientSimulator::get_typed_text()
+{
+	std::lock_guard<std::mutex> lock{ this->simulator_mutex };
+	return this->typed_text;
+}
+
+LeagueClientSimulator::Statistics LeagueClientSimulator::get_statistics()
+{
+	std::lock_guard<std::mutex> lock{ this->simulator_mutex };
+	return this->statistics;
+}
+
+void LeagueClientSimulator::reset_statistics()
+{
+	std::lock_guard<std::mutex> lock{ this->simulator_mutex };
+	this->statistics = Statistics{ 0, 0, 0, 0 };
+	this->typed_text.clear();
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "SyntheticFrames.hpp"
+#include "../helpers/EnumTypes.hpp"
+#include "../input/InputBackend.hpp"
+#include "../window_capture/FrameSource.hpp"
+
+/// <summary>
+/// A deterministic, in-process fake League client, so the whole play() pipeline can run end to end on any machine.
+///
+/// Every screen it's rendered by compositing the needles of the assets that belongs to it (the navbar, the game modes,
+/// the lobby, the accept modal...) over a synthetic client frame, with a little of temporal noise and the hover state
+/// of the button under the cursor. The injected clicks are hit tested against the rendered buttons, and the screen
+/// follows the "next_screen" of the clicked one, the same transitions that the API expects from the real client.
+///
+/// It's both ends of the API: the frame source where the frames comes from and the input backend where the clicks
+/// are delivered (through an InputQueue). Safe to be used from several threads, as any other source.
+/// </summary>
+class LeagueClientSimulator : public FrameSource, public InputBackend
+{
+	public:
+		struct Options
+		{
+			SyntheticFrames::Resolution resolution{ 1280, 720 };
+			// Standard deviation of the noise added to every frame. Zero renders the same frame until the screen changes
+			double noise_sigma = 3.0;
+			// Brightens the button under the cursor, as the client does
+			bool hover_states = true;
+			// Frames captured on the queue before the match it's found. Negative never finds one
+			int queue_frames = 3;
+			// Offset of the client inside the "screen"
+			cv::Point screen_offset;
+			uint64_t seed = 0x5EED;
+		};
+
+		struct Statistics
+		{
+			uint64_t frames;
+			uint64_t clicks;
+			// Clicks that didn't land on any button of the current screen
+			uint64_t missed_clicks;
+			uint64_t screen_changes;
+		};
+
+	private:
+		// Different noise frames that are cycled through. Enough for the consecutive frames to differ
+		static constexpr int noise_frames_count = 4;
+
+		// Added to the pixels of the hovered button
+		static constexpr double hover_boost = 24.0;
+
+		struct PlacedNeedle
+		{
+			std::string needle_id;
+			cv::Rect bounds;
+		};
+
+		// What happens when a button it's clicked, taken from the buttons of the API
+		struct Transition
+		{
+			LeagueClientScreenIdentifier next_screen;
+			LeagueClientScreenIdentifier lobby;
+		};
+
+		Options options;
+
+		// The needles of the language, as BGRA images
+		std::map<std::string, cv::Mat> needles;
+		std::map<std::string, Transition> transitions;
+
+		cv::Mat background;
+		// Split on its positive and negative parts, so they're applied with two saturated (and vectorized) operations
+		std::vector<cv::Mat> positive_noise;
+		std::vector<cv::Mat> negative_noise;
+
+		// Layouts already computed, by screen (and by whether the match was already found, on the queue)
+		std::map<std::pair<LeagueClientScreenIdentifier, bool>, std::vector<PlacedNeedle>> layouts;
+
+		LeagueClientScreenIdentifier screen;
+		LeagueClientScreenIdentifier lobby_candidate;
+		// Frames remaining until the match it's found, while on the queue
+		int queue_countdown;
+
+		cv::Point cursor;
+		bool left_pressed;
+		std::string typed_text;
+
+		// The last rendered frame, without noise. Rendered again when the screen or the hovered button changes
+		cv::Mat rendered_frame;
+		bool rendered_frame_stale;
+		const PlacedNeedle* rendered_hover;
+
+		Statistics statistics;
+		std::mutex simulator_mutex;
+
+		bool match_found() const;
+		const std::vector<PlacedNeedle>& current_layout();
+		const PlacedNeedle* needle_at(const cv::Point& client_point);
+
+		void render();
+		void click(const cv::Point& screen_point);
+		void change_screen(const LeagueClientScreenIdentifier next_screen);
+
+	public:
+		LeagueClientSimulator(const Language language);
+		LeagueClientSimulator(const Language language, const Options& options);
+
+		LeagueClientSimulator(const LeagueClientSimulator&) = delete;
+		LeagueClientSimulator& operator=(const LeagueClientSimulator&) = delete;
+
+		// FrameSource
+		cv::Mat get_video_source() override;
+		cv::Point client_to_screen(const cv::Point& client_point) override;
+
+		// InputBackend
+		void inject(const InputEvent* events, const size_t count) override;
+
+		LeagueClientScreenIdentifier get_screen();
+		// Moves the client to a screen, ie, to start every iteration of a benchmark from the same one
+		void set_screen(const LeagueClientScreenIdentifier screen);
+
+		// Where a needle it's drawn on the current screen, on client coordinates. Empty if it isn't there
+		cv::Rect get_needle_bounds(const std::string& needle_id);
+
+		// The text typed since the creation or the last reset of the statistics
+		std::string get_typed_text();
+
+		Statistics get_statistics();
+		void reset_statistics();
+};
@@ -0,0 +1,197 @@
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "LeagueClientSimulator.hpp"
+#include "../core/RumbleLeague.hpp"
+#include "../input/InputBackend.hpp"
+#include "../input/InputQueue.hpp"
+#include "../logger/RumbleLogger.hpp"
+
+/**
+* End to end scenarios of RumbleLeague against the LeagueClientSimulator, run by ctest.
+*
+* Every scenario it's a script of voice commands, each one with the button that it must click and the screen where
+* the simulated client must be after it. A step fails when the command clicks anything else, clicks more than once
+* (a retried click that the client already took) or leaves the client on another screen:
+*     ./simulator_scenarios [scenario name]
+* Returns the number of failed scenarios.
+*/
+
+namespace {
+
+	// Time that a command that waits for its button (ie, the accept of the match) gets to click it
+	constexpr std::chrono::milliseconds event_timeout{ 5000 };
+
+	struct Step
+	{
+		const char* command;
+		// The button that must be clicked, once
+		const char* needle;
+		LeagueClientScreenIdentifier screen;
+	};
+
+	struct Scenario
+	{
+		const char* name;
+		// Frames on the queue before the match it's found. Negative never finds it
+		int queue_frames;
+		std::vector<Step> steps;
+	};
+
+	const Scenario scenarios[] {
+		{ "queue_and_accept", 0, {
+			{ "play", "play_button", LeagueClientScreenIdentifier::ChooseGame },
+			{ "summoners", "summoners_rift", LeagueClientScreenIdentifier::ChooseGame },
+			{ "blind", "blind_pick", LeagueClientScreenIdentifier::ChooseGame },
+			{ "go", "confirm_button", LeagueClientScreenIdentifier::SummonersBlindLobby },
+			{ "find", "find_game", LeagueClientScreenIdentifier::AcceptDecline },
+			{ "accept", "accept_match", LeagueClientScreenIdentifier::ChampSelect },
+		} },
+		{ "queue_and_cancel", -1, {
+			{ "play", "play_button", LeagueClientScreenIdentifier::ChooseGame },
+			{ "aram", "aram", LeagueClientScreenIdentifier::ChooseGame },
+			{ "go", "confirm_button", LeagueClientScreenIdentifier::AramLobby },
+			{ "find", "find_game", LeagueClientScreenIdentifier::AcceptDecline },
+			{ "cancel", "cancel_button", LeagueClientScreenIdentifier::AramLobby },
+			{ "cancel", "cancel_button", LeagueClientScreenIdentifier::MainScreen },
+		} },
+		{ "ranked_lobby", -1, {
+			{ "play", "play_button", LeagueClientScreenIdentifier::ChooseGame },
+			{ "summoners", "summoners_rift", LeagueClientScreenIdentifier::ChooseGame },
+			{ "ranked", "ranked_solo_duo", LeagueClientScreenIdentifier::ChooseGame },
+			{ "go", "confirm_button", LeagueClientScreenIdentifier::SummonersRankedLobby },
+			{ "primary", "primary", LeagueClientScreenIdentifier::SummonersRankedLobby },
+		} },
+		{ "navbar_hopping", -1, {
+			{ "profile", "profile_button", LeagueClientScreenIdentifier::Profile },
+			{ "collection", "collection_button", LeagueClientScreenIdentifier::Collection },
+			{ "loot", "loot_button", LeagueClientScreenIdentifier::Loot },
+			{ "play", "play_button", LeagueClientScreenIdentifier::ChooseGame },
+			{ "home", "home_button", LeagueClientScreenIdentifier::MainScreen },
+		} },
+	};
+
+	/**
+	* Delivers the input to the simulator, keeping the client point of every click on the way. The simulator tells
+	* where each button it's drawn, so the clicks can be checked against the button of the step
+	*/
+	class RecordingBackend : public InputBackend
+	{
+		private:
+			LeagueClientSimulator* simulator;
+
+			cv::Point cursor;
+			std::vector<cv::Point> clicks;
+			std::mutex clicks_mutex;
+
+		public:
+			explicit RecordingBackend(LeagueClientSimulator* simulator) : simulator{ simulator } {}
+
+			void inject(const InputEvent* events, const size_t count) override
+			{
+				{
+					std::lock_guard<std::mutex> lock{ this->clicks_mutex };
+					for (size_t i = 0; i < count; i++)
+					{
+						if (events[ i ].type == InputEvent::Type::MouseMove)
+							this->cursor = cv::Point{ events[ i ].x, events[ i ].y };
+						else if (events[ i ].type == InputEvent::Type::LeftUp)
+							this->clicks.push_back(this->cursor);
+					}
+				}
+
+				this->simulator->inject(events, count);
+			}
+
+			std::vector<cv::Point> take_clicks()
+			{
+				std::lock_guard<std::mutex> lock{ this->clicks_mutex };
+				std::vector<cv::Point> taken;
+				taken.swap(this->clicks);
+				return taken;
+			}
+	};
+
+	// The client gets to the screen, or the timeout runs out. The commands that waits for their button returns before clicking it
+	bool wait_for_screen(LeagueClientSimulator& simulator, const LeagueClientScreenIdentifier screen, const std::chrono::milliseconds timeout)
+	{
+		const auto deadline = std::chrono::steady_clock::now() + timeout;
+		while (simulator.get_screen() != screen)
+		{
+			if (std::chrono::steady_clock::now() >= deadline)
+				return false;
+			std::this_thread::sleep_for(std::chrono::milliseconds{ 5 });
+		}
+		return true;
+	}
+
+	bool run_scenario(const Scenario& scenario)
+	{
+		LeagueClientSimulator::Options options;
+		options.queue_frames = scenario.queue_frames;
+		LeagueClientSimulator simulator{ Language::English, options };
+		RecordingBackend recording_backend{ &simulator };
+		InputQueue input_queue{ &recording_backend };
+
+		bool passed = true;
+		{
+			RumbleLeague rumble_league{ 1, false, false, &simulator, &input_queue };
+
+			for (const Step& step : scenario.steps)
+			{
+				// Where the button it's drawn now, on client coordinates. The screen offset of the simulator it's zero
+				const cv::Rect needle_bounds = simulator.get_needle_bounds(step.needle);
+
+				rumble_league.play(step.command);
+				const bool on_screen = wait_for_screen(simulator, step.screen, event_timeout);
+				const std::vector<cv::Point> clicks = recording_backend.take_clicks();
+
+				std::string failure;
+				if (needle_bounds.empty())
+					failure = std::string{ "the button " } + step.needle + " isn't on the screen";
+				else if (clicks.size() != 1)
+					failure = std::to_string(clicks.size()) + " clicks instead of one";
+				else if (!needle_bounds.contains(clicks.front()))
+					failure = std::string{ "the click missed " } + step.needle;
+				else if (!on_screen)
+					failure = "the client isn't on the expected screen";
+
+				if (!failure.empty())
+				{
+					std::cerr << "[" << scenario.name << "] \"" << step.command << "\": " << failure
+						<< " (client on " << simulator.get_screen() << ")" << std::endl;
+					passed = false;
+					break;
+				}
+			}
+		}
+
+		std::cout << (passed ? "PASSED " : "FAILED ") << scenario.name << std::endl;
+		return passed;
+	}
+}
+
+
+int main(int argc, char** argv)
+{
+	RumbleLogger::set_level(RumbleLogger::Level::Warning);
+
+	// Absolute assets root, so the scenarios runs from any working directory
+	ClientButton::set_assets_root(RLE_ASSETS_DIR);
+
+	const std::string only_scenario = (argc > 1) ? argv[ 1 ] : "";
+
+	int failed_scenarios = 0;
+	for (const Scenario& scenario : scenarios)
+		if (only_scenario.empty() || only_scenario == scenario.name)
+			failed_scenarios += run_scenario(scenario) ? 0 : 1;
+
+	RumbleLogger::shutdown();
+	return failed_scenarios;
+}
@@ -0,0 +1,75 @@
+#include <algorithm>
+#include <filesystem>
+
+#include "SyntheticFrames.hpp"
+
+
+std::vector<SyntheticFrames::Needle> SyntheticFrames::load_needles(const std::string& assets_language_dir)
+{
+	std::vector<Needle> needles;
+
+	for (const auto& entry : std::filesystem::directory_iterator(assets_language_dir))
+	{
+		if (entry.path().extension() != ".jpg")
+			continue;
+
+		cv::Mat image = cv::imread(entry.path().string(), cv::IMREAD_COLOR);
+		if (!image.empty())
+			needles.push_back(Needle{ entry.path().stem().string(), image });
+	}
+
+	std::sort(needles.begin(), needles.end(), [](const Needle& a, const Needle& b) { return a.name < b.name; });
+	return needles;
+}
+
+cv::Mat SyntheticFrames::client_frame(const Resolution& resolution, const uint64_t seed)
+{
+	cv::RNG rng{ seed };
+
+	// The dark blue background of the client
+	cv::Mat frame{ resolution.height, resolution.width, CV_8UC3, cv::Scalar(19, 10, 1) };
+
+	// Panels, borders and highlights of the client, in its gold / blue / gray palette
+	const cv::Scalar palette[] {
+		cv::Scalar(40, 30, 10), cv::Scalar(70, 150, 200), cv::Scalar(90, 90, 90),
+		cv::Scalar(120, 70, 20), cv::Scalar(160, 200, 230), cv::Scalar(30, 30, 30),
+	};
+	for (int i = 0; i < 32; i++)
+	{
+		const int x = rng.uniform(0, resolution.width - 16);
+		const int y = rng.uniform(0, resolution.height - 16);
+		const int w = rng.uniform(16, std::max(17, resolution.width / 4));
+		const int h = rng.uniform(8, std::max(9, resolution.height / 6));
+		cv::rectangle(frame, cv::Rect(x, y, w, h), palette[ rng.uniform(0, 6) ], (i % 3 == 0) ? 1 : cv::FILLED);
+	}
+
+	// Gaussian noise over the whole frame, as the JPEG needles aren't pixel perfect against the real client either
+	cv::Mat noise{ frame.size(), CV_16SC3 };
+	rng.fill(noise, cv::RNG::NORMAL, 0, 4);
+	cv::Mat noisy_frame;
+	frame.convertTo(noisy_frame, CV_16SC3);
+	noisy_frame += noise;
+	noisy_frame.convertTo(frame, CV_8UC3);
+
+	cv::Mat bgra_frame;
+	cv::cvtColor(frame, bgra_frame, cv::COLOR_BGR2BGRA);
+	return bgra_frame;
+}
+
+cv::Point SyntheticFrames::default_placement(const cv::Mat& frame, const cv::Mat& needle)
+{
+	return cv::Point{ (frame.cols - needle.cols) * 2 / 3, (frame.rows - needle.rows) / 2 };
+}
+
+cv::Point SyntheticFrames::composite(cv::Mat& frame, const cv::Mat& needle, const cv::Point& top_left)
+{
+	cv::Mat converted_needle;
+	if (needle.channels() == frame.channels())
+		converted_needle = needle;
+	else
+		cv::cvtColor(needle, converted_needle, (frame.channels() == 4) ? cv::COLOR_BGR2BGRA : cv::COLOR_BGRA2BGR);
+
+	converted_needle.copyTo(frame(cv::Rect(top_left, needle.size())));
+
+	return top_left + cv::Point{ needle.cols / 2, needle.rows / 2 };
+}
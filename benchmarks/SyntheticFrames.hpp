@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+/**
+* Helpers to build deterministic, League client looking frames for the benchmarks,
+* so they can run on any machine without a real client (or Windows) available.
+*/
+namespace SyntheticFrames {
+
+	struct Resolution
+	{
+		int width;
+		int height;
+	};
+
+	// The window sizes that the League client offers
+	const Resolution client_resolutions[] { { 1024, 576 }, { 1280, 720 }, { 1600, 900 } };
+
+	struct Needle
+	{
+		std::string name;
+		cv::Mat image;
+	};
+
+	// Loads (sorted by name) every .jpg needle of an assets language folder
+	std::vector<Needle> load_needles(const std::string& assets_language_dir);
+
+	/**
+	* A BGRA frame (as the ones captured from the Windows API) with the dark background of the client,
+	* some solid panels as UI clutter and a little of gaussian noise. Same seed, same frame.
+	*/
+	cv::Mat client_frame(const Resolution& resolution, const uint64_t seed = 0x5EED);
+
+	// Where the benchmarks places a needle by default. Away from the corners, where the navbar lives
+	cv::Point default_placement(const cv::Mat& frame, const cv::Mat& needle);
+
+	// Pastes the needle on the frame with its upper left corner at the given point. Returns the center of the pasted needle
+	cv::Point composite(cv::Mat& frame, const cv::Mat& needle, const cv::Point& top_left);
+}
@@ -0,0 +1,179 @@
+#include <algorithm>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <opencv2/opencv.hpp>
+
+#include "SyntheticFrames.hpp"
+#include "../vision/RumbleVision.h"
+#include "../window_capture/FrameKernels.hpp"
+
+/**
+* Micro-benchmarks for RumbleLeagueVision::find and for the conversion of the captured frames to its working formats.
+*
+* Every needle on assets/EN it's composited into a synthetic League client frame at the usual client resolutions,
+* and searched on every working format and match method supported by the vision engine. The miss cases search the
+* same frame without the needle, which it's the worst (and the most common one) case of the polling loops.
+*
+* Besides the timings, every benchmark reports the best score found ("score"), so the threshold can be tuned
+* with real margins between the hits and the misses, and if the engine answered correctly ("correct").
+*
+* Compare builds by storing the results as JSON:
+*     ./vision_benchmark --benchmark_out=vision.json --benchmark_out_format=json
+* and narrow the run with --benchmark_filter, ie: --benchmark_filter='find/summoners_rift/1280x720/.*'
+*/
+
+namespace {
+
+	// Same value as RumbleLeague::threshold_rate
+	constexpr double threshold_rate = 0.05;
+
+	// How far (in pixels) the returned center can be from the real one to consider the hit as correct
+	constexpr int center_tolerance = 2;
+
+	struct MatchMethod
+	{
+		const char* name;
+		int method;
+	};
+
+	const MatchMethod match_methods[] {
+		{ "sqdiff_normed", cv::TM_SQDIFF_NORMED },
+		{ "ccorr_normed", cv::TM_CCORR_NORMED },
+		{ "ccoeff_normed", cv::TM_CCOEFF_NORMED },
+	};
+
+	struct NamedWorkingFormat
+	{
+		const char* name;
+		ChannelMode mode;
+		int downscale;
+		// The integral images cascade. Only the gray formats (with TM_SQDIFF_NORMED) takes it
+		bool cascade;
+	};
+
+	const NamedWorkingFormat working_formats[] {
+		{ "bgra", ChannelMode::BGRA, 1, false },
+		{ "bgr", ChannelMode::BGR, 1, false },
+		{ "gray", ChannelMode::Gray, 1, true },
+		{ "gray_half", ChannelMode::Gray, 2, true },
+		{ "gray_no_cascade", ChannelMode::Gray, 1, false },
+		{ "gray_half_no_cascade", ChannelMode::Gray, 2, false },
+	};
+
+	void BM_find(
+		benchmark::State& state,
+		const cv::Mat needle,
+		const SyntheticFrames::Resolution resolution,
+		const bool needle_on_screen,
+		const NamedWorkingFormat working_format,
+		const int match_method
+	)
+	{
+		cv::Mat frame = SyntheticFrames::client_frame(resolution);
+		cv::Point expected_center{};
+		if (needle_on_screen)
+			expected_center = SyntheticFrames::composite(frame, needle, SyntheticFrames::default_placement(frame, needle));
+
+		RumbleLeagueVision rumble_vision{ working_format.mode, match_method, working_format.downscale };
+		rumble_vision.set_cascade(working_format.cascade);
+		cv::Point match_location;
+
+		// The capture converts the frames, so that cost it's measured apart (BM_frame_conversion)
+		WorkingFrame working_frame;
+		FrameKernels::from_image(frame, rumble_vision.get_working_format(), working_frame);
+
+		for (auto _ : state)
+		{
+			match_location = rumble_vision.find(working_frame, needle, threshold_rate, false);
+			benchmark::DoNotOptimize(match_location);
+		}
+
+		// A pixel of a scaled frame it's several ones of the client
+		const bool found = match_location != cv::Point{};
+		const bool correct = needle_on_screen
+			? found && cv::norm(match_location - expected_center) <= center_tolerance * working_format.downscale
+			: !found;
+
+		state.counters["score"] = rumble_vision.get_last_score();
+		state.counters["correct"] = correct ? 1 : 0;
+		state.SetItemsProcessed(state.iterations());
+	}
+
+	/**
+	* From a captured BGRA frame to the gray working formats, with their integral images: the fused kernel of the
+	* capture against the chain of OpenCV calls that does the same work, one full frame pass each
+	*/
+	void BM_frame_conversion(benchmark::State& state, const SyntheticFrames::Resolution resolution, const int downscale, const bool fused)
+	{
+		const cv::Mat frame = SyntheticFrames::client_frame(resolution);
+		const WorkingFormat format{ ChannelMode::Gray, downscale, true };
+		WorkingFrame working_frame;
+
+		for (auto _ : state)
+		{
+			if (fused)
+				FrameKernels::from_image(frame, format, working_frame);
+			else
+			{
+				cv::Mat gray;
+				cv::cvtColor(frame, gray, cv::COLOR_BGRA2GRAY);
+				if (downscale != 1)
+					cv::resize(gray, gray, cv::Size{ gray.cols / downscale, gray.rows / downscale }, 0, 0, cv::INTER_AREA);
+				cv::integral(gray, working_frame.integral, working_frame.squared_integral, CV_32S, CV_64F);
+				working_frame.image = gray;
+			}
+			benchmark::DoNotOptimize(working_frame.image.data);
+		}
+
+		state.SetBytesProcessed(state.iterations() * frame.total() * frame.elemSize());
+	}
+}
+
+
+int main(int argc, char** argv)
+{
+	const std::vector<SyntheticFrames::Needle> needles = SyntheticFrames::load_needles(RLE_ASSETS_DIR "/EN");
+
+	for (const auto& needle : needles)
+		for (const auto& resolution : SyntheticFrames::client_resolutions)
+			for (const bool needle_on_screen : { true, false })
+				for (const auto& working_format : working_formats)
+					for (const auto& match_method : match_methods)
+					{
+						if (needle.image.cols > resolution.width || needle.image.rows > resolution.height)
+							continue;
+
+						const std::string name = "find/" + needle.name
+							+ "/" + std::to_string(resolution.width) + "x" + std::to_string(resolution.height)
+							+ "/" + (needle_on_screen ? "hit" : "miss")
+							+ "/" + working_format.name
+							+ "/" + match_method.name;
+
+						benchmark::RegisterBenchmark(
+							name.c_str(), BM_find, needle.image, resolution, needle_on_screen, working_format, match_method.method
+						)->Unit(benchmark::kMicrosecond);
+					}
+
+	for (const auto& resolution : SyntheticFrames::client_resolutions)
+		for (const int downscale : { 1, 2 })
+			for (const bool fused : { true, false })
+			{
+				const std::string name = "frame_conversion/" + std::to_string(resolution.width) + "x" + std::to_string(resolution.height)
+					+ "/" + (downscale == 1 ? "gray" : "gray_half")
+					+ "/" + (fused ? "fused" : "opencv");
+
+				benchmark::RegisterBenchmark(name.c_str(), BM_frame_conversion, resolution, downscale, fused)
+					->Unit(benchmark::kMicrosecond);
+			}
+
+	benchmark::Initialize(&argc, argv);
+	if (benchmark::ReportUnrecognizedArguments(argc, argv))
+		return 1;
+	benchmark::RunSpecifiedBenchmarks();
+	benchmark::Shutdown();
+
+	return 0;
+}
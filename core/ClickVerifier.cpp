@@ -0,0 +1,218 @@
+#include <algorithm>
+#include <thread>
+
+#include "ClickVerifier.hpp"
+#include "../logger/RumbleLogger.hpp"
+#include "../tracing/RumbleTrace.hpp"
+
+
+ClickVerifier::ClickVerifier(
+	FrameSource* frame_source,
+	RumbleLeagueVision* rumble_vision,
+	NeedleResources* needle_resources,
+	const std::chrono::milliseconds budget
+)
+	: frame_source{ frame_source },
+	rumble_vision{ rumble_vision },
+	needle_resources{ needle_resources },
+	budget{ budget } {}
+
+
+cv::Rect ClickVerifier::frame_rect(const WorkingFrame& frame, const cv::Point& client_center, const cv::Size& client_size)
+{
+	const int scale = frame.downscale;
+	const cv::Size size{ client_size.width / scale, client_size.height / scale };
+	return cv::Rect{
+		client_center.x / scale - size.width / 2 - region_padding,
+		client_center.y / scale - size.height / 2 - region_padding,
+		size.width + 2 * region_padding,
+		size.height + 2 * region_padding
+	} & cv::Rect{ 0, 0, frame.image.cols, frame.image.rows };
+}
+
+bool ClickVerifier::region_changed(const WorkingFrame& frame, const WorkingFrame& reference_frame, const cv::Rect& region)
+{
+	if (region.empty())
+		return true;
+
+	const double values = static_cast<double>(region.area()) * frame.image.channels();
+	return cv::norm(frame.image(region), reference_frame.image(region), cv::NORM_L1) > change_level * values;
+}
+
+
+bool ClickVerifier::needle_present(
+	WorkingFrame& frame,
+	const std::string& needle_id,
+	const cv::Mat& needle_image,
+	const cv::Rect& region,
+	const double threshold
+)
+{
+	// Cut by the border of the frame, the needle can't be there
+	const int scale = frame.downscale;
+	if (region.width < needle_image.cols / scale || region.height < needle_image.rows / scale)
+		return false;
+
+	WorkingFrame region_frame = frame_region(frame, region);
+	return this->rumble_vision->find(
+		region_frame, needle_id, needle_image, this->needle_resources->get_compiled_needles()->get(needle_id), threshold
+	) != cv::Point{ 0, 0 };
+}
+
+bool ClickVerifier::anchor_present(
+	WorkingFrame& frame,
+	const std::string& anchor_id,
+	const cv::Mat& anchor_image,
+	const cv::Rect& region,
+	const double threshold,
+	cv::Point& location
+)
+{
+	const CompiledNeedle* compiled_needle = this->needle_resources->get_compiled_needles()->get(anchor_id);
+
+	if (region.empty())
+	{
+		location = this->rumble_vision->find(frame, anchor_id, anchor_image, compiled_needle, threshold);
+		return location != cv::Point{ 0, 0 };
+	}
+
+	WorkingFrame region_frame = frame_region(frame, region);
+	location = this->rumble_vision->find(region_frame, anchor_id, anchor_image, compiled_needle, threshold);
+	if (location == cv::Point{ 0, 0 })
+		return false;
+
+	location += region.tl() * frame.downscale;
+	return true;
+}
+
+
+ClickOutcome ClickVerifier::verify(
+	WorkingFrame& reference_frame,
+	const std::string& needle_id,
+	const cv::Mat& needle_image,
+	const cv::Point& click_location,
+	const bool needle_stays,
+	const std::string& anchor_id,
+	const std::string& anchor_path,
+	LayoutProfile* layout_profile
+)
+{
+	RUMBLE_TRACE_SCOPE("click_verification");
+
+	const auto start = std::chrono::steady_clock::now();
+
+	NeedleThresholds* needle_thresholds = this->needle_resources->get_needle_thresholds();
+	const std::string format_tag = this->rumble_vision->get_format_tag();
+	const WorkingFormat working_format = this->rumble_vision->get_working_format();
+
+	// Looser than the one it was clicked with, so the hover and pressed states of the button don't read as gone
+	const double needle_threshold = std::max(needle_thresholds->get(needle_id + format_tag), presence_threshold);
+	const cv::Rect needle_region = frame_rect(reference_frame, click_location, needle_image.size());
+
+	cv::Mat anchor_image = anchor_path.empty()
+		? cv::Mat{}
+		: this->needle_resources->get_needle(anchor_id, anchor_path, this->rumble_vision->get_channel_mode());
+	const double anchor_threshold = needle_thresholds->get(anchor_id + format_tag);
+
+	// Where the anchor was seen on this client size. Only that region it's searched then, instead of the whole frame
+	cv::Rect anchor_region;
+	cv::Rect placement;
+	if (!anchor_image.empty() && layout_profile != nullptr && layout_profile->get(anchor_id, placement))
+	{
+		anchor_region = frame_rect(reference_frame, (placement.tl() + placement.br()) / 2, placement.size());
+		if (anchor_region.width < anchor_image.cols / reference_frame.downscale
+			|| anchor_region.height < anchor_image.rows / reference_frame.downscale)
+			anchor_region = cv::Rect{};
+	}
+
+	// The score of the anchor on the frame of the click, where it wasn't found. Once the client confirms the click,
+	// that frame was on the screen before the one of the anchor, so the score it's a labelled miss of the anchor
+	bool anchor_missed = false;
+	double anchor_miss_score = 0.0;
+	MatchPath anchor_miss_path = MatchPath::Full;
+
+	cv::Point anchor_location;
+	if (!anchor_image.empty() && !reference_frame.image.empty())
+	{
+		// Clicking on a screen that already shows the anchor (a role of the lobby...) can't be confirmed by it
+		if (this->anchor_present(reference_frame, anchor_id, anchor_image, anchor_region, anchor_threshold, anchor_location))
+		{
+			RUMBLE_LOG_TRACE << "The anchor " << anchor_id << " was already on the screen, only the needle it's watched";
+			anchor_image = cv::Mat{};
+		}
+		else if (this->rumble_vision->is_last_score_exact())
+		{
+			anchor_missed = true;
+			anchor_miss_score = this->rumble_vision->get_last_score();
+			anchor_miss_path = this->rumble_vision->get_last_match_path();
+		}
+	}
+
+	// Nothing on the frames could tell a reaction apart from a missed click, so no time it's spent watching them
+	if (anchor_image.empty() && needle_stays)
+	{
+		RUMBLE_LOG_TRACE << "The needle " << needle_id << " stays and there is no anchor, the click can't be verified";
+		return ClickOutcome::Unverified;
+	}
+
+	const auto confirmed = [&]() {
+		if (anchor_missed)
+			needle_thresholds->record(anchor_id + format_tag, anchor_miss_path, anchor_miss_score, false);
+		return ClickOutcome::Confirmed;
+	};
+
+	const auto deadline = start + (anchor_image.empty() ? std::min(this->budget, needle_only_budget) : this->budget);
+
+	int polled_frames = 0;
+	int frames_without_needle = 0;
+	do
+	{
+		WorkingFrame frame;
+		this->frame_source->get_working_frame(working_format, frame);
+		++polled_frames;
+
+		// A resized client it's, for sure, a reaction. Also avoids searching regions out of the new frame
+		if (frame.image.size() != reference_frame.image.size() || frame.image.type() != reference_frame.image.type())
+			return confirmed();
+
+		// The region of the needle as it was on the frame of the click, so the needle it's still there without searching it
+		if (!region_changed(frame, reference_frame, needle_region)
+			|| this->needle_present(frame, needle_id, needle_image, needle_region, needle_threshold))
+			frames_without_needle = 0;
+		else if (++frames_without_needle >= needle_gone_frames)
+		{
+			RUMBLE_LOG_TRACE << "Click confirmed by the needle " << needle_id << " going away after " << polled_frames << " frames";
+			return confirmed();
+		}
+
+		// Only searched once its region changes. Without a known placement, on the whole frame
+		if (!anchor_image.empty() && (anchor_region.empty() || region_changed(frame, reference_frame, anchor_region))
+			&& this->anchor_present(frame, anchor_id, anchor_image, anchor_region, anchor_threshold, anchor_location))
+		{
+			if (anchor_region.empty() && layout_profile != nullptr)
+				layout_profile->record(
+					anchor_id, cv::Rect{ anchor_location - cv::Point{ anchor_image.cols, anchor_image.rows } / 2, anchor_image.size() }
+				);
+
+			RUMBLE_LOG_TRACE << "Click confirmed by the anchor " << anchor_id << " after " << polled_frames << " frames";
+			return confirmed();
+		}
+
+		std::this_thread::sleep_for(poll_interval);
+	} while (std::chrono::steady_clock::now() < deadline);
+
+	if (anchor_image.empty())
+	{
+		RUMBLE_LOG_DEBUG << "The needle " << needle_id << " stayed and there is no anchor, the click can't be verified";
+		return ClickOutcome::Unverified;
+	}
+
+	RUMBLE_LOG_DEBUG << "Unable to confirm the click after " << polled_frames << " frames";
+	return ClickOutcome::Unconfirmed;
+}
+
+
+void ClickVerifier::set_budget(const std::chrono::milliseconds budget)
+{
+	this->budget = budget;
+}
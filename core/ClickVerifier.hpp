@@ -0,0 +1,135 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+
+#include <opencv2/opencv.hpp>
+
+#include "../window_capture/FrameSource.hpp"
+#include "../vision/RumbleVision.h"
+#include "NeedleResources.hpp"
+#include "LayoutProfile.hpp"
+
+// What happened with a click that's expected to be confirmed
+enum class ClickOutcome
+{
+	// The needle wasn't on the screen, so nothing was clicked
+	NotFound,
+	// The client reacted to the click
+	Confirmed,
+	// The needle was clicked, but the client never reacted inside the latency budget
+	Unconfirmed,
+	// The needle was clicked and it stayed, with no anchor to watch (ie, a navbar button, or a pick inside the same
+	// screen). Nothing on the frames can tell whether the client reacted, so the click it's trusted but never retried
+	Unverified
+};
+
+/// <summary>
+/// Confirms that a click really reached the League client, by watching the frames that comes after it.
+///
+/// The frames are watched right away, and a poll only searches what changed: the region of the clicked needle, and
+/// the one where the anchor of the expected next screen was seen on this client size, are compared first against the
+/// same regions of the frame of the click. The click it's confirmed when:
+/// - The clicked needle it's gone from where it was, for a few consecutive frames. It's searched with a looser
+///   threshold than the clicked one, so its hover and pressed states (that changes the region as soon as the cursor
+///   gets there, clicked or not) still counts as the needle.
+/// - Or the anchor of the expected next screen (a needle that's only visible there) appears on the frame. The navbar
+///   buttons stays on the screen after the click, so they can only be confirmed this way. An anchor that was already
+///   on the frame of the click doesn't prove anything, so it isn't watched then. Without a known placement, the
+///   anchor it's searched on the whole frame, and its placement it's recorded on the layout profile once it's found.
+///
+/// Gives up when the latency budget runs out, so the caller can retry the click or re-sync its state. Without an
+/// anchor to watch, a needle that stays on the screen after its click can't be told apart from a missed click, so
+/// it isn't watched at all: the click it's unverified right away.
+///
+/// A confirmed click also labels the search of the anchor on the frame of the click: the client was still on the
+/// previous screen there, so its score it's recorded as a miss of the anchor on the needle thresholds.
+/// </summary>
+class ClickVerifier
+{
+	private:
+		// Pause between two consecutive frames, so the client gets the time to repaint
+		static constexpr std::chrono::milliseconds poll_interval{ 4 };
+
+		// Consecutive frames without the needle that confirms the click, so a single bad frame doesn't
+		static constexpr int needle_gone_frames = 2;
+
+		// Without an anchor, the time that the needle gets to go away. Past it, more frames can't tell anything else
+		static constexpr std::chrono::milliseconds needle_only_budget{ 100 };
+
+		// Score under which the clicked needle still counts as there, whatever its learned threshold
+		static constexpr double presence_threshold = 0.15;
+
+		// Pixels of the frame, around the clicked needle and around the placement of the anchor, where they're searched
+		static constexpr int region_padding = 8;
+
+		// Mean difference per pixel and channel (0 - 255) under which a region it's the same than on the frame of the click
+		static constexpr double change_level = 2.0;
+
+		// All of them borrowed from the RumbleLeague that owns the verifier
+		FrameSource* frame_source;
+		RumbleLeagueVision* rumble_vision;
+		// Where the anchors and their thresholds are taken from
+		NeedleResources* needle_resources;
+
+		// Maximum time spent watching the frames of a single click
+		std::chrono::milliseconds budget;
+
+		// The region of a frame (on its scale) around a needle of "client_size" centered at "client_center", clipped to it
+		static cv::Rect frame_rect(const WorkingFrame& frame, const cv::Point& client_center, const cv::Size& client_size);
+
+		// Whether a region of the frame differs from the same one of the reference frame
+		static bool region_changed(const WorkingFrame& frame, const WorkingFrame& reference_frame, const cv::Rect& region);
+
+		// Whether the needle it's still on the frame, inside a region of it
+		bool needle_present(
+			WorkingFrame& frame,
+			const std::string& needle_id,
+			const cv::Mat& needle_image,
+			const cv::Rect& region,
+			const double threshold
+		);
+
+		/**
+		* Whether the anchor it's on a region of the frame, or anywhere on it when the region it's empty. "location"
+		* gets its center, on client coordinates
+		*/
+		bool anchor_present(
+			WorkingFrame& frame,
+			const std::string& anchor_id,
+			const cv::Mat& anchor_image,
+			const cv::Rect& region,
+			const double threshold,
+			cv::Point& location
+		);
+
+	public:
+		ClickVerifier(
+			FrameSource* frame_source,
+			RumbleLeagueVision* rumble_vision,
+			NeedleResources* needle_resources,
+			const std::chrono::milliseconds budget = std::chrono::milliseconds{ 250 }
+		);
+
+		/**
+		* Watches the frames after a click on the needle centered at "click_location" (client coordinates) of the
+		* "reference_frame", where the needle was found, polling the frames on its same working format.
+		* "needle_stays" tells that the needle it's still on the screen after its click (ie, the navbar).
+		* The anchor it's optional, an empty path skips that check. Its placement it's taken from (and recorded on)
+		* the layout profile, that can be null.
+		* Returns Confirmed as soon as the click it's confirmed. When the budget runs out first, Unconfirmed if an anchor
+		* was watched, Unverified otherwise.
+		*/
+		ClickOutcome verify(
+			WorkingFrame& reference_frame,
+			const std::string& needle_id,
+			const cv::Mat& needle_image,
+			const cv::Point& click_location,
+			const bool needle_stays,
+			const std::string& anchor_id,
+			const std::string& anchor_path,
+			LayoutProfile* layout_profile
+		);
+
+		void set_budget(const std::chrono::milliseconds budget);
+};
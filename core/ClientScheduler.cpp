@@ -0,0 +1,215 @@
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+
+#include "ClientScheduler.hpp"
+#include "../logger/RumbleLogger.hpp"
+
+
+ClientScheduler::ClientScheduler(const int language_id, const size_t worker_count)
+	: needle_resources{ new NeedleResources(RumbleLeague::language_from_id(language_id)) },
+	flow_runtime{ new FlowRuntime },
+	running_commands{ 0 },
+	stopping{ false }
+{
+	const size_t workers_to_start = (worker_count != 0)
+		? worker_count
+		: std::max<size_t>(1, std::thread::hardware_concurrency());
+
+	for (size_t i = 0; i < workers_to_start; i++)
+		this->workers.emplace_back(&ClientScheduler::worker_loop, this);
+
+	RUMBLE_LOG_INFO << "Client scheduler started with " << workers_to_start << " workers";
+}
+
+ClientScheduler::~ClientScheduler()
+{
+	{
+		std::lock_guard<std::mutex> lock{ this->scheduler_mutex };
+		this->stopping = true;
+	}
+	this->work_available.notify_all();
+
+	for (std::thread& worker : this->workers)
+		worker.join();
+
+	for (Session* session : this->sessions)
+	{
+		delete session->rumble_league;
+		delete session->owned_frame_source;
+		delete session->owned_input_sink;
+		delete session->owned_input_backend;
+		delete session;
+	}
+
+	// Every session joins its flows on destruction, so the runtime goes after them
+	delete this->flow_runtime;
+
+	this->needle_resources->save_thresholds();
+	delete this->needle_resources;
+}
+
+
+#ifdef _WIN32
+std::vector<ClientScheduler::SessionId> ClientScheduler::attach_windows(const std::string& window_name, const bool autoaccept_behaviour)
+{
+	std::vector<SessionId> session_ids;
+
+	for (const WindowCapture::Window& window : WindowCapture::list_window_names(window_name))
+	{
+		Session* session = new Session{};
+		// The clients overlaps each other: every one renders its own frames, and gets the focus before its input
+		session->owned_frame_source = new WindowCapture(window.hwnd, true);
+		session->owned_input_backend = new Win32InputBackend(window.hwnd);
+		session->owned_input_sink = new InputQueue(session->owned_input_backend);
+
+		// The debug mode opens OpenCV windows, which can't be done from several threads at once
+		session->rumble_league = new RumbleLeague(
+			autoaccept_behaviour, false, session->owned_frame_source, session->owned_input_sink, this->needle_resources
+		);
+
+		session_ids.push_back(this->add_session(session));
+	}
+
+	RUMBLE_LOG_INFO << "Attached " << session_ids.size() << " clients with the window name " << window_name;
+	return session_ids;
+}
+#endif
+
+ClientScheduler::SessionId ClientScheduler::add_session(FrameSource* frame_source, InputSink* input_sink, const bool autoaccept_behaviour)
+{
+	Session* session = new Session{};
+	session->rumble_league = new RumbleLeague(autoaccept_behaviour, false, frame_source, input_sink, this->needle_resources);
+
+	return this->add_session(session);
+}
+
+ClientScheduler::SessionId ClientScheduler::add_session(Session* session)
+{
+	session->rumble_league->set_flow_runtime(this->flow_runtime);
+
+	std::lock_guard<std::mutex> lock{ this->scheduler_mutex };
+	this->sessions.push_back(session);
+	return this->sessions.size() - 1;
+}
+
+
+std::future<std::string> ClientScheduler::submit(const SessionId session_id, const std::string& user_input)
+{
+	// Shared, since the callback has to be copyable
+	auto result = std::make_shared<std::promise<std::string>>();
+	std::future<std::string> future_answer = result->get_future();
+
+	this->submit(session_id, user_input, [result](const CommandResult& command_result) {
+		if (command_result.error)
+			result->set_exception(command_result.error);
+		else
+			result->set_value(command_result.answer);
+	});
+
+	return future_answer;
+}
+
+void ClientScheduler::submit(const SessionId session_id, const std::string& user_input, CommandCallback on_done)
+{
+	std::lock_guard<std::mutex> lock{ this->scheduler_mutex };
+
+	if (session_id >= this->sessions.size())
+		throw std::out_of_range("There is no client session with the id " + std::to_string(session_id));
+
+	Session* session = this->sessions[ session_id ];
+	session->pending_commands.push_back(Command{ user_input, std::move(on_done), std::chrono::steady_clock::now() });
+
+	// An idle session joins the end of the ready line. A scheduled one will get back there after its current command
+	if (!session->scheduled)
+	{
+		session->scheduled = true;
+		this->ready_sessions.push_back(session_id);
+		this->work_available.notify_one();
+	}
+}
+
+std::string ClientScheduler::play(const SessionId session_id, const std::string& user_input)
+{
+	return this->submit(session_id, user_input).get();
+}
+
+
+void ClientScheduler::worker_loop()
+{
+	std::unique_lock<std::mutex> lock{ this->scheduler_mutex };
+
+	while (true)
+	{
+		this->work_available.wait(lock, [this]() { return this->stopping || !this->ready_sessions.empty(); });
+
+		// Stopping, once the submitted commands are done
+		if (this->ready_sessions.empty())
+			return;
+
+		const SessionId session_id = this->ready_sessions.front();
+		this->ready_sessions.pop_front();
+
+		Session* session = this->sessions[ session_id ];
+		Command command = std::move(session->pending_commands.front());
+		session->pending_commands.pop_front();
+		++this->running_commands;
+
+		lock.unlock();
+
+		CommandResult result{};
+		const auto started_at = std::chrono::steady_clock::now();
+		try
+		{
+			result.answer = session->rumble_league->play(command.user_input);
+		}
+		catch (...)
+		{
+			result.error = std::current_exception();
+		}
+		const auto finished_at = std::chrono::steady_clock::now();
+
+		result.queue_time = std::chrono::duration_cast<std::chrono::microseconds>(started_at - command.submitted_at);
+		result.run_time = std::chrono::duration_cast<std::chrono::microseconds>(finished_at - started_at);
+		command.on_done(result);
+
+		lock.lock();
+
+		--this->running_commands;
+
+		// One command per turn. A session with more of them goes back to the end of the line
+		if (!session->pending_commands.empty())
+		{
+			this->ready_sessions.push_back(session_id);
+			this->work_available.notify_one();
+		}
+		else
+			session->scheduled = false;
+
+		if (this->ready_sessions.empty() && this->running_commands == 0)
+			this->idle.notify_all();
+	}
+}
+
+void ClientScheduler::wait_idle()
+{
+	std::unique_lock<std::mutex> lock{ this->scheduler_mutex };
+	this->idle.wait(lock, [this]() { return this->ready_sessions.empty() && this->running_commands == 0; });
+}
+
+
+size_t ClientScheduler::session_count()
+{
+	std::lock_guard<std::mutex> lock{ this->scheduler_mutex };
+	return this->sessions.size();
+}
+
+size_t ClientScheduler::worker_count() const
+{
+	return this->workers.size();
+}
+
+bool ClientScheduler::save_thresholds() const
+{
+	return this->needle_resources->save_thresholds();
+}
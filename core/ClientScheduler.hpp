@@ -0,0 +1,138 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "RumbleLeague.hpp"
+#include "NeedleResources.hpp"
+
+/// <summary>
+/// Drives several League clients from a single process.
+///
+/// Every client it's a session: a RumbleLeague bound to its own window (frame source) and input sink. All the
+/// sessions shares the needle resources of the language (buttons, needle images, compiled patches and learned
+/// thresholds), and a single pool of worker threads runs their commands.
+///
+/// The commands of a session runs one at a time and in order, since a client can only be on one screen. Between
+/// sessions the scheduling it's round robin: a worker runs one command of a session and sends it back to the end
+/// of the line, so a session with a long script can't starve the rest. Throughput scales with the cores, not with
+/// the number of processes.
+/// </summary>
+class ClientScheduler
+{
+	public:
+		using SessionId = size_t;
+
+		// What a command produced, and where it spent its time
+		struct CommandResult
+		{
+			std::string answer;
+			// Set instead of the answer when the command threw
+			std::exception_ptr error;
+			// From the submission until a worker took it
+			std::chrono::microseconds queue_time;
+			// Running on the worker
+			std::chrono::microseconds run_time;
+		};
+
+		// Called on the worker thread once the command it's done, so it must be short and can't block on the scheduler
+		using CommandCallback = std::function<void(const CommandResult&)>;
+
+	private:
+		struct Command
+		{
+			std::string user_input;
+			CommandCallback on_done;
+			std::chrono::steady_clock::time_point submitted_at;
+		};
+
+		struct Session
+		{
+			RumbleLeague* rumble_league;
+
+			// The devices created by the scheduler for the session. Null when they're borrowed from the caller
+			FrameSource* owned_frame_source;
+			InputSink* owned_input_sink;
+			InputBackend* owned_input_backend;
+
+			// Commands waiting their turn, in order
+			std::deque<Command> pending_commands;
+
+			// True while the session waits on the ready line or one of its commands it's running
+			bool scheduled;
+		};
+
+		// Shared by every session. Owned by the scheduler
+		NeedleResources* needle_resources;
+
+		// A single thread runs the flows of every session (ie, their auto accepts). Owned by the scheduler
+		FlowRuntime* flow_runtime;
+
+		// Never shrinks, so a session id it's just its index. Guarded by the scheduler mutex
+		std::vector<Session*> sessions;
+
+		// Sessions with pending commands, in the order that they'll get a worker
+		std::deque<SessionId> ready_sessions;
+
+		size_t running_commands;
+		bool stopping;
+
+		std::mutex scheduler_mutex;
+		std::condition_variable work_available;
+		std::condition_variable idle;
+
+		std::vector<std::thread> workers;
+
+		void worker_loop();
+
+		SessionId add_session(Session* session);
+
+	public:
+		// Zero workers means one per hardware thread
+		ClientScheduler(const int language_id, const size_t worker_count = 0);
+
+		// Finishes the commands already submitted, stops the workers and saves the learned thresholds
+		~ClientScheduler();
+
+		ClientScheduler(const ClientScheduler&) = delete;
+		ClientScheduler& operator=(const ClientScheduler&) = delete;
+
+#ifdef _WIN32
+		/**
+		* Creates a session for every open window with that title. Every window renders its own frames (PrintWindow),
+		* so they're captured even when another one covers them. The input of all of them shares the desktop: every
+		* batch brings its window to the foreground first, and the batches of different sessions goes one at a time.
+		*/
+		std::vector<SessionId> attach_windows(const std::string& window_name = "League of Legends", const bool autoaccept_behaviour = false);
+#endif
+
+		// Adds a session over any frame source and input sink. Both are borrowed, so the caller keeps the ownership
+		SessionId add_session(FrameSource* frame_source, InputSink* input_sink, const bool autoaccept_behaviour = false);
+
+		// Queues a command for a session. The future receives the answer of RumbleLeague::play
+		std::future<std::string> submit(const SessionId session_id, const std::string& user_input);
+
+		// Same as above, but the result (and its timings) it's handed to a callback instead of a future
+		void submit(const SessionId session_id, const std::string& user_input, CommandCallback on_done);
+
+		// Submits a command and waits for its answer
+		std::string play(const SessionId session_id, const std::string& user_input);
+
+		// Blocks until every submitted command has run
+		void wait_idle();
+
+		size_t session_count();
+		size_t worker_count() const;
+
+		// Persists the thresholds learned by all the sessions
+		bool save_thresholds() const;
+};
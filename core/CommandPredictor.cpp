@@ -0,0 +1,67 @@
+#include <algorithm>
+#include <utility>
+
+#include "CommandPredictor.hpp"
+#include "../data/API_buttons.hpp"
+
+
+CommandPredictor::CommandPredictor(const std::vector<ClientButton*>& client_buttons)
+	: client_buttons{ client_buttons } {}
+
+
+void CommandPredictor::record(const LeagueClientScreenIdentifier screen, const ClientButton* client_button)
+{
+	++this->transitions[ screen ][ client_button ];
+}
+
+std::vector<const ClientButton*> CommandPredictor::predict(const LeagueClientScreenIdentifier screen, const size_t count) const
+{
+	const auto screen_transitions = this->transitions.find(screen);
+
+	std::vector<std::pair<double, const ClientButton*>> ranked;
+	for (const ClientButton* client_button : this->client_buttons)
+	{
+		double score = this->prior(screen, client_button);
+		if (screen_transitions != this->transitions.end())
+		{
+			const auto observed = screen_transitions->second.find(client_button);
+			if (observed != screen_transitions->second.end())
+				score += observed->second;
+		}
+
+		if (score > 0.0)
+			ranked.emplace_back(score, client_button);
+	}
+
+	// Stable, so the ties keeps the order of the buttons on the API
+	std::stable_sort(ranked.begin(), ranked.end(), [](const auto& lhs, const auto& rhs) { return lhs.first > rhs.first; });
+
+	std::vector<const ClientButton*> predicted;
+	for (size_t i = 0; i < ranked.size() && predicted.size() < count; i++)
+	{
+		// Several identifiers can share a needle (ie, "tft" on the navbar and on the game modes). Searched once
+		const bool repeated = std::any_of(predicted.begin(), predicted.end(), [&](const ClientButton* client_button) {
+			return client_button->image_name == ranked[ i ].second->image_name;
+		});
+		if (!repeated)
+			predicted.push_back(ranked[ i ].second);
+	}
+
+	return predicted;
+}
+
+double CommandPredictor::prior(const LeagueClientScreenIdentifier screen, const ClientButton* client_button) const
+{
+	const char* anchor = RLE_data::screen_anchor(screen);
+	if (anchor != nullptr && client_button->image_name == anchor)
+		return CommandPredictor::anchor_prior;
+
+	// The queue has no anchor (the client waits there, it doesn't move forward), but after find comes accept
+	if (screen == LeagueClientScreenIdentifier::AcceptDecline && client_button->image_name == "accept_match")
+		return CommandPredictor::anchor_prior;
+
+	if (screen == LeagueClientScreenIdentifier::ChooseGame && client_button->lobby != LeagueClientScreenIdentifier::NoLobby)
+		return CommandPredictor::game_mode_prior;
+
+	return 0.0;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include "league_client/LeagueClientButton.hpp"
+#include "../helpers/EnumTypes.hpp"
+
+/// <summary>
+/// Ranks the buttons that the next command will most likely press, from the screen where the client is.
+///
+/// The screen graph already tells a lot: the anchor of a screen it's the button that moves forward from it
+/// ("go" on the game modes, "find" on the lobbies, "lock" on the champ select), the accept follows the find of the
+/// queue, and the game modes follows the play button. Over that prior, every command pressed from a screen it's counted, so the habits of the user
+/// (ie, always the same game mode) goes first after a few commands.
+/// </summary>
+class CommandPredictor
+{
+	private:
+		// The prior of a button, in commands. The observed ones takes over after a couple of them
+		static constexpr double anchor_prior = 1.0;
+		static constexpr double game_mode_prior = 0.5;
+
+		// Borrowed from the screen. Their pointers identifies the buttons on the counts
+		std::vector<ClientButton*> client_buttons;
+
+		// Commands pressed from every screen
+		std::map<LeagueClientScreenIdentifier, std::map<const ClientButton*, uint32_t>> transitions;
+
+		double prior(const LeagueClientScreenIdentifier screen, const ClientButton* client_button) const;
+
+	public:
+		CommandPredictor(const std::vector<ClientButton*>& client_buttons);
+
+		// Counts a command pressed from a screen
+		void record(const LeagueClientScreenIdentifier screen, const ClientButton* client_button);
+
+		// Up to "count" buttons, the most likely first. Only the ones with a prior or an observed command
+		std::vector<const ClientButton*> predict(const LeagueClientScreenIdentifier screen, const size_t count) const;
+};
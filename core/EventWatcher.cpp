@@ -0,0 +1,220 @@
+#include <algorithm>
+#include <exception>
+
+#include "EventWatcher.hpp"
+#include "league_client/LeagueClientButton.hpp"
+#include "../logger/RumbleLogger.hpp"
+#include "../tracing/RumbleTrace.hpp"
+
+
+EventWatcher::EventWatcher(FrameSource* frame_source, NeedleResources* needle_resources, const WorkingFormat& working_format)
+	: frame_source{ frame_source },
+	needle_resources{ needle_resources },
+	rumble_vision{ working_format.channel_mode, needle_resources->get_match_method(), working_format.downscale },
+	next_subscription_id{ 1 },
+	stopping{ false },
+	subscriptions_changed{ false }
+{
+	this->rumble_vision.set_matcher_registry(needle_resources->get_matcher_registry());
+	this->rumble_vision.set_match_cache(needle_resources->get_match_cache());
+	this->rumble_vision.set_needle_thresholds(needle_resources->get_needle_thresholds());
+}
+
+EventWatcher::~EventWatcher()
+{
+	{
+		std::lock_guard<std::mutex> lock{ this->watcher_mutex };
+		this->stopping = true;
+	}
+	this->watcher_wakeup.notify_all();
+
+	if (this->watcher_thread.joinable())
+		this->watcher_thread.join();
+}
+
+
+EventWatcher::SubscriptionId EventWatcher::subscribe(const std::string& needle_id, EventCallback callback, const SubscriptionOptions& options)
+{
+	const std::string needle_path = ClientButton::assets_directory(this->needle_resources->get_language()) + "/" + needle_id + ".jpg";
+	const cv::Mat needle_image = this->needle_resources->get_needle(needle_id, needle_path, this->rumble_vision.get_channel_mode());
+	if (needle_image.empty())
+	{
+		RUMBLE_LOG_WARNING << "Unable to watch " << needle_id << ", there is no such needle";
+		return 0;
+	}
+
+	auto subscription = std::make_shared<Subscription>();
+	subscription->needle_id = needle_id;
+	subscription->needle_image = needle_image;
+	subscription->options = options;
+	subscription->callback = std::move(callback);
+	subscription->next_poll = std::chrono::steady_clock::now();
+	subscription->visible = false;
+
+	{
+		std::lock_guard<std::mutex> lock{ this->watcher_mutex };
+		subscription->id = this->next_subscription_id++;
+		this->subscriptions.emplace(subscription->id, subscription);
+		this->subscriptions_changed = true;
+
+		if (!this->watcher_thread.joinable())
+			this->watcher_thread = std::thread{ &EventWatcher::watch_loop, this };
+	}
+	this->watcher_wakeup.notify_all();
+
+	RUMBLE_LOG_DEBUG << "Watching " << needle_id << " every " << options.polling_interval.count() << "ms";
+	return subscription->id;
+}
+
+EventWatcher::SubscriptionId EventWatcher::subscribe(const std::string& needle_id, EventCallback callback)
+{
+	return this->subscribe(needle_id, std::move(callback), SubscriptionOptions{});
+}
+
+bool EventWatcher::unsubscribe(const SubscriptionId subscription_id)
+{
+	std::shared_ptr<Subscription> removed;
+	{
+		std::lock_guard<std::mutex> lock{ this->watcher_mutex };
+		const auto subscription = this->subscriptions.find(subscription_id);
+		if (subscription == this->subscriptions.end())
+			return false;
+
+		removed = std::move(subscription->second);
+		this->subscriptions.erase(subscription);
+	}
+
+	// The callback (maybe a Python one) it's released out of the lock
+	return true;
+}
+
+size_t EventWatcher::subscription_count()
+{
+	std::lock_guard<std::mutex> lock{ this->watcher_mutex };
+	return this->subscriptions.size();
+}
+
+
+void EventWatcher::watch_loop()
+{
+	std::unique_lock<std::mutex> lock{ this->watcher_mutex };
+
+	while (!this->stopping)
+	{
+		if (this->subscriptions.empty())
+		{
+			this->watcher_wakeup.wait(lock, [this]() { return this->stopping || !this->subscriptions.empty(); });
+			continue;
+		}
+
+		auto next_poll = std::chrono::steady_clock::time_point::max();
+		for (const auto& [id, subscription] : this->subscriptions)
+			next_poll = std::min(next_poll, subscription->next_poll);
+
+		this->subscriptions_changed = false;
+		if (this->watcher_wakeup.wait_until(lock, next_poll, [this]() { return this->stopping || this->subscriptions_changed; }))
+			continue;
+
+		// The subscriptions due now. Shared, so an unsubscribe from other thread can't release them while they're polled
+		const auto now = std::chrono::steady_clock::now();
+		std::vector<std::shared_ptr<Subscription>> due;
+		for (const auto& [id, subscription] : this->subscriptions)
+			if (subscription->next_poll <= now)
+			{
+				due.push_back(subscription);
+				subscription->next_poll = now + subscription->options.polling_interval;
+			}
+
+		lock.unlock();
+
+		std::vector<std::pair<std::shared_ptr<Subscription>, Event>> events;
+		{
+			RUMBLE_TRACE_SCOPE("event_watcher_poll");
+
+			// One capture for all of them
+			WorkingFrame frame;
+			this->frame_source->get_working_frame(this->rumble_vision.get_working_format(), frame);
+			const auto captured_at = std::chrono::steady_clock::now();
+
+			for (const auto& subscription : due)
+			{
+				Event event{};
+				if (!frame.image.empty() && this->poll(*subscription, frame, event))
+				{
+					event.captured_at = captured_at;
+					events.emplace_back(subscription, std::move(event));
+				}
+			}
+		}
+
+		for (auto& [subscription, event] : events)
+		{
+			// Unsubscribed while it was being polled
+			{
+				std::lock_guard<std::mutex> subscriptions_lock{ this->watcher_mutex };
+				if (this->subscriptions.find(subscription->id) == this->subscriptions.end())
+					continue;
+			}
+
+			try
+			{
+				subscription->callback(event);
+			}
+			catch (const std::exception& error)
+			{
+				RUMBLE_LOG_ERROR << "The callback of " << subscription->needle_id << " failed: " << error.what();
+			}
+
+			if (subscription->options.once)
+				this->unsubscribe(subscription->id);
+		}
+
+		// The last references of the removed subscriptions are dropped here, still out of the lock
+		events.clear();
+		due.clear();
+
+		lock.lock();
+	}
+}
+
+bool EventWatcher::poll(Subscription& subscription, WorkingFrame& frame, Event& event)
+{
+	const int scale = frame.downscale;
+	const cv::Rect frame_bounds{ 0, 0, frame.image.cols, frame.image.rows };
+
+	// The region on the scale of the frame
+	cv::Rect region = frame_bounds;
+	if (!subscription.options.region.empty())
+	{
+		const cv::Rect& client_region = subscription.options.region;
+		region = cv::Rect{ client_region.x / scale, client_region.y / scale, client_region.width / scale, client_region.height / scale } & frame_bounds;
+	}
+
+	// A region smaller than the needle can't contain it
+	if (region.width < subscription.needle_image.cols / scale || region.height < subscription.needle_image.rows / scale)
+		return false;
+
+	WorkingFrame region_frame = frame_region(frame, region);
+	const std::string threshold_id = subscription.needle_id + this->rumble_vision.get_format_tag();
+	NeedleThresholds* needle_thresholds = this->needle_resources->get_needle_thresholds();
+
+	const cv::Point location = this->rumble_vision.find(
+		region_frame, subscription.needle_id, subscription.needle_image,
+		this->needle_resources->get_compiled_needles()->get(subscription.needle_id), needle_thresholds->get(threshold_id)
+	);
+	// The polls aren't labelled (a miss can be a screen in the middle of an animation), so they don't teach the thresholds
+
+	const bool visible = location != cv::Point{ 0, 0 };
+	const bool appeared = visible && !subscription.visible;
+	subscription.visible = visible;
+
+	if (!appeared)
+		return false;
+
+	event.subscription_id = subscription.id;
+	event.needle_id = subscription.needle_id;
+	event.client_location = location + region.tl() * scale;
+	event.screen_location = this->frame_source->client_to_screen(event.client_location);
+	event.score = this->rumble_vision.get_last_score();
+	return true;
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "NeedleResources.hpp"
+#include "../vision/RumbleVision.h"
+#include "../window_capture/FrameSource.hpp"
+
+/// <summary>
+/// Watches the client on a background thread and notifies the moment that a needle appears on the screen.
+///
+/// Every subscription it's a needle, with its own polling interval and, optionally, the region of the client where
+/// it's expected (ie, the accept button, or the timer of the champ select). The subscriptions due at the same time
+/// share one capture, converted to a cheap working format (gray at half scale by default), and only their regions
+/// are matched. Between the polls, the thread sleeps.
+///
+/// The events are edge triggered: a subscription fires once when its needle appears, and it's armed again when
+/// the needle goes away. The callbacks runs on the watcher thread, so they must be short. A subscription can't be
+/// removed from its own callback, but it can be created with "once" to be removed after firing.
+/// </summary>
+class EventWatcher
+{
+	public:
+		using SubscriptionId = uint64_t;
+
+		struct Event
+		{
+			SubscriptionId subscription_id;
+			std::string needle_id;
+			// Center of the needle, on client coordinates and on the screen ones (where a click must be injected)
+			cv::Point client_location;
+			cv::Point screen_location;
+			double score;
+			// When the frame where the needle appeared was captured
+			std::chrono::steady_clock::time_point captured_at;
+		};
+
+		using EventCallback = std::function<void(const Event&)>;
+
+		struct SubscriptionOptions
+		{
+			std::chrono::milliseconds polling_interval{ 50 };
+			// On client coordinates. Empty means the whole client
+			cv::Rect region;
+			// Removes the subscription after its first event
+			bool once = false;
+		};
+
+	private:
+		struct Subscription
+		{
+			SubscriptionId id;
+			std::string needle_id;
+			cv::Mat needle_image;
+			SubscriptionOptions options;
+			EventCallback callback;
+
+			std::chrono::steady_clock::time_point next_poll;
+			// The needle was on the last polled frame. Keeps it from firing on every poll while it's visible
+			bool visible;
+		};
+
+		// Borrowed. The frame source must be safe to be shared with the thread that runs the commands
+		FrameSource* frame_source;
+		NeedleResources* needle_resources;
+
+		// Its own engine, since the engines keeps the score of their last search
+		RumbleLeagueVision rumble_vision;
+
+		std::map<SubscriptionId, std::shared_ptr<Subscription>> subscriptions;
+		SubscriptionId next_subscription_id;
+
+		bool stopping;
+		// Wakes the watcher up before its next poll, so a new subscription it's polled right away
+		bool subscriptions_changed;
+
+		std::mutex watcher_mutex;
+		std::condition_variable watcher_wakeup;
+		std::thread watcher_thread;
+
+		void watch_loop();
+
+		// Searches the needle of a subscription on its region of the frame. Fills the event if it's there
+		bool poll(Subscription& subscription, WorkingFrame& frame, Event& event);
+
+	public:
+		EventWatcher(
+			FrameSource* frame_source,
+			NeedleResources* needle_resources,
+			const WorkingFormat& working_format = WorkingFormat{ ChannelMode::Gray, 2, false }
+		);
+
+		// Stops the thread. Waits for the callback that's running, if any
+		~EventWatcher();
+
+		EventWatcher(const EventWatcher&) = delete;
+		EventWatcher& operator=(const EventWatcher&) = delete;
+
+		/**
+		* Watches a needle of the assets of the language. Returns the id of the subscription, or zero if the needle
+		* doesn't exist. The watcher thread starts with the first subscription
+		*/
+		SubscriptionId subscribe(const std::string& needle_id, EventCallback callback, const SubscriptionOptions& options);
+		SubscriptionId subscribe(const std::string& needle_id, EventCallback callback);
+
+		// Returns false if there is no such subscription (ie, a "once" one that already fired)
+		bool unsubscribe(const SubscriptionId subscription_id);
+
+		size_t subscription_count();
+};
@@ -0,0 +1,307 @@
+#include "FlowRuntime.hpp"
+#include "../logger/RumbleLogger.hpp"
+#include "../tracing/RumbleTrace.hpp"
+
+
+void FlowRuntime::Flow::promise_type::unhandled_exception()
+{
+	this->error = std::current_exception();
+	if (this->continuation)
+		return;
+
+	try
+	{
+		std::rethrow_exception(this->error);
+	}
+	catch (const std::exception& exception)
+	{
+		RUMBLE_LOG_ERROR << "The flow " << this->flow_state->name << " failed: " << exception.what();
+	}
+	catch (...)
+	{
+		RUMBLE_LOG_ERROR << "The flow " << this->flow_state->name << " failed";
+	}
+}
+
+
+FlowRuntime::SleepAwaiter::SleepAwaiter(FlowRuntime* runtime, const std::chrono::milliseconds duration)
+	: runtime{ runtime }, duration{ duration } {}
+
+bool FlowRuntime::SleepAwaiter::await_suspend(std::coroutine_handle<Flow::promise_type> handle)
+{
+	FlowState* flow_state = handle.promise().flow_state;
+	this->wait = std::make_shared<Wait>();
+	this->wait->flow_state = flow_state;
+	this->wait->handle = handle;
+
+	const auto deadline = std::chrono::steady_clock::now() + this->duration;
+	return this->runtime->suspend(flow_state, this->wait, &deadline);
+}
+
+bool FlowRuntime::SleepAwaiter::await_resume()
+{
+	return !this->runtime->is_cancelled(this->wait->flow_state);
+}
+
+
+FlowRuntime::AppearAwaiter::AppearAwaiter(
+	FlowRuntime* runtime,
+	EventWatcher* event_watcher,
+	const std::string& needle_id,
+	const EventWatcher::SubscriptionOptions& options,
+	const std::chrono::milliseconds timeout
+)
+	: runtime{ runtime },
+	event_watcher{ event_watcher },
+	needle_id{ needle_id },
+	options{ options },
+	timeout{ timeout },
+	subscription_id{ 0 } {}
+
+bool FlowRuntime::AppearAwaiter::await_suspend(std::coroutine_handle<Flow::promise_type> handle)
+{
+	FlowState* flow_state = handle.promise().flow_state;
+	this->wait = std::make_shared<Wait>();
+	this->wait->flow_state = flow_state;
+	this->wait->handle = handle;
+
+	const auto deadline = std::chrono::steady_clock::now() + this->timeout;
+	if (!this->runtime->suspend(flow_state, this->wait, (this->timeout > std::chrono::milliseconds::zero()) ? &deadline : nullptr))
+		return false;
+
+	// The callback runs on the watcher thread. The wait it's weak there, since the flow can be gone by then
+	FlowRuntime* runtime = this->runtime;
+	const std::weak_ptr<Wait> weak_wait = this->wait;
+	EventWatcher::SubscriptionOptions once_options = this->options;
+	once_options.once = true;
+
+	this->subscription_id = this->event_watcher->subscribe(this->needle_id, [runtime, weak_wait](const EventWatcher::Event& event) {
+		if (const std::shared_ptr<Wait> wait = weak_wait.lock())
+			runtime->complete(wait, event);
+	}, once_options);
+
+	// No such needle. Nothing would ever resume the flow
+	if (this->subscription_id == 0)
+		this->runtime->complete(this->wait, std::nullopt);
+
+	return true;
+}
+
+std::optional<EventWatcher::Event> FlowRuntime::AppearAwaiter::await_resume()
+{
+	// Resumed by the timeout or by the cancellation, so the subscription it's still there
+	if (this->subscription_id != 0 && !this->wait->event)
+		this->event_watcher->unsubscribe(this->subscription_id);
+
+	if (this->runtime->is_cancelled(this->wait->flow_state))
+		return std::nullopt;
+	return this->wait->event;
+}
+
+
+FlowRuntime::FlowRuntime()
+	: next_flow_id{ 1 },
+	stopping{ false },
+	runtime_changed{ false } {}
+
+FlowRuntime::~FlowRuntime()
+{
+	{
+		std::lock_guard<std::mutex> lock{ this->runtime_mutex };
+		this->stopping = true;
+	}
+	this->runtime_wakeup.notify_all();
+
+	if (this->runtime_thread.joinable())
+		this->runtime_thread.join();
+
+	// Destroying a suspended coroutine releases its locals, awaiters included. Their waits are only weak anywhere else
+	for (auto& [id, flow_state] : this->flows)
+	{
+		RUMBLE_LOG_DEBUG << "Destroying the unfinished flow " << flow_state->name;
+		flow_state->root.destroy();
+	}
+}
+
+
+FlowRuntime::FlowId FlowRuntime::spawn(Flow flow, const std::string& name)
+{
+	std::coroutine_handle<Flow::promise_type> handle = flow.handle;
+	flow.handle = nullptr;
+
+	FlowId flow_id;
+	{
+		std::lock_guard<std::mutex> lock{ this->runtime_mutex };
+
+		flow_id = this->next_flow_id++;
+		std::unique_ptr<FlowState> flow_state{ new FlowState{ flow_id, name, handle } };
+		handle.promise().runtime = this;
+		handle.promise().flow_state = flow_state.get();
+
+		this->ready.push_back(Ready{ flow_state.get(), handle });
+		this->flows.emplace(flow_id, std::move(flow_state));
+		this->runtime_changed = true;
+
+		if (!this->runtime_thread.joinable())
+			this->runtime_thread = std::thread{ &FlowRuntime::run_loop, this };
+	}
+	this->runtime_wakeup.notify_all();
+
+	RUMBLE_LOG_DEBUG << "Started the flow " << name;
+	return flow_id;
+}
+
+bool FlowRuntime::cancel(const FlowId flow_id)
+{
+	{
+		std::lock_guard<std::mutex> lock{ this->runtime_mutex };
+		const auto flow = this->flows.find(flow_id);
+		if (flow == this->flows.end())
+			return false;
+
+		FlowState* flow_state = flow->second.get();
+		flow_state->cancelled = true;
+		if (flow_state->wait != nullptr)
+			this->resume_locked(*flow_state->wait);
+	}
+
+	return true;
+}
+
+void FlowRuntime::join(const FlowId flow_id)
+{
+	if (std::this_thread::get_id() == this->runtime_thread.get_id())
+	{
+		RUMBLE_LOG_ERROR << "A flow can't join another one, it'd wait for its own thread";
+		return;
+	}
+
+	std::unique_lock<std::mutex> lock{ this->runtime_mutex };
+	this->flow_finished.wait(lock, [this, flow_id]() { return this->flows.count(flow_id) == 0; });
+}
+
+size_t FlowRuntime::flow_count()
+{
+	std::lock_guard<std::mutex> lock{ this->runtime_mutex };
+	return this->flows.size();
+}
+
+
+FlowRuntime::SleepAwaiter FlowRuntime::sleep_for(const std::chrono::milliseconds duration)
+{
+	return SleepAwaiter{ this, duration };
+}
+
+FlowRuntime::AppearAwaiter FlowRuntime::appear(
+	EventWatcher* event_watcher,
+	const std::string& needle_id,
+	const EventWatcher::SubscriptionOptions& options,
+	const std::chrono::milliseconds timeout
+) {
+	return AppearAwaiter{ this, event_watcher, needle_id, options, timeout };
+}
+
+
+bool FlowRuntime::suspend(FlowState* flow_state, const std::shared_ptr<Wait>& wait, const std::chrono::steady_clock::time_point* deadline)
+{
+	std::lock_guard<std::mutex> lock{ this->runtime_mutex };
+	if (flow_state->cancelled)
+		return false;
+
+	flow_state->wait = wait;
+	if (deadline != nullptr)
+	{
+		this->timers.emplace(*deadline, wait);
+		this->runtime_changed = true;
+	}
+	return true;
+}
+
+void FlowRuntime::complete(const std::shared_ptr<Wait>& wait, const std::optional<EventWatcher::Event>& event)
+{
+	{
+		std::lock_guard<std::mutex> lock{ this->runtime_mutex };
+		if (wait->resumed)
+			return;
+
+		wait->event = event;
+		this->resume_locked(*wait);
+	}
+	this->runtime_wakeup.notify_all();
+}
+
+void FlowRuntime::resume_locked(Wait& wait)
+{
+	if (wait.resumed)
+		return;
+
+	wait.resumed = true;
+	this->ready.push_back(Ready{ wait.flow_state, wait.handle });
+	this->runtime_changed = true;
+	this->runtime_wakeup.notify_all();
+
+	// Last, since the wait can be the one of the flow state (the awaiter still owns it, though)
+	wait.flow_state->wait.reset();
+}
+
+bool FlowRuntime::is_cancelled(const FlowState* flow_state)
+{
+	std::lock_guard<std::mutex> lock{ this->runtime_mutex };
+	return flow_state->cancelled;
+}
+
+
+void FlowRuntime::run_loop()
+{
+	std::unique_lock<std::mutex> lock{ this->runtime_mutex };
+
+	while (!this->stopping)
+	{
+		// The timers that are due, and the ones whose wait was already resumed by other means
+		const auto now = std::chrono::steady_clock::now();
+		while (!this->timers.empty() && this->timers.begin()->first <= now)
+		{
+			const std::shared_ptr<Wait> wait = this->timers.begin()->second.lock();
+			this->timers.erase(this->timers.begin());
+			if (wait != nullptr)
+				this->resume_locked(*wait);
+		}
+
+		if (this->ready.empty())
+		{
+			// Nothing to run until the next deadline, or until an event or a new flow arrives
+			this->runtime_changed = false;
+			const auto woken = [this]() { return this->stopping || this->runtime_changed; };
+			if (this->timers.empty())
+				this->runtime_wakeup.wait(lock, woken);
+			else
+				this->runtime_wakeup.wait_until(lock, this->timers.begin()->first, woken);
+			continue;
+		}
+
+		const Ready next = this->ready.front();
+		this->ready.pop_front();
+		lock.unlock();
+
+		// Runs until the flow waits again, or finishes
+		{
+			RUMBLE_TRACE_SCOPE("flow_step");
+			next.handle.resume();
+		}
+
+		lock.lock();
+		FlowState* flow_state = next.flow_state;
+		if (!flow_state->root.done())
+			continue;
+
+		const std::coroutine_handle<> root = flow_state->root;
+		RUMBLE_LOG_DEBUG << "The flow " << flow_state->name << " finished";
+		this->flows.erase(flow_state->id);
+
+		lock.unlock();
+		root.destroy();
+		lock.lock();
+
+		this->flow_finished.notify_all();
+	}
+}
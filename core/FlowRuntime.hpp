@@ -0,0 +1,267 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+
+#include "EventWatcher.hpp"
+
+/// <summary>
+/// Runs the multi step scripts of the clients (ie, find a match, accept it, wait for the champ select, search the
+/// champion and lock it in) as C++20 coroutines, all of them on a single thread.
+///
+/// A flow it's a coroutine that returns FlowRuntime::Flow and awaits the runtime: the appearance of a needle on a
+/// client (a once subscription of its EventWatcher), a timer, or another flow. While a flow waits, nothing runs for
+/// it: the watcher polls at its own interval and the runtime thread sleeps until the next resume or timer, so any
+/// number of flows, over any number of clients, costs a single thread. The flows must not block it, so the clicks
+/// and the typing goes through the input sinks, that only enqueue them.
+///
+/// The cancellation it's cooperative. A cancelled flow it's resumed right away from its wait (or at its next one),
+/// the wait gives back its "nothing happened" value (false, or an empty event) and the flow it's expected to return.
+/// </summary>
+class FlowRuntime
+{
+	public:
+		using FlowId = uint64_t;
+
+	private:
+		struct FlowState;
+
+		// A suspension of a flow. Resumed once: by its event, by its timer or by the cancellation of its flow
+		struct Wait
+		{
+			FlowState* flow_state;
+			std::coroutine_handle<> handle;
+			bool resumed = false;
+			std::optional<EventWatcher::Event> event;
+		};
+
+		struct FlowState
+		{
+			FlowId id;
+			std::string name;
+			// The outermost coroutine of the flow. The runtime destroys it once it's done
+			std::coroutine_handle<> root;
+			bool cancelled = false;
+			// What the flow it's waiting for. Null while it's running or ready to run
+			std::shared_ptr<Wait> wait;
+		};
+
+		struct Ready
+		{
+			FlowState* flow_state;
+			std::coroutine_handle<> handle;
+		};
+
+	public:
+		class Flow
+		{
+			public:
+				struct promise_type;
+
+			private:
+				std::coroutine_handle<promise_type> handle;
+
+				friend class FlowRuntime;
+
+			public:
+				struct promise_type
+				{
+					// Set when the flow it's spawned, or inherited from the flow that awaits it
+					FlowRuntime* runtime = nullptr;
+					FlowState* flow_state = nullptr;
+
+					// The flow that awaits this one, resumed when it finishes. Null for the outermost one
+					std::coroutine_handle<> continuation;
+					std::exception_ptr error;
+
+					struct FinalAwaiter
+					{
+						bool await_ready() noexcept { return false; }
+
+						// Straight back to the awaiting flow, without going through the ready line
+						std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> handle) noexcept
+						{
+							const std::coroutine_handle<> continuation = handle.promise().continuation;
+							return continuation ? continuation : std::noop_coroutine();
+						}
+
+						void await_resume() noexcept {}
+					};
+
+					Flow get_return_object()
+					{
+						return Flow{ std::coroutine_handle<promise_type>::from_promise(*this) };
+					}
+
+					// Nothing runs until the flow it's spawned (or awaited)
+					std::suspend_always initial_suspend() noexcept { return {}; }
+					FinalAwaiter final_suspend() noexcept { return {}; }
+					void return_void() {}
+
+					// Rethrown on the awaiting flow. The outermost one logs it
+					void unhandled_exception();
+				};
+
+				// Awaits a flow from another one. The awaited flow shares the state (and the cancellation) of its parent
+				struct Awaiter
+				{
+					std::coroutine_handle<promise_type> child;
+
+					bool await_ready() noexcept { return !this->child || this->child.done(); }
+
+					std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> parent) noexcept
+					{
+						this->child.promise().runtime = parent.promise().runtime;
+						this->child.promise().flow_state = parent.promise().flow_state;
+						this->child.promise().continuation = parent;
+						return this->child;
+					}
+
+					void await_resume()
+					{
+						if (this->child.promise().error)
+							std::rethrow_exception(this->child.promise().error);
+					}
+				};
+
+				explicit Flow(std::coroutine_handle<promise_type> handle) : handle{ handle } {}
+				~Flow()
+				{
+					if (this->handle)
+						this->handle.destroy();
+				}
+
+				Flow(const Flow&) = delete;
+				Flow& operator=(const Flow&) = delete;
+
+				Flow(Flow&& source) noexcept : handle{ source.handle }
+				{
+					source.handle = nullptr;
+				}
+
+				Awaiter operator co_await() && noexcept
+				{
+					return Awaiter{ this->handle };
+				}
+		};
+
+		// Resumes after a time. Gives back false if the flow was cancelled meanwhile
+		class SleepAwaiter
+		{
+			private:
+				FlowRuntime* runtime;
+				std::chrono::milliseconds duration;
+				std::shared_ptr<Wait> wait;
+
+			public:
+				SleepAwaiter(FlowRuntime* runtime, const std::chrono::milliseconds duration);
+
+				bool await_ready() const noexcept { return false; }
+				bool await_suspend(std::coroutine_handle<Flow::promise_type> handle);
+				bool await_resume();
+		};
+
+		/**
+		* Resumes when a needle appears on a client, with its event. Gives back an empty event if the timeout (when
+		* it isn't zero) passed first, if the needle doesn't exist, or if the flow was cancelled meanwhile
+		*/
+		class AppearAwaiter
+		{
+			private:
+				FlowRuntime* runtime;
+				EventWatcher* event_watcher;
+				std::string needle_id;
+				EventWatcher::SubscriptionOptions options;
+				std::chrono::milliseconds timeout;
+
+				std::shared_ptr<Wait> wait;
+				EventWatcher::SubscriptionId subscription_id;
+
+			public:
+				AppearAwaiter(
+					FlowRuntime* runtime,
+					EventWatcher* event_watcher,
+					const std::string& needle_id,
+					const EventWatcher::SubscriptionOptions& options,
+					const std::chrono::milliseconds timeout
+				);
+
+				bool await_ready() const noexcept { return false; }
+				bool await_suspend(std::coroutine_handle<Flow::promise_type> handle);
+				std::optional<EventWatcher::Event> await_resume();
+		};
+
+	private:
+		std::map<FlowId, std::unique_ptr<FlowState>> flows;
+		FlowId next_flow_id;
+
+		std::deque<Ready> ready;
+
+		// Deadlines of the waits, by time. A wait resumed by other means it's just skipped when its deadline comes
+		std::multimap<std::chrono::steady_clock::time_point, std::weak_ptr<Wait>> timers;
+
+		bool stopping;
+		// Something was added to the ready line or to the timers, so the loop must look again
+		bool runtime_changed;
+
+		std::mutex runtime_mutex;
+		std::condition_variable runtime_wakeup;
+		// Notified every time that a flow finishes, for the joins
+		std::condition_variable flow_finished;
+		std::thread runtime_thread;
+
+		void run_loop();
+
+		/**
+		* Parks a flow on a wait, with an optional deadline. Returns false if the flow was already cancelled, so the
+		* awaiter doesn't suspend it at all
+		*/
+		bool suspend(FlowState* flow_state, const std::shared_ptr<Wait>& wait, const std::chrono::steady_clock::time_point* deadline);
+
+		// Resumes a wait with its event (if it wasn't resumed yet). Safe from any thread
+		void complete(const std::shared_ptr<Wait>& wait, const std::optional<EventWatcher::Event>& event);
+
+		// Moves a wait to the ready line. The runtime mutex must be held
+		void resume_locked(Wait& wait);
+
+		bool is_cancelled(const FlowState* flow_state);
+
+	public:
+		FlowRuntime();
+
+		// Stops the thread, and destroys the flows that didn't finish. Cancel and join them first to let them return
+		~FlowRuntime();
+
+		FlowRuntime(const FlowRuntime&) = delete;
+		FlowRuntime& operator=(const FlowRuntime&) = delete;
+
+		// Starts a flow on the runtime thread. The name it's only for the logs. The thread starts with the first flow
+		FlowId spawn(Flow flow, const std::string& name);
+
+		// Returns false if there is no such flow (ie, it already finished)
+		bool cancel(const FlowId flow_id);
+
+		// Waits until a flow finishes. Must not be called from a flow, since they run on the thread that it'd wait for
+		void join(const FlowId flow_id);
+
+		size_t flow_count();
+
+		// The awaitables of the flows
+		SleepAwaiter sleep_for(const std::chrono::milliseconds duration);
+		AppearAwaiter appear(
+			EventWatcher* event_watcher,
+			const std::string& needle_id,
+			const EventWatcher::SubscriptionOptions& options = EventWatcher::SubscriptionOptions{},
+			const std::chrono::milliseconds timeout = std::chrono::milliseconds::zero()
+		);
+};
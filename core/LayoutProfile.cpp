@@ -0,0 +1,121 @@
+#include "LayoutProfile.hpp"
+#include "league_client/LeagueClientButton.hpp"
+#include "../logger/RumbleLogger.hpp"
+
+
+LayoutProfile::LayoutProfile(const Language language, const cv::Size& client_size)
+	: language{ language },
+	client_size{ client_size },
+	dirty{ false } {}
+
+
+std::string LayoutProfile::file_name(const cv::Size& client_size)
+{
+	return "layout_" + std::to_string(client_size.width) + "x" + std::to_string(client_size.height) + ".yml";
+}
+
+std::string LayoutProfile::path() const
+{
+	return ClientButton::assets_directory(this->language) + "/" + LayoutProfile::file_name(this->client_size);
+}
+
+
+void LayoutProfile::record(const std::string& needle_id, const cv::Rect& client_rect)
+{
+	cv::Rect& placement = this->placements[ needle_id ];
+	if (placement == client_rect)
+		return;
+
+	placement = client_rect;
+	this->dirty = true;
+}
+
+bool LayoutProfile::get(const std::string& needle_id, cv::Rect& client_rect) const
+{
+	const auto placement = this->placements.find(needle_id);
+	if (placement == this->placements.end())
+		return false;
+
+	client_rect = placement->second;
+	return true;
+}
+
+const cv::Size& LayoutProfile::get_client_size() const
+{
+	return this->client_size;
+}
+
+size_t LayoutProfile::placement_count() const
+{
+	return this->placements.size();
+}
+
+bool LayoutProfile::is_dirty() const
+{
+	return this->dirty;
+}
+
+
+bool LayoutProfile::load()
+{
+	cv::FileStorage storage;
+	try
+	{
+		if (!storage.open(this->path(), cv::FileStorage::READ))
+			return false;
+	}
+	catch (const cv::Exception&)
+	{
+		return false;
+	}
+
+	// The file name already says it, but a renamed (or copied) file would place every button wrong
+	if (static_cast<int>(storage[ "client_width" ]) != this->client_size.width
+		|| static_cast<int>(storage[ "client_height" ]) != this->client_size.height)
+	{
+		RUMBLE_LOG_WARNING << "Ignoring the layout of " << this->path() << ", it was recorded on another client size";
+		return false;
+	}
+
+	const cv::FileNode buttons_node = storage[ "buttons" ];
+	for (auto it = buttons_node.begin(); it != buttons_node.end(); ++it)
+	{
+		const cv::Rect client_rect{
+			static_cast<int>((*it)[ "x" ]), static_cast<int>((*it)[ "y" ]),
+			static_cast<int>((*it)[ "width" ]), static_cast<int>((*it)[ "height" ])
+		};
+		this->placements[ static_cast<std::string>((*it)[ "id" ]) ] = client_rect;
+	}
+
+	RUMBLE_LOG_INFO << "Loaded the layout of " << this->placements.size() << " buttons for a "
+		<< this->client_size.width << "x" << this->client_size.height << " client";
+	return true;
+}
+
+bool LayoutProfile::save()
+{
+	cv::FileStorage storage;
+	try
+	{
+		if (!storage.open(this->path(), cv::FileStorage::WRITE))
+			return false;
+	}
+	catch (const cv::Exception&)
+	{
+		return false;
+	}
+
+	storage << "client_width" << this->client_size.width;
+	storage << "client_height" << this->client_size.height;
+	storage << "buttons" << "[";
+	for (const auto& [needle_id, client_rect] : this->placements)
+	{
+		storage << "{" << "id" << needle_id
+			<< "x" << client_rect.x << "y" << client_rect.y << "width" << client_rect.width << "height" << client_rect.height
+			<< "}";
+	}
+	storage << "]";
+
+	this->dirty = false;
+	return true;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <map>
+#include <string>
+
+#include <opencv2/opencv.hpp>
+
+#include "../helpers/EnumTypes.hpp"
+
+/// <summary>
+/// Where every button of the client was seen, for a language and a client size.
+///
+/// The layout of the League client only depends on its size, so once a button was found, the next searches of it
+/// can start by verifying that small region instead of scanning the whole frame. The profile it's filled by the
+/// clicks of the normal sessions, and all at once by the calibration, that records every button visible on each
+/// screen of the client (walking them by itself, or following the commands of the user). Saved next to the assets of the language, one file per client size,
+/// so the sessions starts warm.
+/// </summary>
+class LayoutProfile
+{
+	private:
+		Language language;
+		cv::Size client_size;
+
+		// Client coordinates of the needles, by needle id
+		std::map<std::string, cv::Rect> placements;
+
+		// There are placements not saved yet
+		bool dirty;
+
+	public:
+		LayoutProfile(const Language language, const cv::Size& client_size);
+
+		// The file of a client size, inside the assets folder of the language. ie, "layout_1280x720.yml"
+		static std::string file_name(const cv::Size& client_size);
+		std::string path() const;
+
+		// Sets where a needle was found, on client coordinates
+		void record(const std::string& needle_id, const cv::Rect& client_rect);
+
+		// Where a needle was found the last time. Returns false if it was never found on this client size
+		bool get(const std::string& needle_id, cv::Rect& client_rect) const;
+
+		const cv::Size& get_client_size() const;
+		size_t placement_count() const;
+		bool is_dirty() const;
+
+		// Loads the profile of a previous session. Returns false if there is no (compatible) file
+		bool load();
+
+		// Saves the placements as an OpenCV YAML file
+		bool save();
+};
@@ -0,0 +1,157 @@
+#include "NeedleResources.hpp"
+#include "../data/API_buttons.hpp"
+#include "../logger/RumbleLogger.hpp"
+#include "../tracing/RumbleTrace.hpp"
+
+
+NeedleResources::NeedleResources(const Language language, const int match_method)
+	: language{ language },
+	match_method{ match_method },
+	client_buttons{ RLE_data::get_buttons(language) },
+	needle_thresholds{ new NeedleThresholds(NeedleResources::threshold_rate, match_method) },
+	compiled_needles{ new CompiledNeedles },
+	matcher_registry{ new MatcherRegistry },
+	match_cache{ new MatchCache },
+	needle_atlas{ new NeedleAtlas }
+{
+	const std::string assets_directory = ClientButton::assets_directory(this->language);
+
+	// Starts with the thresholds learned on previous sessions, if any
+	this->needle_thresholds->load(this->thresholds_path());
+
+	// The engines chosen on previous sessions, so the needles doesn't have to be calibrated again
+	this->matcher_registry->load(this->matcher_choices_path());
+
+	// The screens cached on previous sessions are hash lookups from the first search
+	this->match_cache->load(this->match_cache_path());
+
+	// The needles compiled for this language, if any, are matched by their patch instead of as a whole
+	this->compiled_needles->load(assets_directory + "/" + CompiledNeedles::file_name);
+
+	// Mapping the atlas it's the whole needle loading. Pages are brought in by the OS as the needles are used
+	if (!this->needle_atlas->open(assets_directory + "/" + NeedleAtlas::file_name))
+	{
+		RUMBLE_LOG_DEBUG << "There is no needle atlas for " << this->language << ", decoding the needle images";
+	}
+}
+
+NeedleResources::~NeedleResources()
+{
+	for (ClientButton* client_button : this->client_buttons)
+		delete client_button;
+
+	// The needles may point to the mapped atlas, so they go first
+	this->needles.clear();
+	delete this->needle_atlas;
+	delete this->match_cache;
+	delete this->matcher_registry;
+	delete this->compiled_needles;
+	delete this->needle_thresholds;
+}
+
+
+const cv::Mat& NeedleResources::get_needle(const std::string& needle_id, const std::string& image_path, const ChannelMode channel_mode)
+{
+	std::lock_guard<std::mutex> lock{ this->needles_mutex };
+
+	const auto key = std::make_pair(needle_id, channel_mode);
+	const auto needle = this->needles.find(key);
+	if (needle != this->needles.end())
+		return needle->second;
+
+	// Already on the channel mode of the vision engine, so it's matched without any conversion
+	cv::Mat needle_image = this->needle_atlas->get(needle_id, channel_mode);
+	if (!needle_image.empty())
+		return this->needles.emplace(key, needle_image).first->second;
+
+	cv::Mat img_to_find = cv::imread(image_path, cv::IMREAD_COLOR);
+	if (img_to_find.empty())
+	{
+		RUMBLE_LOG_WARNING << "Unable to load the needle " << image_path;
+		static const cv::Mat missing_needle;
+		return missing_needle;
+	}
+
+	{
+		RUMBLE_TRACE_SCOPE("color_conversion");
+		switch (channel_mode)
+		{
+			case ChannelMode::BGR:
+				needle_image = img_to_find;
+				break;
+			case ChannelMode::Gray:
+				cv::cvtColor(img_to_find, needle_image, cv::COLOR_BGR2GRAY);
+				break;
+			default:
+				cv::cvtColor(img_to_find, needle_image, cv::COLOR_BGR2BGRA);
+		}
+	}
+
+	return this->needles.emplace(key, needle_image).first->second;
+}
+
+std::string NeedleResources::thresholds_path() const
+{
+	return ClientButton::assets_directory(this->language) + "/" + NeedleThresholds::file_name;
+}
+
+std::string NeedleResources::matcher_choices_path() const
+{
+	return ClientButton::assets_directory(this->language) + "/" + MatcherRegistry::file_name;
+}
+
+std::string NeedleResources::match_cache_path() const
+{
+	return ClientButton::assets_directory(this->language) + "/" + MatchCache::file_name;
+}
+
+bool NeedleResources::save_thresholds() const
+{
+	const bool thresholds_saved = this->needle_thresholds->save(this->thresholds_path());
+	const bool cache_saved = this->match_cache->save(this->match_cache_path());
+	return this->matcher_registry->save(this->matcher_choices_path()) && thresholds_saved && cache_saved;
+}
+
+
+/**
+* Getters
+*/
+Language NeedleResources::get_language() const
+{
+	return this->language;
+}
+
+int NeedleResources::get_match_method() const
+{
+	return this->match_method;
+}
+
+const std::vector<ClientButton*>& NeedleResources::get_client_buttons() const
+{
+	return this->client_buttons;
+}
+
+NeedleThresholds* NeedleResources::get_needle_thresholds()
+{
+	return this->needle_thresholds;
+}
+
+const CompiledNeedles* NeedleResources::get_compiled_needles() const
+{
+	return this->compiled_needles;
+}
+
+MatcherRegistry* NeedleResources::get_matcher_registry()
+{
+	return this->matcher_registry;
+}
+
+MatchCache* NeedleResources::get_match_cache()
+{
+	return this->match_cache;
+}
+
+const NeedleAtlas* NeedleResources::get_needle_atlas() const
+{
+	return this->needle_atlas;
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "../vision/RumbleVision.h"
+#include "../vision/NeedleThresholds.hpp"
+#include "../vision/CompiledNeedles.hpp"
+#include "../vision/NeedleAtlas.hpp"
+#include "../vision/MatcherRegistry.hpp"
+#include "../vision/MatchCache.hpp"
+#include "league_client/LeagueClientButton.hpp"
+#include "../helpers/EnumTypes.hpp"
+
+/// <summary>
+/// Everything that the API knows about the needles of a language: the client buttons, the needle images
+/// (mapped from the atlas or decoded once), the compiled patches and the learned thresholds.
+///
+/// None of it depends on a concrete client, so a single instance can be shared by every RumbleLeague
+/// that drives a client on that language, even from different threads.
+/// </summary>
+class NeedleResources
+{
+	private:
+		/*
+		* The amount of precision required to filter the image to find against a source.
+		* Due to the match method used on the OpenCV library for this project, the lower the number, the higher precision should
+		* be required to a cv::Mat result to be considered as a match comparing images.
+		* It's the default one. Every needle learns its own threshold from the scores of its searches (see needle_thresholds)
+		*/
+		static constexpr double threshold_rate = 0.05;
+
+		Language language;
+
+		// The one of the vision engines that uses the learned thresholds
+		int match_method;
+
+		// The buttons of the language, shared by the screens of every client
+		std::vector<ClientButton*> client_buttons;
+
+		// Per needle match thresholds, learned from the scores of the confirmed hits and misses
+		NeedleThresholds* needle_thresholds;
+
+		// Discriminative patches and masks of the needles, built offline by the needle compiler. Empty if it wasn't run
+		CompiledNeedles* compiled_needles;
+
+		// The fastest matcher engine of every needle, calibrated on this machine
+		MatcherRegistry* matcher_registry;
+
+		// The results of the searches by the pixels where they ran. The client repeats its screens, so most of them are found again
+		MatchCache* match_cache;
+
+		// The pre-decoded needles of the language, memory mapped. When there is no atlas, they're decoded from their images
+		NeedleAtlas* needle_atlas;
+
+		// The needles handed out, by needle id and channel mode: views of the atlas, or decoded from their images once
+		std::map<std::pair<std::string, ChannelMode>, cv::Mat> needles;
+		std::mutex needles_mutex;
+
+	public:
+		// The match method must be the one of the vision engines that will use the thresholds
+		NeedleResources(const Language language, const int match_method = cv::TM_SQDIFF_NORMED);
+		~NeedleResources();
+
+		NeedleResources(const NeedleResources&) = delete;
+		NeedleResources& operator=(const NeedleResources&) = delete;
+
+		/**
+		* Returns the needle on a channel mode. Taken from the atlas if it has it, otherwise decoded from its image the
+		* first time. It's a read only view, shared by every caller and maybe over the read only pages of the atlas,
+		* so a caller that needs to write on it must clone it first. Valid while the resources lives.
+		*/
+		const cv::Mat& get_needle(const std::string& needle_id, const std::string& image_path, const ChannelMode channel_mode);
+
+		// Where the learned thresholds of the language are stored
+		std::string thresholds_path() const;
+
+		// Where the matcher engine choices of the language are stored
+		std::string matcher_choices_path() const;
+
+		// Where the match cache of the language is stored
+		std::string match_cache_path() const;
+
+		// Persists what was learned about every needle (its threshold, its matcher engine and its cached results) next to the assets
+		bool save_thresholds() const;
+
+		// Getters
+		Language get_language() const;
+		int get_match_method() const;
+		const std::vector<ClientButton*>& get_client_buttons() const;
+		NeedleThresholds* get_needle_thresholds();
+		const CompiledNeedles* get_compiled_needles() const;
+		MatcherRegistry* get_matcher_registry();
+		MatchCache* get_match_cache();
+		const NeedleAtlas* get_needle_atlas() const;
+};
@@ -1,14 +1,18 @@
+#include <algorithm>
+#include <cstring>
+
 #include "RumbleLeague.hpp"
+#include "../data/API_buttons.hpp"
 
 using namespace std;
 
 // Initializacion of static non const members of the class
-int RumbleLeague::instances_counter{ 0 };
+std::atomic<int> RumbleLeague::instances_counter{ 0 };
 
 /**
 * 
 * Constructors more critical part it's to create the internal user defined C++ objects
-* { WindowCapture, RumbleLeagueVision } dependant objects of this class.
+* { FrameSource, InputSink, RumbleLeagueVision } dependant objects of this class.
 * They will by dispatched via dinamic memory allocation, storing them on the heap 
 * and returning a pointer for each of them.
 * Be careful that if we lose those pointers, we will be leaking memory.
@@ -28,34 +32,136 @@ int RumbleLeague::instances_counter{ 0 };
 * We still have to assign the data of the "current_league_client_screen" member in the constructor body, 'cause until this
 * point we don't have available what language (as an Enum variant) it's currently setted.
 */
-RumbleLeague::RumbleLeague(const int language_id, const bool autoaccept_behaviour, const bool debug_mode)
-	: window_capture{ new WindowCapture( "League of Legends" ) },
+RumbleLeague::RumbleLeague(
+	const bool autoaccept_behaviour,
+	const bool debug_mode,
+	FrameSource* frame_source,
+	InputSink* input_sink,
+	NeedleResources* needle_resources
+)
+	: frame_source{ frame_source },
+	input_sink{ input_sink },
+	input_backend{ nullptr },
+	owns_io_devices{ false },
 	rumble_vision{ new RumbleLeagueVision },
+	needle_resources{ needle_resources },
+	owns_needle_resources{ false },
+	event_watcher{ nullptr },
+	flow_runtime{ nullptr },
+	owns_flow_runtime{ false },
+	layout_profile{ nullptr },
+	layout_calibration{ false },
+	click_verification{ true },
+	last_click_score{ 1.0 },
+	last_click_path{ MatchPath::Full },
+	last_click_exact{ false },
 	autoaccept_behaviour{ autoaccept_behaviour },
+	autoaccept_flow_id{ 0 },
+	wait_flow_id{ 0 },
+	match_accepted{ false },
 	debug_mode{ debug_mode },
+	language{ needle_resources->get_language() },
 	previous_league_client_screen{ nullptr },
 	game_lobby_candidate{ LeagueClientScreenIdentifier::SummonersBlindLobby }
 { 
-	this->set_cpp_language(language_id);	
-	current_league_client_screen = new LeagueClientScreen(this->language);
+	this->rumble_vision->set_matcher_registry(this->needle_resources->get_matcher_registry());
+	this->rumble_vision->set_match_cache(this->needle_resources->get_match_cache());
+	this->rumble_vision->set_needle_thresholds(this->needle_resources->get_needle_thresholds());
+
+	// The screen works over the buttons of the resources, instead of creating its own ones
+	current_league_client_screen = new LeagueClientScreen(this->language, this->needle_resources->get_client_buttons());
+
+	this->click_verifier = new ClickVerifier(this->frame_source, this->rumble_vision, this->needle_resources);
+	this->speculative_matcher = new SpeculativeMatcher(this->frame_source, this->needle_resources);
+	this->command_predictor = new CommandPredictor(this->needle_resources->get_client_buttons());
 
 	// Increment the number of instances created
 	++RumbleLeague::instances_counter;
-	cout << "Number of active RumbleLeague instances = " << RumbleLeague::instances_counter << endl;
+	RUMBLE_LOG_INFO << "Number of active RumbleLeague instances = " << RumbleLeague::instances_counter;
 	
 }
 
+// A single client. The resources of the language are created for it, and owned by this object
+RumbleLeague::RumbleLeague(
+	const int language_id,
+	const bool autoaccept_behaviour,
+	const bool debug_mode,
+	FrameSource* frame_source,
+	InputSink* input_sink
+)
+	: RumbleLeague{
+		autoaccept_behaviour, debug_mode, frame_source, input_sink,
+		new NeedleResources(RumbleLeague::language_from_id(language_id))
+	}
+{
+	this->owns_needle_resources = true;
+}
+
+#ifdef _WIN32
+// Captures the League of Legends window and injects the input events on the desktop. All the devices are owned by this object
+RumbleLeague::RumbleLeague(const int language_id, const bool autoaccept_behaviour, const bool debug_mode)
+	: RumbleLeague{ language_id, autoaccept_behaviour, debug_mode, new WindowCapture( "League of Legends" ), nullptr }
+{
+	this->input_backend = new Win32InputBackend;
+	this->input_sink = new InputQueue(this->input_backend);
+	this->owns_io_devices = true;
+}
+
 // No params constructor. Constructor delegation applied here.
 // 1 it's the ID for the default language (English)
 RumbleLeague::RumbleLeague() : RumbleLeague{ 1, true, false } {} 
+#endif
 
 
 // Destructor
 RumbleLeague::~RumbleLeague()
 {
 	--RumbleLeague::instances_counter;
-	cout << "Destructor for the class RumbleLeague has been called. ";
-	cout << "Number of active RumbleLeague instances = " << RumbleLeague::instances_counter << endl;
+
+	// The flows click through the devices and wait on the watcher, so they return first
+	std::set<FlowRuntime::FlowId> started_flows;
+	{
+		std::lock_guard<std::mutex> lock{ this->flow_runtime_mutex };
+		started_flows = this->flow_ids;
+	}
+	if (this->flow_runtime != nullptr)
+	{
+		for (const FlowRuntime::FlowId flow_id : started_flows)
+			this->flow_runtime->cancel(flow_id);
+		for (const FlowRuntime::FlowId flow_id : started_flows)
+			this->flow_runtime->join(flow_id);
+	}
+	if (this->owns_flow_runtime)
+		delete this->flow_runtime;
+
+	// The watcher and the speculation threads uses the devices and the resources, so they're stopped before releasing them
+	delete this->event_watcher;
+	delete this->speculative_matcher;
+
+	if (this->owns_io_devices)
+	{
+		delete this->frame_source;
+		delete this->input_sink;
+		delete this->input_backend;
+	}
+
+	delete this->click_verifier;
+	delete this->command_predictor;
+
+	if (this->layout_profile != nullptr && this->layout_profile->is_dirty())
+		this->layout_profile->save();
+	delete this->layout_profile;
+	delete this->rumble_vision;
+	delete this->current_league_client_screen;
+
+	if (this->owns_needle_resources)
+	{
+		this->save_thresholds();
+		delete this->needle_resources;
+	}
+
+	RUMBLE_LOG_INFO << "Destructor for the class RumbleLeague has been called. "
+		<< "Number of active RumbleLeague instances = " << RumbleLeague::instances_counter;
 }
 
 
@@ -70,21 +176,38 @@ RumbleLeague::~RumbleLeague()
 */
 const char* RumbleLeague::play(const std::string& user_input)
 {
+	RUMBLE_TRACE_SCOPE("play");
+
 	// TODO Very first -> Create the decision tree, to find by action, by button identifier... etc
 
+	// The watcher accepted a match since the last command, so the client it's already on the champ select
+	if (this->match_accepted.exchange(false))
+		this->current_league_client_screen->set_identifier(LeagueClientScreenIdentifier::ChampSelect);
+
 	// 1�st -> Get a list with the posible client buttons that could possible be the desired user action
-	auto matched_client_buttons = this->current_league_client_screen->find_client_button(user_input);
+	std::vector<ClientButton*> matched_client_buttons;
+	{
+		RUMBLE_TRACE_SCOPE("command_parsing");
+		matched_client_buttons = this->current_league_client_screen->find_client_button(user_input);
+	}
 
 	if (matched_client_buttons.size() > 0)
 	{
-		cout << "\n *************************" << endl;
 		for (auto button : matched_client_buttons) {
-			cout << "Founded a button candidate: " << button->identifier << endl;
+			RUMBLE_LOG_DEBUG << "Founded a button candidate: " << button->identifier;
 		}
 
-		const ClientButton* const& button = matched_client_buttons[0];
-		cout << "[WARNING] Taking -> " << button->identifier << " <- as the first element matched. "
-			"This is because there is not NLP implemented yet." << endl;
+		// The first word that names a button wins, as always. Only when that word names several buttons (ie, "tft"),
+		// the client itself tells which one of them it's on the screen
+		std::vector<ClientButton*> candidates;
+		for (ClientButton* candidate : matched_client_buttons)
+			if (strcmp(candidate->identifier, matched_client_buttons[0]->identifier) == 0)
+				candidates.push_back(candidate);
+
+		const ClientButton* button = (candidates.size() > 1)
+			? this->disambiguate(candidates)
+			: candidates[0];
+		RUMBLE_LOG_DEBUG << "Taking -> " << button->identifier << " <-";
 
 		// Calls the member method to perform a desired action based on the matched button.
 		this->league_client_action(button);
@@ -96,6 +219,52 @@ const char* RumbleLeague::play(const std::string& user_input)
 	}
 }
 
+/**
+* The speech recognition sends many partials before the final transcript, each one a bit longer (or revised).
+* The candidates are narrowed again on every one of them, and when the most likely button changes, its needle
+* it's searched in the background. The final play finds that search already done, and just clicks.
+*
+* The most likely button it's the one that play would take: the first complete word that names a button.
+* A word still being spoken only counts when it can't be more than one button.
+*/
+const char* RumbleLeague::play_partial(const std::string& partial_input)
+{
+	RUMBLE_TRACE_SCOPE("play_partial");
+
+	size_t complete_matches = 0;
+	const std::vector<ClientButton*> candidates = this->current_league_client_screen->find_client_button_candidates(
+		partial_input, complete_matches
+	);
+
+	// Nothing yet, or a word still being spoken that can be several buttons
+	if (candidates.empty() || (complete_matches == 0 && candidates.size() > 1))
+		return "";
+
+	const ClientButton* const& button = candidates[0];
+
+	const cv::Mat& needle_image = this->get_needle_image(button->image_name, button->image_path);
+	if (needle_image.empty())
+		return "";
+
+	const std::string threshold_id = std::string{ button->image_name } + this->rumble_vision->get_format_tag();
+	this->speculative_matcher->speculate(
+		button->image_name, needle_image, this->rumble_vision->get_working_format(),
+		this->needle_resources->get_needle_thresholds()->get(threshold_id)
+	);
+
+	return button->identifier;
+}
+
+/**
+* Types the text received from the Python API. The whole text it's delivered to the input sink at once,
+* so the default InputQueue injects it with a single call, instead of one per key press and release
+*/
+void RumbleLeague::write(const std::string& text)
+{
+	RUMBLE_LOG_DEBUG << "Writing -> " << text;
+	this->input_sink->type_text(text);
+}
+
 /**
 * Moves the mouse and make a click on the location on the League of Legends Client.
 * Changes the pointer value what points to instance of the LeagueClientScreen child for the new one after matching a user input,
@@ -106,10 +275,14 @@ void RumbleLeague::league_client_action(const ClientButton* const& client_button
 	// Controls when an even should be awaited (until appears on screen) or not.
 	bool wait_event{ false };
 
+	// Any new command, from the accept / decline screen, replaces the wait for the match to be accepted
+	this->cancel_pending_waits();
+
 	// Tracks the lastest screen seen before the current one
 	this->previous_league_client_screen = this->current_league_client_screen;
-	cout << "[INFO] Previous screen -> " <<
-		this->previous_league_client_screen->get_identifier() << " <- " << endl;
+	const LeagueClientScreenIdentifier previous_identifier = this->current_league_client_screen->get_identifier();
+	RUMBLE_LOG_DEBUG << "Previous screen -> " <<
+		this->previous_league_client_screen->get_identifier() << " <- ";
 
 	/** Updates the pointer to the LeagueClientScreen with the enum value that identifies what screen comes
 	* next after pressing any button
@@ -130,7 +303,7 @@ void RumbleLeague::league_client_action(const ClientButton* const& client_button
 			if (client_button->lobby != LeagueClientScreenIdentifier::NoLobby)
 			{
 				this->game_lobby_candidate = client_button->lobby;
-				cout << "[INFO] Game lobby candidate -> " << this->game_lobby_candidate << " <- " << endl;
+				RUMBLE_LOG_DEBUG << "Game lobby candidate -> " << this->game_lobby_candidate << " <- ";
 			}
 
 			this->current_league_client_screen->set_identifier(
@@ -159,28 +332,42 @@ void RumbleLeague::league_client_action(const ClientButton* const& client_button
 			this->current_league_client_screen->set_identifier(client_button->next_screen);
 	}
 
-	cout << "[INFO] Current screen -> " <<
-		this->current_league_client_screen->get_identifier() << " <- " << endl;
+	RUMBLE_LOG_DEBUG << "Current screen -> " <<
+		this->current_league_client_screen->get_identifier() << " <- ";
 
 
 	// Sets the needle image for what we are looking for
-	cv::Mat needle_image;
-	this->set_needle_image(client_button->image_path, needle_image);
+	const cv::Mat& needle_image = this->get_needle_image(client_button->image_name, client_button->image_path);
 
 	// Change this for a fn pointer or callback inside the button
-	(!wait_event) ? this->click_event(needle_image) : this->wait_event(needle_image);
+	if (!wait_event)
+	{
+		// A click that the client never received leaves it on the previous screen, so the state goes back there
+		if (this->confirmed_click_event(client_button->image_name, needle_image) == ClickOutcome::Unconfirmed)
+		{
+			RUMBLE_LOG_WARNING << "The client didn't react to " << client_button->identifier
+				<< ", staying on " << previous_identifier;
+			this->current_league_client_screen->set_identifier(previous_identifier);
+		}
+	}
+	else
+		this->wait_event(client_button->image_name);
+
+	// The client it's on a new screen, so the previous speculations are gone. The next command it's predictable from here
+	this->command_predictor->record(previous_identifier, client_button);
+	this->speculative_matcher->discard();
+	if (this->layout_calibration)
+		this->calibrate_layout_screen();
+	this->prefetch_next_buttons();
 
-	// Special behaviour (Under testing and development)
+	// The match can take minutes to be found. Instead of blocking the command until then, the watcher accepts it
 	if (this->autoaccept_behaviour && this->current_league_client_screen->get_identifier()
 		== LeagueClientScreenIdentifier::AcceptDecline)
-	{
-		cout << "Generating a recursive call for the autoaccept behaviour " << endl;
-		// Recursive call for generate the autoaccept match when the screen spawns
-		this->play("accept"); // TODO the value should be passed by language
-	}
+		this->watch_autoaccept();
 
-	// Prevents to leak memory and clean up resources
-	cv::destroyAllWindows();
+	// Prevents to leak memory and clean up resources. Windows are only opened on debug mode
+	if (this->debug_mode)
+		cv::destroyAllWindows();
 }
 
 
@@ -188,50 +375,403 @@ void RumbleLeague::league_client_action(const ClientButton* const& client_button
 * Private members
 */
 
-cv::Point RumbleLeague::click_event(const cv::Mat& needle_image)
+cv::Point RumbleLeague::click_event(const std::string& needle_id, const cv::Mat& needle_image)
 {
-	cv::Mat video_source = this->window_capture->get_video_source();
-	cv::Mat* video_source_ptr = &video_source;
+	// The scores of every working format are learned apart
+	const std::string threshold_id = needle_id + this->rumble_vision->get_format_tag();
+	NeedleThresholds* needle_thresholds = this->needle_resources->get_needle_thresholds();
+	cv::Point m_loc;
 
-	// Img finder. Matches the video source and the needle image and returns the point where the needle image is found inside the video source.
-	cv::Point m_loc = this->rumble_vision->find(
-		video_source_ptr, needle_image, RumbleLeague::threshold_rate, this->debug_mode
-	);
+	// Found while the user was still speaking the command, or prefetched. The debug mode always searches, to show the match
+	SpeculativeMatcher::Speculation speculation;
+	const SpeculativeMatcher::Freshness freshness = this->debug_mode
+		? SpeculativeMatcher::Freshness::Missing
+		: this->speculative_matcher->claim(needle_id, speculation);
+
+	if (freshness == SpeculativeMatcher::Freshness::Fresh)
+	{
+		RUMBLE_LOG_DEBUG << "Using the speculative match of " << needle_id;
+		this->last_video_source = std::move(speculation.frame);
+		m_loc = speculation.location;
+		this->last_click_score = speculation.score;
+		this->last_click_path = speculation.path;
+		this->last_click_exact = speculation.exact_score;
+	}
+	else
+	{
+		// Already on the working format of the vision engine, converted by the capture itself
+		WorkingFrame video_source;
+		this->frame_source->get_working_frame(this->rumble_vision->get_working_format(), video_source);
+
+		// Kept as the reference of the click confirmation. The debug mode draws over the frame, so it needs its own copy
+		this->last_video_source = video_source;
+		if (this->debug_mode)
+			this->last_video_source.image = video_source.image.clone();
+
+		// An older speculation, or the layout profile, still tells where the button was. Verifying that small region goes first
+		const double threshold = needle_thresholds->get(threshold_id);
+		cv::Rect placement;
+		if (freshness == SpeculativeMatcher::Freshness::Stale)
+			m_loc = this->find_around(video_source, needle_id, needle_image, speculation.location, threshold);
+		else if (!this->debug_mode && !video_source.image.empty()
+			&& this->get_layout_profile(video_source)->get(needle_id, placement))
+			m_loc = this->find_around(video_source, needle_id, needle_image, (placement.tl() + placement.br()) / 2, threshold);
+
+		// Img finder. Matches the video source and the needle image and returns the point where the needle image is found inside the video source.
+		// Dispatched to the fastest engine for the needle, chosen the first time that it's searched
+		if (m_loc == cv::Point{ 0, 0 })
+		{
+			const CompiledNeedle* compiled_needle = this->needle_resources->get_compiled_needles()->get(needle_id);
+			m_loc = this->rumble_vision->find(video_source, needle_id, needle_image, compiled_needle, threshold, this->debug_mode);
+		}
+
+		// Only a hit once the client confirms the click. The cascade only bounds the score of a miss, so it's never one
+		this->last_click_score = this->rumble_vision->get_last_score();
+		this->last_click_path = this->rumble_vision->get_last_match_path();
+		this->last_click_exact = this->rumble_vision->is_last_score_exact();
+	}
 
 
 	if (m_loc.x != 0 && m_loc.y != 0)
 	{
-		// Copy the data from the openCV Point type to the POINT type from the Windows API
-		POINT coords { m_loc.x, m_loc.y };
+		if (!this->last_video_source.image.empty())
+			this->get_layout_profile(this->last_video_source)->record(
+				needle_id, cv::Rect{ m_loc - cv::Point{ needle_image.cols, needle_image.rows } / 2, needle_image.size() }
+			);
 
-		// Transform the match location coordinates into the relative coordinates 
-		// of the current machine desktop screen
-		// Details: https://docs.microsoft.com/en-us/windows/win32/api/winuser/nf-winuser-clienttoscreen
-		::ClientToScreen(this->window_capture->get_hwnd(), &coords);
+		// Transform the match location coordinates into the coordinates where the click has to be injected,
+		// ie, the relative coordinates of the current machine desktop screen
+		const cv::Point coords = this->frame_source->client_to_screen(m_loc);
 
-		std::cout << "MATCH LOCATION (Windowed) -> " << m_loc << std::endl;
-		std::cout << "MATCH LOCATION -> [" << coords.x << " , " << coords.y << "]" << std::endl;
+		RUMBLE_LOG_DEBUG << "MATCH LOCATION (Windowed) -> [" << m_loc.x << " , " << m_loc.y << "]";
+		RUMBLE_LOG_DEBUG << "MATCH LOCATION -> [" << coords.x << " , " << coords.y << "]";
 
-		RumbleMotion* rumble_motion = new RumbleMotion();
-		rumble_motion->move_mouse_and_left_click(coords.x, coords.y);
-		delete rumble_motion;
+		this->input_sink->left_click(coords.x, coords.y);
 	}
 
 	return m_loc;
 }
 
 
-void RumbleLeague::wait_event(const cv::Mat& needle_image)
+cv::Point RumbleLeague::find_around(
+	WorkingFrame& video_source, const std::string& needle_id, const cv::Mat& needle_image, const cv::Point& hint, const double threshold
+) {
+	const int scale = video_source.downscale;
+	const cv::Size needle_size{ needle_image.cols / scale, needle_image.rows / scale };
+
+	// The region on the scale of the frame, centered where the needle was
+	const cv::Rect region = cv::Rect{
+		cv::Point{ hint.x / scale - needle_size.width / 2 - RumbleLeague::hint_margin, hint.y / scale - needle_size.height / 2 - RumbleLeague::hint_margin },
+		cv::Size{ needle_size.width + 2 * RumbleLeague::hint_margin, needle_size.height + 2 * RumbleLeague::hint_margin }
+	} & cv::Rect{ 0, 0, video_source.image.cols, video_source.image.rows };
+
+	// Cut by the border of the frame, the needle can't be there
+	if (region.width < needle_size.width || region.height < needle_size.height)
+		return cv::Point{ 0, 0 };
+
+	WorkingFrame region_frame = frame_region(video_source, region);
+	const cv::Point location = this->rumble_vision->find(
+		region_frame, needle_id, needle_image, this->needle_resources->get_compiled_needles()->get(needle_id), threshold
+	);
+
+	if (location == cv::Point{ 0, 0 })
+	{
+		RUMBLE_LOG_DEBUG << "The button " << needle_id << " moved away from its prefetched location";
+		return location;
+	}
+
+	return location + region.tl() * scale;
+}
+
+/**
+* Several buttons can answer to the same command: "tft" it's both the TFT tab of the main screen and the Teamfight
+* Tactics game mode, and "ranked" it's the ranked queue of both games. All of them are searched on a single frame,
+* and the visible one with the best score wins. The learned thresholds differs between needles, so the scores are
+* compared by how far below their threshold they are. When none of them it's visible, the first one it's taken, as
+* the commands did before
+*/
+const ClientButton* RumbleLeague::disambiguate(const std::vector<ClientButton*>& candidates)
+{
+	RUMBLE_TRACE_SCOPE("disambiguation");
+
+	WorkingFrame video_source;
+	this->frame_source->get_working_frame(this->rumble_vision->get_working_format(), video_source);
+	if (video_source.image.empty())
+		return candidates[0];
+	const auto captured_at = std::chrono::steady_clock::now();
+
+	NeedleThresholds* needle_thresholds = this->needle_resources->get_needle_thresholds();
+	std::set<std::string> searched_needles;
+	const ClientButton* best_button = nullptr;
+	double best_margin = 0.0;
+	SpeculativeMatcher::Speculation best_match;
+
+	for (const ClientButton* client_button : candidates)
+	{
+		// Several identifiers can share a needle
+		if (!searched_needles.insert(client_button->image_name).second)
+			continue;
+
+		const cv::Mat& needle_image = this->get_needle_image(client_button->image_name, client_button->image_path);
+		if (needle_image.empty())
+			continue;
+
+		const std::string threshold_id = client_button->image_name + this->rumble_vision->get_format_tag();
+		const double threshold = needle_thresholds->get(threshold_id);
+
+		// The layout profile tells where the candidate was, when it was visible before. Verifying there goes first
+		cv::Point location;
+		cv::Rect placement;
+		if (this->get_layout_profile(video_source)->get(client_button->image_name, placement))
+			location = this->find_around(video_source, client_button->image_name, needle_image, (placement.tl() + placement.br()) / 2, threshold);
+		if (location == cv::Point{ 0, 0 })
+			location = this->rumble_vision->find(
+				video_source, client_button->image_name, needle_image,
+				this->needle_resources->get_compiled_needles()->get(client_button->image_name), threshold
+			);
+
+		// Not labelled: the candidates that aren't chosen can still be on the screen
+		const double score = this->rumble_vision->get_last_score();
+		const bool exact_score = this->rumble_vision->is_last_score_exact();
+		const MatchPath match_path = this->rumble_vision->get_last_match_path();
+
+		RUMBLE_LOG_DEBUG << "Candidate " << client_button->identifier << " scored " << score
+			<< ((location == cv::Point{ 0, 0 }) ? " (not visible)" : "");
+		if (location == cv::Point{ 0, 0 })
+			continue;
+
+		// The score of the compiled patch goes against the threshold of the patch, as find compared it
+		const double margin = score / needle_thresholds->get(threshold_id, match_path);
+		if (best_button == nullptr || margin < best_margin)
+		{
+			best_button = client_button;
+			best_margin = margin;
+			best_match = SpeculativeMatcher::Speculation{
+				client_button->image_name, video_source, location, score, exact_score, match_path, captured_at
+			};
+		}
+	}
+
+	if (best_button == nullptr)
+	{
+		RUMBLE_LOG_DEBUG << "None of the candidates it's visible";
+		return candidates[0];
+	}
+
+	// Found on a frame that was just captured, so the click can take it as it is, instead of searching it again
+	this->speculative_matcher->offer(std::move(best_match));
+	return best_button;
+}
+
+void RumbleLeague::prefetch_next_buttons()
+{
+	const std::vector<const ClientButton*> predicted = this->command_predictor->predict(
+		this->current_league_client_screen->get_identifier(), RumbleLeague::prefetched_buttons
+	);
+
+	NeedleThresholds* needle_thresholds = this->needle_resources->get_needle_thresholds();
+	std::vector<SpeculativeMatcher::Needle> needles;
+	for (const ClientButton* client_button : predicted)
+	{
+		const cv::Mat& needle_image = this->get_needle_image(client_button->image_name, client_button->image_path);
+		if (needle_image.empty())
+			continue;
+
+		const double threshold = needle_thresholds->get(client_button->image_name + this->rumble_vision->get_format_tag());
+		needles.push_back(SpeculativeMatcher::Needle{ client_button->image_name, needle_image, threshold });
+	}
+
+	this->speculative_matcher->prefetch(needles, this->rumble_vision->get_working_format(), RumbleLeague::prefetch_settle_delay);
+}
+
+
+LayoutProfile* RumbleLeague::get_layout_profile(const WorkingFrame& video_source)
+{
+	const cv::Size client_size{ video_source.image.cols * video_source.downscale, video_source.image.rows * video_source.downscale };
+	if (this->layout_profile != nullptr && this->layout_profile->get_client_size() == client_size)
+		return this->layout_profile;
+
+	// The client was resized. What was learned on the previous size it's kept for when it comes back
+	if (this->layout_profile != nullptr && this->layout_profile->is_dirty())
+		this->layout_profile->save();
+	delete this->layout_profile;
+
+	this->layout_profile = new LayoutProfile(this->language, client_size);
+	this->layout_profile->load();
+	return this->layout_profile;
+}
+
+void RumbleLeague::calibrate_layout_screen()
+{
+	RUMBLE_TRACE_SCOPE("calibrate_layout_screen");
+
+	// The client paints the new screen first
+	std::this_thread::sleep_for(RumbleLeague::prefetch_settle_delay);
+
+	WorkingFrame video_source;
+	this->frame_source->get_working_frame(this->rumble_vision->get_working_format(), video_source);
+	if (video_source.image.empty())
+		return;
+
+	LayoutProfile* layout_profile = this->get_layout_profile(video_source);
+	NeedleThresholds* needle_thresholds = this->needle_resources->get_needle_thresholds();
+	std::set<std::string> searched_needles;
+	int located_buttons = 0;
+
+	for (const ClientButton* client_button : this->needle_resources->get_client_buttons())
+	{
+		// Several identifiers can share a needle
+		if (!searched_needles.insert(client_button->image_name).second)
+			continue;
+
+		const cv::Mat& needle_image = this->get_needle_image(client_button->image_name, client_button->image_path);
+		if (needle_image.empty())
+			continue;
+
+		const std::string threshold_id = client_button->image_name + this->rumble_vision->get_format_tag();
+		const cv::Point location = this->rumble_vision->find(
+			video_source, client_button->image_name, needle_image,
+			this->needle_resources->get_compiled_needles()->get(client_button->image_name), needle_thresholds->get(threshold_id)
+		);
+		if (location == cv::Point{ 0, 0 })
+			continue;
+
+		layout_profile->record(
+			client_button->image_name, cv::Rect{ location - cv::Point{ needle_image.cols, needle_image.rows } / 2, needle_image.size() }
+		);
+		++located_buttons;
+	}
+
+	RUMBLE_LOG_INFO << "Layout calibration of " << this->current_league_client_screen->get_identifier() << ": "
+		<< located_buttons << " buttons located, " << layout_profile->placement_count() << " on the profile";
+}
+
+void RumbleLeague::set_layout_calibration(const bool enabled)
+{
+	this->layout_calibration = enabled;
+
+	if (enabled)
+		this->calibrate_layout_screen();
+	else if (this->layout_profile != nullptr && this->layout_profile->save())
+	{
+		RUMBLE_LOG_INFO << "Layout profile saved on " << this->layout_profile->path();
+	}
+}
+
+
+bool RumbleLeague::calibrate_layout()
+{
+	RUMBLE_TRACE_SCOPE("calibrate_layout");
+
+	// The navbar it's hidden there, and leaving them would drop the match
+	const LeagueClientScreenIdentifier screen = this->current_league_client_screen->get_identifier();
+	if (screen == LeagueClientScreenIdentifier::AcceptDecline || screen == LeagueClientScreenIdentifier::ChampSelect)
+	{
+		RUMBLE_LOG_WARNING << "The layout can't be calibrated from " << screen;
+		return false;
+	}
+
+	this->calibrate_layout_screen();
+
+	// Only clicks and records. The walk isn't a command of the user, so the predictor, the flows and the speculations
+	// never see it
+	const std::vector<ClientButton*> client_buttons = this->needle_resources->get_client_buttons();
+	for (const char* needle_id : RLE_data::calibration_route)
+	{
+		const auto client_button = std::find_if(client_buttons.begin(), client_buttons.end(), [&](const ClientButton* button) {
+			return button->image_name == needle_id;
+		});
+
+		// The route only has needles of the assets, but a language could lack some of them
+		if (client_button == client_buttons.end())
+			continue;
+
+		const cv::Mat& needle_image = this->get_needle_image((*client_button)->image_name, (*client_button)->image_path);
+		if (needle_image.empty())
+			continue;
+
+		WorkingFrame video_source;
+		this->frame_source->get_working_frame(this->rumble_vision->get_working_format(), video_source);
+		if (video_source.image.empty())
+			break;
+
+		const std::string threshold_id = (*client_button)->image_name + this->rumble_vision->get_format_tag();
+		const cv::Point location = this->rumble_vision->find(
+			video_source, (*client_button)->image_name, needle_image,
+			this->needle_resources->get_compiled_needles()->get((*client_button)->image_name),
+			this->needle_resources->get_needle_thresholds()->get(threshold_id)
+		);
+		if (location == cv::Point{ 0, 0 })
+		{
+			RUMBLE_LOG_DEBUG << "Layout calibration: " << needle_id << " isn't on the screen, skipping it";
+			continue;
+		}
+
+		const cv::Point coords = this->frame_source->client_to_screen(location);
+		this->input_sink->left_click(coords.x, coords.y);
+
+		// Every button of the route leads to a screen without lobby (the game modes stays on the choose game one)
+		this->current_league_client_screen->set_identifier((*client_button)->next_screen);
+		this->calibrate_layout_screen();
+	}
+
+	// The walk ends on the home screen. The profile it's saved once, whatever the mode was
+	if (this->layout_profile != nullptr && this->layout_profile->save())
+	{
+		RUMBLE_LOG_INFO << "Layout profile saved on " << this->layout_profile->path();
+	}
+
+	return true;
+}
+
+
+void RumbleLeague::wait_event(const std::string& needle_id)
 {
-	int key = 0;
-	while (key != 27) // 'ESC' key // TODO Check if works on wait events or should be replaced by a while True
+	this->wait_flow_id = this->start_flow(this->wait_event_flow(needle_id), "wait_" + needle_id);
+}
+
+
+ClickOutcome RumbleLeague::confirmed_click_event(const std::string& needle_id, const cv::Mat& needle_image)
+{
+	// The anchor of the screen where the click should lead. The state machine already points there
+	const char* anchor_id = this->current_league_client_screen->get_anchor();
+	const std::string anchor_path = (anchor_id != nullptr)
+		? ClientButton::assets_directory(this->language) + "/" + anchor_id + ".jpg"
+		: std::string{};
+
+	for (int attempt = 0; attempt <= RumbleLeague::click_retries; attempt++)
 	{
-		if (this->click_event(needle_image) != cv::Point{ 0, 0 })
-		{ 
-			break; 
+		const cv::Point m_loc = this->click_event(needle_id, needle_image);
+		if (m_loc == cv::Point{ 0, 0 })
+			return ClickOutcome::NotFound;
+
+		if (!this->click_verification)
+			return ClickOutcome::Confirmed;
+
+		LayoutProfile* layout_profile = this->last_video_source.image.empty() ? nullptr : this->get_layout_profile(this->last_video_source);
+		const ClickOutcome outcome = this->click_verifier->verify(
+			this->last_video_source, needle_id, needle_image, m_loc, RLE_data::stays_visible(needle_id),
+			anchor_id != nullptr ? anchor_id : "", anchor_path, layout_profile
+		);
+
+		// Clicking it again couldn't tell anything more, and it could undo the first click
+		if (outcome == ClickOutcome::Unverified)
+			return outcome;
+
+		if (outcome == ClickOutcome::Confirmed)
+		{
+			// The client reacted, so the needle really was there. The only way that a score becomes a labelled hit
+			if (this->last_click_exact)
+				this->needle_resources->get_needle_thresholds()->record(
+					needle_id + this->rumble_vision->get_format_tag(), this->last_click_path, this->last_click_score, true
+				);
+			return ClickOutcome::Confirmed;
 		}
-		key = cv::waitKey(60); // you can change wait time. Need a large value when the find game it's detected?
+
+		RUMBLE_LOG_DEBUG << "Unconfirmed click on " << needle_id << " (attempt " << attempt + 1 << ")";
 	}
+
+	return ClickOutcome::Unconfirmed;
 }
 
 
@@ -239,13 +779,242 @@ void RumbleLeague::wait_event(const cv::Mat& needle_image)
 * Helpers
 */
 
-void RumbleLeague::set_needle_image(const std::string& image_path, cv::Mat& needle_image)
+const cv::Mat& RumbleLeague::get_needle_image(const std::string& needle_id, const std::string& image_path)
+{
+	// Mapped from the atlas, or decoded once and shared, already on the channel mode of the vision engine
+	return this->needle_resources->get_needle(needle_id, image_path, this->rumble_vision->get_channel_mode());
+}
+
+bool RumbleLeague::save_thresholds() const
+{
+	return this->needle_resources->save_thresholds();
+}
+
+void RumbleLeague::set_click_verification(const bool enabled, const int budget_ms)
+{
+	this->click_verification = enabled;
+	this->click_verifier->set_budget(std::chrono::milliseconds{ budget_ms });
+}
+
+void RumbleLeague::set_working_format(const ChannelMode channel_mode, const int downscale)
+{
+	this->rumble_vision->set_working_format(channel_mode, downscale);
+	// Searched on the previous format, so their scores aren't comparable anymore
+	this->speculative_matcher->discard();
+	const std::string format_tag = this->rumble_vision->get_format_tag();
+	RUMBLE_LOG_INFO << "Working format of the matcher -> " << (format_tag.empty() ? "@bgra" : format_tag);
+}
+
+EventWatcher::SubscriptionId RumbleLeague::subscribe(
+	const std::string& needle_id,
+	EventWatcher::EventCallback callback,
+	const EventWatcher::SubscriptionOptions& options
+) {
+	return this->get_event_watcher()->subscribe(needle_id, std::move(callback), options);
+}
+
+bool RumbleLeague::unsubscribe(const EventWatcher::SubscriptionId subscription_id)
+{
+	return this->get_event_watcher()->unsubscribe(subscription_id);
+}
+
+EventWatcher* RumbleLeague::get_event_watcher()
 {
-	cv::Mat img_to_find = cv::imread(image_path, cv::IMREAD_COLOR);
-	cvtColor(img_to_find, needle_image, cv::COLOR_BGR2BGRA);
+	std::lock_guard<std::mutex> lock{ this->event_watcher_mutex };
+	if (this->event_watcher == nullptr)
+		this->event_watcher = new EventWatcher(this->frame_source, this->needle_resources);
+
+	return this->event_watcher;
 }
 
-void RumbleLeague::set_cpp_language(const int language_id)
+void RumbleLeague::watch_autoaccept()
+{
+	// A single watch at a time. Two of them would click the accept twice
+	FlowRuntime* flow_runtime = this->get_flow_runtime();
+	if (this->autoaccept_flow_id != 0)
+		flow_runtime->cancel(this->autoaccept_flow_id);
+
+	this->autoaccept_flow_id = this->start_flow(this->autoaccept_flow(), "autoaccept");
+	RUMBLE_LOG_INFO << "Waiting for the match to be found, to accept it";
+}
+
+void RumbleLeague::cancel_pending_waits()
+{
+	FlowRuntime* flow_runtime;
+	{
+		std::lock_guard<std::mutex> lock{ this->flow_runtime_mutex };
+		flow_runtime = this->flow_runtime;
+	}
+	if (flow_runtime == nullptr)
+		return;
+
+	if (this->autoaccept_flow_id != 0)
+		flow_runtime->cancel(this->autoaccept_flow_id);
+	if (this->wait_flow_id != 0)
+		flow_runtime->cancel(this->wait_flow_id);
+
+	this->autoaccept_flow_id = 0;
+	this->wait_flow_id = 0;
+}
+
+
+FlowRuntime* RumbleLeague::get_flow_runtime()
+{
+	std::lock_guard<std::mutex> lock{ this->flow_runtime_mutex };
+	if (this->flow_runtime == nullptr)
+	{
+		this->flow_runtime = new FlowRuntime;
+		this->owns_flow_runtime = true;
+	}
+
+	return this->flow_runtime;
+}
+
+void RumbleLeague::set_flow_runtime(FlowRuntime* flow_runtime)
+{
+	std::lock_guard<std::mutex> lock{ this->flow_runtime_mutex };
+	if (this->flow_runtime != nullptr)
+	{
+		RUMBLE_LOG_WARNING << "The flow runtime it's already in use, keeping it";
+		return;
+	}
+
+	this->flow_runtime = flow_runtime;
+}
+
+FlowRuntime::FlowId RumbleLeague::start_flow(FlowRuntime::Flow flow, const std::string& name)
+{
+	FlowRuntime* flow_runtime = this->get_flow_runtime();
+	const std::shared_ptr<FlowRuntime::FlowId> flow_id = std::make_shared<FlowRuntime::FlowId>(0);
+
+	// Held through the spawn, so a flow that finishes right away waits for its id to be recorded before forgetting it
+	std::lock_guard<std::mutex> lock{ this->flow_runtime_mutex };
+	*flow_id = flow_runtime->spawn(this->tracked_flow(std::move(flow), flow_id), name);
+	this->flow_ids.insert(*flow_id);
+	return *flow_id;
+}
+
+FlowRuntime::FlowId RumbleLeague::queue_and_lock_in(const std::string& champion)
+{
+	return this->start_flow(this->queue_flow(champion), "queue_" + champion);
+}
+
+bool RumbleLeague::cancel_flow(const FlowRuntime::FlowId flow_id)
+{
+	FlowRuntime* flow_runtime;
+	{
+		std::lock_guard<std::mutex> lock{ this->flow_runtime_mutex };
+		if (this->flow_ids.count(flow_id) == 0)
+			return false;
+		flow_runtime = this->flow_runtime;
+	}
+
+	return flow_runtime->cancel(flow_id);
+}
+
+
+/**
+* The flows. They run on the flow runtime thread, as the watcher callbacks did: only the input sink it's touched
+* there, and the screen it's updated by the next command
+*/
+FlowRuntime::Flow RumbleLeague::tracked_flow(FlowRuntime::Flow flow, const std::shared_ptr<FlowRuntime::FlowId> flow_id)
+{
+	try
+	{
+		co_await std::move(flow);
+	}
+	catch (...)
+	{
+		std::lock_guard<std::mutex> lock{ this->flow_runtime_mutex };
+		this->flow_ids.erase(*flow_id);
+		throw;
+	}
+
+	std::lock_guard<std::mutex> lock{ this->flow_runtime_mutex };
+	this->flow_ids.erase(*flow_id);
+}
+
+FlowRuntime::Flow RumbleLeague::autoaccept_flow()
+{
+	EventWatcher::SubscriptionOptions options;
+	options.polling_interval = RumbleLeague::accept_polling_interval;
+
+	const std::optional<EventWatcher::Event> accept = co_await this->get_flow_runtime()->appear(
+		this->get_event_watcher(), "accept_match", options
+	);
+	if (!accept)
+		co_return;
+
+	this->input_sink->left_click(accept->screen_location.x, accept->screen_location.y);
+	this->match_accepted = true;
+
+	const auto latency = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - accept->captured_at);
+	RUMBLE_LOG_INFO << "Match accepted " << latency.count() << "ms after it was seen";
+}
+
+FlowRuntime::Flow RumbleLeague::wait_event_flow(const std::string needle_id)
+{
+	const std::optional<EventWatcher::Event> event = co_await this->get_flow_runtime()->appear(this->get_event_watcher(), needle_id);
+	if (!event)
+		co_return;
+
+	this->input_sink->left_click(event->screen_location.x, event->screen_location.y);
+	RUMBLE_LOG_DEBUG << "Clicked " << needle_id << " as soon as it showed up";
+}
+
+FlowRuntime::Flow RumbleLeague::queue_flow(const std::string champion)
+{
+	FlowRuntime* runtime = this->get_flow_runtime();
+	EventWatcher* event_watcher = this->get_event_watcher();
+
+	const std::optional<EventWatcher::Event> find_game = co_await runtime->appear(
+		event_watcher, "find_game", EventWatcher::SubscriptionOptions{}, RumbleLeague::flow_step_timeout
+	);
+	if (!find_game)
+	{
+		RUMBLE_LOG_WARNING << "There is no find match button, the client isn't on a lobby";
+		co_return;
+	}
+	this->input_sink->left_click(find_game->screen_location.x, find_game->screen_location.y);
+
+	// The queue can take minutes. A match that somebody declines goes back to it, so the accept it's awaited again
+	EventWatcher::SubscriptionOptions accept_options;
+	accept_options.polling_interval = RumbleLeague::accept_polling_interval;
+
+	std::optional<EventWatcher::Event> search_bar;
+	while (!search_bar)
+	{
+		const std::optional<EventWatcher::Event> accept = co_await runtime->appear(event_watcher, "accept_match", accept_options);
+		if (!accept)
+			co_return;
+
+		this->input_sink->left_click(accept->screen_location.x, accept->screen_location.y);
+		this->match_accepted = true;
+		RUMBLE_LOG_INFO << "Match accepted, waiting for the champ select";
+
+		search_bar = co_await runtime->appear(
+			event_watcher, "search_bar", EventWatcher::SubscriptionOptions{}, RumbleLeague::champ_select_timeout
+		);
+	}
+
+	this->input_sink->left_click(search_bar->screen_location.x, search_bar->screen_location.y);
+	this->input_sink->type_text(champion);
+
+	// The lock in button it's only enabled once the user picks the champion from the search results
+	const std::optional<EventWatcher::Event> lock_in = co_await runtime->appear(
+		event_watcher, "lock_in", EventWatcher::SubscriptionOptions{}, RumbleLeague::pick_timeout
+	);
+	if (!lock_in)
+	{
+		RUMBLE_LOG_WARNING << "No champion was picked in time, nothing was locked in";
+		co_return;
+	}
+
+	this->input_sink->left_click(lock_in->screen_location.x, lock_in->screen_location.y);
+	RUMBLE_LOG_INFO << champion << " locked in";
+}
+
+Language RumbleLeague::language_from_id(const int language_id)
 {
 	// Switch statement prefered here 'cause potentially the API could be translated to more languages.
 	// Obviously, the default case always should be setted to a default language (English in this case),
@@ -254,14 +1023,11 @@ void RumbleLeague::set_cpp_language(const int language_id)
 	switch (language_id)
 	{
 		case 1:
-			this->language = Language::English;
-			break;
+			return Language::English;
 		case 2:
-			this->language = Language::Spanish;
-			break;
+			return Language::Spanish;
 		// ... case N
 		default:
-			this->language = Language::English;
-			break;
+			return Language::English;
 	}
 }
@@ -7,13 +7,33 @@
 
 #include "opencv2/opencv.hpp"
 
-#include "../motion/RumbleMotion.hpp"
-#include "../writer/RumbleWriter.h"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <thread>
+
 #include "../vision/RumbleVision.h"
+#include "NeedleResources.hpp"
+#include "ClickVerifier.hpp"
+#include "EventWatcher.hpp"
+#include "FlowRuntime.hpp"
+#include "SpeculativeMatcher.hpp"
+#include "CommandPredictor.hpp"
+#include "LayoutProfile.hpp"
+#include "../window_capture/FrameSource.hpp"
+#include "../input/InputSink.hpp"
+#include "../input/InputBackend.hpp"
+#ifdef _WIN32
 #include "../window_capture/WindowCapture.h"
+#include "../input/InputQueue.hpp"
+#include "../input/Win32InputBackend.hpp"
+#endif
 #include "league_client/LeagueClientScreen.hpp"
 #include "../helpers/StringHelper.hpp"
 #include "../helpers/EnumTypes.hpp"
+#include "../tracing/RumbleTrace.hpp"
+#include "../logger/RumbleLogger.hpp"
 
 
 class RumbleLeague
@@ -22,15 +42,32 @@ class RumbleLeague
 		// The title of the opencv generated window that shows the matching results if it's active (debug mode)
 		static constexpr const char* titlebar_window_name = "C++ Rumble AI League of Legends Extension";
 
-		// Counter for the active RumbleLeague instances
-		static int instances_counter;
+		// Counter for the active RumbleLeague instances. Atomic, since several clients can be driven from different threads
+		static std::atomic<int> instances_counter;
 
-		/*
-		* The amount of precision required to filter the image to find against a source. 
-		* Due to the match method used on the OpenCV library for this project, the lower the number, the higher precision should
-		* be required to a cv::Mat result to be considered as a match comparing images.
-		*/ 
-		static constexpr double threshold_rate = 0.05;
+		// Times that an unconfirmed click it's repeated before giving up and re-syncing the current screen
+		static constexpr int click_retries = 1;
+
+		// How often the accept button it's searched while waiting for a match. The accept latency stays under 100ms
+		static constexpr std::chrono::milliseconds accept_polling_interval{ 50 };
+
+		// Time for the button of a flow step (ie, the find match one of the lobby) to show up, before the flow gives up
+		static constexpr std::chrono::milliseconds flow_step_timeout{ 10000 };
+
+		// From the accept of a match until the champ select shows up. A match that somebody declined it's back on the queue by then
+		static constexpr std::chrono::milliseconds champ_select_timeout{ 15000 };
+
+		// Time for the user to pick the champion, until the lock in button it's enabled
+		static constexpr std::chrono::milliseconds pick_timeout{ 60000 };
+
+		// Buttons located in the background after every action, the most likely ones for the next command
+		static constexpr size_t prefetched_buttons = 3;
+
+		// Time that the client takes to paint the screen that a click leads to, before its buttons can be prefetched
+		static constexpr std::chrono::milliseconds prefetch_settle_delay{ 150 };
+
+		// Pixels of the frame, around the location of a button already known, where it's verified
+		static constexpr int hint_margin = 8;
 
 		// Control flag to allow the Python's side determine when it's desired to see some useful logs
 		// or even the OpenCV window showing how it's performing a match on the image
@@ -40,20 +77,35 @@ class RumbleLeague
 		// or if prefers to accept it / decline it by voice control
 		bool autoaccept_behaviour;
 
+		// The flow that accepts the match when it's found. Zero when there isn't one
+		FlowRuntime::FlowId autoaccept_flow_id;
+
+		// The flow that clicks the button of the last command once it shows up (ie, the accept one). Zero when there isn't one
+		FlowRuntime::FlowId wait_flow_id;
+
+		// Set by the flow runtime thread when it accepts a match. The next command moves the current screen to the champ select
+		std::atomic<bool> match_accepted;
+
 		// The current selected language, as a C++ enum variant. This tracks the language that the main API it's using,
 		// and acts as a flag for some common tree decision actions based on what the user it's quering.
 		Language language;
 
 
 		/*
-		* Declares our helper to get the video source
-		* BIG TODO -> On the named constructor, should implement a way to converse coordinates from a captured window,
-		* ie, the League of Legends window, instead of capturing the whole screen. Second way it's the implemented right now,
-		* because the match location also matches where the program should make the mouse click action.
-		* The W2 lib has a method that converts the internal window coordinates(Client) to Screen coordinates 
-		* -> ::ClientToScreen( hwndDesktop, mouse_click_point_ptr );
+		* Declares our helper to get the video source. By default, a WindowCapture of the League of Legends window,
+		* that also converts the match locations (client coordinates) into the screen coordinates where the click happens.
 		*/
-		WindowCapture* window_capture;
+		FrameSource* frame_source;
+
+		// Where the mouse clicks and keystrokes generated by the API are delivered. By default, an InputQueue
+		// that injects them in batches on the Windows desktop
+		InputSink* input_sink;
+
+		// The backend of the default InputQueue. Null when the input sink it's provided by the caller
+		InputBackend* input_backend;
+
+		// True when the frame source and the input sink were created (and must be released) by this object
+		bool owns_io_devices;
 
 		/*
 		* Rumble Vision.Tools for simulate vision skills for Rumble AI.The main goal of this object
@@ -62,6 +114,49 @@ class RumbleLeague
 		*/
 		RumbleLeagueVision* rumble_vision;
 
+		// The buttons, needles and learned thresholds of the language. Shared when several clients are driven together
+		NeedleResources* needle_resources;
+
+		// True when the needle resources were created (and must be released) by this object
+		bool owns_needle_resources;
+
+		// Confirms, through the next frames, that the clicks really reached the client
+		ClickVerifier* click_verifier;
+
+		// Notifies the needles that appears on the client, on its own thread. Created with the first subscription
+		EventWatcher* event_watcher;
+		std::mutex event_watcher_mutex;
+
+		// Runs the multi step flows of this client. Borrowed when several clients shares one, otherwise created with the first flow
+		FlowRuntime* flow_runtime;
+		bool owns_flow_runtime;
+		// The flows of this client that didn't finish yet, so they're cancelled (and joined) before the devices are released
+		std::set<FlowRuntime::FlowId> flow_ids;
+		std::mutex flow_runtime_mutex;
+
+		// Searches the most likely button of the command that it's still being spoken
+		SpeculativeMatcher* speculative_matcher;
+
+		// Learns which commands follows every screen, to prefetch their buttons
+		CommandPredictor* command_predictor;
+
+		// Where the buttons were seen on the current client size. Created (or replaced) when a frame of a new size arrives
+		LayoutProfile* layout_profile;
+
+		// Records every button of the screens that the client goes through, instead of just the clicked ones
+		bool layout_calibration;
+
+		// Enables the click confirmation. When disabled, every click it's assumed to succeed
+		bool click_verification;
+
+		// The frame where the last click_event searched its needle. The reference of the click confirmation
+		WorkingFrame last_video_source;
+
+		// The score of the search that found the last clicked button. A hit of its needle, once the client confirms the click
+		double last_click_score;
+		MatchPath last_click_path;
+		bool last_click_exact;
+
 		// The League of Legends client screen on which the user it's currently located
 		LeagueClientScreen* current_league_client_screen;
 
@@ -74,12 +169,6 @@ class RumbleLeague
 
 		/// Private methods. Should act as a helper for parse info or performs internal operations
 
-		/*
-		* Sets the language on this C++ library by taking the id of the language (provided via constructor from Rumble AI),
-		* and converting it into an variant of the Language (enum) type in the implementation of this method
-		*/
-		void set_cpp_language(const int language_id);
-
 		/*
 		* Designed to encapsulate the final behaviour of a move and click action on the RumbleLeague object.
 		* This method receives a needle image and inmedialy tries to found it on the video source, 
@@ -88,22 +177,100 @@ class RumbleLeague
 		* has to be awaited to found them. One example is the "Accept" game button or the "Decline" game button.
 		* For actions like this, please, refer to the ::wait_event() member method.
 		*/
-		cv::Point click_event(const cv::Mat& needle_image);
+		cv::Point click_event(const std::string& needle_id, const cv::Mat& needle_image);
+
+		// Clicks a button as soon as it appears on the screen. Waits on the flow runtime, so it returns right away
+		void wait_event(const std::string& needle_id);
+
+		/*
+		* A click_event that confirms that the client reacted to the click, by the needle going away or the anchor of
+		* the expected next screen appearing. An unconfirmed click (ie, one that landed during an animation) it's
+		* searched and clicked again, up to click_retries times. An unverified one it's never clicked again.
+		*/
+		ClickOutcome confirmed_click_event(const std::string& needle_id, const cv::Mat& needle_image);
+
+		/**
+		* Searches a needle just on the region around the location where it was seen before (client coordinates),
+		* instead of on the whole frame. Returns the location as click_event does, zero if it isn't there anymore
+		*/
+		cv::Point find_around(
+			WorkingFrame& video_source, const std::string& needle_id, const cv::Mat& needle_image, const cv::Point& hint, const double threshold
+		);
+
+		/**
+		* Picks, between the buttons that a command names, the one that's visible on the client. Every candidate it's
+		* searched on the same frame, and the search of the winner it's kept for its click
+		*/
+		const ClientButton* disambiguate(const std::vector<ClientButton*>& candidates);
+
+		// Locates, in the background, the buttons that the next command will most likely press from the current screen
+		void prefetch_next_buttons();
+
+		// The layout profile of the client size of a frame, loaded the first time that a frame of that size arrives
+		LayoutProfile* get_layout_profile(const WorkingFrame& video_source);
 
-		// Awaits until a event or a desired button to clicks appears on the screen and performs a click action against him
-		void wait_event(const cv::Mat& needle_image);
+		// Records on the layout profile the location of every button of the language that's visible on the current screen
+		void calibrate_layout_screen();
 
-		// Sets the image that will be the needle to detect against the video stream
-		void set_needle_image(const std::string& image_path, cv::Mat& needle_image);
+		// The image that will be the needle to detect against the video stream. Taken from the atlas if it has it, so it's read only
+		const cv::Mat& get_needle_image(const std::string& needle_id, const std::string& image_path);
 
 		// Executes an internal action of this API
 		void league_client_action(const ClientButton* const& client_button);
 
+		// Watches for the match to be found, and accepts it from the flow runtime as soon as it appears
+		void watch_autoaccept();
+
+		// Stops waiting for a match to accept, and for the button of the previous command, if it was
+		void cancel_pending_waits();
+
+		EventWatcher* get_event_watcher();
+		FlowRuntime* get_flow_runtime();
+
+		// Starts a flow of this client on the flow runtime
+		FlowRuntime::FlowId start_flow(FlowRuntime::Flow flow, const std::string& name);
+
+		/**
+		* The flows. Their parameters are taken by value, since a coroutine outlives the call that starts it
+		*/
+
+		// Runs a flow started by start_flow, and forgets its id once it finishes. The id it's set right after the spawn
+		FlowRuntime::Flow tracked_flow(FlowRuntime::Flow flow, const std::shared_ptr<FlowRuntime::FlowId> flow_id);
+
+		FlowRuntime::Flow autoaccept_flow();
+		FlowRuntime::Flow wait_event_flow(const std::string needle_id);
+		FlowRuntime::Flow queue_flow(const std::string champion);
+
 
 	public:
+		/*
+		* Gets the language for this C++ library by taking the id of the language (provided via constructor from Rumble AI),
+		* and converting it into an variant of the Language (enum) type in the implementation of this method
+		*/
+		static Language language_from_id(const int language_id);
+
 		// Constructors
+#ifdef _WIN32
 		RumbleLeague();
 		RumbleLeague(const int language_id, bool autoaccept_behaviour, const bool debug_mode);
+#endif
+		// Drives the API with any frame source and input sink. Both are borrowed, so the caller keeps the ownership
+		RumbleLeague(
+			const int language_id,
+			const bool autoaccept_behaviour,
+			const bool debug_mode,
+			FrameSource* frame_source,
+			InputSink* input_sink
+		);
+
+		// Same as above, but with needle resources shared with other clients. The language it's the one of the resources
+		RumbleLeague(
+			const bool autoaccept_behaviour,
+			const bool debug_mode,
+			FrameSource* frame_source,
+			InputSink* input_sink,
+			NeedleResources* needle_resources
+		);
 
 		// Copy constructor
 		RumbleLeague(const RumbleLeague &source);
@@ -117,4 +284,66 @@ class RumbleLeague
 		// The entry point for the Python API
 		const char* play(const std::string& user_input);
 
+		/**
+		* Takes a partial transcript of the command that the user it's still speaking, and starts searching the button
+		* that it will most likely press, so the final play only has to click it. Returns the identifier of that button,
+		* or an empty string if the transcript doesn't point to one yet. Nothing it's clicked until play is called
+		*/
+		const char* play_partial(const std::string& partial_input);
+
+		// Types a text (ie, a champion name on the search bar) where the keyboard focus currently is
+		void write(const std::string& text);
+
+		// Persists the learned per needle thresholds next to the assets. Also done on destruction
+		bool save_thresholds() const;
+
+		/**
+		* While enabled, every button visible on the current screen, and on every screen that the commands leads to,
+		* it's located and recorded on the layout profile of the client size. Walking the client once, the next sessions
+		* with that size starts by verifying each button where it was, instead of scanning the whole frame.
+		* Disabling it saves the profile
+		*/
+		void set_layout_calibration(const bool enabled);
+
+		/**
+		* Walks the client screens once by itself (the navbar, and the game modes of the choose game screen, without
+		* confirming any of them), recording the buttons of every screen, and saves the profile. Blocks until the walk
+		* ends. Returns false, without clicking anything, while the client it's on the queue or on the champ select
+		*/
+		bool calibrate_layout();
+
+		// Enables or disables the confirmation of the clicks, and sets the maximum time spent confirming each of them
+		void set_click_verification(const bool enabled, const int budget_ms = 250);
+
+		/**
+		* Changes the format of the frames where the needles are searched. Gray at half scale it's converted by
+		* the capture in a single pass and matched over a quarter of the pixels, at the cost of finer details
+		*/
+		void set_working_format(const ChannelMode channel_mode, const int downscale);
+
+		/**
+		* Notifies, from a background thread, every time that a needle of the assets appears on the client.
+		* Returns the id of the subscription, zero if there is no such needle
+		*/
+		EventWatcher::SubscriptionId subscribe(
+			const std::string& needle_id,
+			EventWatcher::EventCallback callback,
+			const EventWatcher::SubscriptionOptions& options = EventWatcher::SubscriptionOptions{}
+		);
+
+		bool unsubscribe(const EventWatcher::SubscriptionId subscription_id);
+
+		// Shares a flow runtime (ie, the one of a ClientScheduler) instead of creating one. Must be set before the first flow
+		void set_flow_runtime(FlowRuntime* flow_runtime);
+
+		/**
+		* Finds a match from the lobby, accepts it, searches the champion on the champ select and locks it in once the
+		* user picks it. Every step waits for its button to show up. Runs on the flow runtime, so it returns right away,
+		* with the id of the flow
+		*/
+		FlowRuntime::FlowId queue_and_lock_in(const std::string& champion);
+
+		// Stops a flow of this client. Returns false if it already finished
+		bool cancel_flow(const FlowRuntime::FlowId flow_id);
+
 };
\ No newline at end of file
@@ -0,0 +1,198 @@
+#include <exception>
+
+#include "SpeculativeMatcher.hpp"
+#include "../logger/RumbleLogger.hpp"
+#include "../tracing/RumbleTrace.hpp"
+
+
+SpeculativeMatcher::SpeculativeMatcher(
+	FrameSource* frame_source,
+	NeedleResources* needle_resources,
+	const std::chrono::milliseconds max_age
+)
+	: frame_source{ frame_source },
+	needle_resources{ needle_resources },
+	max_age{ max_age },
+	rumble_vision{ ChannelMode::BGRA, needle_resources->get_match_method() },
+	running_discarded{ false },
+	stopping{ false }
+{
+	this->rumble_vision.set_matcher_registry(needle_resources->get_matcher_registry());
+	this->rumble_vision.set_match_cache(needle_resources->get_match_cache());
+	this->rumble_vision.set_needle_thresholds(needle_resources->get_needle_thresholds());
+}
+
+SpeculativeMatcher::~SpeculativeMatcher()
+{
+	{
+		std::lock_guard<std::mutex> lock{ this->speculation_mutex };
+		this->stopping = true;
+	}
+	this->speculation_changed.notify_all();
+
+	if (this->speculation_thread.joinable())
+		this->speculation_thread.join();
+}
+
+
+void SpeculativeMatcher::speculate(
+	const std::string& needle_id, const cv::Mat& needle_image, const WorkingFormat& working_format, const double threshold
+) {
+	{
+		std::lock_guard<std::mutex> lock{ this->speculation_mutex };
+
+		if (this->running_needle_ids.count(needle_id) > 0)
+			return;
+
+		// A miss it's searched again, the button can be showing up
+		const auto finished = this->finished.find(needle_id);
+		if (finished != this->finished.end() && finished->second.location != cv::Point{ 0, 0 }
+			&& std::chrono::steady_clock::now() - finished->second.captured_at < this->max_age)
+			return;
+
+		this->pending = Request{ { Needle{ needle_id, needle_image, threshold } }, working_format, std::chrono::steady_clock::now() };
+
+		if (!this->speculation_thread.joinable())
+			this->speculation_thread = std::thread{ &SpeculativeMatcher::speculation_loop, this };
+	}
+	this->speculation_changed.notify_all();
+
+	RUMBLE_LOG_TRACE << "Speculating on " << needle_id;
+}
+
+void SpeculativeMatcher::prefetch(
+	const std::vector<Needle>& needles, const WorkingFormat& working_format, const std::chrono::milliseconds settle_delay
+) {
+	if (needles.empty())
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock{ this->speculation_mutex };
+		this->pending = Request{ needles, working_format, std::chrono::steady_clock::now() + settle_delay };
+
+		if (!this->speculation_thread.joinable())
+			this->speculation_thread = std::thread{ &SpeculativeMatcher::speculation_loop, this };
+	}
+	this->speculation_changed.notify_all();
+
+	RUMBLE_LOG_TRACE << "Prefetching " << needles.size() << " needles, starting with " << needles.front().needle_id;
+}
+
+SpeculativeMatcher::Freshness SpeculativeMatcher::claim(const std::string& needle_id, Speculation& speculation)
+{
+	std::unique_lock<std::mutex> lock{ this->speculation_mutex };
+
+	// Already half way. Waiting for it it's never slower than starting over
+	this->speculation_changed.wait(lock, [this, &needle_id]() {
+		return this->stopping || this->running_needle_ids.count(needle_id) == 0;
+	});
+
+	const auto finished = this->finished.find(needle_id);
+	if (finished == this->finished.end())
+		return Freshness::Missing;
+
+	speculation = std::move(finished->second);
+	this->finished.erase(finished);
+	lock.unlock();
+
+	if (speculation.location == cv::Point{ 0, 0 })
+		return Freshness::Missing;
+
+	const auto age = std::chrono::steady_clock::now() - speculation.captured_at;
+	if (age >= this->max_age)
+	{
+		RUMBLE_LOG_TRACE << "The speculation on " << needle_id << " it's "
+			<< std::chrono::duration_cast<std::chrono::milliseconds>(age).count() << "ms old, it must be verified";
+		return Freshness::Stale;
+	}
+
+	return Freshness::Fresh;
+}
+
+void SpeculativeMatcher::offer(Speculation speculation)
+{
+	std::lock_guard<std::mutex> lock{ this->speculation_mutex };
+	this->finished[ speculation.needle_id ] = std::move(speculation);
+}
+
+void SpeculativeMatcher::discard()
+{
+	std::lock_guard<std::mutex> lock{ this->speculation_mutex };
+	this->pending = Request{};
+	this->finished.clear();
+	this->running_discarded = !this->running_needle_ids.empty();
+}
+
+
+void SpeculativeMatcher::speculation_loop()
+{
+	std::unique_lock<std::mutex> lock{ this->speculation_mutex };
+
+	while (true)
+	{
+		this->speculation_changed.wait(lock, [this]() { return this->stopping || !this->pending.needles.empty(); });
+		if (this->stopping)
+			return;
+
+		// A newer request, or a discard, can still replace this one while the client settles
+		const auto not_before = this->pending.not_before;
+		this->speculation_changed.wait_until(lock, not_before, [this]() {
+			return this->stopping || this->pending.needles.empty() || this->pending.not_before <= std::chrono::steady_clock::now();
+		});
+		if (this->stopping)
+			return;
+		if (this->pending.needles.empty() || std::chrono::steady_clock::now() < this->pending.not_before)
+			continue;
+
+		const Request request = std::move(this->pending);
+		this->pending = Request{};
+		for (const Needle& needle : request.needles)
+			this->running_needle_ids.insert(needle.needle_id);
+		this->running_discarded = false;
+		lock.unlock();
+
+		std::vector<Speculation> speculations;
+		try
+		{
+			RUMBLE_TRACE_SCOPE("speculative_match");
+
+			// The commands can change their working format between two speculations
+			const WorkingFormat current_format = this->rumble_vision.get_working_format();
+			if (current_format.channel_mode != request.working_format.channel_mode
+				|| current_format.downscale != request.working_format.downscale)
+				this->rumble_vision.set_working_format(request.working_format.channel_mode, request.working_format.downscale);
+
+			// One capture for all of them
+			WorkingFrame frame;
+			this->frame_source->get_working_frame(this->rumble_vision.get_working_format(), frame);
+			const auto captured_at = std::chrono::steady_clock::now();
+
+			for (const Needle& needle : request.needles)
+			{
+				Speculation speculation{ needle.needle_id, frame, cv::Point{ 0, 0 }, 1.0, false, MatchPath::Full, captured_at };
+				if (!frame.image.empty())
+				{
+					speculation.location = this->rumble_vision.find(
+						frame, needle.needle_id, needle.needle_image,
+						this->needle_resources->get_compiled_needles()->get(needle.needle_id), needle.threshold
+					);
+					speculation.score = this->rumble_vision.get_last_score();
+					speculation.exact_score = this->rumble_vision.is_last_score_exact();
+					speculation.path = this->rumble_vision.get_last_match_path();
+				}
+				speculations.push_back(std::move(speculation));
+			}
+		}
+		catch (const std::exception& error)
+		{
+			RUMBLE_LOG_ERROR << "The speculative search of " << request.needles.front().needle_id << " failed: " << error.what();
+		}
+
+		lock.lock();
+		this->running_needle_ids.clear();
+		if (!this->running_discarded)
+			for (Speculation& speculation : speculations)
+				this->finished[ speculation.needle_id ] = std::move(speculation);
+		this->speculation_changed.notify_all();
+	}
+}
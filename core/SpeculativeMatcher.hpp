@@ -0,0 +1,141 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "NeedleResources.hpp"
+#include "../vision/RumbleVision.h"
+#include "../window_capture/FrameSource.hpp"
+
+/// <summary>
+/// Searches, on a background thread, the needles of the buttons that the next command will most likely press,
+/// so the command finds them already located.
+///
+/// Two kinds of requests gets here. The partial transcripts of the speech recognition, while the user it's still
+/// speaking, point to a single button. After every action, the buttons that usually follows it are prefetched
+/// together, on one capture. Only the latest request counts: a new one replaces the one that wasn't started yet.
+///
+/// A fresh speculation (younger than max_age) it's trusted as it is. An older one still tells where the button was,
+/// so the command only has to verify the small region around it, instead of searching the whole frame.
+/// </summary>
+class SpeculativeMatcher
+{
+	public:
+		// A finished search of a needle
+		struct Speculation
+		{
+			std::string needle_id;
+			WorkingFrame frame;
+			// Center of the needle, on client coordinates. Zero if it wasn't on the frame
+			cv::Point location;
+			double score;
+			// A bounded miss of the cascade isn't a real score, so it can't teach the thresholds
+			bool exact_score;
+			MatchPath path;
+			std::chrono::steady_clock::time_point captured_at;
+		};
+
+		enum class Freshness
+		{
+			// There is no speculation of the needle, or the needle wasn't on its frame
+			Missing,
+			// Its location it's a hint, to be verified on a new frame
+			Stale,
+			// Good enough to click on it right away
+			Fresh
+		};
+
+		// A needle to be searched, with the threshold that decides whether it's on the frame
+		struct Needle
+		{
+			std::string needle_id;
+			cv::Mat needle_image;
+			double threshold;
+		};
+
+	private:
+		struct Request
+		{
+			std::vector<Needle> needles;
+			WorkingFormat working_format;
+			// The capture waits until then, ie, until the client finishes the transition to its new screen
+			std::chrono::steady_clock::time_point not_before;
+		};
+
+		// Borrowed. The frame source must be safe to be shared with the thread that runs the commands
+		FrameSource* frame_source;
+		NeedleResources* needle_resources;
+
+		// Age from which a speculation it's no longer trusted without a verification
+		std::chrono::milliseconds max_age;
+
+		// Its own engine, since the engines keeps the score of their last search
+		RumbleLeagueVision rumble_vision;
+
+		// The next needles to search. Empty when there are none
+		Request pending;
+		// The needles that the thread it's searching right now. Empty when it's idle
+		std::set<std::string> running_needle_ids;
+		// Discarded while they were running, so their results are dropped
+		bool running_discarded;
+		// The results of the finished searches, by needle. Removed when they're claimed
+		std::map<std::string, Speculation> finished;
+
+		bool stopping;
+
+		std::mutex speculation_mutex;
+		// Wakes up the thread with a new request, and the claims with a finished search
+		std::condition_variable speculation_changed;
+		std::thread speculation_thread;
+
+		void speculation_loop();
+
+	public:
+		SpeculativeMatcher(
+			FrameSource* frame_source,
+			NeedleResources* needle_resources,
+			const std::chrono::milliseconds max_age = std::chrono::milliseconds{ 500 }
+		);
+
+		// Stops the thread. Waits for the search that's running, if any
+		~SpeculativeMatcher();
+
+		SpeculativeMatcher(const SpeculativeMatcher&) = delete;
+		SpeculativeMatcher& operator=(const SpeculativeMatcher&) = delete;
+
+		/**
+		* Requests the search of a needle on the next frame, on the given working format. Replaces the pending request,
+		* if any. Nothing it's requested if the same needle it's already being searched, or has a fresh speculation
+		*/
+		void speculate(
+			const std::string& needle_id, const cv::Mat& needle_image, const WorkingFormat& working_format, const double threshold
+		);
+
+		/**
+		* Requests the search of several needles on the same frame, captured once "settle_delay" has passed.
+		* Replaces the pending request, if any
+		*/
+		void prefetch(
+			const std::vector<Needle>& needles, const WorkingFormat& working_format, const std::chrono::milliseconds settle_delay
+		);
+
+		/**
+		* Takes the speculation of a needle. A search of the needle that's still running it's waited for, since it's
+		* already ahead of a new one. Unless it's fresh, the caller must verify it, or capture and search by itself
+		*/
+		Freshness claim(const std::string& needle_id, Speculation& speculation);
+
+		// Keeps a search that the caller already did, to be claimed as any other speculation
+		void offer(Speculation speculation);
+
+		// Drops the pending request and the finished searches. The client, or the hypotheses of the user, went away from them
+		void discard();
+};
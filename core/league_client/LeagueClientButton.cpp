@@ -1,9 +1,10 @@
-#include <string.h>
+#include <cstring>
 #include <ostream>
 #include <iostream>
 
 #include "LeagueClientButton.hpp"
 #include "../../helpers/EnumTypes.hpp"
+#include "../../logger/RumbleLogger.hpp"
  
 
 /// Four parameters delegating constructor
@@ -31,15 +32,31 @@ ClientButton::ClientButton(
 	const LeagueClientScreenIdentifier lobby
 )
 	: identifier{ const_cast<char*>(identifier)  }, 
+	image_name{ image_path },
 	image_path{ image_path }, 
 	next_screen{ next_screen }, 
 	selected_language{ selected_language },
 	lobby{ lobby }
 {
-	std::string base_path{ "../assets/" };
+	std::string base_path{ ClientButton::assets_directory(selected_language) };
 	std::string image_extension{ ".jpg" };
 
-	switch (selected_language)
+	base_path.append("/").append(image_path).append(image_extension);
+	this->image_path = base_path;
+}
+
+std::string ClientButton::assets_root{ "../assets" };
+
+void ClientButton::set_assets_root(const std::string& path)
+{
+	ClientButton::assets_root = path;
+}
+
+std::string ClientButton::assets_directory(const Language language)
+{
+	std::string base_path{ ClientButton::assets_root + "/" };
+
+	switch (language)
 	{
 		case Language::English:
 			base_path.append("EN");
@@ -51,8 +68,7 @@ ClientButton::ClientButton(
 			base_path.append("EN");
 	};
 
-	base_path.append("/").append(image_path).append(image_extension);
-	this->image_path = base_path;
+	return base_path;
 }
 
 // Copy constructor
@@ -62,25 +78,27 @@ ClientButton::ClientButton(const ClientButton &source)
 	identifier = new char[ strlen(source.identifier) + 1 ];
 	strcpy(identifier, source.identifier);
 	// Shallow copy for the rest of the members
+	image_name = source.image_name;
 	image_path = source.image_path;
 	next_screen = source.next_screen;
 	selected_language = source.selected_language;
 	lobby = source.lobby;
 
-	std::cout << "[Warning]  - Copy constructor called for " << identifier << std::endl;
+	RUMBLE_LOG_TRACE << "Copy constructor called for " << identifier;
 }
 
 // Move constructor
 ClientButton::ClientButton(ClientButton &&source) noexcept
 	: identifier { source.identifier },
-	image_path { source.image_path },
+	image_name { std::move(source.image_name) },
+	image_path { std::move(source.image_path) },
 	next_screen { source.next_screen },
 	selected_language { source.selected_language },
 	lobby { source.lobby}
 {
 	// Now we null the raw pointer that contains the moved data from the another resource
 	source.identifier = nullptr;
-	std::cout << "[Info] - Move constructor called for " << identifier << std::endl;
+	RUMBLE_LOG_TRACE << "Move constructor called for " << identifier;
 }
 
 // Destructor 
@@ -89,24 +107,25 @@ ClientButton::~ClientButton()
 	// Just debugging if we are correctly using the move constructor.
 	if (identifier != nullptr)
 	{
-		std::cout << "Destructor freeing data for " << identifier << std::endl;
+		RUMBLE_LOG_TRACE << "Destructor freeing data for " << identifier;
 	}
 	else 
 	{
-		std::cout << "Destructor freeing data for nullptr" << std::endl;
+		RUMBLE_LOG_TRACE << "Destructor freeing data for nullptr";
 	}
 }
 
 // Copy assigment operator overload
 ClientButton &ClientButton::operator=(const ClientButton &rhs)
 {
-	std::cout << "Using copy assignment" << std::endl;
+	RUMBLE_LOG_TRACE << "Using copy assignment";
 	if (this == &rhs)
 		return *this;
 
 	this->identifier = new char[ std::strlen(rhs.identifier) + 1 ];
 	std::strcpy( this->identifier, rhs.identifier );
 
+	image_name = rhs.image_name;
 	image_path = rhs.image_path;
 	next_screen = rhs.next_screen;
 	selected_language = rhs.selected_language;
@@ -118,7 +137,7 @@ ClientButton &ClientButton::operator=(const ClientButton &rhs)
 // Move assignment operator overload
 ClientButton &ClientButton::operator=(ClientButton &&rhs)
 {
-	std::cout << "Using move assignment" << std::endl;
+	RUMBLE_LOG_TRACE << "Using move assignment";
 	if (this == &rhs)
 		return *this;
 
@@ -128,7 +147,8 @@ ClientButton &ClientButton::operator=(ClientButton &&rhs)
 	identifier = rhs.identifier;
 	rhs.identifier = nullptr;
 
-	image_path = rhs.image_path;
+	image_name = std::move(rhs.image_name);
+	image_path = std::move(rhs.image_path);
 	next_screen = rhs.next_screen;
 	selected_language = rhs.selected_language;
 	lobby = rhs.lobby;
@@ -7,6 +7,8 @@
 struct ClientButton
 {
 	char* identifier;
+	// The name of the needle image on the assets, without folder nor extension. Identifies the needle across the API
+	std::string image_name;
 	std::string image_path;
 	// When clicked, informs about what screen will follows the current one
 	LeagueClientScreenIdentifier next_screen;
@@ -46,4 +48,15 @@ struct ClientButton
 
 	// Move assignment operator overload
 	ClientButton &operator=(ClientButton &&rhs);
+
+	// The folder where the assets of a language lives, inside the assets root
+	static std::string assets_directory(const Language language);
+
+	/**
+	* The folder that contains the assets of every language. By default, relative to the python_mod folder,
+	* so the working directory must be that one. Setting an absolute path removes that requirement.
+	* Must be set before creating any RumbleLeague object
+	*/
+	static std::string assets_root;
+	static void set_assets_root(const std::string& path);
 };
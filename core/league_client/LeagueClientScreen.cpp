@@ -1,4 +1,5 @@
 #include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <string>
 #include <sstream>
@@ -10,6 +11,7 @@
 #include "../../helpers/EnumTypes.hpp"
 #include "../../data/API_buttons.hpp"
 #include "../../helpers/StringHelper.hpp"
+#include "../../logger/RumbleLogger.hpp"
 
 using namespace std;
 
@@ -23,6 +25,14 @@ LeagueClientScreen::LeagueClientScreen(const Language& selected_language)
 {
 	this->client_buttons = RLE_data::get_buttons(this->get_selected_language());
 }
+/**
+* Shared buttons constructor.
+*/
+LeagueClientScreen::LeagueClientScreen(const Language& selected_language, const std::vector<ClientButton*>& client_buttons)
+	: identifier{ LeagueClientScreenIdentifier::MainScreen },
+	selected_language{ selected_language },
+	client_buttons{ client_buttons } {}
+
 /**
 * Default constructor.
 * 
@@ -43,7 +53,7 @@ LeagueClientScreen::LeagueClientScreen()
 */
 LeagueClientScreen::~LeagueClientScreen()
 {
-	std::cout << "Destructor called on the screen of LeagueClientScreen: " << this->get_identifier() << std::endl;
+	RUMBLE_LOG_DEBUG << "Destructor called on the screen of LeagueClientScreen: " << this->get_identifier();
 }
 
 
@@ -63,11 +73,10 @@ std::vector<ClientButton*> LeagueClientScreen::find_client_button(const std::str
 	splitted_input = StringHelper::split_by_delimiter(user_input, ' ', splitted_input);
 
 	// Outputing debug info to the console
-	std::cout << "\nSplitted user input: " << std::endl;
 	for (int i = 0; i < splitted_input.size(); i++)
-		std::cout << "    N" << i + 1 << ": " << splitted_input[i] << std::endl;
+		RUMBLE_LOG_TRACE << "Splitted user input N" << i + 1 << ": " << splitted_input[i];
 
-	std::cout << "\nGetting data from: " << this->get_identifier() << std::endl;
+	RUMBLE_LOG_TRACE << "Getting data from: " << this->get_identifier();
 	
 	// Calls the method on the current selected child screen and recovers the client buttons pointers
 	// associated with that screen
@@ -84,7 +93,7 @@ std::vector<ClientButton*> LeagueClientScreen::find_client_button(const std::str
 			
 			if ( strcmp(buttons[i]->identifier, word.c_str()) == 0 ) 
 			{
-				std::cout << "\t Match founded!" << std::endl;
+				RUMBLE_LOG_TRACE << "Match founded: " << word;
 				matched_buttons.push_back(buttons[i]);
 			}
 			else 
@@ -96,6 +105,36 @@ std::vector<ClientButton*> LeagueClientScreen::find_client_button(const std::str
 	return matched_buttons;
 }
 
+std::vector<ClientButton*> LeagueClientScreen::find_client_button_candidates(const std::string& partial_input, size_t& complete_matches)
+{
+	std::vector<std::string> splitted_input;
+	splitted_input = StringHelper::split_by_delimiter(partial_input, ' ', splitted_input);
+
+	// The last word it's still being spoken, unless the recognizer already closed it
+	std::string cut_word;
+	if (!splitted_input.empty() && !partial_input.empty() && partial_input.back() != ' ')
+	{
+		cut_word = splitted_input.back();
+		splitted_input.pop_back();
+	}
+
+	std::vector<ClientButton*> candidates {};
+	std::vector<ClientButton*> buttons = this->get_client_buttons();
+
+	for (const auto& word : splitted_input)
+		for (ClientButton* button : buttons)
+			if (strcmp(button->identifier, word.c_str()) == 0)
+				candidates.push_back(button);
+	complete_matches = candidates.size();
+
+	if (!cut_word.empty())
+		for (ClientButton* button : buttons)
+			if (strncmp(button->identifier, cut_word.c_str(), cut_word.size()) == 0)
+				candidates.push_back(button);
+
+	return candidates;
+}
+
 
 /**
 * Getters
@@ -115,6 +154,11 @@ const Language& LeagueClientScreen::get_selected_language()
 	return this->selected_language;
 }
 
+const char* LeagueClientScreen::get_anchor()
+{
+	return RLE_data::screen_anchor(this->identifier);
+}
+
 
 /**
 * Setters
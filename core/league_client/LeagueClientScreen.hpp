@@ -27,6 +27,8 @@ class LeagueClientScreen
 		// Constructors
 		LeagueClientScreen();
 		LeagueClientScreen(const Language &language);
+		// Uses buttons created (and owned) by someone else, ie, shared between the screens of several clients
+		LeagueClientScreen(const Language &language, const std::vector<ClientButton*>& client_buttons);
 
 		// Destructor
 		~LeagueClientScreen();
@@ -35,11 +37,20 @@ class LeagueClientScreen
 		LeagueClientScreenIdentifier get_identifier();
 		std::vector<ClientButton*> get_client_buttons();
 		const Language& get_selected_language();
+		// The needle that identifies this screen on the client, or nullptr if it hasn't any
+		const char* get_anchor();
 
 		// Setters
 		void set_identifier(LeagueClientScreenIdentifier identifier);
 
 		// Methods
 		std::vector<ClientButton*> find_client_button(const std::string &user_input);
+
+		/**
+		* The buttons that a partial transcript (still being spoken) can end up pressing. The complete words are matched
+		* as find_client_button does, and go first. The last word can be cut, so it's matched as the start of an identifier,
+		* unless the transcript ends with a space. The number of buttons named by complete words it's left on "complete_matches"
+		*/
+		std::vector<ClientButton*> find_client_button_candidates(const std::string &partial_input, size_t &complete_matches);
 		
 };
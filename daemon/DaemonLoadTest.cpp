@@ -0,0 +1,253 @@
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "DaemonProtocol.hpp"
+#include "DaemonSocket.hpp"
+
+/**
+* Load test of a running Rumble daemon.
+*
+* Opens several connections and, on each of them, keeps a fixed number of requests in flight (the pipelining depth)
+* until all of them are answered. The commands are spread over the sessions of the daemon, round robin:
+*     ./rumble_daemon_load --socket=/tmp/rle.sock [--connections=4] [--requests=1000] [--depth=16] [--command=play]
+*
+* --command=ping measures the protocol alone. Reports the throughput, the round trip latency seen by the clients and
+* the queue / run times reported by the daemon, in microseconds.
+*/
+
+namespace {
+
+	using Clock = std::chrono::steady_clock;
+
+	// A whole non negative number, nothing else. std::stoul throws on garbage and takes "12abc" or "-1" as numbers
+	bool parse_count(const std::string& text, size_t& value)
+	{
+		const char* const end = text.data() + text.size();
+		const std::from_chars_result result = std::from_chars(text.data(), end, value);
+		return !text.empty() && result.ec == std::errc{} && result.ptr == end;
+	}
+
+	struct Options
+	{
+		std::string socket_path;
+		size_t connections = 4;
+		size_t requests = 1000;
+		size_t depth = 16;
+		std::string command{ "play" };
+	};
+
+	struct Samples
+	{
+		std::vector<double> round_trip_us;
+		std::vector<double> queue_us;
+		std::vector<double> run_us;
+		size_t errors = 0;
+	};
+
+	double percentile(std::vector<double>& values, const double p)
+	{
+		if (values.empty())
+			return 0.0;
+
+		const size_t index = static_cast<size_t>(p * (values.size() - 1) + 0.5);
+		std::nth_element(values.begin(), values.begin() + index, values.end());
+		return values[ index ];
+	}
+
+	bool send_request(const DaemonSocket::Handle handle, const DaemonProtocol::RequestHeader& header, const std::string& payload)
+	{
+		std::vector<unsigned char> frame(DaemonProtocol::request_header_size + payload.size());
+		DaemonProtocol::encode(header, frame.data());
+		std::copy(payload.begin(), payload.end(), frame.begin() + DaemonProtocol::request_header_size);
+		return DaemonSocket::write_all(handle, frame.data(), frame.size());
+	}
+
+	bool read_response(const DaemonSocket::Handle handle, DaemonProtocol::ResponseHeader& header, std::string& payload)
+	{
+		unsigned char header_bytes[ DaemonProtocol::response_header_size ];
+		if (!DaemonSocket::read_exact(handle, header_bytes, sizeof(header_bytes)))
+			return false;
+
+		header = DaemonProtocol::decode_response(header_bytes);
+		payload.resize(header.payload_length);
+		return DaemonSocket::read_exact(handle, payload.data(), payload.size());
+	}
+
+	DaemonSocket::Handle open_connection(const std::string& socket_path)
+	{
+		const DaemonSocket::Handle handle = DaemonSocket::connect_to(socket_path);
+		if (handle != DaemonSocket::invalid_handle
+			&& !DaemonSocket::write_all(handle, DaemonProtocol::handshake, sizeof(DaemonProtocol::handshake)))
+		{
+			DaemonSocket::close(handle);
+			return DaemonSocket::invalid_handle;
+		}
+		return handle;
+	}
+
+	uint32_t query_sessions(const std::string& socket_path)
+	{
+		const DaemonSocket::Handle handle = open_connection(socket_path);
+		if (handle == DaemonSocket::invalid_handle)
+			return 0;
+
+		DaemonProtocol::ResponseHeader response{};
+		std::string payload;
+		uint32_t sessions = 0;
+		if (send_request(handle, { 0, 0, DaemonProtocol::Opcode::Sessions, 0 }, "")
+			&& read_response(handle, response, payload) && payload.size() == 4)
+			sessions = DaemonProtocol::get_u32(reinterpret_cast<const unsigned char*>(payload.data()));
+
+		DaemonSocket::close(handle);
+		return sessions;
+	}
+
+	/**
+	* Drives one connection: fills the pipeline up to the depth, and sends a new request for every response
+	* until all the requests of the connection are answered.
+	*/
+	Samples drive_connection(const Options& options, const size_t connection_index, const uint32_t sessions)
+	{
+		Samples samples;
+		const DaemonSocket::Handle handle = open_connection(options.socket_path);
+		if (handle == DaemonSocket::invalid_handle)
+		{
+			samples.errors = options.requests;
+			return samples;
+		}
+
+		const bool ping = options.command == "ping";
+		const DaemonProtocol::Opcode opcode = ping ? DaemonProtocol::Opcode::Ping : DaemonProtocol::Opcode::Play;
+		const std::string payload = ping ? std::string{} : options.command;
+
+		std::unordered_map<uint32_t, Clock::time_point> sent_at;
+		uint32_t next_request = 0;
+		size_t answered = 0;
+
+		auto send_next = [&]() {
+			const uint32_t request_id = next_request++;
+			const uint16_t session_id = static_cast<uint16_t>((connection_index + request_id) % sessions);
+			sent_at[ request_id ] = Clock::now();
+			return send_request(handle, { request_id, session_id, opcode, static_cast<uint32_t>(payload.size()) }, payload);
+		};
+
+		bool healthy = true;
+		while (healthy && next_request < options.requests && next_request < options.depth)
+			healthy = send_next();
+
+		DaemonProtocol::ResponseHeader response{};
+		std::string answer;
+		while (healthy && answered < next_request && read_response(handle, response, answer))
+		{
+			const auto sent = sent_at.find(response.request_id);
+			if (sent != sent_at.end())
+			{
+				samples.round_trip_us.push_back(std::chrono::duration<double, std::micro>(Clock::now() - sent->second).count());
+				sent_at.erase(sent);
+			}
+			if (response.status == DaemonProtocol::Status::Ok)
+			{
+				samples.queue_us.push_back(response.queue_us);
+				samples.run_us.push_back(response.run_us);
+			}
+			else
+				++samples.errors;
+			++answered;
+
+			if (next_request < options.requests)
+				healthy = send_next();
+		}
+
+		samples.errors += options.requests - answered;
+		DaemonSocket::close(handle);
+		return samples;
+	}
+}
+
+
+int main(int argc, char** argv)
+{
+	Options options;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const std::string arg{ argv[ i ] };
+		bool valid = true;
+		if (arg.rfind("--socket=", 0) == 0)
+			options.socket_path = arg.substr(std::strlen("--socket="));
+		else if (arg.rfind("--connections=", 0) == 0)
+			valid = parse_count(arg.substr(std::strlen("--connections=")), options.connections) && options.connections > 0;
+		else if (arg.rfind("--requests=", 0) == 0)
+			valid = parse_count(arg.substr(std::strlen("--requests=")), options.requests);
+		else if (arg.rfind("--depth=", 0) == 0)
+			valid = parse_count(arg.substr(std::strlen("--depth=")), options.depth) && options.depth > 0;
+		else if (arg.rfind("--command=", 0) == 0)
+			options.command = arg.substr(std::strlen("--command="));
+		else
+			valid = false;
+
+		if (!valid)
+		{
+			std::cerr << "Invalid option " << arg << std::endl;
+			options.socket_path.clear();
+			break;
+		}
+	}
+
+	if (options.socket_path.empty())
+	{
+		std::cerr << "Usage: rumble_daemon_load --socket=<path> [--connections=4] [--requests=1000] [--depth=16] [--command=play|ping]" << std::endl;
+		return 1;
+	}
+
+	if (!DaemonSocket::startup())
+		return 1;
+
+	const uint32_t sessions = query_sessions(options.socket_path);
+	if (sessions == 0)
+	{
+		std::cerr << "No daemon with sessions on " << options.socket_path << std::endl;
+		return 1;
+	}
+
+	Samples all_samples;
+	std::mutex samples_mutex;
+	std::vector<std::thread> clients;
+
+	const auto start = Clock::now();
+	for (size_t i = 0; i < options.connections; i++)
+		clients.emplace_back([&, i]() {
+			Samples samples = drive_connection(options, i, sessions);
+
+			std::lock_guard<std::mutex> lock{ samples_mutex };
+			all_samples.round_trip_us.insert(all_samples.round_trip_us.end(), samples.round_trip_us.begin(), samples.round_trip_us.end());
+			all_samples.queue_us.insert(all_samples.queue_us.end(), samples.queue_us.begin(), samples.queue_us.end());
+			all_samples.run_us.insert(all_samples.run_us.end(), samples.run_us.begin(), samples.run_us.end());
+			all_samples.errors += samples.errors;
+		});
+
+	for (std::thread& client : clients)
+		client.join();
+	const double elapsed_s = std::chrono::duration<double>(Clock::now() - start).count();
+
+	std::cout << "sessions " << sessions << ", connections " << options.connections << ", depth " << options.depth << std::endl;
+	std::cout << "answered " << all_samples.round_trip_us.size() << ", errors " << all_samples.errors
+		<< ", " << (all_samples.round_trip_us.size() / elapsed_s) << " requests/s" << std::endl;
+	std::cout << "round trip us: p50 " << percentile(all_samples.round_trip_us, 0.50)
+		<< ", p99 " << percentile(all_samples.round_trip_us, 0.99) << std::endl;
+	std::cout << "queue us: p50 " << percentile(all_samples.queue_us, 0.50)
+		<< ", p99 " << percentile(all_samples.queue_us, 0.99) << std::endl;
+	std::cout << "run us: p50 " << percentile(all_samples.run_us, 0.50)
+		<< ", p99 " << percentile(all_samples.run_us, 0.99) << std::endl;
+
+	return all_samples.errors == 0 ? 0 : 1;
+}
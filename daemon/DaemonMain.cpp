@@ -0,0 +1,166 @@
+#include <charconv>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "RumbleDaemon.hpp"
+#include "../core/ClientScheduler.hpp"
+#include "../input/InputQueue.hpp"
+#include "../input/MockInputBackend.hpp"
+#include "../logger/RumbleLogger.hpp"
+#include "../window_capture/ImageSequenceSource.hpp"
+
+/**
+* Rumble daemon.
+*
+* One warm engine per host: loads the assets of a language once, opens the client sessions and serves the commands
+* of every local client through a Unix domain socket (see DaemonProtocol.hpp):
+*     ./rumble_daemon --socket=/tmp/rle.sock [--language=1] [--workers=0] [--assets=<assets root>]
+*
+* On Windows, every window of the League client becomes a session (--window=<title> to change the title).
+* Anywhere, --frames=<dir> replaces the real clients with --sessions=N replayed ones, over a folder of recorded frames
+* and without touching the desktop, to load test the daemon locally.
+*/
+
+namespace {
+
+	RumbleDaemon* running_daemon = nullptr;
+
+	void on_stop_signal(int)
+	{
+		if (running_daemon != nullptr)
+			running_daemon->stop();
+	}
+
+	// A whole non negative number, nothing else. std::stoul throws on garbage and takes "12abc" or "-1" as numbers
+	bool parse_count(const std::string& text, size_t& value)
+	{
+		const char* const end = text.data() + text.size();
+		const std::from_chars_result result = std::from_chars(text.data(), end, value);
+		return !text.empty() && result.ec == std::errc{} && result.ptr == end;
+	}
+
+	void print_usage()
+	{
+		std::cerr << "Usage: rumble_daemon --socket=<path> [--language=1] [--workers=0] [--assets=<dir>]"
+			<< " [--window=<title> | --frames=<dir> --sessions=N]" << std::endl;
+	}
+
+	// The devices of the replayed sessions. They must outlive the scheduler that drives them
+	struct ReplayedClient
+	{
+		std::unique_ptr<ImageSequenceSource> frame_source;
+		std::unique_ptr<MockInputBackend> input_backend;
+		std::unique_ptr<InputQueue> input_queue;
+	};
+}
+
+
+int main(int argc, char** argv)
+{
+	std::string socket_path;
+	std::string frames_dir;
+	std::string assets_root;
+	std::string window_name{ "League of Legends" };
+	size_t language_id = 1;
+	size_t workers = 0;
+	size_t replayed_sessions = 1;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const std::string arg{ argv[ i ] };
+		bool valid = true;
+		if (arg.rfind("--socket=", 0) == 0)
+			socket_path = arg.substr(std::strlen("--socket="));
+		else if (arg.rfind("--language=", 0) == 0)
+			// 1 English, 2 Spanish
+			valid = parse_count(arg.substr(std::strlen("--language=")), language_id) && language_id >= 1 && language_id <= 2;
+		else if (arg.rfind("--workers=", 0) == 0)
+			valid = parse_count(arg.substr(std::strlen("--workers=")), workers);
+		else if (arg.rfind("--assets=", 0) == 0)
+			assets_root = arg.substr(std::strlen("--assets="));
+		else if (arg.rfind("--window=", 0) == 0)
+			window_name = arg.substr(std::strlen("--window="));
+		else if (arg.rfind("--frames=", 0) == 0)
+			frames_dir = arg.substr(std::strlen("--frames="));
+		else if (arg.rfind("--sessions=", 0) == 0)
+			valid = parse_count(arg.substr(std::strlen("--sessions=")), replayed_sessions) && replayed_sessions > 0;
+		else
+		{
+			std::cerr << "Unknown option " << arg << std::endl;
+			print_usage();
+			return 1;
+		}
+
+		if (!valid)
+		{
+			std::cerr << "Invalid value on " << arg << std::endl;
+			print_usage();
+			return 1;
+		}
+	}
+
+#ifndef _WIN32
+	// There are no real clients to attach here
+	if (frames_dir.empty())
+		socket_path.clear();
+#endif
+	if (socket_path.empty())
+	{
+		print_usage();
+		return 1;
+	}
+
+	if (!DaemonSocket::startup())
+	{
+		std::cerr << "Unable to initialize the sockets" << std::endl;
+		return 1;
+	}
+
+	if (!assets_root.empty())
+		ClientButton::set_assets_root(assets_root);
+
+	std::vector<ReplayedClient> replayed_clients;
+	ClientScheduler client_scheduler{ static_cast<int>(language_id), workers };
+
+	if (!frames_dir.empty())
+	{
+		for (size_t i = 0; i < replayed_sessions; i++)
+		{
+			ReplayedClient client;
+			client.frame_source = std::make_unique<ImageSequenceSource>(ImageSequenceSource::from_directory(frames_dir));
+			client.input_backend = std::make_unique<MockInputBackend>();
+			client.input_queue = std::make_unique<InputQueue>(client.input_backend.get());
+
+			client_scheduler.add_session(client.frame_source.get(), client.input_queue.get());
+			replayed_clients.push_back(std::move(client));
+		}
+	}
+#ifdef _WIN32
+	else
+		client_scheduler.attach_windows(window_name);
+#endif
+
+	if (client_scheduler.session_count() == 0)
+	{
+		std::cerr << "There are no clients to serve" << std::endl;
+		return 1;
+	}
+
+	RumbleDaemon daemon{ &client_scheduler, socket_path };
+	running_daemon = &daemon;
+	std::signal(SIGINT, on_stop_signal);
+	std::signal(SIGTERM, on_stop_signal);
+
+	const bool served = daemon.run();
+	running_daemon = nullptr;
+
+	// The lines logged from here (ie, by the destructors) are written synchronously
+	RumbleLogger::shutdown();
+
+	// The scheduler it's destroyed before the replayed clients, so no worker can touch them anymore
+	return served ? 0 : 1;
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+* Binary protocol of the Rumble daemon.
+*
+* After connecting, the client sends the 4 bytes of the handshake ("RLE" + version). From there on, both sides
+* exchanges frames: a fixed size header, in little endian, followed by a payload of the length that the header says.
+*
+*     Request  (12 bytes): request_id u32 | session_id u16 | opcode u8 | reserved u8 | payload_length u32
+*     Response (20 bytes): request_id u32 | status u8 | reserved u8[3] | queue_us u32 | run_us u32 | payload_length u32
+*
+* The requests are pipelined: a client can send many of them without waiting, and the responses comes back as the
+* commands finish, which isn't necessarily the order of the requests (the commands of a session do keep their order).
+* The request_id it's chosen by the client and echoed on its response, to match them.
+*/
+namespace DaemonProtocol {
+
+	constexpr unsigned char handshake[ 4 ] = { 'R', 'L', 'E', 1 };
+
+	constexpr size_t request_header_size = 12;
+	constexpr size_t response_header_size = 20;
+
+	// Voice commands are a few words. Anything longer it's rejected, and the connection closed
+	constexpr uint32_t max_request_payload = 1024;
+
+	enum class Opcode : uint8_t {
+		// Answered right away by the connection, without touching the engine. Measures the protocol overhead
+		Ping = 0,
+		// Runs the payload (an UTF-8 voice command) on a session, like RumbleLeague::play. Answers the play result
+		Play = 1,
+		// Answers the number of sessions of the daemon, as an u32 payload
+		Sessions = 2
+	};
+
+	enum class Status : uint8_t {
+		Ok = 0,
+		UnknownOpcode = 1,
+		UnknownSession = 2,
+		// The command threw. The payload it's the error message
+		EngineError = 3,
+		PayloadTooLarge = 4
+	};
+
+	struct RequestHeader
+	{
+		uint32_t request_id;
+		uint16_t session_id;
+		Opcode opcode;
+		uint32_t payload_length;
+	};
+
+	struct ResponseHeader
+	{
+		uint32_t request_id;
+		Status status;
+		uint32_t queue_us;
+		uint32_t run_us;
+		uint32_t payload_length;
+	};
+
+
+	inline void put_u16(unsigned char* out, const uint16_t value)
+	{
+		out[ 0 ] = static_cast<unsigned char>(value);
+		out[ 1 ] = static_cast<unsigned char>(value >> 8);
+	}
+
+	inline void put_u32(unsigned char* out, const uint32_t value)
+	{
+		for (int i = 0; i < 4; i++)
+			out[ i ] = static_cast<unsigned char>(value >> (8 * i));
+	}
+
+	inline uint16_t get_u16(const unsigned char* in)
+	{
+		return static_cast<uint16_t>(in[ 0 ] | (in[ 1 ] << 8));
+	}
+
+	inline uint32_t get_u32(const unsigned char* in)
+	{
+		uint32_t value = 0;
+		for (int i = 0; i < 4; i++)
+			value |= static_cast<uint32_t>(in[ i ]) << (8 * i);
+		return value;
+	}
+
+
+	inline void encode(const RequestHeader& header, unsigned char* out)
+	{
+		put_u32(out, header.request_id);
+		put_u16(out + 4, header.session_id);
+		out[ 6 ] = static_cast<unsigned char>(header.opcode);
+		out[ 7 ] = 0;
+		put_u32(out + 8, header.payload_length);
+	}
+
+	inline RequestHeader decode_request(const unsigned char* in)
+	{
+		return RequestHeader{ get_u32(in), get_u16(in + 4), static_cast<Opcode>(in[ 6 ]), get_u32(in + 8) };
+	}
+
+	inline void encode(const ResponseHeader& header, unsigned char* out)
+	{
+		put_u32(out, header.request_id);
+		out[ 4 ] = static_cast<unsigned char>(header.status);
+		out[ 5 ] = out[ 6 ] = out[ 7 ] = 0;
+		put_u32(out + 8, header.queue_us);
+		put_u32(out + 12, header.run_us);
+		put_u32(out + 16, header.payload_length);
+	}
+
+	inline ResponseHeader decode_response(const unsigned char* in)
+	{
+		return ResponseHeader{ get_u32(in), static_cast<Status>(in[ 4 ]), get_u32(in + 8), get_u32(in + 12), get_u32(in + 16) };
+	}
+}
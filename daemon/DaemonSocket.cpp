@@ -0,0 +1,185 @@
+#include <cstring>
+
+#include "DaemonSocket.hpp"
+
+#ifdef _WIN32
+	#include <winsock2.h>
+	#include <afunix.h>
+	#include <stdio.h>
+
+	#pragma comment(lib, "Ws2_32.lib")
+#else
+	#include <poll.h>
+	#include <sys/socket.h>
+	#include <sys/un.h>
+	#include <unistd.h>
+#endif
+
+
+namespace DaemonSocket {
+
+#ifdef _WIN32
+	const Handle invalid_handle = static_cast<Handle>(INVALID_SOCKET);
+#else
+	const Handle invalid_handle = -1;
+#endif
+
+	namespace {
+
+		bool socket_address(const std::string& path, sockaddr_un& address)
+		{
+			std::memset(&address, 0, sizeof(address));
+			address.sun_family = AF_UNIX;
+
+			// The path has to fit, with its terminator, in the fixed array of the address
+			if (path.size() >= sizeof(address.sun_path))
+				return false;
+
+			std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+			return true;
+		}
+
+		Handle new_socket()
+		{
+			return static_cast<Handle>(socket(AF_UNIX, SOCK_STREAM, 0));
+		}
+	}
+
+
+	bool startup()
+	{
+#ifdef _WIN32
+		WSADATA wsa_data;
+		return WSAStartup(MAKEWORD(2, 2), &wsa_data) == 0;
+#else
+		return true;
+#endif
+	}
+
+	Handle listen_on(const std::string& path, const int backlog)
+	{
+		sockaddr_un address;
+		if (!socket_address(path, address))
+			return invalid_handle;
+
+		const Handle listener = new_socket();
+		if (listener == invalid_handle)
+			return invalid_handle;
+
+		remove_path(path);
+		if (bind(listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0
+			|| listen(listener, backlog) != 0)
+		{
+			close(listener);
+			return invalid_handle;
+		}
+
+		return listener;
+	}
+
+	Handle connect_to(const std::string& path)
+	{
+		sockaddr_un address;
+		if (!socket_address(path, address))
+			return invalid_handle;
+
+		const Handle connection = new_socket();
+		if (connection == invalid_handle)
+			return invalid_handle;
+
+		if (connect(connection, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0)
+		{
+			close(connection);
+			return invalid_handle;
+		}
+
+		return connection;
+	}
+
+	Handle accept_connection(const Handle listener, const int timeout_ms)
+	{
+#ifdef _WIN32
+		WSAPOLLFD listener_poll{ static_cast<SOCKET>(listener), POLLRDNORM, 0 };
+		if (WSAPoll(&listener_poll, 1, timeout_ms) <= 0)
+			return invalid_handle;
+#else
+		pollfd listener_poll{ listener, POLLIN, 0 };
+		if (poll(&listener_poll, 1, timeout_ms) <= 0)
+			return invalid_handle;
+#endif
+
+		return static_cast<Handle>(accept(listener, nullptr, nullptr));
+	}
+
+	bool read_exact(const Handle handle, void* buffer, const size_t size)
+	{
+		char* cursor = static_cast<char*>(buffer);
+		size_t remaining = size;
+
+		while (remaining > 0)
+		{
+#ifdef _WIN32
+			const int received = recv(static_cast<SOCKET>(handle), cursor, static_cast<int>(remaining), 0);
+#else
+			const ssize_t received = recv(handle, cursor, remaining, 0);
+#endif
+			if (received <= 0)
+				return false;
+
+			cursor += received;
+			remaining -= static_cast<size_t>(received);
+		}
+
+		return true;
+	}
+
+	bool write_all(const Handle handle, const void* buffer, const size_t size)
+	{
+		const char* cursor = static_cast<const char*>(buffer);
+		size_t remaining = size;
+
+		while (remaining > 0)
+		{
+#ifdef _WIN32
+			const int sent = send(static_cast<SOCKET>(handle), cursor, static_cast<int>(remaining), 0);
+#else
+			// A client that went away must end in an error, not in a SIGPIPE that kills the daemon
+			const ssize_t sent = send(handle, cursor, remaining, MSG_NOSIGNAL);
+#endif
+			if (sent <= 0)
+				return false;
+
+			cursor += sent;
+			remaining -= static_cast<size_t>(sent);
+		}
+
+		return true;
+	}
+
+	void shutdown_connection(const Handle handle)
+	{
+#ifdef _WIN32
+		shutdown(static_cast<SOCKET>(handle), SD_BOTH);
+#else
+		shutdown(handle, SHUT_RDWR);
+#endif
+	}
+
+	void close(const Handle handle)
+	{
+#ifdef _WIN32
+		closesocket(static_cast<SOCKET>(handle));
+#else
+		::close(handle);
+#endif
+	}
+
+	void remove_path(const std::string& path)
+	{
+#ifdef _WIN32
+		::remove(path.c_str());
+#else
+		::unlink(path.c_str());
+#endif
+	}
+}
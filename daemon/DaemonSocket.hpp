@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+* The few Unix domain socket operations that the daemon and its clients needs, over the POSIX sockets or
+* the Winsock ones (AF_UNIX it's supported since Windows 10 1803).
+*/
+namespace DaemonSocket {
+
+#ifdef _WIN32
+	using Handle = uintptr_t;
+#else
+	using Handle = int;
+#endif
+
+	extern const Handle invalid_handle;
+
+	// Initializes the sockets library of the platform. Must be called once, before any other function
+	bool startup();
+
+	// Binds and listens on a socket path, removing the file left there by a previous daemon
+	Handle listen_on(const std::string& path, const int backlog = 64);
+
+	Handle connect_to(const std::string& path);
+
+	// Waits up to timeout_ms for a new connection. Returns invalid_handle on timeout or error
+	Handle accept_connection(const Handle listener, const int timeout_ms);
+
+	// Blocks until all the bytes are read or written. False when the peer closed the connection, or on error
+	bool read_exact(const Handle handle, void* buffer, const size_t size);
+	bool write_all(const Handle handle, const void* buffer, const size_t size);
+
+	// Wakes up any blocked read on the socket, without releasing it
+	void shutdown_connection(const Handle handle);
+
+	void close(const Handle handle);
+
+	void remove_path(const std::string& path);
+}
@@ -0,0 +1,258 @@
+#include <algorithm>
+#include <exception>
+#include <iterator>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "RumbleDaemon.hpp"
+#include "../logger/RumbleLogger.hpp"
+
+
+RumbleDaemon::Connection::~Connection()
+{
+	DaemonSocket::close(this->handle);
+}
+
+
+RumbleDaemon::RumbleDaemon(ClientScheduler* client_scheduler, const std::string& socket_path)
+	: client_scheduler{ client_scheduler },
+	socket_path{ socket_path },
+	running{ true },
+	served_requests{ 0 } {}
+
+
+bool RumbleDaemon::run()
+{
+	const DaemonSocket::Handle listener = DaemonSocket::listen_on(this->socket_path);
+	if (listener == DaemonSocket::invalid_handle)
+	{
+		RUMBLE_LOG_ERROR << "The daemon can't listen on " << this->socket_path;
+		return false;
+	}
+
+	RUMBLE_LOG_INFO << "Rumble daemon listening on " << this->socket_path
+		<< " with " << this->client_scheduler->session_count() << " sessions";
+
+	while (this->running)
+	{
+		const DaemonSocket::Handle handle = DaemonSocket::accept_connection(listener, accept_poll_ms);
+		if (handle == DaemonSocket::invalid_handle)
+			continue;
+
+		auto connection = std::make_shared<Connection>();
+		connection->handle = handle;
+		connection->in_flight = 0;
+		connection->closing = false;
+		{
+			std::lock_guard<std::mutex> lock{ this->connections_mutex };
+			this->connections.insert(connection);
+		}
+
+		std::thread{ &RumbleDaemon::serve, this, std::move(connection) }.detach();
+	}
+
+	DaemonSocket::close(listener);
+	DaemonSocket::remove_path(this->socket_path);
+
+	// Wakes up the readers and waits for them to leave. The responses still pending are written to closed sockets,
+	// so their writes fail right away
+	std::unique_lock<std::mutex> lock{ this->connections_mutex };
+	for (const auto& connection : this->connections)
+		DaemonSocket::shutdown_connection(connection->handle);
+	this->connections_closed.wait(lock, [this]() { return this->connections.empty(); });
+	lock.unlock();
+
+	this->client_scheduler->wait_idle();
+
+	RUMBLE_LOG_INFO << "Rumble daemon stopped after " << this->served_requests.load() << " requests";
+	return true;
+}
+
+void RumbleDaemon::stop()
+{
+	this->running = false;
+}
+
+uint64_t RumbleDaemon::get_served_requests() const
+{
+	return this->served_requests.load(std::memory_order_relaxed);
+}
+
+
+void RumbleDaemon::serve(std::shared_ptr<Connection> connection)
+{
+	std::thread writer{ &RumbleDaemon::write_responses, connection.get() };
+
+	unsigned char handshake[ sizeof(DaemonProtocol::handshake) ];
+	bool open = DaemonSocket::read_exact(connection->handle, handshake, sizeof(handshake))
+		&& std::equal(std::begin(handshake), std::end(handshake), std::begin(DaemonProtocol::handshake));
+
+	if (!open)
+	{
+		RUMBLE_LOG_WARNING << "Rejected a daemon connection with an unknown handshake";
+	}
+
+	unsigned char header_bytes[ DaemonProtocol::request_header_size ];
+	while (open && DaemonSocket::read_exact(connection->handle, header_bytes, sizeof(header_bytes)))
+	{
+		const DaemonProtocol::RequestHeader request = DaemonProtocol::decode_request(header_bytes);
+
+		if (request.payload_length > DaemonProtocol::max_request_payload)
+		{
+			respond(*connection, request.request_id, DaemonProtocol::Status::PayloadTooLarge, "");
+			break;
+		}
+
+		std::string payload(request.payload_length, '\0');
+		if (!DaemonSocket::read_exact(connection->handle, payload.data(), payload.size()))
+			break;
+
+		// Backpressure. The client it's pipelining faster than the engine answers
+		{
+			std::unique_lock<std::mutex> lock{ connection->in_flight_mutex };
+			connection->in_flight_released.wait(lock, [&connection]() { return connection->in_flight < max_in_flight; });
+		}
+
+		this->dispatch(connection, request, std::move(payload));
+		this->served_requests.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	// The commands already submitted still answers. Once they did, the writer sends what's left and leaves
+	{
+		std::unique_lock<std::mutex> lock{ connection->in_flight_mutex };
+		connection->in_flight_released.wait(lock, [&connection]() { return connection->in_flight == 0; });
+	}
+	{
+		std::lock_guard<std::mutex> lock{ connection->responses_mutex };
+		connection->closing = true;
+	}
+	connection->responses_available.notify_one();
+	writer.join();
+
+	// The socket it's closed once the last callback of the scheduler releases the connection
+	std::lock_guard<std::mutex> lock{ this->connections_mutex };
+	this->connections.erase(connection);
+	this->connections_closed.notify_all();
+}
+
+void RumbleDaemon::dispatch(const std::shared_ptr<Connection>& connection, const DaemonProtocol::RequestHeader& request, std::string payload)
+{
+	switch (request.opcode)
+	{
+		case DaemonProtocol::Opcode::Ping:
+			respond(*connection, request.request_id, DaemonProtocol::Status::Ok, payload);
+			break;
+
+		case DaemonProtocol::Opcode::Sessions:
+		{
+			std::string sessions(4, '\0');
+			DaemonProtocol::put_u32(
+				reinterpret_cast<unsigned char*>(sessions.data()),
+				static_cast<uint32_t>(this->client_scheduler->session_count())
+			);
+			respond(*connection, request.request_id, DaemonProtocol::Status::Ok, sessions);
+			break;
+		}
+
+		case DaemonProtocol::Opcode::Play:
+		{
+			if (request.session_id >= this->client_scheduler->session_count())
+			{
+				respond(*connection, request.request_id, DaemonProtocol::Status::UnknownSession, "");
+				break;
+			}
+
+			{
+				std::lock_guard<std::mutex> lock{ connection->in_flight_mutex };
+				++connection->in_flight;
+			}
+
+			const uint32_t request_id = request.request_id;
+			this->client_scheduler->submit(request.session_id, payload, [connection, request_id](const ClientScheduler::CommandResult& result) {
+				std::string answer = result.answer;
+				DaemonProtocol::Status status = DaemonProtocol::Status::Ok;
+
+				if (result.error)
+				{
+					status = DaemonProtocol::Status::EngineError;
+					try
+					{
+						std::rethrow_exception(result.error);
+					}
+					catch (const std::exception& error)
+					{
+						answer = error.what();
+					}
+					catch (...)
+					{
+						answer = "Unknown error";
+					}
+				}
+
+				respond(
+					*connection, request_id, status, answer,
+					static_cast<uint32_t>(result.queue_time.count()), static_cast<uint32_t>(result.run_time.count())
+				);
+
+				std::lock_guard<std::mutex> lock{ connection->in_flight_mutex };
+				--connection->in_flight;
+				connection->in_flight_released.notify_all();
+			});
+			break;
+		}
+
+		default:
+			respond(*connection, request.request_id, DaemonProtocol::Status::UnknownOpcode, "");
+	}
+}
+
+void RumbleDaemon::respond(
+	Connection& connection,
+	const uint32_t request_id,
+	const DaemonProtocol::Status status,
+	const std::string& payload,
+	const uint32_t queue_us,
+	const uint32_t run_us
+) {
+	// Header and payload in a single write, so a response never needs two syscalls
+	std::vector<unsigned char> frame(DaemonProtocol::response_header_size + payload.size());
+	DaemonProtocol::encode(
+		DaemonProtocol::ResponseHeader{ request_id, status, queue_us, run_us, static_cast<uint32_t>(payload.size()) },
+		frame.data()
+	);
+	std::copy(payload.begin(), payload.end(), frame.begin() + DaemonProtocol::response_header_size);
+
+	{
+		std::lock_guard<std::mutex> lock{ connection.responses_mutex };
+		connection.pending_responses.push_back(std::move(frame));
+	}
+	connection.responses_available.notify_one();
+}
+
+void RumbleDaemon::write_responses(Connection* connection)
+{
+	std::deque<std::vector<unsigned char>> responses;
+	bool writable = true;
+
+	std::unique_lock<std::mutex> lock{ connection->responses_mutex };
+	while (true)
+	{
+		connection->responses_available.wait(lock, [connection]() {
+			return !connection->pending_responses.empty() || connection->closing;
+		});
+		if (connection->pending_responses.empty())
+			return;
+
+		// Everything queued meanwhile goes out together, without holding the lock while the socket blocks
+		responses.swap(connection->pending_responses);
+		lock.unlock();
+
+		for (const std::vector<unsigned char>& response : responses)
+			if (writable)
+				writable = DaemonSocket::write_all(connection->handle, response.data(), response.size());
+		responses.clear();
+
+		lock.lock();
+	}
+}
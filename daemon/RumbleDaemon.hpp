@@ -0,0 +1,97 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "DaemonProtocol.hpp"
+#include "DaemonSocket.hpp"
+#include "../core/ClientScheduler.hpp"
+
+/// <summary>
+/// Serves the commands of many clients (ie, every Rumble-AI worker of the host) from one warm engine.
+///
+/// The daemon owns nothing but the socket: the sessions, the shared needle resources and the workers are the
+/// ones of the ClientScheduler that it's given. Every connection has a reader thread that decodes the requests
+/// and submits them to the scheduler without waiting, so a client can pipeline as many of them as it wants (up to
+/// max_in_flight per connection). The responses are queued as soon as each command ends, with the time that the
+/// command waited in the queue and the time that it ran, and a writer thread per connection sends them. So a
+/// scheduler worker never blocks on a slow (or stuck) client socket.
+/// </summary>
+class RumbleDaemon
+{
+	private:
+		// Requests of a connection submitted and not answered yet. Past this, the reader stops reading
+		static constexpr size_t max_in_flight = 256;
+
+		// How often the accept loop checks if the daemon has been stopped
+		static constexpr int accept_poll_ms = 200;
+
+		struct Connection
+		{
+			DaemonSocket::Handle handle;
+
+			// Encoded responses waiting for the writer thread, from the reader and from the workers
+			std::mutex responses_mutex;
+			std::condition_variable responses_available;
+			std::deque<std::vector<unsigned char>> pending_responses;
+			// Set by the reader once every response has been queued, so the writer leaves when it drains them
+			bool closing;
+
+			std::mutex in_flight_mutex;
+			std::condition_variable in_flight_released;
+			size_t in_flight;
+
+			~Connection();
+		};
+
+		ClientScheduler* client_scheduler;
+		std::string socket_path;
+
+		std::atomic<bool> running;
+		std::atomic<uint64_t> served_requests;
+
+		// The open connections, to wake up their readers on stop
+		std::mutex connections_mutex;
+		std::condition_variable connections_closed;
+		std::set<std::shared_ptr<Connection>> connections;
+
+		void serve(std::shared_ptr<Connection> connection);
+
+		// The writer thread of a connection. Sends the queued responses until the connection it's closing and drained
+		static void write_responses(Connection* connection);
+
+		void dispatch(const std::shared_ptr<Connection>& connection, const DaemonProtocol::RequestHeader& request, std::string payload);
+
+		// Queues a response for the writer thread of the connection. Never blocks on the socket
+		static void respond(
+			Connection& connection,
+			const uint32_t request_id,
+			const DaemonProtocol::Status status,
+			const std::string& payload,
+			const uint32_t queue_us = 0,
+			const uint32_t run_us = 0
+		);
+
+	public:
+		RumbleDaemon(ClientScheduler* client_scheduler, const std::string& socket_path);
+
+		RumbleDaemon(const RumbleDaemon&) = delete;
+		RumbleDaemon& operator=(const RumbleDaemon&) = delete;
+
+		// Listens and serves until stop() it's called. Returns false if the socket can't be opened
+		bool run();
+
+		// Makes run() return, after closing the connections and finishing the commands already submitted.
+		// Only sets an atomic flag, so it can be called from a signal handler
+		void stop();
+
+		uint64_t get_served_requests() const;
+};
@@ -1,10 +1,14 @@
 #pragma once
 
+#include <algorithm>
+#include <iterator>
+#include <string>
 #include <vector>
 #include <tuple>
 
 #include "../helpers/EnumTypes.hpp"
 #include "../core/league_client/LeagueClientButton.hpp"
+#include "../logger/RumbleLogger.hpp"
 
 using namespace std;
 
@@ -40,7 +44,7 @@ namespace RLE_data {
 	/**
 	* The available buttons to use with this API against the League of Legends client with the League
 	*/
-	vector<tuple<const char*, const char*, const LeagueClientScreenIdentifier>> english_buttons {
+	inline vector<tuple<const char*, const char*, const LeagueClientScreenIdentifier>> english_buttons {
 		// Navbar buttons
 		make_tuple("home", "home_button", LeagueClientScreenIdentifier::MainScreen),
 		make_tuple("play", "play_button", LeagueClientScreenIdentifier::ChooseGame),
@@ -114,19 +118,90 @@ namespace RLE_data {
 		make_tuple("no", "no", LeagueClientScreenIdentifier::ClientClosed),
 	};
 
-	vector<tuple<const char*, const char*, const LeagueClientScreenIdentifier>> spanish_buttons{
+	inline vector<tuple<const char*, const char*, const LeagueClientScreenIdentifier>> spanish_buttons{
 		// TODO Just change it for the spanish correct definitions
 	};
 
 
 
+	/**
+	* The needles that stays on the screen after their click: the navbar, and the picks inside a screen (game modes,
+	* queues, positions and roles). Their click can only be confirmed by the anchor of the next screen
+	*/
+	inline bool stays_visible(const std::string& needle_id)
+	{
+		static const char* const staying_needles [] {
+			"home_button", "play_button", "tft_button", "clash_button", "profile_button", "collection_button",
+			"loot_button", "your_shop_button", "store_button",
+			"summoners_rift", "aram", "teamfight_tactics", "urf", "training",
+			"blind_pick", "draft_pick", "ranked_solo_duo", "flex", "tft_normal", "tft_ranked", "tft_hyper_roll",
+			"primary", "secondary", "top_role", "jungler_role", "mid_role", "bot_role", "support_role", "autofill_role",
+			"search_bar",
+		};
+
+		return std::any_of(std::begin(staying_needles), std::end(staying_needles), [&](const char* staying_needle) {
+			return needle_id == staying_needle;
+		});
+	}
+
+	/**
+	* The buttons that the layout calibration presses, in order, to walk the client screens once. None of them
+	* creates a lobby or joins a queue: the game modes are only selected on the choose game screen, never confirmed,
+	* and the walk ends back on the home screen. Needle ids, so the route it's the same for every language
+	*/
+	const size_t calibration_route_length = 13;
+
+	const char* const calibration_route [ calibration_route_length ] {
+		"home_button",
+		"profile_button",
+		"collection_button",
+		"loot_button",
+		"tft_button",
+		"clash_button",
+		"store_button",
+		"play_button",
+		"summoners_rift",
+		"teamfight_tactics",
+		"aram",
+		"training",
+		"home_button",
+	};
+
+	/**
+	* Anchors of the screens. A needle that's only visible on that screen, so finding it confirms that the client
+	* really is there (ie, after a click that should lead to it). Screens without a reliable one returns nullptr.
+	*/
+	inline const char* screen_anchor(const LeagueClientScreenIdentifier screen)
+	{
+		switch (screen)
+		{
+			case LeagueClientScreenIdentifier::ChooseGame:
+				return "confirm_button";
+			case LeagueClientScreenIdentifier::SummonersBlindLobby:
+			case LeagueClientScreenIdentifier::SummonersDraftLobby:
+			case LeagueClientScreenIdentifier::SummonersRankedLobby:
+			case LeagueClientScreenIdentifier::SummonersFlexLobby:
+			case LeagueClientScreenIdentifier::AramLobby:
+			case LeagueClientScreenIdentifier::TFT_NormalLobby:
+			case LeagueClientScreenIdentifier::TFT_RankedLobby:
+			case LeagueClientScreenIdentifier::TFT_HyperRollLobby:
+			case LeagueClientScreenIdentifier::UrfLobby:
+				return "find_game";
+			case LeagueClientScreenIdentifier::ChampSelect:
+				return "lock_in";
+			default:
+				return nullptr;
+		}
+	}
+
+
 	/**
 	* Helper that returns a vector of ClientButton pointers, filled with the concretes one that satisfies the
 	* specified desired language.
 	* 
 	* TODO Complete the full description of what this method does, and why it's designed in this way
 	*/
-	vector<ClientButton*> get_buttons(const Language language, const bool debug = false)
+	inline vector<ClientButton*> get_buttons(const Language language, const bool debug = false)
 	{
 		vector<tuple<const char*, const char*, const LeagueClientScreenIdentifier>> desired_group_buttons{};
 		vector<ClientButton*> api_buttons;
@@ -185,10 +260,10 @@ namespace RLE_data {
 		{
 			for (ClientButton*& button : api_buttons)
 			{
-				cout << "Button with identifier: " << button->identifier
-					<< "; with path: " << button->image_path << endl;
-				cout << "\tpointing to: " << button->next_screen
-					<< " and belongs to: " << button->lobby << endl;
+				RUMBLE_LOG_DEBUG << "Button with identifier: " << button->identifier
+					<< "; with path: " << button->image_path
+					<< "; pointing to: " << button->next_screen
+					<< " and belongs to: " << button->lobby;
 			}
 		}
 
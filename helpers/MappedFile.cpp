@@ -0,0 +1,156 @@
+#include <utility>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "MappedFile.hpp"
+
+
+#ifdef _WIN32
+MappedFile::MappedFile()
+	: mapped_data{ nullptr }, mapped_size{ 0 }, file_handle{ INVALID_HANDLE_VALUE }, mapping_handle{ nullptr } {}
+#else
+MappedFile::MappedFile()
+	: mapped_data{ nullptr }, mapped_size{ 0 }, file_descriptor{ -1 } {}
+#endif
+
+MappedFile::~MappedFile()
+{
+	this->close();
+}
+
+MappedFile::MappedFile(MappedFile&& source) noexcept
+	: MappedFile{}
+{
+	*this = std::move(source);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& rhs) noexcept
+{
+	if (this != &rhs)
+	{
+		this->close();
+		std::swap(this->mapped_data, rhs.mapped_data);
+		std::swap(this->mapped_size, rhs.mapped_size);
+#ifdef _WIN32
+		std::swap(this->file_handle, rhs.file_handle);
+		std::swap(this->mapping_handle, rhs.mapping_handle);
+#else
+		std::swap(this->file_descriptor, rhs.file_descriptor);
+#endif
+	}
+	return *this;
+}
+
+
+#ifdef _WIN32
+bool MappedFile::open(const std::string& path)
+{
+	this->close();
+
+	this->file_handle = CreateFileA(
+		path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr
+	);
+	if (this->file_handle == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(this->file_handle, &file_size) || file_size.QuadPart == 0)
+	{
+		this->close();
+		return false;
+	}
+
+	this->mapping_handle = CreateFileMappingA(this->file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (this->mapping_handle == nullptr)
+	{
+		this->close();
+		return false;
+	}
+
+	this->mapped_data = static_cast<const unsigned char*>(MapViewOfFile(this->mapping_handle, FILE_MAP_READ, 0, 0, 0));
+	if (this->mapped_data == nullptr)
+	{
+		this->close();
+		return false;
+	}
+
+	this->mapped_size = static_cast<size_t>(file_size.QuadPart);
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (this->mapped_data != nullptr)
+		UnmapViewOfFile(this->mapped_data);
+	if (this->mapping_handle != nullptr)
+		CloseHandle(this->mapping_handle);
+	if (this->file_handle != INVALID_HANDLE_VALUE)
+		CloseHandle(this->file_handle);
+
+	this->mapped_data = nullptr;
+	this->mapped_size = 0;
+	this->mapping_handle = nullptr;
+	this->file_handle = INVALID_HANDLE_VALUE;
+}
+#else
+bool MappedFile::open(const std::string& path)
+{
+	this->close();
+
+	this->file_descriptor = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (this->file_descriptor < 0)
+		return false;
+
+	struct stat file_status;
+	if (fstat(this->file_descriptor, &file_status) != 0 || file_status.st_size == 0)
+	{
+		this->close();
+		return false;
+	}
+
+	void* mapping = mmap(nullptr, static_cast<size_t>(file_status.st_size), PROT_READ, MAP_SHARED, this->file_descriptor, 0);
+	if (mapping == MAP_FAILED)
+	{
+		this->close();
+		return false;
+	}
+
+	this->mapped_data = static_cast<const unsigned char*>(mapping);
+	this->mapped_size = static_cast<size_t>(file_status.st_size);
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (this->mapped_data != nullptr)
+		munmap(const_cast<unsigned char*>(this->mapped_data), this->mapped_size);
+	if (this->file_descriptor >= 0)
+		::close(this->file_descriptor);
+
+	this->mapped_data = nullptr;
+	this->mapped_size = 0;
+	this->file_descriptor = -1;
+}
+#endif
+
+bool MappedFile::is_open() const
+{
+	return this->mapped_data != nullptr;
+}
+
+const unsigned char* MappedFile::data() const
+{
+	return this->mapped_data;
+}
+
+size_t MappedFile::size() const
+{
+	return this->mapped_size;
+}
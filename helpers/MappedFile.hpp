@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+/// <summary>
+/// A read only view of a whole file, mapped on the address space of the process. The pages are loaded by the
+/// OS on demand, and they're shared between every process that maps the same file.
+/// </summary>
+class MappedFile
+{
+	private:
+		const unsigned char* mapped_data;
+		size_t mapped_size;
+
+#ifdef _WIN32
+		void* file_handle;
+		void* mapping_handle;
+#else
+		int file_descriptor;
+#endif
+
+	public:
+		MappedFile();
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		MappedFile(MappedFile&& source) noexcept;
+		MappedFile& operator=(MappedFile&& rhs) noexcept;
+
+		// Maps the file. Returns false if it doesn't exists, or it's empty, or can't be mapped
+		bool open(const std::string& path);
+
+		// Unmaps the file. Every pointer returned by data() becomes invalid
+		void close();
+
+		bool is_open() const;
+		const unsigned char* data() const;
+		size_t size() const;
+};
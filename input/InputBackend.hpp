@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstddef>
+
+#include "InputEvent.hpp"
+
+/// <summary>
+/// Delivers batches of input events to a platform. Implementations must inject the whole batch with the
+/// minimum number of system calls possible (ideally one), keeping the order of the events.
+/// </summary>
+class InputBackend
+{
+	public:
+		virtual ~InputBackend() = default;
+
+		virtual void inject(const InputEvent* events, const size_t count) = 0;
+};
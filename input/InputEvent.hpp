@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+
+// A point on screen coordinates, where the input events are injected
+struct ScreenPoint
+{
+	int x;
+	int y;
+};
+
+/// <summary>
+/// A single low level input event. The input queue translates clicks and texts into sequences of them,
+/// and the backends translates them into the native events of every platform.
+/// </summary>
+struct InputEvent
+{
+	enum class Type : uint8_t { MouseMove, LeftDown, LeftUp, KeyDown, KeyUp };
+
+	Type type;
+
+	// Screen coordinates, only meaningful for MouseMove
+	int x;
+	int y;
+
+	// The (ASCII) character of the key, only meaningful for KeyDown / KeyUp. Every backend maps it to its own key codes
+	char key;
+};
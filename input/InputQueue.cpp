@@ -0,0 +1,93 @@
+#include "InputQueue.hpp"
+#include "KeyCodes.hpp"
+#include "../logger/RumbleLogger.hpp"
+#include "../tracing/RumbleTrace.hpp"
+
+
+InputQueue::InputQueue(InputBackend* backend)
+	: backend{ backend },
+	batch_depth{ 0 }
+{
+	// A click it's three events, so the usual batches fits without growing
+	this->pending_events.reserve(64);
+}
+
+void InputQueue::enqueue_click(int x, int y)
+{
+	std::lock_guard<std::recursive_mutex> lock{ this->queue_mutex };
+	this->pending_events.push_back(InputEvent{ InputEvent::Type::MouseMove, x, y, 0 });
+	this->pending_events.push_back(InputEvent{ InputEvent::Type::LeftDown, x, y, 0 });
+	this->pending_events.push_back(InputEvent{ InputEvent::Type::LeftUp, x, y, 0 });
+}
+
+void InputQueue::enqueue_text(const std::string& text)
+{
+	std::lock_guard<std::recursive_mutex> lock{ this->queue_mutex };
+	for (const char c : text)
+	{
+		if (KeyCodes::virtual_keycode(c) == 0 && KeyCodes::keysym(c) == 0)
+		{
+			RUMBLE_LOG_WARNING << "NOT allowed char -> " << c;
+			continue;
+		}
+
+		this->pending_events.push_back(InputEvent{ InputEvent::Type::KeyDown, 0, 0, c });
+		this->pending_events.push_back(InputEvent{ InputEvent::Type::KeyUp, 0, 0, c });
+	}
+}
+
+void InputQueue::begin_batch()
+{
+	this->queue_mutex.lock();
+	++this->batch_depth;
+}
+
+void InputQueue::end_batch()
+{
+	std::lock_guard<std::recursive_mutex> lock{ this->queue_mutex };
+	if (this->batch_depth == 0)
+		return;
+
+	if (--this->batch_depth == 0)
+		this->flush();
+
+	// Releases the lock taken by the matching begin_batch()
+	this->queue_mutex.unlock();
+}
+
+void InputQueue::flush()
+{
+	std::lock_guard<std::recursive_mutex> lock{ this->queue_mutex };
+	if (this->pending_events.empty())
+		return;
+
+	RUMBLE_TRACE_SCOPE("input_injection");
+	this->backend->inject(this->pending_events.data(), this->pending_events.size());
+	this->pending_events.clear();
+}
+
+
+/**
+* InputSink. Every action it's a batch, unless an outer batch it's already open
+*/
+void InputQueue::left_click(int x, int y)
+{
+	this->begin_batch();
+	this->enqueue_click(x, y);
+	this->end_batch();
+}
+
+void InputQueue::left_click_sequence(const std::vector<ScreenPoint>& points)
+{
+	this->begin_batch();
+	for (const ScreenPoint& point : points)
+		this->enqueue_click(point.x, point.y);
+	this->end_batch();
+}
+
+void InputQueue::type_text(const std::string& text)
+{
+	this->begin_batch();
+	this->enqueue_text(text);
+	this->end_batch();
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "InputBackend.hpp"
+#include "InputEvent.hpp"
+#include "InputSink.hpp"
+
+/// <summary>
+/// Coalesces the input actions of the API into batches of events, delivered to the backend with a single
+/// injection call. A whole text, or a whole sequence of clicks, costs one call instead of one (or two) per key.
+///
+/// Every InputSink action it's a batch by itself. Several actions can be grouped into a single batch by enqueueing
+/// them between begin_batch() and end_batch().
+///
+/// Safe to be used from several threads (ie, the commands and the event watcher callbacks). An open batch belongs
+/// to the thread that opened it, so the batches of different threads are never mixed.
+/// </summary>
+class InputQueue : public InputSink
+{
+	private:
+		// Borrowed, the caller keeps the ownership
+		InputBackend* backend;
+
+		std::vector<InputEvent> pending_events;
+
+		// Nesting depth of begin_batch() calls. Events are only injected when it comes back to zero
+		int batch_depth;
+
+		// Held from the outermost begin_batch() until its end_batch(). Recursive, for the nested batches
+		std::recursive_mutex queue_mutex;
+
+	public:
+		explicit InputQueue(InputBackend* backend);
+
+		// Enqueueing methods. Nothing it's injected until the batch ends
+		void enqueue_click(int x, int y);
+		void enqueue_text(const std::string& text);
+
+		// Must be paired on the same thread
+		void begin_batch();
+		void end_batch();
+
+		// Injects every pending event with a single call to the backend
+		void flush();
+
+		// InputSink
+		void left_click(int x, int y) override;
+		void left_click_sequence(const std::vector<ScreenPoint>& points) override;
+		void type_text(const std::string& text) override;
+};
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "InputEvent.hpp"
+
+/// <summary>
+/// The destination of the input events generated by the API (mouse clicks and keystrokes).
+/// The InputQueue it's the real one, that delivers them to an InputBackend in batches. The interface allows
+/// to drive the engine without touching the user's mouse and keyboard, ie, on benchmarks and simulations.
+/// </summary>
+class InputSink
+{
+	public:
+		virtual ~InputSink() = default;
+
+		// Moves the mouse to a (x, y) point on screen coordinates and performs a left click when arrives
+		virtual void left_click(int x, int y) = 0;
+
+		// Clicks a sequence of points, in order
+		virtual void left_click_sequence(const std::vector<ScreenPoint>& points)
+		{
+			for (const ScreenPoint& point : points)
+				this->left_click(point.x, point.y);
+		}
+
+		// Types a text, key by key
+		virtual void type_text(const std::string& text) = 0;
+};
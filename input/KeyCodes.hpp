@@ -0,0 +1,62 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+/**
+* Flat, compile time tables that maps the characters that the API can type to the key codes of every platform.
+* A lookup it's a single indexed load, instead of a search over a std::map.
+*/
+namespace KeyCodes {
+
+	// Only the ASCII range can be typed
+	constexpr size_t table_size = 128;
+
+	/**
+	* Windows virtual key codes. Letters (both cases) and digits shares their code with the upper case ASCII value.
+	* Zero means that the character can't be typed.
+	*/
+	constexpr std::array<uint8_t, table_size> make_virtual_keycodes()
+	{
+		std::array<uint8_t, table_size> table{};
+
+		table[ '\b' ] = 0x08; // BACKSPACE
+		table[ '\n' ] = 0x0D; // ENTER
+		table[ ' ' ] = 0x20;  // SPACEBAR
+
+		for (char c = 'a'; c <= 'z'; c++)
+		{
+			table[ c ] = static_cast<uint8_t>(0x41 + (c - 'a'));
+			table[ c - 'a' + 'A' ] = static_cast<uint8_t>(0x41 + (c - 'a'));
+		}
+
+		for (char c = '0'; c <= '9'; c++)
+			table[ c ] = static_cast<uint8_t>(0x30 + (c - '0'));
+
+		return table;
+	}
+
+	inline constexpr std::array<uint8_t, table_size> virtual_keycodes = make_virtual_keycodes();
+
+	constexpr uint8_t virtual_keycode(const char c)
+	{
+		return (static_cast<unsigned char>(c) < table_size) ? virtual_keycodes[ static_cast<unsigned char>(c) ] : 0;
+	}
+
+	static_assert(virtual_keycode('a') == 0x41 && virtual_keycode('Z') == 0x5A && virtual_keycode(' ') == 0x20);
+
+	/**
+	* X11 keysyms. The printable ASCII characters are their own keysym, the control ones lives on the 0xFF00 page.
+	* Zero means that the character can't be typed.
+	*/
+	constexpr uint32_t keysym(const char c)
+	{
+		switch (c)
+		{
+			case '\b': return 0xFF08; // XK_BackSpace
+			case '\n': return 0xFF0D; // XK_Return
+			default:
+				return (c >= 0x20 && c < 0x7F) ? static_cast<uint32_t>(c) : 0;
+		}
+	}
+}
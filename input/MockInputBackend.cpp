@@ -0,0 +1,33 @@
+#include "MockInputBackend.hpp"
+
+
+MockInputBackend::MockInputBackend() : injection_calls{ 0 } {}
+
+void MockInputBackend::inject(const InputEvent* events, const size_t count)
+{
+	const auto timestamp = std::chrono::steady_clock::now();
+
+	std::lock_guard<std::mutex> lock{ this->events_mutex };
+	for (size_t i = 0; i < count; i++)
+		this->events.push_back(RecordedEvent{ events[ i ], timestamp, this->injection_calls });
+	++this->injection_calls;
+}
+
+std::vector<MockInputBackend::RecordedEvent> MockInputBackend::get_events() const
+{
+	std::lock_guard<std::mutex> lock{ this->events_mutex };
+	return this->events;
+}
+
+uint64_t MockInputBackend::get_injection_calls() const
+{
+	std::lock_guard<std::mutex> lock{ this->events_mutex };
+	return this->injection_calls;
+}
+
+void MockInputBackend::clear()
+{
+	std::lock_guard<std::mutex> lock{ this->events_mutex };
+	this->events.clear();
+	this->injection_calls = 0;
+}
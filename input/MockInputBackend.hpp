@@ -0,0 +1,44 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "InputBackend.hpp"
+
+/// <summary>
+/// A backend that doesn't touch the desktop. It just records every injected event with the moment when
+/// its batch arrived, so benchmarks and simulations can measure the command to input latency and check
+/// how many injection calls were made. Safe to be used from several threads.
+/// </summary>
+class MockInputBackend : public InputBackend
+{
+	public:
+		struct RecordedEvent
+		{
+			InputEvent event;
+			std::chrono::steady_clock::time_point timestamp;
+			// Ordinal of the injection call that delivered the event
+			uint64_t batch;
+		};
+
+	private:
+		mutable std::mutex events_mutex;
+		std::vector<RecordedEvent> events;
+		uint64_t injection_calls;
+
+	public:
+		MockInputBackend();
+
+		void inject(const InputEvent* events, const size_t count) override;
+
+		// Returns a copy of the recorded events, from the oldest to the newest
+		std::vector<RecordedEvent> get_events() const;
+
+		// Number of calls to inject() since the creation or the last clear()
+		uint64_t get_injection_calls() const;
+
+		// Forgets all the recorded events
+		void clear();
+};
@@ -0,0 +1,135 @@
+#include <mutex>
+
+#include "Win32InputBackend.hpp"
+#include "KeyCodes.hpp"
+#include "../logger/RumbleLogger.hpp"
+
+
+namespace {
+
+	// The focus, the cursor and the keyboard are one per desktop, so the batches of every backend goes one at a time
+	std::mutex desktop_mutex;
+}
+
+
+Win32InputBackend::Win32InputBackend(HWND target_window)
+	: target_window{ target_window } {}
+
+
+void Win32InputBackend::inject(const InputEvent* events, const size_t count)
+{
+	std::lock_guard<std::mutex> lock{ desktop_mutex };
+
+	if (this->target_window != NULL && !this->focus_target_window())
+	{
+		RUMBLE_LOG_WARNING << "Dropping " << count << " input events, the window " << this->target_window
+			<< " couldn't be brought to the foreground";
+		return;
+	}
+
+	this->inputs.clear();
+
+	for (size_t i = 0; i < count; i++)
+	{
+		const InputEvent& event = events[ i ];
+		switch (event.type)
+		{
+			case InputEvent::Type::MouseMove:
+				this->inputs.push_back(this->mouse_move(event.x, event.y));
+				break;
+			case InputEvent::Type::LeftDown:
+				this->inputs.push_back(mouse_button(MOUSEEVENTF_LEFTDOWN));
+				break;
+			case InputEvent::Type::LeftUp:
+				this->inputs.push_back(mouse_button(MOUSEEVENTF_LEFTUP));
+				break;
+			case InputEvent::Type::KeyDown:
+				this->inputs.push_back(character_key(event.key, 0));
+				break;
+			case InputEvent::Type::KeyUp:
+				this->inputs.push_back(character_key(event.key, KEYEVENTF_KEYUP));
+				break;
+		}
+	}
+
+	if (this->inputs.empty())
+		return;
+
+	const UINT injected = SendInput(static_cast<UINT>(this->inputs.size()), this->inputs.data(), sizeof(INPUT));
+	if (injected != this->inputs.size())
+		RUMBLE_LOG_WARNING << "SendInput only injected " << injected << " of " << this->inputs.size() << " events";
+}
+
+
+bool Win32InputBackend::focus_target_window() const
+{
+	if (GetForegroundWindow() == this->target_window)
+		return true;
+
+	// A minimized client doesn't paint nor receives the clicks
+	if (IsIconic(this->target_window))
+		ShowWindow(this->target_window, SW_RESTORE);
+	SetForegroundWindow(this->target_window);
+
+	// The focus changes asynchronously, the events must wait until the window has it
+	const ULONGLONG deadline = GetTickCount64() + focus_timeout_ms;
+	while (GetForegroundWindow() != this->target_window)
+	{
+		if (GetTickCount64() >= deadline)
+			return false;
+		Sleep(1);
+	}
+
+	return true;
+}
+
+
+/**
+* Absolute mouse moves are expressed on the [0, 65535] range over the whole virtual desktop,
+* so the screen coordinates are normalized against it (works with several monitors too)
+*/
+INPUT Win32InputBackend::mouse_move(int x, int y) const
+{
+	const int desktop_x = GetSystemMetrics(SM_XVIRTUALSCREEN);
+	const int desktop_y = GetSystemMetrics(SM_YVIRTUALSCREEN);
+	const int desktop_width = GetSystemMetrics(SM_CXVIRTUALSCREEN);
+	const int desktop_height = GetSystemMetrics(SM_CYVIRTUALSCREEN);
+
+	INPUT input{};
+	input.type = INPUT_MOUSE;
+	input.mi.dx = MulDiv(x - desktop_x, 65535, desktop_width - 1);
+	input.mi.dy = MulDiv(y - desktop_y, 65535, desktop_height - 1);
+	input.mi.dwFlags = MOUSEEVENTF_MOVE | MOUSEEVENTF_ABSOLUTE | MOUSEEVENTF_VIRTUALDESK;
+	return input;
+}
+
+INPUT Win32InputBackend::mouse_button(DWORD flags)
+{
+	INPUT input{};
+	input.type = INPUT_MOUSE;
+	input.mi.dwFlags = flags;
+	return input;
+}
+
+INPUT Win32InputBackend::keyboard_key(WORD virtual_keycode, DWORD flags)
+{
+	INPUT input{};
+	input.type = INPUT_KEYBOARD;
+	input.ki.wVk = virtual_keycode;
+	input.ki.dwFlags = flags; // 0 for key press, KEYEVENTF_KEYUP for key release
+	return input;
+}
+
+INPUT Win32InputBackend::character_key(char character, DWORD flags)
+{
+	const WORD virtual_keycode = KeyCodes::virtual_keycode(character);
+	if (virtual_keycode != 0 && !(character >= 'A' && character <= 'Z'))
+		return keyboard_key(virtual_keycode, flags);
+
+	INPUT input{};
+	input.type = INPUT_KEYBOARD;
+	input.ki.wVk = 0;
+	input.ki.wScan = static_cast<WORD>(static_cast<unsigned char>(character));
+	input.ki.dwFlags = flags | KEYEVENTF_UNICODE;
+	return input;
+}
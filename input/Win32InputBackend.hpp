@@ -0,0 +1,49 @@
+#pragma once
+
+#pragma comment(lib, "user32.lib")
+
+#include <vector>
+#include <Windows.h>
+
+#include "InputBackend.hpp"
+
+/// <summary>
+/// Injects the input events on the Windows desktop. A whole batch it's translated into an array of INPUT
+/// structures and delivered with a single SendInput call, so the system can't interleave other events between them.
+///
+/// SendInput goes to whatever window has the focus, and there is a single one per desktop. So a backend can be
+/// bound to a target window: every batch it's then injected under a lock shared by every backend of the process,
+/// right after bringing the target to the foreground. A batch whose target can't get the focus it's dropped,
+/// instead of clicking on another client.
+/// </summary>
+class Win32InputBackend : public InputBackend
+{
+	private:
+		// Time that the target window gets to come to the foreground before a batch it's dropped
+		static constexpr DWORD focus_timeout_ms = 100;
+
+		// The window that must have the focus when a batch it's injected. Null injects on whatever window has it
+		HWND target_window;
+
+		// Reused between batches, to avoid allocating on every injection
+		std::vector<INPUT> inputs;
+
+		INPUT mouse_move(int x, int y) const;
+		static INPUT mouse_button(DWORD flags);
+		static INPUT keyboard_key(WORD virtual_keycode, DWORD flags);
+
+		/**
+		* The key of a character. Only the lower case letters, the digits and the control keys have a virtual key that
+		* types them without modifiers. The rest (upper case, punctuation: "Kai'Sa", "Dr. Mundo") are typed as the
+		* unicode character itself, whatever the keyboard layout
+		*/
+		static INPUT character_key(char character, DWORD flags);
+
+		// Brings the target window to the foreground. Returns false if it doesn't have the focus after the timeout
+		bool focus_target_window() const;
+
+	public:
+		explicit Win32InputBackend(HWND target_window = NULL);
+
+		void inject(const InputEvent* events, const size_t count) override;
+};
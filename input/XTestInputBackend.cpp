@@ -0,0 +1,103 @@
+#include <X11/extensions/XTest.h>
+#include <X11/keysym.h>
+
+#include "XTestInputBackend.hpp"
+#include "../logger/RumbleLogger.hpp"
+
+
+XTestInputBackend::XTestInputBackend(const std::string& display_name)
+	: display{ XOpenDisplay(display_name.empty() ? nullptr : display_name.c_str()) },
+	keycodes{},
+	shifted{},
+	shift_keycode{ 0 }
+{
+	if (this->display == nullptr)
+	{
+		RUMBLE_LOG_ERROR << "Unable to open the X display " << (display_name.empty() ? "$DISPLAY" : display_name);
+		return;
+	}
+
+	int event_base, error_base, major_version, minor_version;
+	if (!XTestQueryExtension(this->display, &event_base, &error_base, &major_version, &minor_version))
+	{
+		RUMBLE_LOG_ERROR << "The X display doesn't support the XTest extension";
+		XCloseDisplay(this->display);
+		this->display = nullptr;
+		return;
+	}
+
+	// Resolves the keycodes once, so the injection it's only a table lookup per key
+	for (size_t c = 0; c < KeyCodes::table_size; c++)
+	{
+		const KeySym symbol = KeyCodes::keysym(static_cast<char>(c));
+		if (symbol == 0)
+			continue;
+
+		this->keycodes[ c ] = XKeysymToKeycode(this->display, symbol);
+		this->shifted[ c ] = c >= 'A' && c <= 'Z';
+	}
+	this->shift_keycode = XKeysymToKeycode(this->display, XK_Shift_L);
+}
+
+XTestInputBackend::~XTestInputBackend()
+{
+	if (this->display != nullptr)
+		XCloseDisplay(this->display);
+}
+
+bool XTestInputBackend::is_available() const
+{
+	return this->display != nullptr;
+}
+
+void XTestInputBackend::inject(const InputEvent* events, const size_t count)
+{
+	if (this->display == nullptr)
+		return;
+
+	for (size_t i = 0; i < count; i++)
+	{
+		const InputEvent& event = events[ i ];
+		switch (event.type)
+		{
+			case InputEvent::Type::MouseMove:
+				// -1 as the screen number means the screen where the pointer currently is
+				XTestFakeMotionEvent(this->display, -1, event.x, event.y, CurrentTime);
+				break;
+			case InputEvent::Type::LeftDown:
+				XTestFakeButtonEvent(this->display, Button1, True, CurrentTime);
+				break;
+			case InputEvent::Type::LeftUp:
+				XTestFakeButtonEvent(this->display, Button1, False, CurrentTime);
+				break;
+			case InputEvent::Type::KeyDown:
+				this->fake_key(event.key, true);
+				break;
+			case InputEvent::Type::KeyUp:
+				this->fake_key(event.key, false);
+				break;
+		}
+	}
+
+	// The whole batch travels to the server at once
+	XFlush(this->display);
+}
+
+void XTestInputBackend::fake_key(const char key, const bool press)
+{
+	const unsigned char index = static_cast<unsigned char>(key);
+	if (index >= KeyCodes::table_size || this->keycodes[ index ] == 0)
+	{
+		RUMBLE_LOG_WARNING << "There is no key on the X display for the char -> " << key;
+		return;
+	}
+
+	// The shift key wraps the key, pressed before it and released after it
+	if (press && this->shifted[ index ])
+		XTestFakeKeyEvent(this->display, this->shift_keycode, True, CurrentTime);
+
+	XTestFakeKeyEvent(this->display, this->keycodes[ index ], press ? True : False, CurrentTime);
+
+	if (!press && this->shifted[ index ])
+		XTestFakeKeyEvent(this->display, this->shift_keycode, False, CurrentTime);
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <array>
+#include <string>
+
+#include <X11/Xlib.h>
+
+#include "InputBackend.hpp"
+#include "KeyCodes.hpp"
+
+/// <summary>
+/// Injects the input events on a X11 display through the XTest extension. Every event of a batch it's queued
+/// on the Xlib output buffer, and the whole batch it's sent to the server with a single XFlush.
+///
+/// Works with any X server, so the input path can be exercised without a desktop, under Xvfb:
+///     Xvfb :99 & DISPLAY=:99 ./your_program
+/// </summary>
+class XTestInputBackend : public InputBackend
+{
+	private:
+		Display* display;
+
+		// X11 keycodes of every typeable character, resolved once from their keysyms. Zero when there isn't any key for it
+		std::array<KeyCode, KeyCodes::table_size> keycodes;
+
+		// Characters that needs the shift key held (the upper case letters)
+		std::array<bool, KeyCodes::table_size> shifted;
+
+		KeyCode shift_keycode;
+
+		void fake_key(const char key, const bool press);
+
+	public:
+		// Opens the display, ie: ":99". An empty name means the DISPLAY environment variable
+		explicit XTestInputBackend(const std::string& display_name = "");
+		~XTestInputBackend();
+
+		XTestInputBackend(const XTestInputBackend&) = delete;
+		XTestInputBackend& operator=(const XTestInputBackend&) = delete;
+
+		// False if the display couldn't be opened or it doesn't support the XTest extension
+		bool is_available() const;
+
+		void inject(const InputEvent* events, const size_t count) override;
+};
@@ -0,0 +1,361 @@
+#include <charconv>
+#include <condition_variable>
+#include <cstring>
+#include <cstdio>
+#include <ctime>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "RumbleLogger.hpp"
+
+namespace {
+
+	static_assert((RumbleLogger::queue_capacity & (RumbleLogger::queue_capacity - 1)) == 0,
+		"The capacity of the log ring buffer must be a power of two");
+
+	const char* level_name(const RumbleLogger::Level level)
+	{
+		switch (level)
+		{
+			case RumbleLogger::Level::Trace: return "TRACE";
+			case RumbleLogger::Level::Debug: return "DEBUG";
+			case RumbleLogger::Level::Info: return "INFO";
+			case RumbleLogger::Level::Warning: return "WARNING";
+			case RumbleLogger::Level::Error: return "ERROR";
+			default: return "LOG";
+		}
+	}
+
+	/**
+	* Bounded multi-producer / single-consumer ring buffer.
+	* Every slot carries a sequence number that tells producers and the consumer whose turn it is on that slot,
+	* so producers only compete on a single compare and swap over the enqueue position.
+	*/
+	class RingBuffer
+	{
+		private:
+			struct Slot
+			{
+				std::atomic<size_t> sequence;
+				RumbleLogger::Record record;
+			};
+
+			static constexpr size_t mask = RumbleLogger::queue_capacity - 1;
+
+			std::unique_ptr<Slot[]> slots;
+			alignas(64) std::atomic<size_t> enqueue_position{ 0 };
+			alignas(64) size_t dequeue_position{ 0 };
+
+		public:
+			RingBuffer() : slots{ new Slot[ RumbleLogger::queue_capacity ] }
+			{
+				for (size_t i = 0; i < RumbleLogger::queue_capacity; i++)
+					this->slots[ i ].sequence.store(i, std::memory_order_relaxed);
+			}
+
+			bool try_push(const RumbleLogger::Record& record)
+			{
+				size_t position = this->enqueue_position.load(std::memory_order_relaxed);
+				Slot* slot;
+
+				while (true)
+				{
+					slot = &this->slots[ position & mask ];
+					const size_t sequence = slot->sequence.load(std::memory_order_acquire);
+					const intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+
+					if (difference == 0)
+					{
+						if (this->enqueue_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+							break;
+					}
+					else if (difference < 0)
+						return false; // Full
+					else
+						position = this->enqueue_position.load(std::memory_order_relaxed);
+				}
+
+				// Only copies the used part of the message
+				slot->record.level = record.level;
+				slot->record.timestamp = record.timestamp;
+				slot->record.length = record.length;
+				std::memcpy(slot->record.message, record.message, record.length);
+
+				slot->sequence.store(position + 1, std::memory_order_release);
+				return true;
+			}
+
+			// Only called from the writer thread
+			bool try_pop(RumbleLogger::Record& record)
+			{
+				Slot& slot = this->slots[ this->dequeue_position & mask ];
+				if (slot.sequence.load(std::memory_order_acquire) != this->dequeue_position + 1)
+					return false;
+
+				record.level = slot.record.level;
+				record.timestamp = slot.record.timestamp;
+				record.length = slot.record.length;
+				std::memcpy(record.message, slot.record.message, slot.record.length);
+
+				slot.sequence.store(this->dequeue_position + RumbleLogger::queue_capacity, std::memory_order_release);
+				++this->dequeue_position;
+				return true;
+			}
+	};
+
+
+	/**
+	* Owns the ring buffer and the writer thread. The thread sleeps for a while when there is nothing to write,
+	* so producers never pay for waking it up.
+	*
+	* It's never destroyed: joining a thread during the static destruction can hang (ie, while the Python module
+	* unloads, with the loader lock held). The owner of the process stops it with RumbleLogger::shutdown instead.
+	*/
+	class Backend
+	{
+		private:
+			RingBuffer ring;
+			std::atomic<bool> running{ true };
+			// Set once the writer is gone. The late lines are written right away by their callers
+			std::atomic<bool> stopped{ false };
+			std::mutex shutdown_mutex;
+
+			std::atomic<uint64_t> submitted{ 0 };
+			std::atomic<uint64_t> written{ 0 };
+
+			std::mutex flush_mutex;
+			std::condition_variable flushed;
+
+			// Declared after everything that the thread uses, so it starts once all of it is initialized
+			std::thread writer;
+
+			void write_record(std::ostream& out, const RumbleLogger::Record& record)
+			{
+				const std::time_t seconds = std::chrono::system_clock::to_time_t(record.timestamp);
+				const long long millis = std::chrono::duration_cast<std::chrono::milliseconds>(
+					record.timestamp.time_since_epoch()
+				).count() % 1000;
+
+				std::tm local_time{};
+#ifdef _WIN32
+				localtime_s(&local_time, &seconds);
+#else
+				localtime_r(&seconds, &local_time);
+#endif
+				char time_buffer[ 16 ];
+				std::strftime(time_buffer, sizeof(time_buffer), "%H:%M:%S", &local_time);
+
+				char millis_buffer[ 8 ];
+				std::snprintf(millis_buffer, sizeof(millis_buffer), ".%03lld", millis);
+
+				out << '[' << time_buffer << millis_buffer << "] [" << level_name(record.level) << "] ";
+				out.write(record.message, record.length);
+				out << '\n';
+			}
+
+			void run()
+			{
+				RumbleLogger::Record record;
+
+				while (true)
+				{
+					uint64_t batch = 0;
+					while (this->ring.try_pop(record))
+					{
+						this->write_record(std::cout, record);
+						++batch;
+					}
+
+					if (batch > 0)
+					{
+						// One flush per batch, not per line
+						std::cout.flush();
+						this->written.fetch_add(batch, std::memory_order_release);
+
+						std::lock_guard<std::mutex> lock{ this->flush_mutex };
+						this->flushed.notify_all();
+						continue;
+					}
+
+					if (!this->running.load(std::memory_order_acquire))
+						break;
+
+					std::this_thread::sleep_for(std::chrono::milliseconds(2));
+				}
+			}
+
+		public:
+			std::atomic<uint64_t> dropped{ 0 };
+
+			Backend()
+			{
+				this->writer = std::thread{ &Backend::run, this };
+			}
+
+			// Drains the pending lines and stops the writer. Safe to be called more than once
+			void shutdown()
+			{
+				std::lock_guard<std::mutex> shutdown_lock{ this->shutdown_mutex };
+				if (!this->writer.joinable())
+					return;
+
+				this->running.store(false, std::memory_order_release);
+				this->writer.join();
+
+				// The writer it's gone, so this thread it's the only consumer now
+				std::lock_guard<std::mutex> lock{ this->flush_mutex };
+				RumbleLogger::Record record;
+				while (this->ring.try_pop(record))
+					this->write_record(std::cout, record);
+				std::cout.flush();
+
+				this->stopped.store(true, std::memory_order_release);
+				this->flushed.notify_all();
+			}
+
+			void submit(const RumbleLogger::Record& record)
+			{
+				if (this->stopped.load(std::memory_order_acquire))
+				{
+					std::lock_guard<std::mutex> lock{ this->flush_mutex };
+					this->write_record(std::cout, record);
+					std::cout.flush();
+					return;
+				}
+
+				if (this->ring.try_push(record))
+					this->submitted.fetch_add(1, std::memory_order_relaxed);
+				else
+					this->dropped.fetch_add(1, std::memory_order_relaxed);
+			}
+
+			void flush()
+			{
+				if (this->stopped.load(std::memory_order_acquire))
+					return;
+
+				const uint64_t target = this->submitted.load(std::memory_order_relaxed);
+
+				std::unique_lock<std::mutex> lock{ this->flush_mutex };
+				this->flushed.wait_for(lock, std::chrono::seconds(1), [this, target] {
+					return this->written.load(std::memory_order_acquire) >= target;
+				});
+			}
+	};
+
+	Backend& backend()
+	{
+		static Backend* instance = new Backend;
+		return *instance;
+	}
+}
+
+
+std::atomic<int> RumbleLogger::runtime_level{ static_cast<int>(RumbleLogger::compile_time_level) };
+
+void RumbleLogger::set_level(const Level level)
+{
+	runtime_level.store(static_cast<int>(level), std::memory_order_relaxed);
+}
+
+RumbleLogger::Level RumbleLogger::get_level()
+{
+	return static_cast<Level>(runtime_level.load(std::memory_order_relaxed));
+}
+
+void RumbleLogger::submit(const Record& record)
+{
+	backend().submit(record);
+}
+
+void RumbleLogger::flush()
+{
+	backend().flush();
+}
+
+void RumbleLogger::shutdown()
+{
+	backend().shutdown();
+}
+
+uint64_t RumbleLogger::dropped_lines()
+{
+	return backend().dropped.load(std::memory_order_relaxed);
+}
+
+
+/**
+* Line builder
+*/
+RumbleLogger::Line::Line(const Level level)
+{
+	this->record.level = level;
+	this->record.timestamp = std::chrono::system_clock::now();
+	this->record.length = 0;
+}
+
+RumbleLogger::Line::~Line()
+{
+	submit(this->record);
+}
+
+void RumbleLogger::Line::append(const char* text, size_t length)
+{
+	const size_t available = max_message_length - this->record.length;
+	if (length > available)
+		length = available;
+
+	std::memcpy(this->record.message + this->record.length, text, length);
+	this->record.length += static_cast<uint32_t>(length);
+}
+
+void RumbleLogger::Line::append_integer(long long value)
+{
+	char buffer[ 24 ];
+	const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+	this->append(buffer, result.ptr - buffer);
+}
+
+void RumbleLogger::Line::append_unsigned(unsigned long long value)
+{
+	char buffer[ 24 ];
+	const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+	this->append(buffer, result.ptr - buffer);
+}
+
+void RumbleLogger::Line::append_floating(double value)
+{
+	char buffer[ 32 ];
+	const int length = std::snprintf(buffer, sizeof(buffer), "%g", value);
+	if (length > 0)
+		this->append(buffer, static_cast<size_t>(length) < sizeof(buffer) ? length : sizeof(buffer) - 1);
+}
+
+RumbleLogger::Line& RumbleLogger::Line::operator<<(const char* text)
+{
+	if (text != nullptr)
+		this->append(text, std::strlen(text));
+	else
+		this->append("(null)", 6);
+	return *this;
+}
+
+RumbleLogger::Line& RumbleLogger::Line::operator<<(const std::string& text)
+{
+	this->append(text.data(), text.size());
+	return *this;
+}
+
+RumbleLogger::Line& RumbleLogger::Line::operator<<(const char character)
+{
+	this->append(&character, 1);
+	return *this;
+}
+
+RumbleLogger::Line& RumbleLogger::Line::operator<<(const bool value)
+{
+	value ? this->append("true", 4) : this->append("false", 5);
+	return *this;
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <type_traits>
+
+/**
+* Asynchronous leveled logger.
+*
+* A log call formats its message into a fixed buffer on the stack of the caller, pushes it into a lock-free
+* multi-producer ring buffer and returns. A background thread drains the ring and writes the lines to the output,
+* flushing once per batch instead of once per line.
+*
+* Usage, with the same stream style of std::cout:
+*     RUMBLE_LOG_INFO << "Current screen -> " << identifier;
+*
+* Levels below RUMBLE_LOG_LEVEL (Info by default) are discarded at compile time, so the trace and debug lines
+* of the hot paths doesn't generate code at all on release builds. The rest of them can still be filtered at runtime.
+* When the ring buffer it's full, the new lines are dropped (and counted) instead of blocking the caller.
+*/
+
+// Numeric values of the levels, to be used on the RUMBLE_LOG_LEVEL definition, ie: /DRUMBLE_LOG_LEVEL=0
+#define RUMBLE_LOG_LEVEL_TRACE 0
+#define RUMBLE_LOG_LEVEL_DEBUG 1
+#define RUMBLE_LOG_LEVEL_INFO 2
+#define RUMBLE_LOG_LEVEL_WARNING 3
+#define RUMBLE_LOG_LEVEL_ERROR 4
+#define RUMBLE_LOG_LEVEL_OFF 5
+
+#ifndef RUMBLE_LOG_LEVEL
+	#define RUMBLE_LOG_LEVEL RUMBLE_LOG_LEVEL_INFO
+#endif
+
+namespace RumbleLogger {
+
+	enum class Level : int {
+		Trace = RUMBLE_LOG_LEVEL_TRACE,
+		Debug = RUMBLE_LOG_LEVEL_DEBUG,
+		Info = RUMBLE_LOG_LEVEL_INFO,
+		Warning = RUMBLE_LOG_LEVEL_WARNING,
+		Error = RUMBLE_LOG_LEVEL_ERROR,
+		Off = RUMBLE_LOG_LEVEL_OFF
+	};
+
+	// The lowest level that it's compiled in
+	constexpr Level compile_time_level = static_cast<Level>(RUMBLE_LOG_LEVEL);
+
+	// Longest message that a single log line can hold. Longer ones are truncated
+	constexpr size_t max_message_length = 224;
+
+	// Lines that the ring buffer can hold before starting to drop them. Must be a power of two
+	constexpr size_t queue_capacity = 4096;
+
+	// A log line as it travels through the ring buffer
+	struct Record
+	{
+		Level level;
+		std::chrono::system_clock::time_point timestamp;
+		uint32_t length;
+		char message[ max_message_length ];
+	};
+
+	// Runtime filter. Lines below this level are discarded after a relaxed atomic load
+	extern std::atomic<int> runtime_level;
+
+	inline bool is_enabled(const Level level)
+	{
+		return static_cast<int>(level) >= runtime_level.load(std::memory_order_relaxed);
+	}
+
+	void set_level(const Level level);
+	Level get_level();
+
+	// Pushes a finished record into the ring buffer. Starts the writer thread on the first call
+	void submit(const Record& record);
+
+	// Blocks until every line submitted before the call has been written
+	void flush();
+
+	/**
+	* Writes the pending lines and stops the writer thread. Must be called before the process (or the module) goes
+	* away, since nothing joins the thread on the static destruction. The lines logged after it are written synchronously
+	*/
+	void shutdown();
+
+	// Lines lost because the ring buffer was full
+	uint64_t dropped_lines();
+
+
+	/**
+	* Builder of a single log line. Collects the pieces into a fixed buffer, without allocating,
+	* and submits the line when it goes out of scope, at the end of the full expression.
+	*/
+	class Line
+	{
+		private:
+			Record record;
+
+			void append(const char* text, size_t length);
+			void append_integer(long long value);
+			void append_unsigned(unsigned long long value);
+			void append_floating(double value);
+
+		public:
+			explicit Line(const Level level);
+			~Line();
+
+			Line(const Line&) = delete;
+			Line& operator=(const Line&) = delete;
+
+			Line& operator<<(const char* text);
+			Line& operator<<(const std::string& text);
+			Line& operator<<(const char character);
+			Line& operator<<(const bool value);
+
+			template <typename T>
+			Line& operator<<(const T& value)
+			{
+				if constexpr (std::is_convertible_v<T, const char*>)
+					*this << static_cast<const char*>(value);
+				else if constexpr (std::is_floating_point_v<T>)
+					this->append_floating(static_cast<double>(value));
+				else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>)
+					this->append_integer(static_cast<long long>(value));
+				else if constexpr (std::is_integral_v<T>)
+					this->append_unsigned(static_cast<unsigned long long>(value));
+				else
+				{
+					// Slow path for the user defined types that only knows how to print themselves into a std::ostream
+					std::ostringstream stream;
+					stream << value;
+					*this << stream.str();
+				}
+				return *this;
+			}
+	};
+}
+
+
+/**
+* The log macros. Every "if" has its "else", so they are safe to be used inside if / else statements without braces,
+* and the discarded levels are removed by the "if constexpr" at compile time.
+*/
+#define RUMBLE_LOG(level) \
+	if constexpr (level < RumbleLogger::compile_time_level) {} \
+	else if (!RumbleLogger::is_enabled(level)) {} \
+	else RumbleLogger::Line{ level }
+
+#define RUMBLE_LOG_TRACE RUMBLE_LOG(RumbleLogger::Level::Trace)
+#define RUMBLE_LOG_DEBUG RUMBLE_LOG(RumbleLogger::Level::Debug)
+#define RUMBLE_LOG_INFO RUMBLE_LOG(RumbleLogger::Level::Info)
+#define RUMBLE_LOG_WARNING RUMBLE_LOG(RumbleLogger::Level::Warning)
+#define RUMBLE_LOG_ERROR RUMBLE_LOG(RumbleLogger::Level::Error)
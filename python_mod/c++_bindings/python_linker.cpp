@@ -1,11 +1,135 @@
+#include <memory>
+
 #include <pybind11/pybind11.h>
+#include <pybind11/functional.h>
+#include <pybind11/stl.h>
 #include "../../core/RumbleLeague.hpp"
+#include "../../core/ClientScheduler.hpp"
+#include "../../tracing/RumbleTrace.hpp"
+#include "../../logger/RumbleLogger.hpp"
 
 namespace py = pybind11;
 
+namespace {
+
+    // Deleting the API stops its event watcher, that waits for the running callback, and the callbacks into Python
+    // needs the GIL. So the GIL it's released first, or both threads would wait for each other
+    struct ReleasingGilDeleter
+    {
+        void operator()(RumbleLeague* rumble_league) const
+        {
+            py::gil_scoped_release release;
+            delete rumble_league;
+        }
+    };
+}
+
 PYBIND11_MODULE(rle, m) {
-    py::class_<RumbleLeague>(m, "RumbleLeague")
+    py::class_<RumbleLeague, std::unique_ptr<RumbleLeague, ReleasingGilDeleter>>(m, "RumbleLeague")
         .def(py::init<>())
         .def(py::init<const int &, const bool&, const bool &>())
-        .def("play", &RumbleLeague::play);
-}
\ No newline at end of file
+        .def("play", &RumbleLeague::play)
+        .def("play_partial", &RumbleLeague::play_partial, py::arg("partial_input"))
+        .def("write", &RumbleLeague::write)
+        .def("save_thresholds", &RumbleLeague::save_thresholds)
+        .def("set_click_verification", &RumbleLeague::set_click_verification,
+            py::arg("enabled"), py::arg("budget_ms") = 250)
+        .def("set_layout_calibration", &RumbleLeague::set_layout_calibration, py::arg("enabled") = true)
+        .def("calibrate_layout", &RumbleLeague::calibrate_layout)
+        .def("set_working_format", &RumbleLeague::set_working_format,
+            py::arg("channel_mode"), py::arg("downscale") = 1)
+        // The callback runs on the watcher thread. To wake an asyncio loop, use loop.call_soon_threadsafe inside it
+        .def("subscribe", [](RumbleLeague& rumble_league, const std::string& needle_id, EventWatcher::EventCallback callback,
+            const int interval_ms, const py::object& region, const bool once) {
+                EventWatcher::SubscriptionOptions options;
+                options.polling_interval = std::chrono::milliseconds{ interval_ms };
+                options.once = once;
+                if (!region.is_none())
+                {
+                    const auto [x, y, width, height] = region.cast<std::tuple<int, int, int, int>>();
+                    options.region = cv::Rect{ x, y, width, height };
+                }
+
+                py::gil_scoped_release release;
+                return rumble_league.subscribe(needle_id, std::move(callback), options);
+            },
+            py::arg("needle_id"), py::arg("callback"), py::arg("interval_ms") = 50,
+            py::arg("region") = py::none(), py::arg("once") = false)
+        .def("unsubscribe", &RumbleLeague::unsubscribe, py::arg("subscription_id"),
+            py::call_guard<py::gil_scoped_release>())
+        // Returns right away with the id of the flow, that runs on its own thread
+        .def("queue_and_lock_in", &RumbleLeague::queue_and_lock_in, py::arg("champion"),
+            py::call_guard<py::gil_scoped_release>())
+        .def("cancel_flow", &RumbleLeague::cancel_flow, py::arg("flow_id"),
+            py::call_guard<py::gil_scoped_release>());
+
+    py::class_<EventWatcher::Event>(m, "WatcherEvent")
+        .def_readonly("subscription_id", &EventWatcher::Event::subscription_id)
+        .def_readonly("needle_id", &EventWatcher::Event::needle_id)
+        .def_readonly("score", &EventWatcher::Event::score)
+        .def_property_readonly("x", [](const EventWatcher::Event& event) { return event.screen_location.x; })
+        .def_property_readonly("y", [](const EventWatcher::Event& event) { return event.screen_location.y; })
+        .def_property_readonly("client_x", [](const EventWatcher::Event& event) { return event.client_location.x; })
+        .def_property_readonly("client_y", [](const EventWatcher::Event& event) { return event.client_location.y; });
+
+    py::enum_<ChannelMode>(m, "ChannelMode")
+        .value("BGRA", ChannelMode::BGRA)
+        .value("BGR", ChannelMode::BGR)
+        .value("GRAY", ChannelMode::Gray);
+
+    // Several clients on a shared pool of workers. The GIL it's released while the commands runs, so other Python
+    // threads can keep submitting commands to the rest of the clients
+    py::class_<ClientScheduler>(m, "ClientScheduler")
+        .def(py::init<const int, const size_t>(), py::arg("language_id"), py::arg("workers") = 0)
+        .def("attach_windows", &ClientScheduler::attach_windows,
+            py::arg("window_name") = "League of Legends", py::arg("autoaccept") = false)
+        .def("play", &ClientScheduler::play, py::arg("session_id"), py::arg("command"),
+            py::call_guard<py::gil_scoped_release>())
+        .def("wait_idle", &ClientScheduler::wait_idle, py::call_guard<py::gil_scoped_release>())
+        .def("session_count", &ClientScheduler::session_count)
+        .def("worker_count", &ClientScheduler::worker_count)
+        .def("save_thresholds", &ClientScheduler::save_thresholds);
+
+    // With an absolute path, the extension no longer depends on the working directory to find its assets and atlas
+    m.def("set_assets_root", &ClientButton::set_assets_root, py::arg("path"));
+
+    // Latency tracing. Spans are only recorded if the extension was compiled with RUMBLE_TRACING
+    py::module_ trace = m.def_submodule("trace", "Per stage latency tracing of the command pipeline");
+
+    py::class_<RumbleTrace::StageSummary>(trace, "StageSummary")
+        .def_readonly("name", &RumbleTrace::StageSummary::name)
+        .def_readonly("count", &RumbleTrace::StageSummary::count)
+        .def_readonly("p50_us", &RumbleTrace::StageSummary::p50_us)
+        .def_readonly("p99_us", &RumbleTrace::StageSummary::p99_us)
+        .def_readonly("max_us", &RumbleTrace::StageSummary::max_us)
+        .def_readonly("histogram", &RumbleTrace::StageSummary::histogram);
+
+    trace.def("enable", &RumbleTrace::set_enabled, py::arg("enable") = true);
+    trace.def("is_enabled", &RumbleTrace::is_enabled);
+    trace.def("clear", &RumbleTrace::clear);
+    trace.def("export_chrome", &RumbleTrace::export_chrome_trace, py::arg("path"));
+    trace.def("summary", &RumbleTrace::summary);
+
+    // Logging. Levels below the compile time one (RUMBLE_LOG_LEVEL) are never emitted, whatever the runtime level says
+    py::module_ log = m.def_submodule("log", "Asynchronous leveled logger of the extension");
+
+    py::enum_<RumbleLogger::Level>(log, "Level")
+        .value("TRACE", RumbleLogger::Level::Trace)
+        .value("DEBUG", RumbleLogger::Level::Debug)
+        .value("INFO", RumbleLogger::Level::Info)
+        .value("WARNING", RumbleLogger::Level::Warning)
+        .value("ERROR", RumbleLogger::Level::Error)
+        .value("OFF", RumbleLogger::Level::Off);
+
+    log.def("set_level", &RumbleLogger::set_level, py::arg("level"));
+    log.def("get_level", &RumbleLogger::get_level);
+    log.def("flush", &RumbleLogger::flush, py::call_guard<py::gil_scoped_release>());
+    log.def("dropped_lines", &RumbleLogger::dropped_lines);
+    log.def("shutdown", &RumbleLogger::shutdown, py::call_guard<py::gil_scoped_release>());
+
+    // The writer thread it's stopped on the interpreter teardown, while it's still safe to join it. Never on the module unload
+    py::module_::import("atexit").attr("register")(py::cpp_function([]() {
+        py::gil_scoped_release release;
+        RumbleLogger::shutdown();
+    }));
+}
@@ -18,6 +18,9 @@ except ImportError:
 import pybind11
 
 cpp_args = [
+    # Compiles in the latency trace spans. They stay disabled until rle.trace.enable() it's called
+    "/DRUMBLE_TRACING",
+    "/std:c++20",
     "-IC:\\vcpkg\\installed\\x64-windows\\include",
     f"-I{rel_path}\\rumble_league_extension_plugin\X64\RELEASE",
     "/link",
@@ -37,17 +40,40 @@ sfc_module = Extension(
         f'{rel_path}\\rumble_league_extension_plugin\python_mod\c++_bindings\python_linker.cpp',
         # Main library
         f'{rel_path}\\rumble_league_extension_plugin\core\RumbleLeague.cpp',
+        f'{rel_path}\\rumble_league_extension_plugin\core\ClickVerifier.cpp',
+        f'{rel_path}\\rumble_league_extension_plugin\core\NeedleResources.cpp',
+        f'{rel_path}\\rumble_league_extension_plugin\core\ClientScheduler.cpp',
+        f'{rel_path}\\rumble_league_extension_plugin\core\EventWatcher.cpp',
+        f'{rel_path}\\rumble_league_extension_plugin\core\FlowRuntime.cpp',
+        f'{rel_path}\\rumble_league_extension_plugin\core\SpeculativeMatcher.cpp',
+        f'{rel_path}\\rumble_league_extension_plugin\core\CommandPredictor.cpp',
+        f'{rel_path}\\rumble_league_extension_plugin\core\LayoutProfile.cpp',
         # League Client screens and buttons
         f'{rel_path}\\rumble_league_extension_plugin\core\league_client\LeagueClientScreen.cpp',
         f'{rel_path}\\rumble_league_extension_plugin\core\league_client\LeagueClientButton.cpp',
-        # Motion
-        f'{rel_path}\\rumble_league_extension_plugin\motion\RumbleMotion.cpp',
         # Vision
         f'{rel_path}\\rumble_league_extension_plugin\\vision\RumbleVision.cpp',
+        f'{rel_path}\\rumble_league_extension_plugin\\vision\\NeedleThresholds.cpp',
+        f'{rel_path}\\rumble_league_extension_plugin\\vision\\CompiledNeedles.cpp',
+        f'{rel_path}\\rumble_league_extension_plugin\\vision\\MatcherEngine.cpp',
+        f'{rel_path}\\rumble_league_extension_plugin\\vision\\MatcherRegistry.cpp',
+        f'{rel_path}\\rumble_league_extension_plugin\\vision\\MatcherCascade.cpp',
+        f'{rel_path}\\rumble_league_extension_plugin\\vision\\SpectralMatcher.cpp',
+        f'{rel_path}\\rumble_league_extension_plugin\\vision\\MatchCache.cpp',
+        f'{rel_path}\\rumble_league_extension_plugin\\vision\\NeedleAtlas.cpp',
         # Window Capture
         f'{rel_path}\\rumble_league_extension_plugin\window_capture\WindowCapture.cpp',
+        f'{rel_path}\\rumble_league_extension_plugin\window_capture\FrameKernels.cpp',
         # Window Capture
         f'{rel_path}\\rumble_league_extension_plugin\helpers\StringHelper.cpp',
+        f'{rel_path}\\rumble_league_extension_plugin\helpers\MappedFile.cpp',
+        # Input injection
+        f'{rel_path}\\rumble_league_extension_plugin\input\InputQueue.cpp',
+        f'{rel_path}\\rumble_league_extension_plugin\input\Win32InputBackend.cpp',
+        # Logging
+        f'{rel_path}\\rumble_league_extension_plugin\logger\RumbleLogger.cpp',
+        # Tracing
+        f'{rel_path}\\rumble_league_extension_plugin\\tracing\RumbleTrace.cpp',
     ],
     include_dirs=[
         pybind11.get_include(),
@@ -21,6 +21,9 @@ except ImportError:
 # import pybind11
 
 cpp_args = [
+    # Compiles in the latency trace spans. They stay disabled until rle.trace.enable() it's called
+    "/DRUMBLE_TRACING",
+    "/std:c++20",
     "-IC:\\vcpkg\\installed\\x64-windows\\include",
     f"-I{rel_path}\\rumble_league_extension_plugin\X64\RELEASE",
     "/link",
@@ -40,19 +43,40 @@ sfc_module = Extension(
         f'D:\MSi 2020-2021\Code\Python\Rumble-AI\src\plugins\\rumble_league_extension_plugin\python_mod\c++_bindings\python_linker.cpp',
         # Main library
         f'D:\MSi 2020-2021\Code\Python\Rumble-AI\src\plugins\\rumble_league_extension_plugin\core\RumbleLeague.cpp',
+        f'D:\MSi 2020-2021\Code\Python\Rumble-AI\src\plugins\\rumble_league_extension_plugin\core\ClickVerifier.cpp',
+        f'D:\MSi 2020-2021\Code\Python\Rumble-AI\src\plugins\\rumble_league_extension_plugin\core\NeedleResources.cpp',
+        f'D:\MSi 2020-2021\Code\Python\Rumble-AI\src\plugins\\rumble_league_extension_plugin\core\ClientScheduler.cpp',
+        f'D:\MSi 2020-2021\Code\Python\Rumble-AI\src\plugins\\rumble_league_extension_plugin\core\EventWatcher.cpp',
+        f'D:\MSi 2020-2021\Code\Python\Rumble-AI\src\plugins\\rumble_league_extension_plugin\core\FlowRuntime.cpp',
+        f'D:\MSi 2020-2021\Code\Python\Rumble-AI\src\plugins\\rumble_league_extension_plugin\core\SpeculativeMatcher.cpp',
+        f'D:\MSi 2020-2021\Code\Python\Rumble-AI\src\plugins\\rumble_league_extension_plugin\core\CommandPredictor.cpp',
+        f'D:\MSi 2020-2021\Code\Python\Rumble-AI\src\plugins\\rumble_league_extension_plugin\core\LayoutProfile.cpp',
         # League Client screens and buttons
         f'D:\MSi 2020-2021\Code\Python\Rumble-AI\src\plugins\\rumble_league_extension_plugin\core\league_client\LeagueClientScreen.cpp',
         f'D:\MSi 2020-2021\Code\Python\Rumble-AI\src\plugins\\rumble_league_extension_plugin\core\league_client\LeagueClientButton.cpp',
-        # Motion
-        f'D:\MSi 2020-2021\Code\Python\Rumble-AI\src\plugins\\rumble_league_extension_plugin\motion\RumbleMotion.cpp',
         # Vision
         f'D:\MSi 2020-2021\Code\Python\Rumble-AI\src\plugins\\rumble_league_extension_plugin\gision\RumbleVision.cpp',
+        f'D:\MSi 2020-2021\Code\Python\Rumble-AI\src\plugins\\rumble_league_extension_plugin\\vision\\NeedleThresholds.cpp',
+        f'D:\MSi 2020-2021\Code\Python\Rumble-AI\src\plugins\\rumble_league_extension_plugin\\vision\\CompiledNeedles.cpp',
+        f'D:\MSi 2020-2021\Code\Python\Rumble-AI\src\plugins\\rumble_league_extension_plugin\\vision\\MatcherEngine.cpp',
+        f'D:\MSi 2020-2021\Code\Python\Rumble-AI\src\plugins\\rumble_league_extension_plugin\\vision\\MatcherRegistry.cpp',
+        f'D:\MSi 2020-2021\Code\Python\Rumble-AI\src\plugins\\rumble_league_extension_plugin\\vision\\MatcherCascade.cpp',
+        f'D:\MSi 2020-2021\Code\Python\Rumble-AI\src\plugins\\rumble_league_extension_plugin\\vision\\SpectralMatcher.cpp',
+        f'D:\MSi 2020-2021\Code\Python\Rumble-AI\src\plugins\\rumble_league_extension_plugin\\vision\\MatchCache.cpp',
+        f'D:\MSi 2020-2021\Code\Python\Rumble-AI\src\plugins\\rumble_league_extension_plugin\\vision\\NeedleAtlas.cpp',
         # Window Capture
         f'D:\MSi 2020-2021\Code\Python\Rumble-AI\src\plugins\\rumble_league_extension_plugin\window_capture\WindowCapture.cpp',
-        # Writer
-        f'D:\MSi 2020-2021\Code\Python\Rumble-AI\src\plugins\\rumble_league_extension_plugin\writer\RumbleWriter.cpp',
+        f'D:\MSi 2020-2021\Code\Python\Rumble-AI\src\plugins\\rumble_league_extension_plugin\window_capture\FrameKernels.cpp',
         # Helpers
         f'D:\MSi 2020-2021\Code\Python\Rumble-AI\src\plugins\\rumble_league_extension_plugin\helpers\StringHelper.cpp',
+        f'D:\MSi 2020-2021\Code\Python\Rumble-AI\src\plugins\\rumble_league_extension_plugin\helpers\MappedFile.cpp',
+        # Input injection
+        f'D:\MSi 2020-2021\Code\Python\Rumble-AI\src\plugins\\rumble_league_extension_plugin\input\InputQueue.cpp',
+        f'D:\MSi 2020-2021\Code\Python\Rumble-AI\src\plugins\\rumble_league_extension_plugin\input\Win32InputBackend.cpp',
+        # Logging
+        f'D:\MSi 2020-2021\Code\Python\Rumble-AI\src\plugins\\rumble_league_extension_plugin\logger\RumbleLogger.cpp',
+        # Tracing
+        f'D:\MSi 2020-2021\Code\Python\Rumble-AI\src\plugins\\rumble_league_extension_plugin\\tracing\RumbleTrace.cpp',
         
     ],
     include_dirs=[
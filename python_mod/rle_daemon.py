@@ -0,0 +1,96 @@
+import socket
+import struct
+
+'''
+    Client of the Rumble daemon (daemon/RumbleDaemon.hpp), for the Rumble-AI workers that shares one warm engine
+    per host instead of loading their own copy of the extension:
+
+        client = RumbleDaemonClient( '/tmp/rle.sock' )
+        answer, queue_us, run_us = client.play( 'play' )
+
+    The protocol it's the one described on daemon/DaemonProtocol.hpp. Requests can be pipelined with send_play()
+    and read back, in completion order, with receive().
+'''
+
+HANDSHAKE = b'RLE\x01'
+REQUEST_HEADER = struct.Struct( '<IHBBI' )
+RESPONSE_HEADER = struct.Struct( '<IB3xIII' )
+
+OPCODE_PING = 0
+OPCODE_PLAY = 1
+OPCODE_SESSIONS = 2
+
+STATUS_OK = 0
+
+
+class RumbleDaemonError( Exception ):
+    pass
+
+
+class RumbleDaemonClient:
+    def __init__( self, socket_path ):
+        self.connection = socket.socket( socket.AF_UNIX, socket.SOCK_STREAM )
+        self.connection.connect( socket_path )
+        self.connection.sendall( HANDSHAKE )
+        self.next_request_id = 0
+        # Responses read while waiting for another request, by request id, in completion order
+        self.unclaimed_responses = {}
+
+    def close( self ):
+        self.connection.close()
+
+    def _send( self, opcode, session_id, payload ):
+        request_id = self.next_request_id
+        self.next_request_id = ( self.next_request_id + 1 ) & 0xFFFFFFFF
+        self.connection.sendall( REQUEST_HEADER.pack( request_id, session_id, opcode, 0, len( payload ) ) + payload )
+        return request_id
+
+    def _read_exact( self, size ):
+        data = bytearray()
+        while len( data ) < size:
+            chunk = self.connection.recv( size - len( data ) )
+            if not chunk:
+                raise RumbleDaemonError( 'The daemon closed the connection' )
+            data += chunk
+        return bytes( data )
+
+    def send_play( self, command, session_id = 0 ):
+        ''' Queues a command without waiting for its answer. Returns the id of the request '''
+        return self._send( OPCODE_PLAY, session_id, command.encode( 'utf-8' ) )
+
+    def _read_response( self ):
+        request_id, status, queue_us, run_us, length = RESPONSE_HEADER.unpack( self._read_exact( RESPONSE_HEADER.size ) )
+        return request_id, status, self._read_exact( length ), queue_us, run_us
+
+    def _wait_response( self, request_id ):
+        ''' The response of a request. The ones of the other requests read meanwhile are kept for receive() '''
+        if request_id in self.unclaimed_responses:
+            return self.unclaimed_responses.pop( request_id )
+        while True:
+            response = self._read_response()
+            if response[ 0 ] == request_id:
+                return response
+            self.unclaimed_responses[ response[ 0 ] ] = response
+
+    def receive( self ):
+        ''' Reads the next response: ( request_id, status, payload bytes, queue_us, run_us ) '''
+        if self.unclaimed_responses:
+            oldest_id = next( iter( self.unclaimed_responses ) )
+            return self.unclaimed_responses.pop( oldest_id )
+        return self._read_response()
+
+    def play( self, command, session_id = 0 ):
+        ''' Runs a command on a session of the daemon and waits for it. Returns ( answer, queue_us, run_us ) '''
+        request_id = self.send_play( command, session_id )
+        _, status, payload, queue_us, run_us = self._wait_response( request_id )
+        answer = payload.decode( 'utf-8', errors = 'replace' )
+        if status != STATUS_OK:
+            raise RumbleDaemonError( f'Request failed with status { status }: { answer }' )
+        return answer, queue_us, run_us
+
+    def sessions( self ):
+        request_id = self._send( OPCODE_SESSIONS, 0, b'' )
+        _, status, payload, _, _ = self._wait_response( request_id )
+        if status != STATUS_OK:
+            raise RumbleDaemonError( f'Request failed with status { status }' )
+        return struct.unpack( '<I', payload )[ 0 ]
@@ -0,0 +1,584 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "../../vision/CompiledNeedles.hpp"
+#include "../../vision/NeedleThresholds.hpp"
+#include "../../vision/RumbleVision.h"
+#include "../../window_capture/FrameKernels.hpp"
+
+/**
+* Accuracy harness of the vision engine.
+*
+* Runs every matcher configuration (channel mode, match method, scale, whole or compiled needles) over a corpus of
+* real client screenshots, annotated with the ground truth boxes of the buttons that are on each of them, and reports
+* per configuration and per needle: precision, recall, center error of the hits and milliseconds per frame.
+*
+* Each screenshot (png or jpg) of the corpus comes with a YAML file of the same name that lists its buttons:
+*     %YAML:1.0
+*     buttons:
+*        - { id: accept_match, x: 862, y: 706, width: 196, height: 64 }
+* Every needle that isn't listed it's expected to be absent from the screenshot, so searching it there can only end
+* in a false positive or a true negative. "partial: 1" on a file makes the unlisted needles unknown instead.
+*
+* A detection it's right when its center (where the click would land) falls inside the box of the button.
+* Any other detection it's a false positive, and the ones of the champ select and the accept modal are reported apart:
+* a false click there is worse than a slow one.
+*
+* Every needle it's searched with the threshold that the extension learned for it (the thresholds.yml next to the
+* needles, or --thresholds=<file>), on the same match path: the compiled configurations take the ones of the patch.
+* The needles without a learned one, and the configurations of another match method, use the default threshold.
+* --threshold=<value> overrides all of them with a single one.
+*
+* Optimizations of the matcher must not regress the detection. The report can be saved (--out) and used as the
+* baseline of the next runs (--baseline), that fails when any configuration finds less buttons or clicks more
+* wrong places than it did on the baseline:
+*     ./accuracy_harness --needles=assets/EN --corpus=corpus/EN --out=accuracy.yml
+*     ./accuracy_harness --needles=assets/EN --corpus=corpus/EN --baseline=accuracy.yml
+*/
+
+namespace {
+
+	namespace fs = std::filesystem;
+
+	// The needles where a false positive means a wrong click with consequences (a lost pick, a dodged queue...)
+	const std::set<std::string> critical_needles {
+		"accept_match", "decline_match", "lock_in", "search_bar", "runes_editor", "runes_picker",
+	};
+
+	struct Options
+	{
+		std::string needles_dir;
+		std::string corpus_dir;
+		std::string compiled_path;
+		std::string thresholds_path;
+		std::string baseline_path;
+		std::string output_path;
+		// Comma separated names of the configurations to run. Empty runs all of them
+		std::string configurations;
+		// The default threshold. With threshold_override, the only one
+		double threshold = 0.05;
+		bool threshold_override = false;
+		// Times that every search it's repeated, to steady the timings
+		int repeat = 1;
+		bool per_needle = false;
+	};
+
+	struct Configuration
+	{
+		std::string name;
+		ChannelMode channel_mode;
+		int match_method;
+		int downscale;
+		bool compiled;
+	};
+
+	struct Annotation
+	{
+		std::string needle_id;
+		cv::Rect box;
+	};
+
+	struct Screenshot
+	{
+		std::string name;
+		cv::Mat frame;
+		std::vector<Annotation> annotations;
+		// The unlisted needles are unknown, rather than absent
+		bool partial;
+	};
+
+	struct NeedleStats
+	{
+		int true_positives = 0;
+		int false_positives = 0;
+		int false_negatives = 0;
+		int true_negatives = 0;
+		double center_error_sum = 0.0;
+		double search_ms = 0.0;
+		int searches = 0;
+
+		double precision() const
+		{
+			const int detections = this->true_positives + this->false_positives;
+			return detections > 0 ? static_cast<double>(this->true_positives) / detections : 1.0;
+		}
+
+		double recall() const
+		{
+			const int present = this->true_positives + this->false_negatives;
+			return present > 0 ? static_cast<double>(this->true_positives) / present : 1.0;
+		}
+
+		double center_error() const
+		{
+			return this->true_positives > 0 ? this->center_error_sum / this->true_positives : 0.0;
+		}
+
+		void add(const NeedleStats& other)
+		{
+			this->true_positives += other.true_positives;
+			this->false_positives += other.false_positives;
+			this->false_negatives += other.false_negatives;
+			this->true_negatives += other.true_negatives;
+			this->center_error_sum += other.center_error_sum;
+			this->search_ms += other.search_ms;
+			this->searches += other.searches;
+		}
+	};
+
+	struct ConfigurationReport
+	{
+		std::string name;
+		std::map<std::string, NeedleStats> needles;
+		double frame_ms = 0.0;
+		int critical_false_positives = 0;
+	};
+
+	const char* channel_mode_name(const ChannelMode channel_mode)
+	{
+		switch (channel_mode)
+		{
+			case ChannelMode::BGRA: return "bgra";
+			case ChannelMode::BGR: return "bgr";
+			default: return "gray";
+		}
+	}
+
+	const char* match_method_name(const int match_method)
+	{
+		switch (match_method)
+		{
+			case cv::TM_SQDIFF_NORMED: return "sqdiff";
+			case cv::TM_CCORR_NORMED: return "ccorr";
+			default: return "ccoeff";
+		}
+	}
+
+	// Every combination that the engine supports. The compiled ones, only if there are compiled needles
+	std::vector<Configuration> all_configurations(const bool with_compiled)
+	{
+		std::vector<Configuration> configurations;
+		for (const ChannelMode channel_mode : { ChannelMode::BGRA, ChannelMode::BGR, ChannelMode::Gray })
+			for (const int match_method : { cv::TM_SQDIFF_NORMED, cv::TM_CCORR_NORMED, cv::TM_CCOEFF_NORMED })
+				for (const int downscale : { 1, 2 })
+					for (const bool compiled : { false, true })
+					{
+						if (compiled && !with_compiled)
+							continue;
+
+						const std::string name = std::string{ channel_mode_name(channel_mode) } + "/" + match_method_name(match_method)
+							+ "/" + std::to_string(downscale) + (compiled ? "/compiled" : "");
+						configurations.push_back(Configuration{ name, channel_mode, match_method, downscale, compiled });
+					}
+		return configurations;
+	}
+
+	std::map<std::string, cv::Mat> load_needles(const std::string& directory)
+	{
+		std::map<std::string, cv::Mat> needles;
+		for (const auto& entry : fs::directory_iterator(directory))
+		{
+			if (entry.path().extension() != ".jpg")
+				continue;
+
+			cv::Mat needle = cv::imread(entry.path().string(), cv::IMREAD_COLOR);
+			if (!needle.empty())
+				needles.emplace(entry.path().stem().string(), needle);
+		}
+		return needles;
+	}
+
+	// The annotated screenshots of the corpus, as BGRA frames (the layout of the captures). The unannotated ones are skipped
+	std::vector<Screenshot> load_corpus(const std::string& directory)
+	{
+		std::vector<fs::path> paths;
+		for (const auto& entry : fs::directory_iterator(directory))
+		{
+			const std::string extension = entry.path().extension().string();
+			if (extension == ".png" || extension == ".jpg")
+				paths.push_back(entry.path());
+		}
+		std::sort(paths.begin(), paths.end());
+
+		std::vector<Screenshot> corpus;
+		for (const fs::path& path : paths)
+		{
+			fs::path annotation_path = path;
+			annotation_path.replace_extension(".yml");
+			if (!fs::exists(annotation_path))
+			{
+				std::cerr << "Skipping " << path.filename().string() << ", it has no annotations" << std::endl;
+				continue;
+			}
+
+			Screenshot screenshot;
+			screenshot.name = path.filename().string();
+			screenshot.frame = cv::imread(path.string(), cv::IMREAD_COLOR);
+			if (screenshot.frame.empty())
+				continue;
+			cv::cvtColor(screenshot.frame, screenshot.frame, cv::COLOR_BGR2BGRA);
+
+			cv::FileStorage storage{ annotation_path.string(), cv::FileStorage::READ };
+			screenshot.partial = !storage[ "partial" ].empty() && static_cast<int>(storage[ "partial" ]) != 0;
+
+			const cv::FileNode buttons = storage[ "buttons" ];
+			for (auto it = buttons.begin(); it != buttons.end(); ++it)
+			{
+				screenshot.annotations.push_back(Annotation{
+					static_cast<std::string>((*it)[ "id" ]),
+					cv::Rect{ static_cast<int>((*it)[ "x" ]), static_cast<int>((*it)[ "y" ]),
+						static_cast<int>((*it)[ "width" ]), static_cast<int>((*it)[ "height" ]) }
+				});
+			}
+
+			corpus.push_back(std::move(screenshot));
+		}
+		return corpus;
+	}
+
+	ConfigurationReport evaluate(
+		const Configuration& configuration,
+		const std::vector<Screenshot>& corpus,
+		const std::map<std::string, cv::Mat>& needles,
+		const CompiledNeedles& compiled_needles,
+		const Options& options
+	) {
+		using Clock = std::chrono::steady_clock;
+
+		RumbleLeagueVision rumble_vision{ configuration.channel_mode, configuration.match_method, configuration.downscale };
+		const WorkingFormat format = rumble_vision.get_working_format();
+
+		// Only the file of the same match method loads. The rest of the configurations keeps the default one
+		NeedleThresholds needle_thresholds{ options.threshold, configuration.match_method };
+		if (!options.threshold_override)
+			needle_thresholds.load(options.thresholds_path);
+		const std::string format_tag = rumble_vision.get_format_tag();
+
+		ConfigurationReport report;
+		report.name = configuration.name;
+		double total_ms = 0.0;
+
+		for (const Screenshot& screenshot : corpus)
+		{
+			const Clock::time_point frame_start = Clock::now();
+
+			// The same conversion that the captures makes at runtime, so it's paid on every frame
+			WorkingFrame frame;
+			FrameKernels::from_image(screenshot.frame, format, frame);
+
+			for (const auto& [needle_id, needle] : needles)
+			{
+				const auto annotation = std::find_if(screenshot.annotations.begin(), screenshot.annotations.end(),
+					[&](const Annotation& candidate) { return candidate.needle_id == needle_id; });
+				const bool present = annotation != screenshot.annotations.end();
+				if (!present && screenshot.partial)
+					continue;
+				if (needle.cols > screenshot.frame.cols || needle.rows > screenshot.frame.rows)
+					continue;
+
+				const CompiledNeedle* compiled_needle = configuration.compiled ? compiled_needles.get(needle_id) : nullptr;
+				if (compiled_needle != nullptr && compiled_needle->needle_size != needle.size())
+					compiled_needle = nullptr;
+
+				const double threshold = options.threshold_override
+					? options.threshold
+					: needle_thresholds.get(needle_id + format_tag, (compiled_needle != nullptr) ? MatchPath::Patch : MatchPath::Full);
+
+				cv::Point location;
+				const Clock::time_point search_start = Clock::now();
+				for (int i = 0; i < options.repeat; i++)
+					location = (compiled_needle != nullptr)
+						? rumble_vision.find(frame, needle, *compiled_needle, threshold)
+						: rumble_vision.find(frame, needle, threshold);
+				const double search_ms = std::chrono::duration<double, std::milli>(Clock::now() - search_start).count() / options.repeat;
+
+				NeedleStats& stats = report.needles[ needle_id ];
+				stats.search_ms += search_ms;
+				++stats.searches;
+
+				// The engine reports a miss as the origin
+				const bool detected = location.x != 0 && location.y != 0;
+				if (detected && present && annotation->box.contains(location))
+				{
+					++stats.true_positives;
+					const cv::Point center = annotation->box.tl() + cv::Point{ annotation->box.width / 2, annotation->box.height / 2 };
+					stats.center_error_sum += std::hypot(location.x - center.x, location.y - center.y);
+					continue;
+				}
+
+				if (detected)
+				{
+					++stats.false_positives;
+					if (critical_needles.count(needle_id) > 0)
+					{
+						++report.critical_false_positives;
+						std::cout << "  critical false positive: " << needle_id << " on " << screenshot.name
+							<< " at [" << location.x << ", " << location.y << "] (" << configuration.name << ")" << std::endl;
+					}
+				}
+
+				if (present)
+					++stats.false_negatives;
+				else if (!detected)
+					++stats.true_negatives;
+			}
+
+			total_ms += std::chrono::duration<double, std::milli>(Clock::now() - frame_start).count();
+		}
+
+		// The repetitions only steadies the searches. The time of a frame counts each of them once
+		double repeated_ms = 0.0;
+		for (const auto& [needle_id, stats] : report.needles)
+			repeated_ms += stats.search_ms * (options.repeat - 1);
+		report.frame_ms = corpus.empty() ? 0.0 : (total_ms - repeated_ms) / corpus.size();
+
+		return report;
+	}
+
+	void print_report(const ConfigurationReport& report, const bool per_needle)
+	{
+		NeedleStats total;
+		for (const auto& [needle_id, stats] : report.needles)
+			total.add(stats);
+
+		std::cout << std::left << std::setw(28) << report.name << std::right << std::fixed
+			<< std::setprecision(3) << std::setw(10) << total.precision()
+			<< std::setw(10) << total.recall()
+			<< std::setprecision(2) << std::setw(12) << total.center_error()
+			<< std::setw(12) << report.frame_ms
+			<< std::setw(8) << total.false_positives
+			<< std::setw(10) << report.critical_false_positives << std::endl;
+
+		if (!per_needle)
+			return;
+
+		for (const auto& [needle_id, stats] : report.needles)
+		{
+			std::cout << "    " << std::left << std::setw(24) << needle_id << std::right
+				<< std::setprecision(3) << std::setw(10) << stats.precision()
+				<< std::setw(10) << stats.recall()
+				<< std::setprecision(2) << std::setw(12) << stats.center_error()
+				<< std::setprecision(3) << std::setw(12) << (stats.searches > 0 ? stats.search_ms / stats.searches : 0.0)
+				<< std::setw(8) << stats.false_positives << std::endl;
+		}
+	}
+
+	bool save_reports(const std::string& path, const std::vector<ConfigurationReport>& reports, const Options& options)
+	{
+		cv::FileStorage storage;
+		try
+		{
+			if (!storage.open(path, cv::FileStorage::WRITE))
+				return false;
+		}
+		catch (const cv::Exception&)
+		{
+			return false;
+		}
+
+		storage << "threshold" << options.threshold;
+		storage << "learned_thresholds" << (options.threshold_override ? std::string{} : options.thresholds_path);
+		storage << "configurations" << "[";
+		for (const ConfigurationReport& report : reports)
+		{
+			storage << "{" << "name" << report.name << "frame_ms" << report.frame_ms << "needles" << "[";
+			for (const auto& [needle_id, stats] : report.needles)
+			{
+				storage << "{"
+					<< "id" << needle_id
+					<< "tp" << stats.true_positives
+					<< "fp" << stats.false_positives
+					<< "fn" << stats.false_negatives
+					<< "tn" << stats.true_negatives
+					<< "center_error" << stats.center_error()
+					<< "search_ms" << (stats.searches > 0 ? stats.search_ms / stats.searches : 0.0)
+					<< "}";
+			}
+			storage << "]" << "}";
+		}
+		storage << "]";
+
+		return true;
+	}
+
+	/**
+	* The detection can't get worse than on the baseline: no needle finds less buttons, nor clicks more wrong places,
+	* on any configuration that both runs share. Timings are reported, but never fail the run.
+	* Returns the number of regressions
+	*/
+	int compare_with_baseline(const std::string& path, const std::vector<ConfigurationReport>& reports)
+	{
+		cv::FileStorage storage{ path, cv::FileStorage::READ };
+		if (!storage.isOpened())
+		{
+			std::cerr << "Unable to read the baseline " << path << std::endl;
+			return 1;
+		}
+
+		int regressions = 0;
+		const cv::FileNode configurations = storage[ "configurations" ];
+		for (auto configuration = configurations.begin(); configuration != configurations.end(); ++configuration)
+		{
+			const std::string name = static_cast<std::string>((*configuration)[ "name" ]);
+			const auto report = std::find_if(reports.begin(), reports.end(), [&](const ConfigurationReport& candidate) {
+				return candidate.name == name;
+			});
+			if (report == reports.end())
+				continue;
+
+			const double baseline_ms = static_cast<double>((*configuration)[ "frame_ms" ]);
+			if (baseline_ms > 0.0)
+				std::cout << name << ": " << std::setprecision(2) << report->frame_ms << " ms/frame (baseline "
+					<< baseline_ms << ", " << std::showpos << 100.0 * (report->frame_ms / baseline_ms - 1.0) << std::noshowpos << "%)" << std::endl;
+
+			const cv::FileNode needles = (*configuration)[ "needles" ];
+			for (auto needle = needles.begin(); needle != needles.end(); ++needle)
+			{
+				const std::string needle_id = static_cast<std::string>((*needle)[ "id" ]);
+				const auto stats = report->needles.find(needle_id);
+				if (stats == report->needles.end())
+					continue;
+
+				const int baseline_true_positives = static_cast<int>((*needle)[ "tp" ]);
+				const int baseline_false_positives = static_cast<int>((*needle)[ "fp" ]);
+
+				if (stats->second.true_positives < baseline_true_positives)
+				{
+					std::cout << "REGRESSION " << name << " " << needle_id << ": " << stats->second.true_positives
+						<< " hits, " << baseline_true_positives << " on the baseline" << std::endl;
+					++regressions;
+				}
+				if (stats->second.false_positives > baseline_false_positives)
+				{
+					std::cout << "REGRESSION " << name << " " << needle_id << ": " << stats->second.false_positives
+						<< " false positives, " << baseline_false_positives << " on the baseline"
+						<< (critical_needles.count(needle_id) > 0 ? " (critical)" : "") << std::endl;
+					++regressions;
+				}
+			}
+		}
+
+		return regressions;
+	}
+
+	bool parse_options(int argc, char** argv, Options& options)
+	{
+		const auto value_of = [](const char* arg, const char* flag, std::string& value) {
+			if (std::strncmp(arg, flag, std::strlen(flag)) != 0)
+				return false;
+			value = arg + std::strlen(flag);
+			return true;
+		};
+
+		std::string threshold, repeat;
+		for (int i = 1; i < argc; i++)
+		{
+			if (std::strcmp(argv[ i ], "--per-needle") == 0)
+				options.per_needle = true;
+			else if (!value_of(argv[ i ], "--needles=", options.needles_dir)
+				&& !value_of(argv[ i ], "--corpus=", options.corpus_dir)
+				&& !value_of(argv[ i ], "--compiled=", options.compiled_path)
+				&& !value_of(argv[ i ], "--thresholds=", options.thresholds_path)
+				&& !value_of(argv[ i ], "--baseline=", options.baseline_path)
+				&& !value_of(argv[ i ], "--out=", options.output_path)
+				&& !value_of(argv[ i ], "--configs=", options.configurations)
+				&& !value_of(argv[ i ], "--threshold=", threshold)
+				&& !value_of(argv[ i ], "--repeat=", repeat))
+			{
+				std::cerr << "Unknown option " << argv[ i ] << std::endl;
+				return false;
+			}
+		}
+
+		if (!threshold.empty())
+		{
+			options.threshold = std::stod(threshold);
+			options.threshold_override = true;
+		}
+		if (!repeat.empty())
+			options.repeat = std::max(1, std::stoi(repeat));
+		if (options.compiled_path.empty() && !options.needles_dir.empty())
+			options.compiled_path = options.needles_dir + "/" + CompiledNeedles::file_name;
+		if (options.thresholds_path.empty() && !options.needles_dir.empty())
+			options.thresholds_path = options.needles_dir + "/" + NeedleThresholds::file_name;
+
+		return !options.needles_dir.empty() && !options.corpus_dir.empty();
+	}
+}
+
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!parse_options(argc, argv, options))
+	{
+		std::cerr << "Usage: accuracy_harness --needles=<assets folder> --corpus=<annotated screenshots folder>"
+			" [--configs=<name,name...>] [--thresholds=<file> | --threshold=0.05] [--repeat=1] [--compiled=<file>]"
+			" [--out=<report>] [--baseline=<report>] [--per-needle]" << std::endl;
+		return 1;
+	}
+
+	const std::vector<Screenshot> corpus = load_corpus(options.corpus_dir);
+	if (corpus.empty())
+	{
+		std::cerr << "There isn't any annotated screenshot on " << options.corpus_dir << std::endl;
+		return 1;
+	}
+
+	const std::map<std::string, cv::Mat> needles = load_needles(options.needles_dir);
+	CompiledNeedles compiled_needles;
+	const bool with_compiled = compiled_needles.load(options.compiled_path);
+
+	std::vector<Configuration> configurations = all_configurations(with_compiled);
+	if (!options.configurations.empty())
+	{
+		const std::string selected = "," + options.configurations + ",";
+		configurations.erase(std::remove_if(configurations.begin(), configurations.end(), [&](const Configuration& configuration) {
+			return selected.find("," + configuration.name + ",") == std::string::npos;
+		}), configurations.end());
+	}
+
+	std::cout << corpus.size() << " screenshots, " << needles.size() << " needles, "
+		<< configurations.size() << " configurations" << std::endl << std::endl;
+	std::cout << std::left << std::setw(28) << "configuration" << std::right << std::setw(10) << "precision"
+		<< std::setw(10) << "recall" << std::setw(12) << "center (px)" << std::setw(12) << "ms/frame"
+		<< std::setw(8) << "fp" << std::setw(10) << "critical" << std::endl;
+
+	std::vector<ConfigurationReport> reports;
+	for (const Configuration& configuration : configurations)
+	{
+		reports.push_back(evaluate(configuration, corpus, needles, compiled_needles, options));
+		print_report(reports.back(), options.per_needle);
+	}
+
+	if (!options.output_path.empty() && !save_reports(options.output_path, reports, options))
+	{
+		std::cerr << "Unable to write " << options.output_path << std::endl;
+		return 1;
+	}
+
+	if (!options.baseline_path.empty())
+	{
+		std::cout << std::endl;
+		const int regressions = compare_with_baseline(options.baseline_path, reports);
+		if (regressions > 0)
+		{
+			std::cout << regressions << " detection regressions against " << options.baseline_path << std::endl;
+			return 2;
+		}
+		std::cout << "No detection regressions against " << options.baseline_path << std::endl;
+	}
+
+	return 0;
+}
@@ -0,0 +1,111 @@
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "../../vision/NeedleAtlas.hpp"
+
+/**
+* Atlas packer.
+*
+* Decodes every needle (.jpg) of an assets folder and packs them, converted to the requested channel modes,
+* into the memory mapped atlas that the extension loads at startup:
+*     ./atlas_packer --needles=assets/EN [--modes=bgra,bgr,gray] [--out=assets/EN/needles.atlas]
+*/
+
+namespace {
+
+	namespace fs = std::filesystem;
+
+	bool parse_channel_modes(const std::string& list, std::vector<ChannelMode>& channel_modes)
+	{
+		std::stringstream stream{ list };
+		std::string mode;
+		while (std::getline(stream, mode, ','))
+		{
+			if (mode == "bgra")
+				channel_modes.push_back(ChannelMode::BGRA);
+			else if (mode == "bgr")
+				channel_modes.push_back(ChannelMode::BGR);
+			else if (mode == "gray")
+				channel_modes.push_back(ChannelMode::Gray);
+			else
+			{
+				std::cerr << "Unknown channel mode " << mode << std::endl;
+				return false;
+			}
+		}
+		return !channel_modes.empty();
+	}
+}
+
+
+int main(int argc, char** argv)
+{
+	std::string needles_dir;
+	std::string output_path;
+	std::string modes{ "bgra,bgr,gray" };
+
+	for (int i = 1; i < argc; i++)
+	{
+		const std::string arg{ argv[ i ] };
+		if (arg.rfind("--needles=", 0) == 0)
+			needles_dir = arg.substr(std::strlen("--needles="));
+		else if (arg.rfind("--modes=", 0) == 0)
+			modes = arg.substr(std::strlen("--modes="));
+		else if (arg.rfind("--out=", 0) == 0)
+			output_path = arg.substr(std::strlen("--out="));
+		else
+		{
+			std::cerr << "Unknown option " << arg << std::endl;
+			return 1;
+		}
+	}
+
+	std::vector<ChannelMode> channel_modes;
+	if (needles_dir.empty() || !parse_channel_modes(modes, channel_modes))
+	{
+		std::cerr << "Usage: atlas_packer --needles=<assets folder> [--modes=bgra,bgr,gray] [--out=<file>]" << std::endl;
+		return 1;
+	}
+	if (output_path.empty())
+		output_path = needles_dir + "/" + NeedleAtlas::file_name;
+
+	std::map<std::string, cv::Mat> needles;
+	for (const auto& entry : fs::directory_iterator(needles_dir))
+	{
+		if (entry.path().extension() != ".jpg")
+			continue;
+
+		cv::Mat needle = cv::imread(entry.path().string(), cv::IMREAD_COLOR);
+		if (needle.empty())
+		{
+			std::cerr << "Unable to decode " << entry.path() << std::endl;
+			return 1;
+		}
+		needles.emplace(entry.path().stem().string(), needle);
+	}
+
+	if (!NeedleAtlas::write(output_path, needles, channel_modes))
+	{
+		std::cerr << "Unable to write " << output_path << std::endl;
+		return 1;
+	}
+
+	// Reads it back, so a broken atlas never reaches the extension
+	NeedleAtlas atlas;
+	if (!atlas.open(output_path) || atlas.size() != needles.size() * channel_modes.size())
+	{
+		std::cerr << "The written atlas " << output_path << " doesn't validate" << std::endl;
+		return 1;
+	}
+
+	std::cout << "Packed " << needles.size() << " needles on " << channel_modes.size() << " channel modes into "
+		<< output_path << " (" << fs::file_size(output_path) / 1024 << " KiB)" << std::endl;
+	return 0;
+}
@@ -0,0 +1,359 @@
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "../../vision/CompiledNeedles.hpp"
+
+/**
+* Needle compiler.
+*
+* Analyzes every needle of an assets folder against a set of sample client frames (recorded from a real client,
+* ideally with the buttons both idle and highlighted) and emits, for each of them:
+*   - the smallest sub-patch that still finds the button, and only the button, on every sample frame,
+*   - a mask that leaves out the pixels that changes between the samples (hover highlights, animations...),
+*   - the offset from the center of the patch back to the center of the button.
+*
+* RumbleLeagueVision matches just the patch, ignoring the masked pixels, so it computes less and doesn't miss
+* the highlighted buttons:
+*     ./needle_compiler --needles=assets/EN --frames=recorded/EN --out=assets/EN/compiled_needles.yml
+*/
+
+namespace {
+
+	namespace fs = std::filesystem;
+
+	// The runtime defaults of the vision engine (BGRA frames and square differences)
+	constexpr int match_method = cv::TM_SQDIFF_NORMED;
+
+	// Score below which the whole needle it's considered present on a sample frame. Lenient, so the highlighted buttons counts too
+	constexpr double presence_threshold = 0.15;
+
+	// The default threshold of the engine. A patch must score below it wherever the button is, and above it everywhere else
+	constexpr double runtime_threshold = 0.05;
+
+	// Gray level difference against the needle above which a pixel it's considered unstable
+	constexpr double unstable_pixel_difference = 40.0;
+
+	// Minimum side of a patch, and minimum gray standard deviation of its stable pixels (uniform patches aren't discriminative)
+	constexpr int min_patch_side = 12;
+	constexpr double min_patch_texture = 12.0;
+
+	// Fraction of the pixels of a patch that must be stable
+	constexpr double min_stable_ratio = 0.7;
+
+	// Distance (in pixels) that a patch match can be away from the real location of the button
+	constexpr int location_tolerance = 2;
+
+	// Score gap required between the patch match and any other place of the frame (or the best place on the frames without the button)
+	constexpr double min_score_margin = 0.08;
+
+	// Fractions of the needle sides tried as patch sides
+	constexpr double patch_fractions[] { 0.25, 0.35, 0.5, 0.7, 1.0 };
+
+	struct Options
+	{
+		std::string needles_dir;
+		std::string frames_dir;
+		std::string output_path;
+	};
+
+	// A sample frame, and where the whole needle was found on it (if it was)
+	struct Sample
+	{
+		const cv::Mat* frame;
+		bool needle_present;
+		cv::Point needle_location;
+	};
+
+	struct Candidate
+	{
+		cv::Rect patch;
+		double texture;
+	};
+
+	std::vector<cv::Mat> load_frames(const std::string& directory)
+	{
+		std::vector<fs::path> paths;
+		for (const auto& entry : fs::directory_iterator(directory))
+		{
+			const std::string extension = entry.path().extension().string();
+			if (extension == ".png" || extension == ".jpg")
+				paths.push_back(entry.path());
+		}
+		std::sort(paths.begin(), paths.end());
+
+		std::vector<cv::Mat> frames;
+		for (const fs::path& path : paths)
+		{
+			cv::Mat frame = cv::imread(path.string(), cv::IMREAD_COLOR);
+			if (frame.empty())
+				continue;
+			cv::cvtColor(frame, frame, cv::COLOR_BGR2BGRA);
+			frames.push_back(frame);
+		}
+		return frames;
+	}
+
+	// Best score and its location. Lower it's better, as on the vision engine
+	double best_match(const cv::Mat& frame, const cv::Mat& templ, const cv::Mat& mask, cv::Point& location, cv::Mat* result_out = nullptr)
+	{
+		cv::Mat result;
+		if (mask.empty())
+			cv::matchTemplate(frame, templ, result, match_method);
+		else
+		{
+			cv::Mat templ_mask;
+			cv::merge(std::vector<cv::Mat>(templ.channels(), mask), templ_mask);
+			cv::matchTemplate(frame, templ, result, match_method, templ_mask);
+		}
+
+		// Masked matches of perfectly flat areas can produce NaNs or infinities, that never should win
+		cv::patchNaNs(result, 1.0);
+		cv::threshold(result, result, 1.0, 1.0, cv::THRESH_TRUNC);
+
+		double min_value;
+		cv::minMaxLoc(result, &min_value, nullptr, &location, nullptr);
+		if (result_out != nullptr)
+			*result_out = result;
+		return min_value;
+	}
+
+	/**
+	* Pixels of the needle that are different on any of the samples where it was found.
+	* Returns an empty mask if all of them are stable.
+	*/
+	cv::Mat stability_mask(const cv::Mat& needle, const std::vector<Sample>& samples)
+	{
+		cv::Mat needle_gray;
+		cv::cvtColor(needle, needle_gray, cv::COLOR_BGRA2GRAY);
+		needle_gray.convertTo(needle_gray, CV_32F);
+
+		cv::Mat max_difference = cv::Mat::zeros(needle.size(), CV_32F);
+		for (const Sample& sample : samples)
+		{
+			if (!sample.needle_present)
+				continue;
+
+			cv::Mat sample_gray;
+			cv::cvtColor((*sample.frame)(cv::Rect{ sample.needle_location, needle.size() }), sample_gray, cv::COLOR_BGRA2GRAY);
+			sample_gray.convertTo(sample_gray, CV_32F);
+
+			cv::Mat difference;
+			cv::absdiff(sample_gray, needle_gray, difference);
+			max_difference = cv::max(max_difference, difference);
+		}
+
+		cv::Mat mask = max_difference <= unstable_pixel_difference;
+		return (static_cast<size_t>(cv::countNonZero(mask)) == mask.total()) ? cv::Mat{} : mask;
+	}
+
+	// Every patch with enough stable, textured pixels. The smallest ones first, the most textured first between equals
+	std::vector<Candidate> candidate_patches(const cv::Mat& needle, const cv::Mat& mask)
+	{
+		cv::Mat needle_gray;
+		cv::cvtColor(needle, needle_gray, cv::COLOR_BGRA2GRAY);
+
+		std::vector<Candidate> candidates;
+		for (const double width_fraction : patch_fractions)
+			for (const double height_fraction : patch_fractions)
+			{
+				const int width = std::max(min_patch_side, static_cast<int>(needle.cols * width_fraction));
+				const int height = std::max(min_patch_side, static_cast<int>(needle.rows * height_fraction));
+				if (width > needle.cols || height > needle.rows)
+					continue;
+
+				const int stride_x = std::max(2, width / 4);
+				const int stride_y = std::max(2, height / 4);
+				for (int y = 0; y + height <= needle.rows; y += stride_y)
+					for (int x = 0; x + width <= needle.cols; x += stride_x)
+					{
+						const cv::Rect patch{ x, y, width, height };
+						const cv::Mat patch_mask = mask.empty() ? cv::Mat{} : mask(patch);
+
+						const double stable_pixels = patch_mask.empty() ? patch.area() : cv::countNonZero(patch_mask);
+						if (stable_pixels < min_stable_ratio * patch.area())
+							continue;
+
+						cv::Scalar mean, deviation;
+						cv::meanStdDev(needle_gray(patch), mean, deviation, patch_mask);
+						if (deviation[ 0 ] >= min_patch_texture)
+							candidates.push_back(Candidate{ patch, deviation[ 0 ] });
+					}
+			}
+
+		std::sort(candidates.begin(), candidates.end(), [](const Candidate& lhs, const Candidate& rhs) {
+			return (lhs.patch.area() != rhs.patch.area()) ? lhs.patch.area() < rhs.patch.area() : lhs.texture > rhs.texture;
+		});
+		return candidates;
+	}
+
+	/**
+	* A patch it's discriminative when, on every sample, it finds the button where the whole needle found it,
+	* clearly better than on any other place, and it isn't found on the samples without the button.
+	*/
+	bool is_discriminative(const cv::Mat& needle, const Candidate& candidate, const cv::Mat& mask, const std::vector<Sample>& samples)
+	{
+		const cv::Mat patch = needle(candidate.patch);
+		const cv::Mat patch_mask = mask.empty() ? cv::Mat{} : mask(candidate.patch);
+
+		for (const Sample& sample : samples)
+		{
+			cv::Point location;
+			cv::Mat result;
+			const double score = best_match(*sample.frame, patch, patch_mask, location, &result);
+
+			if (!sample.needle_present)
+			{
+				if (score < runtime_threshold + min_score_margin)
+					return false;
+				continue;
+			}
+
+			if (score >= runtime_threshold)
+				return false;
+
+			const cv::Point expected = sample.needle_location + candidate.patch.tl();
+			if (std::abs(location.x - expected.x) > location_tolerance || std::abs(location.y - expected.y) > location_tolerance)
+				return false;
+
+			// The best score outside the neighbourhood of the match must be clearly worse
+			const cv::Rect neighbourhood = cv::Rect{
+				location - cv::Point{ patch.cols / 2, patch.rows / 2 }, patch.size()
+			} & cv::Rect{ 0, 0, result.cols, result.rows };
+			result(neighbourhood).setTo(1.0);
+
+			double second_score;
+			cv::minMaxLoc(result, &second_score);
+			if (second_score - score < min_score_margin)
+				return false;
+		}
+
+		return true;
+	}
+
+	CompiledNeedle compile_needle(const std::string& needle_id, const cv::Mat& needle, const std::vector<cv::Mat>& frames)
+	{
+		std::vector<Sample> samples;
+		for (const cv::Mat& frame : frames)
+		{
+			if (frame.cols < needle.cols || frame.rows < needle.rows)
+				continue;
+
+			cv::Point location;
+			const double score = best_match(frame, needle, cv::Mat{}, location);
+			samples.push_back(Sample{ &frame, score < presence_threshold, location });
+		}
+
+		const size_t present_samples = std::count_if(samples.begin(), samples.end(), [](const Sample& sample) {
+			return sample.needle_present;
+		});
+
+		CompiledNeedle compiled_needle;
+		compiled_needle.needle_size = needle.size();
+		compiled_needle.mask = stability_mask(needle, samples);
+
+		// By default, the whole needle with its mask
+		compiled_needle.patch = cv::Rect{ cv::Point{}, needle.size() };
+
+		// Without samples showing the button, nothing tells which patches are discriminative
+		if (present_samples == 0)
+			std::cout << needle_id << ": not found on any sample frame, keeping the whole needle" << std::endl;
+		else
+		{
+			const std::vector<Candidate> candidates = candidate_patches(needle, compiled_needle.mask);
+			const auto discriminative = std::find_if(candidates.begin(), candidates.end(), [&](const Candidate& candidate) {
+				return is_discriminative(needle, candidate, compiled_needle.mask, samples);
+			});
+
+			if (discriminative != candidates.end())
+				compiled_needle.patch = discriminative->patch;
+		}
+
+		if (!compiled_needle.mask.empty())
+			compiled_needle.mask = compiled_needle.mask(compiled_needle.patch).clone();
+
+		const cv::Point needle_center{ needle.cols / 2, needle.rows / 2 };
+		const cv::Point patch_center = compiled_needle.patch.tl() + cv::Point{ compiled_needle.patch.width / 2, compiled_needle.patch.height / 2 };
+		compiled_needle.center_offset = needle_center - patch_center;
+
+		const int masked_pixels = compiled_needle.mask.empty() ? 0 : compiled_needle.patch.area() - cv::countNonZero(compiled_needle.mask);
+		std::cout << needle_id << ": patch " << compiled_needle.patch.width << "x" << compiled_needle.patch.height
+			<< " of " << needle.cols << "x" << needle.rows << " (" << 100 * compiled_needle.patch.area() / needle.size().area() << "% of the pixels)"
+			<< ", " << masked_pixels << " masked pixels, found on " << present_samples << " of " << samples.size() << " samples" << std::endl;
+
+		return compiled_needle;
+	}
+
+	bool parse_options(int argc, char** argv, Options& options)
+	{
+		const auto value_of = [](const char* arg, const char* flag, std::string& value) {
+			if (std::strncmp(arg, flag, std::strlen(flag)) != 0)
+				return false;
+			value = arg + std::strlen(flag);
+			return true;
+		};
+
+		for (int i = 1; i < argc; i++)
+		{
+			if (!value_of(argv[ i ], "--needles=", options.needles_dir)
+				&& !value_of(argv[ i ], "--frames=", options.frames_dir)
+				&& !value_of(argv[ i ], "--out=", options.output_path))
+			{
+				std::cerr << "Unknown option " << argv[ i ] << std::endl;
+				return false;
+			}
+		}
+
+		if (options.output_path.empty() && !options.needles_dir.empty())
+			options.output_path = options.needles_dir + "/" + CompiledNeedles::file_name;
+
+		return !options.needles_dir.empty() && !options.frames_dir.empty();
+	}
+}
+
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!parse_options(argc, argv, options))
+	{
+		std::cerr << "Usage: needle_compiler --needles=<assets folder> --frames=<sample client frames folder> [--out=<file>]" << std::endl;
+		return 1;
+	}
+
+	const std::vector<cv::Mat> frames = load_frames(options.frames_dir);
+	if (frames.empty())
+	{
+		std::cerr << "There isn't any sample frame on " << options.frames_dir << std::endl;
+		return 1;
+	}
+
+	CompiledNeedles compiled_needles;
+	for (const auto& entry : fs::directory_iterator(options.needles_dir))
+	{
+		if (entry.path().extension() != ".jpg")
+			continue;
+
+		cv::Mat needle = cv::imread(entry.path().string(), cv::IMREAD_COLOR);
+		if (needle.empty())
+			continue;
+		cv::cvtColor(needle, needle, cv::COLOR_BGR2BGRA);
+
+		const std::string needle_id = entry.path().stem().string();
+		compiled_needles.add(needle_id, compile_needle(needle_id, needle, frames));
+	}
+
+	if (!compiled_needles.save(options.output_path))
+	{
+		std::cerr << "Unable to write " << options.output_path << std::endl;
+		return 1;
+	}
+
+	std::cout << "Compiled " << compiled_needles.size() << " needles into " << options.output_path << std::endl;
+	return 0;
+}
@@ -0,0 +1,165 @@
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+
+#include "RumbleTrace.hpp"
+
+namespace {
+
+	/**
+	* The ring buffer owned by every thread that records spans.
+	* Only the owner thread writes into it. The exporter reads it from any thread, and a span that it's being
+	* overwritten while the export happens may be lost, which is fine for a profiling tool.
+	*
+	* The head only ever moves forward, and only the owner moves it. A clear from another thread just moves the
+	* start of the visible spans up to the head, so it never races with the owner's writes.
+	*/
+	struct ThreadRing
+	{
+		uint32_t tid;
+		std::atomic<uint64_t> head{ 0 };
+		// Spans before this one were dropped by a clear
+		std::atomic<uint64_t> cleared_head{ 0 };
+		RumbleTrace::Span spans[ RumbleTrace::ring_capacity ];
+	};
+
+	// Rings are never released, so the spans of a finished thread still can be exported
+	std::mutex registry_mutex;
+	std::vector<std::unique_ptr<ThreadRing>> rings;
+
+	thread_local ThreadRing* local_ring = nullptr;
+
+	const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+	ThreadRing* register_thread()
+	{
+		std::lock_guard<std::mutex> lock{ registry_mutex };
+		rings.push_back(std::make_unique<ThreadRing>());
+		rings.back()->tid = static_cast<uint32_t>(rings.size());
+		local_ring = rings.back().get();
+		return local_ring;
+	}
+
+	size_t histogram_bucket(const uint64_t duration_ns)
+	{
+		uint64_t us = duration_ns / 1000;
+		size_t bucket = 0;
+		while (us > 1 && bucket < RumbleTrace::histogram_buckets - 1)
+		{
+			us >>= 1;
+			++bucket;
+		}
+		return bucket;
+	}
+
+	double percentile_us(const std::vector<uint64_t>& sorted_durations, const double percentile)
+	{
+		const size_t index = static_cast<size_t>(percentile * (sorted_durations.size() - 1) + 0.5);
+		return sorted_durations[index] / 1000.0;
+	}
+}
+
+
+std::atomic<bool> RumbleTrace::enabled{ false };
+
+void RumbleTrace::set_enabled(const bool enable)
+{
+	enabled.store(enable, std::memory_order_relaxed);
+}
+
+bool RumbleTrace::is_enabled()
+{
+	return enabled.load(std::memory_order_relaxed);
+}
+
+uint64_t RumbleTrace::now_ns()
+{
+	// The +1 keeps zero free as the "span not opened" marker of ScopedSpan
+	return static_cast<uint64_t>(
+		std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count()
+	) + 1;
+}
+
+void RumbleTrace::record(const char* name, const uint64_t start_ns, const uint64_t end_ns)
+{
+	ThreadRing* ring = (local_ring != nullptr) ? local_ring : register_thread();
+
+	const uint64_t head = ring->head.load(std::memory_order_relaxed);
+	ring->spans[ head % ring_capacity ] = Span{ name, start_ns, end_ns - start_ns };
+	ring->head.store(head + 1, std::memory_order_release);
+}
+
+void RumbleTrace::clear()
+{
+	std::lock_guard<std::mutex> lock{ registry_mutex };
+	for (auto& ring : rings)
+		ring->cleared_head.store(ring->head.load(std::memory_order_acquire), std::memory_order_release);
+}
+
+
+/**
+* Visits every span held by the rings, from the oldest to the newest of each thread
+*/
+template <typename Visitor>
+static void for_each_span(Visitor visitor)
+{
+	std::lock_guard<std::mutex> lock{ registry_mutex };
+	for (auto& ring : rings)
+	{
+		const uint64_t head = ring->head.load(std::memory_order_acquire);
+		const uint64_t count = std::min<uint64_t>(head - ring->cleared_head.load(std::memory_order_acquire), RumbleTrace::ring_capacity);
+
+		for (uint64_t i = head - count; i < head; i++)
+			visitor(ring->tid, ring->spans[ i % RumbleTrace::ring_capacity ]);
+	}
+}
+
+bool RumbleTrace::export_chrome_trace(const std::string& path)
+{
+	std::ofstream out{ path };
+	if (!out.is_open())
+		return false;
+
+	// Complete events ("ph": "X") with timestamps and durations in microseconds, as the trace-event format expects
+	out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+	bool first = true;
+	for_each_span([&out, &first](const uint32_t tid, const Span& span) {
+		out << (first ? "\n" : ",\n")
+			<< "{\"name\":\"" << span.name << "\",\"cat\":\"rle\",\"ph\":\"X\",\"pid\":1,\"tid\":" << tid
+			<< ",\"ts\":" << span.start_ns / 1000.0
+			<< ",\"dur\":" << span.duration_ns / 1000.0 << "}";
+		first = false;
+	});
+	out << "\n]}\n";
+
+	return out.good();
+}
+
+std::vector<RumbleTrace::StageSummary> RumbleTrace::summary()
+{
+	// Grouping by the stage name. Spans names are string literals, but the same literal may live on different addresses
+	std::map<std::string, std::vector<uint64_t>> durations_by_stage;
+	for_each_span([&durations_by_stage](const uint32_t, const Span& span) {
+		durations_by_stage[ span.name ].push_back(span.duration_ns);
+	});
+
+	std::vector<StageSummary> stages;
+	for (auto& [name, durations] : durations_by_stage)
+	{
+		std::sort(durations.begin(), durations.end());
+
+		StageSummary stage{ name, durations.size(), 0.0, 0.0, 0.0, std::vector<size_t>(histogram_buckets, 0) };
+		stage.p50_us = percentile_us(durations, 0.50);
+		stage.p99_us = percentile_us(durations, 0.99);
+		stage.max_us = durations.back() / 1000.0;
+		for (const uint64_t duration : durations)
+			++stage.histogram[ histogram_bucket(duration) ];
+
+		stages.push_back(std::move(stage));
+	}
+
+	return stages;
+}
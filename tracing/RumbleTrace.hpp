@@ -0,0 +1,104 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+* Low overhead latency tracing for the command pipeline.
+*
+* Every stage between a voice command reaching RumbleLeague::play() and the final input injection
+* (parsing, capture, color conversion, matchTemplate, minMaxLoc, ClientToScreen, injection...) it's wrapped
+* with a RUMBLE_TRACE_SCOPE( "stage" ) span. Spans are written into a ring buffer owned by the thread that
+* recorded them, so the hot path never takes a lock.
+*
+* The spans are only compiled in when the RUMBLE_TRACING macro it's defined. Even then, they are disabled
+* at runtime until RumbleTrace::set_enabled(true) it's called, and a disabled span costs a relaxed atomic load.
+*/
+namespace RumbleTrace {
+
+	// Number of spans that every thread keeps. When the ring it's full, the oldest spans are overwritten
+	constexpr size_t ring_capacity = 16384;
+
+	// Number of log2 buckets (in microseconds) of the latency histograms. Last bucket collects everything above
+	constexpr size_t histogram_buckets = 24;
+
+	// A single completed span
+	struct Span
+	{
+		const char* name;
+		uint64_t start_ns;
+		uint64_t duration_ns;
+	};
+
+	// The latency distribution of all the recorded spans that shares the same name
+	struct StageSummary
+	{
+		std::string name;
+		size_t count;
+		double p50_us;
+		double p99_us;
+		double max_us;
+		// histogram[i] counts the spans with a duration in [2^i, 2^(i+1)) microseconds. Bucket 0 also holds the sub-microsecond ones
+		std::vector<size_t> histogram;
+	};
+
+	// Runtime switch. Read on every span, so keep it as a plain atomic flag
+	extern std::atomic<bool> enabled;
+
+	void set_enabled(const bool enable);
+	bool is_enabled();
+
+	// Monotonic nanoseconds since the first time that the tracer was used
+	uint64_t now_ns();
+
+	// Stores a finished span into the ring buffer of the calling thread
+	void record(const char* name, const uint64_t start_ns, const uint64_t end_ns);
+
+	// Drops every recorded span on every thread
+	void clear();
+
+	// Writes the recorded spans as a Chrome / Perfetto trace-event JSON file. Returns false if the file can't be opened
+	bool export_chrome_trace(const std::string& path);
+
+	// Per stage p50 / p99 and histograms of the spans currently held by the ring buffers
+	std::vector<StageSummary> summary();
+
+
+	/**
+	* RAII span. Takes the start timestamp on construction and records the span on destruction,
+	* only if the tracer was enabled when the span was opened.
+	*/
+	class ScopedSpan
+	{
+		private:
+			const char* name;
+			uint64_t start_ns;
+
+		public:
+			explicit ScopedSpan(const char* name)
+				: name{ name },
+				start_ns{ enabled.load(std::memory_order_relaxed) ? now_ns() : 0 } {}
+
+			~ScopedSpan()
+			{
+				if (this->start_ns != 0)
+					record(this->name, this->start_ns, now_ns());
+			}
+
+			ScopedSpan(const ScopedSpan&) = delete;
+			ScopedSpan& operator=(const ScopedSpan&) = delete;
+	};
+}
+
+
+#define RUMBLE_TRACE_CONCAT_IMPL(a, b) a##b
+#define RUMBLE_TRACE_CONCAT(a, b) RUMBLE_TRACE_CONCAT_IMPL(a, b)
+
+#ifdef RUMBLE_TRACING
+	#define RUMBLE_TRACE_SCOPE(name) RumbleTrace::ScopedSpan RUMBLE_TRACE_CONCAT(rumble_trace_span_, __LINE__){ name }
+#else
+	#define RUMBLE_TRACE_SCOPE(name) ((void)0)
+#endif
@@ -0,0 +1,4 @@
+#pragma once
+
+// The color layout where the template matching takes place. Both the video source and the needle are converted to it
+enum class ChannelMode { BGRA, BGR, Gray };
@@ -0,0 +1,88 @@
+#include "CompiledNeedles.hpp"
+#include "../logger/RumbleLogger.hpp"
+
+
+const CompiledNeedle* CompiledNeedles::get(const std::string& needle_id) const
+{
+	const auto compiled_needle = this->needles.find(needle_id);
+	return (compiled_needle != this->needles.end()) ? &compiled_needle->second : nullptr;
+}
+
+void CompiledNeedles::add(const std::string& needle_id, const CompiledNeedle& compiled_needle)
+{
+	this->needles[ needle_id ] = compiled_needle;
+}
+
+size_t CompiledNeedles::size() const
+{
+	return this->needles.size();
+}
+
+
+bool CompiledNeedles::load(const std::string& path)
+{
+	cv::FileStorage storage;
+	try
+	{
+		if (!storage.open(path, cv::FileStorage::READ))
+			return false;
+	}
+	catch (const cv::Exception&)
+	{
+		return false;
+	}
+
+	const cv::FileNode needles_node = storage[ "needles" ];
+	for (auto it = needles_node.begin(); it != needles_node.end(); ++it)
+	{
+		CompiledNeedle compiled_needle;
+		(*it)[ "needle_size" ] >> compiled_needle.needle_size;
+		(*it)[ "patch" ] >> compiled_needle.patch;
+		(*it)[ "center_offset" ] >> compiled_needle.center_offset;
+		(*it)[ "mask" ] >> compiled_needle.mask;
+
+		// Discards the data that doesn't fit on its own needle, ie, compiled from an older version of the asset
+		const bool is_valid = (compiled_needle.patch & cv::Rect{ cv::Point{}, compiled_needle.needle_size }) == compiled_needle.patch
+			&& !compiled_needle.patch.empty()
+			&& (compiled_needle.mask.empty() || compiled_needle.mask.size() == compiled_needle.patch.size());
+
+		const std::string id = static_cast<std::string>((*it)[ "id" ]);
+		if (is_valid)
+			this->needles[ id ] = std::move(compiled_needle);
+		else
+			RUMBLE_LOG_WARNING << "Ignoring the malformed compiled needle " << id;
+	}
+
+	RUMBLE_LOG_DEBUG << "Loaded " << this->needles.size() << " compiled needles from " << path;
+	return true;
+}
+
+bool CompiledNeedles::save(const std::string& path) const
+{
+	cv::FileStorage storage;
+	try
+	{
+		if (!storage.open(path, cv::FileStorage::WRITE))
+			return false;
+	}
+	catch (const cv::Exception&)
+	{
+		return false;
+	}
+
+	storage << "needles" << "[";
+	for (const auto& [id, compiled_needle] : this->needles)
+	{
+		storage << "{"
+			<< "id" << id
+			<< "needle_size" << compiled_needle.needle_size
+			<< "patch" << compiled_needle.patch
+			<< "center_offset" << compiled_needle.center_offset;
+		if (!compiled_needle.mask.empty())
+			storage << "mask" << compiled_needle.mask;
+		storage << "}";
+	}
+	storage << "]";
+
+	return true;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <map>
+#include <string>
+
+#include <opencv2/opencv.hpp>
+
+/// <summary>
+/// The output of the needle compiler (tools/needle_compiler) for a single needle: the smallest part of the image
+/// that still identifies the button on the client, and a mask that leaves out the pixels that changes
+/// between frames (ie, the ones that lights up when the button it's highlighted).
+/// </summary>
+struct CompiledNeedle
+{
+	// Size of the original needle image
+	cv::Size needle_size;
+
+	// The discriminative sub-patch, in coordinates of the original needle
+	cv::Rect patch;
+
+	// From the center of the patch to the center of the button, where the click must land
+	cv::Point center_offset;
+
+	// Single channel, the size of the patch. Zero for the unstable pixels. Empty when all of them are stable
+	cv::Mat mask;
+};
+
+/// <summary>
+/// The compiled needles of a language, as they are emitted by the needle compiler.
+/// The needles without compiled data are matched as a whole, as usual.
+/// </summary>
+class CompiledNeedles
+{
+	private:
+		std::map<std::string, CompiledNeedle> needles;
+
+	public:
+		// The file, inside the assets folder of the language, where the compiler writes its output
+		static constexpr const char* file_name = "compiled_needles.yml";
+
+		// Returns nullptr if the needle hasn't been compiled
+		const CompiledNeedle* get(const std::string& needle_id) const;
+
+		void add(const std::string& needle_id, const CompiledNeedle& compiled_needle);
+
+		size_t size() const;
+
+		// Loads the output of the compiler. Returns false if there is no file
+		bool load(const std::string& path);
+
+		// Writes the compiled needles as an OpenCV YAML file
+		bool save(const std::string& path) const;
+};
@@ -0,0 +1,240 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include "MatchCache.hpp"
+#include "../helpers/MappedFile.hpp"
+#include "../logger/RumbleLogger.hpp"
+#include "../tracing/RumbleTrace.hpp"
+
+
+namespace {
+
+	constexpr uint64_t multiplier = 0x9E3779B97F4A7C15ull;
+	constexpr uint64_t mixer = 0xBF58476D1CE4E5B9ull;
+
+	inline uint64_t rotate_left(const uint64_t value, const int bits)
+	{
+		return (value << bits) | (value >> (64 - bits));
+	}
+
+	// Folds a word into the running hash. A multiply per 8 bytes, so the hashing runs close to the memory bandwidth
+	inline uint64_t absorb(const uint64_t hash, const uint64_t word)
+	{
+		return rotate_left(hash ^ (word * multiplier), 31) * mixer;
+	}
+
+	// The final avalanche of splitmix64, so every input bit reaches every output bit
+	inline uint64_t finalize(uint64_t hash)
+	{
+		hash ^= hash >> 30;
+		hash *= mixer;
+		hash ^= hash >> 27;
+		hash *= 0x94D049BB133111EBull;
+		hash ^= hash >> 31;
+		return hash;
+	}
+
+	uint64_t absorb_bytes(uint64_t hash, const unsigned char* bytes, const size_t length)
+	{
+		size_t i = 0;
+		for (; i + sizeof(uint64_t) <= length; i += sizeof(uint64_t))
+		{
+			uint64_t word;
+			std::memcpy(&word, bytes + i, sizeof(word));
+			hash = absorb(hash, word);
+		}
+
+		// The tail, with its length so "ab" and "ab\0" differs
+		uint64_t tail = length - i;
+		for (size_t shift = 8; i < length; i++, shift += 8)
+			tail |= static_cast<uint64_t>(bytes[ i ]) << shift;
+		return absorb(hash, tail);
+	}
+}
+
+
+MatchCache::MatchCache(const size_t capacity)
+	: capacity{ capacity }, hits{ 0 }, misses{ 0 } {}
+
+
+uint64_t MatchCache::hash_image(const cv::Mat& image)
+{
+	RUMBLE_TRACE_SCOPE("region_hash");
+
+	uint64_t hash = absorb(absorb(0, static_cast<uint64_t>(image.cols) << 32 | static_cast<uint32_t>(image.rows)), image.type());
+
+	// Row by row, since the regions of a frame aren't continuous
+	const size_t row_length = image.cols * image.elemSize();
+	for (int y = 0; y < image.rows; y++)
+		hash = absorb_bytes(hash, image.ptr(y), row_length);
+
+	return finalize(hash);
+}
+
+uint64_t MatchCache::hash_signature(const cv::Mat& image)
+{
+	RUMBLE_TRACE_SCOPE("region_signature");
+
+	if (image.depth() != CV_8U)
+		return MatchCache::hash_image(image);
+
+	const cv::Size cells_size{
+		(image.cols + MatchCache::signature_cell - 1) / MatchCache::signature_cell,
+		(image.rows + MatchCache::signature_cell - 1) / MatchCache::signature_cell
+	};
+
+	// Reused by every signature of the thread
+	thread_local cv::Mat cells;
+	thread_local std::vector<unsigned char> quantized;
+	cv::resize(image, cells, cells_size, 0, 0, cv::INTER_AREA);
+
+	uint64_t hash = absorb(absorb(0, static_cast<uint64_t>(image.cols) << 32 | static_cast<uint32_t>(image.rows)), image.type());
+
+	const size_t row_length = cells.cols * cells.elemSize();
+	quantized.resize(row_length);
+	for (int y = 0; y < cells.rows; y++)
+	{
+		const unsigned char* row = cells.ptr(y);
+		for (size_t i = 0; i < row_length; i++)
+			quantized[ i ] = row[ i ] >> MatchCache::signature_shift;
+		hash = absorb_bytes(hash, quantized.data(), row_length);
+	}
+
+	return finalize(hash);
+}
+
+uint64_t MatchCache::hash_needle(const std::string& needle_key, const cv::Mat& needle_image)
+{
+	const uint64_t key_hash = absorb_bytes(0, reinterpret_cast<const unsigned char*>(needle_key.data()), needle_key.size());
+	return finalize(absorb(key_hash, MatchCache::hash_image(needle_image)));
+}
+
+
+bool MatchCache::lookup(const uint64_t region_hash, const uint64_t needle_hash, MatchResult& result, bool& exact)
+{
+	std::lock_guard<std::mutex> lock{ this->cache_mutex };
+
+	const auto found = this->index.find(Key{ region_hash, needle_hash });
+	if (found == this->index.end())
+	{
+		++this->misses;
+		return false;
+	}
+
+	// Back to the front, as the most recently used
+	this->entries.splice(this->entries.begin(), this->entries, found->second);
+
+	const CacheEntry& entry = *found->second;
+	result = MatchResult{ cv::Point{ entry.x, entry.y }, entry.score, (entry.patch != 0) ? MatchPath::Patch : MatchPath::Full };
+	exact = entry.exact != 0;
+	++this->hits;
+	return true;
+}
+
+void MatchCache::store(const uint64_t region_hash, const uint64_t needle_hash, const MatchResult& result, const bool exact)
+{
+	CacheEntry entry{};
+	entry.region_hash = region_hash;
+	entry.needle_hash = needle_hash;
+	entry.x = result.location.x;
+	entry.y = result.location.y;
+	entry.score = static_cast<float>(result.score);
+	entry.exact = exact ? 1 : 0;
+	entry.patch = (result.path == MatchPath::Patch) ? 1 : 0;
+
+	std::lock_guard<std::mutex> lock{ this->cache_mutex };
+	this->insert(entry);
+}
+
+void MatchCache::insert(const CacheEntry& entry)
+{
+	if (this->capacity == 0)
+		return;
+
+	const Key key{ entry.region_hash, entry.needle_hash };
+	const auto found = this->index.find(key);
+	if (found != this->index.end())
+	{
+		*found->second = entry;
+		this->entries.splice(this->entries.begin(), this->entries, found->second);
+		return;
+	}
+
+	this->entries.push_front(entry);
+	this->index.emplace(key, this->entries.begin());
+
+	while (this->entries.size() > this->capacity)
+	{
+		const CacheEntry& evicted = this->entries.back();
+		this->index.erase(Key{ evicted.region_hash, evicted.needle_hash });
+		this->entries.pop_back();
+	}
+}
+
+
+size_t MatchCache::size() const
+{
+	std::lock_guard<std::mutex> lock{ this->cache_mutex };
+	return this->entries.size();
+}
+
+double MatchCache::hit_rate() const
+{
+	std::lock_guard<std::mutex> lock{ this->cache_mutex };
+	const uint64_t lookups = this->hits + this->misses;
+	return (lookups > 0) ? static_cast<double>(this->hits) / lookups : 0.0;
+}
+
+
+bool MatchCache::load(const std::string& path)
+{
+	MappedFile mapped_file;
+	if (!mapped_file.open(path))
+		return false;
+
+	const size_t file_size = mapped_file.size();
+	const CacheHeader* header = reinterpret_cast<const CacheHeader*>(mapped_file.data());
+	if (file_size < sizeof(CacheHeader)
+		|| std::memcmp(header->magic, magic, sizeof(magic)) != 0 || header->version != version
+		|| sizeof(CacheHeader) + static_cast<uint64_t>(header->entry_count) * sizeof(CacheEntry) > file_size)
+	{
+		RUMBLE_LOG_WARNING << "Ignoring the match cache " << path << ", it's corrupted or from another version";
+		return false;
+	}
+
+	const CacheEntry* saved_entries = reinterpret_cast<const CacheEntry*>(mapped_file.data() + sizeof(CacheHeader));
+
+	std::lock_guard<std::mutex> lock{ this->cache_mutex };
+
+	// From the least to the most recently used, so the order survives the reinsertion. The oldest ones past the capacity are left out
+	const size_t loaded_entries = std::min<size_t>(header->entry_count, this->capacity);
+	for (size_t i = loaded_entries; i > 0; i--)
+		this->insert(saved_entries[ i - 1 ]);
+
+	RUMBLE_LOG_DEBUG << "Loaded " << loaded_entries << " cached matches from " << path;
+	return true;
+}
+
+bool MatchCache::save(const std::string& path) const
+{
+	std::vector<CacheEntry> saved_entries;
+	{
+		std::lock_guard<std::mutex> lock{ this->cache_mutex };
+		saved_entries.assign(this->entries.begin(), this->entries.end());
+	}
+
+	CacheHeader header{};
+	std::memcpy(header.magic, magic, sizeof(magic));
+	header.version = version;
+	header.entry_count = static_cast<uint32_t>(saved_entries.size());
+
+	std::ofstream file{ path, std::ios::binary | std::ios::trunc };
+	if (!file)
+		return false;
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(saved_entries.data()), saved_entries.size() * sizeof(CacheEntry));
+	return static_cast<bool>(file);
+}
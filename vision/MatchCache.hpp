@@ -0,0 +1,146 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include <opencv2/opencv.hpp>
+
+#include "MatcherEngine.hpp"
+
+/// <summary>
+/// The results of the searches, by the content of the pixels where they were done.
+///
+/// The League client paints the same screens again and again, across games and sessions. A search it's keyed by
+/// the signature of the region where it ran and by the hash of the needle (its id, its working format, its match
+/// method and its pixels), so a region that looks the same with the same needle gives back the stored candidate
+/// and score. The live captures are never the same to the bit (the compression of the client, its animations), so
+/// the signature it's coarse: the means of blocks of pixels, quantized, that the noise of a capture doesn't change.
+/// Different regions can share it, so only the hits are keyed by it, and the engine scores the stored candidate
+/// again before trusting it, a single window instead of the whole search. A small needle that appears can leave the
+/// signature as it was, so the misses are keyed by the exact hash of the pixels of the region instead.
+///
+/// The cache it's bounded: the entries that weren't used for the longest are evicted first. It can be saved, so the
+/// next sessions starts warm. The saved file it's memory mapped to be loaded.
+///
+/// Layout (little endian, as the machines that runs the client):
+///     CacheHeader | CacheEntry[ entry_count ], from the most to the least recently used
+/// </summary>
+class MatchCache
+{
+	public:
+		static constexpr char magic[ 8 ] = { 'R', 'L', 'E', 'M', 'C', 'A', 'C', 'H' };
+		// 4 keys the hits by the signature of their region, and the misses by its exact hash
+		static constexpr uint32_t version = 4;
+
+		// The file, inside the assets folder of the language, where the cache it's persisted
+		static constexpr const char* file_name = "match_cache.bin";
+
+		// Entries kept by default. 32 bytes each, so 128 KB
+		static constexpr size_t default_capacity = 4096;
+
+		struct CacheHeader
+		{
+			char magic[ 8 ];
+			uint32_t version;
+			uint32_t entry_count;
+			uint8_t reserved[ 16 ];
+		};
+
+		struct CacheEntry
+		{
+			uint64_t region_hash;
+			uint64_t needle_hash;
+			// Upper left corner of the candidate, on the region
+			int32_t x;
+			int32_t y;
+			float score;
+			// Zero when the score it's just a lower bound of the real one (see MatcherCascade)
+			uint8_t exact;
+			// One when the score it's the one of the compiled patch (MatchPath::Patch)
+			uint8_t patch;
+			uint8_t reserved[ 2 ];
+		};
+
+		static_assert(sizeof(CacheHeader) == 32 && sizeof(CacheEntry) == 32, "The cache layout must not have any padding");
+
+	private:
+		// Side of the blocks of pixels averaged into a cell of the signature
+		static constexpr int signature_cell = 16;
+
+		// Low bits of every cell dropped from the signature. 3 keeps 32 levels of each channel
+		static constexpr int signature_shift = 3;
+
+		struct Key
+		{
+			uint64_t region_hash;
+			uint64_t needle_hash;
+
+			bool operator==(const Key& rhs) const
+			{
+				return this->region_hash == rhs.region_hash && this->needle_hash == rhs.needle_hash;
+			}
+		};
+
+		struct KeyHash
+		{
+			size_t operator()(const Key& key) const
+			{
+				return static_cast<size_t>(key.region_hash ^ (key.needle_hash * 0x9E3779B97F4A7C15ull));
+			}
+		};
+
+		size_t capacity;
+
+		// The most recently used first
+		std::list<CacheEntry> entries;
+		std::unordered_map<Key, std::list<CacheEntry>::iterator, KeyHash> index;
+
+		uint64_t hits;
+		uint64_t misses;
+
+		// Shared by the engines of every client of a language
+		mutable std::mutex cache_mutex;
+
+		// Inserts (or refreshes) an entry as the most recently used, evicting the least recently used ones over the capacity
+		void insert(const CacheEntry& entry);
+
+	public:
+		explicit MatchCache(const size_t capacity = MatchCache::default_capacity);
+
+		MatchCache(const MatchCache&) = delete;
+		MatchCache& operator=(const MatchCache&) = delete;
+
+		// Hash of the pixels of an image (a whole frame or a region of it), its size and its type
+		static uint64_t hash_image(const cv::Mat& image);
+
+		/**
+		* Hash of the coarse signature of an image: its size, its type, and the means of its blocks of pixels, quantized.
+		* The same for two captures of the same screen, but also for some different ones
+		*/
+		static uint64_t hash_signature(const cv::Mat& image);
+
+		// Hash of a needle: its key on the matcher registry (id, working format and match method) and its pixels
+		static uint64_t hash_needle(const std::string& needle_key, const cv::Mat& needle_image);
+
+		/**
+		* Returns the stored result of a needle on a region, if any. "exact" tells whether its score it's the real
+		* best score of the region, or just a lower bound of it
+		*/
+		bool lookup(const uint64_t region_hash, const uint64_t needle_hash, MatchResult& result, bool& exact);
+
+		// Stores the result of a search
+		void store(const uint64_t region_hash, const uint64_t needle_hash, const MatchResult& result, const bool exact);
+
+		size_t size() const;
+
+		// Fraction of the lookups that found a result. Zero before the first lookup
+		double hit_rate() const;
+
+		// Loads the entries saved by a previous session, up to the capacity. Returns false if there is no (valid) file
+		bool load(const std::string& path);
+
+		bool save(const std::string& path) const;
+};
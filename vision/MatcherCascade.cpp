@@ -0,0 +1,137 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "MatcherCascade.hpp"
+#include "../tracing/RumbleTrace.hpp"
+
+
+namespace {
+
+	// Sum of the box of an integral image with its upper left corner at (x, y)
+	template <typename T>
+	inline double box_sum(const cv::Mat& integral, const int x, const int y, const int width, const int height)
+	{
+		const T* top = integral.ptr<T>(y);
+		const T* bottom = integral.ptr<T>(y + height);
+		return static_cast<double>(bottom[ x + width ]) - bottom[ x ] - top[ x + width ] + top[ x ];
+	}
+
+	// The TM_SQDIFF_NORMED score, clamped as OpenCV does when the window (or the needle) it's all black
+	inline double normalized_score(const double square_difference, const double denominator)
+	{
+		if (denominator <= 0.0)
+			return 1.0;
+		return std::min(1.0, square_difference / denominator);
+	}
+
+	// The real score of a window, pixel by pixel
+	double window_score(const cv::Mat& source, const cv::Mat& needle, const cv::Point& window, const double needle_squared_sum, const double window_squared_sum)
+	{
+		int64_t square_difference = 0;
+		for (int y = 0; y < needle.rows; y++)
+		{
+			const uchar* needle_row = needle.ptr<uchar>(y);
+			const uchar* source_row = source.ptr<uchar>(window.y + y) + window.x;
+			for (int x = 0; x < needle.cols; x++)
+			{
+				const int difference = static_cast<int>(needle_row[ x ]) - source_row[ x ];
+				square_difference += difference * difference;
+			}
+		}
+
+		return normalized_score(static_cast<double>(square_difference), std::sqrt(needle_squared_sum * window_squared_sum));
+	}
+}
+
+
+bool MatcherCascade::match_sqdiff_normed(
+	const cv::Mat& source,
+	const cv::Mat& integral,
+	const cv::Mat& squared_integral,
+	const cv::Mat& needle,
+	const double threshold,
+	MatchResult& result,
+	bool& exact
+) {
+	RUMBLE_TRACE_SCOPE("cascade_match");
+
+	CV_Assert(source.type() == CV_8UC1 && needle.type() == CV_8UC1);
+	CV_Assert(integral.type() == CV_32S && squared_integral.type() == CV_64F);
+	CV_Assert(integral.rows == source.rows + 1 && integral.cols == source.cols + 1);
+
+	const int windows_width = source.cols - needle.cols + 1;
+	const int windows_height = source.rows - needle.rows + 1;
+	if (windows_width <= 0 || windows_height <= 0)
+		return false;
+
+	// The statistics of the needle
+	const double pixels = static_cast<double>(needle.total());
+	const double needle_sum = cv::sum(needle)[ 0 ];
+	const double needle_squared_sum = needle.dot(needle);
+	const double needle_mean = needle_sum / pixels;
+	const double needle_deviation = std::sqrt(std::max(0.0, needle_squared_sum / pixels - needle_mean * needle_mean));
+	const double needle_norm = std::sqrt(needle_squared_sum);
+
+	const size_t max_survivors = static_cast<size_t>(
+		static_cast<double>(windows_width) * windows_height * MatcherCascade::max_survivors_fraction
+	);
+	const double rejection_bound = threshold + MatcherCascade::bound_tolerance;
+
+	std::vector<cv::Point> survivors;
+	double best_rejected_bound = 2.0;
+	cv::Point best_rejected_window;
+
+	for (int y = 0; y < windows_height; y++)
+		for (int x = 0; x < windows_width; x++)
+		{
+			const double window_sum = box_sum<int>(integral, x, y, needle.cols, needle.rows);
+			const double window_squared_sum = box_sum<double>(squared_integral, x, y, needle.cols, needle.rows);
+			const double window_mean = window_sum / pixels;
+			const double window_deviation = std::sqrt(std::max(0.0, window_squared_sum / pixels - window_mean * window_mean));
+
+			const double mean_difference = needle_mean - window_mean;
+			const double deviation_difference = needle_deviation - window_deviation;
+			const double bound = normalized_score(
+				pixels * (mean_difference * mean_difference + deviation_difference * deviation_difference),
+				needle_norm * std::sqrt(window_squared_sum)
+			);
+
+			if (bound < rejection_bound)
+			{
+				survivors.emplace_back(x, y);
+				if (survivors.size() > max_survivors)
+					return false;
+			}
+			else if (bound < best_rejected_bound)
+			{
+				best_rejected_bound = bound;
+				best_rejected_window = cv::Point{ x, y };
+			}
+		}
+
+	// The survivors, scored for real. The first of the best ones, in the same order that minMaxLoc walks the scores
+	double best_score = 2.0;
+	cv::Point best_window;
+	for (const cv::Point& window : survivors)
+	{
+		const double window_squared_sum = box_sum<double>(squared_integral, window.x, window.y, needle.cols, needle.rows);
+		const double score = window_score(source, needle, window, needle_squared_sum, window_squared_sum);
+		if (score < best_score)
+		{
+			best_score = score;
+			best_window = window;
+		}
+	}
+
+	// No rejected window can score under its bound, so a survivor under every bound (ie, under the threshold)
+	// it's the best of the whole source. Otherwise, the lowest bound it's all that's known about the best score
+	exact = best_score <= best_rejected_bound;
+	if (exact)
+		result = MatchResult{ best_window, best_score };
+	else
+		result = MatchResult{ best_rejected_window, best_rejected_bound };
+
+	return true;
+}
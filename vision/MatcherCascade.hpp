@@ -0,0 +1,43 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+#include "MatcherEngine.hpp"
+
+/**
+* A cascade in front of the square differences matching, for the gray frames that comes with their integral images.
+*
+* The square difference between the needle and a window splits into the difference of their means and the one of
+* their centered pixels, which can't be smaller than the difference of their deviations:
+*
+*     sum (T - I)^2 >= n * ((mean_T - mean_I)^2 + (deviation_T - deviation_I)^2)
+*
+* With the integral images, the mean and the deviation of any window costs four reads, so that bound of the
+* TM_SQDIFF_NORMED score of every window it's known without touching its pixels. The windows whose bound it's
+* already over the threshold can't hold the needle (ie, the dark background under a golden button), and only the
+* survivors are scored for real. The decision and the location of a match are the same that the full matching gives.
+*/
+namespace MatcherCascade {
+
+	// Fraction of the windows that can survive before the full matching (that shares its work between windows) gets cheaper
+	constexpr double max_survivors_fraction = 1.0 / 64.0;
+
+	// Room for the rounding of the OpenCV matching (single precision) against the bound (double precision)
+	constexpr double bound_tolerance = 1e-4;
+
+	/**
+	* Searches a single channel needle on a single channel source, with the integral (CV_32S) and squared integral
+	* (CV_64F) images of the source. Returns false when too many windows survive, so the caller must run the full
+	* matching. Otherwise, the result it's the best window, and "exact" tells whether its score it's the real best
+	* score of the source (always for a match below the threshold) or, for the misses, just a bound of it
+	*/
+	bool match_sqdiff_normed(
+		const cv::Mat& source,
+		const cv::Mat& integral,
+		const cv::Mat& squared_integral,
+		const cv::Mat& needle,
+		const double threshold,
+		MatchResult& result,
+		bool& exact
+	);
+}
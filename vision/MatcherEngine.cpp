@@ -0,0 +1,192 @@
+#include <algorithm>
+#include <vector>
+
+#include "MatcherEngine.hpp"
+#include "../tracing/RumbleTrace.hpp"
+
+
+namespace {
+
+	// Height of a band of the result, in needles. The bands of the source overlap by a needle, so this keeps the
+	// rows matched twice under a quarter of the band (and the whole source it's a single band for the big needles)
+	constexpr int band_needle_heights = 4;
+
+	// Below this height, the overlap of the bands costs more than the memory that they save
+	constexpr int min_band_rows = 32;
+
+	// The location that minMaxLoc gives on ties: the first one on raster order
+	inline bool is_better(const double score, const cv::Point& location, const double best_score, const cv::Point& best_location)
+	{
+		if (score != best_score)
+			return score < best_score;
+		return location.y < best_location.y || (location.y == best_location.y && location.x < best_location.x);
+	}
+}
+
+
+MatchResult MatcherEngine::match_template(const cv::Mat& source, const cv::Mat& templ, const cv::Mat& mask, const int match_method)
+{
+	// The compiled masks are single channel. Not every OpenCV version broadcast them to the channels of the template
+	cv::Mat templ_mask = mask;
+	if (!mask.empty() && mask.channels() != templ.channels())
+		cv::merge(std::vector<cv::Mat>(templ.channels(), mask), templ_mask);
+
+	const int result_cols = source.cols - templ.cols + 1;
+	const int result_rows = source.rows - templ.rows + 1;
+	CV_Assert(result_cols > 0 && result_rows > 0);
+
+	/**
+	* The result it's streamed by bands of rows, instead of materialized whole: every band it's matched into the
+	* same buffer and only its best score it's kept. The bands always spans the whole width, so cv::matchTemplate
+	* gets its rows as they are on the source. The bands of the source overlap by a needle, so they're a few needles
+	* high, and the buffer it's at most band_needle_heights needles (or min_band_rows) by the width of the result:
+	* ie, 152 x 1755 floats (1 MB) for find_game on a 1920x1080 client, never more than the whole result
+	*/
+	const int band_rows = std::min(result_rows, std::max(min_band_rows, band_needle_heights * templ.rows));
+
+	// Reused by every search of the thread, so it only grows (ie, with a wider client). cv::matchTemplate writes on a header over it
+	thread_local std::vector<float> band_buffer;
+	if (band_buffer.size() < static_cast<size_t>(band_rows) * result_cols)
+		band_buffer.resize(static_cast<size_t>(band_rows) * result_cols);
+
+	// The square differences are better when lower, the correlations when higher. Kept as a lower it's better score
+	const bool lower_is_better = match_method == cv::TM_SQDIFF_NORMED;
+	double best_score = 2.0;
+	cv::Point best_location;
+
+	RUMBLE_TRACE_SCOPE("match_template");
+	for (int y = 0; y < result_rows; y += band_rows)
+	{
+		const int rows = std::min(band_rows, result_rows - y);
+		const cv::Mat band_source = source(cv::Rect{ 0, y, source.cols, rows + templ.rows - 1 });
+		cv::Mat band_scores{ rows, result_cols, CV_32F, band_buffer.data() };
+
+		if (templ_mask.empty())
+			cv::matchTemplate(band_source, templ, band_scores, match_method);
+		else
+			cv::matchTemplate(band_source, templ, band_scores, match_method, templ_mask);
+
+		cv::Point min_loc, max_loc;
+		double min_value, max_value;
+		{
+			RUMBLE_TRACE_SCOPE("min_max_loc");
+			cv::minMaxLoc(band_scores, &min_value, &max_value, &min_loc, &max_loc);
+		}
+
+		// The bands goes on raster order, so a tie with an earlier one keeps the earlier one, as minMaxLoc
+		const double score = lower_is_better ? min_value : 1.0 - max_value;
+		const cv::Point location = (lower_is_better ? min_loc : max_loc) + cv::Point{ 0, y };
+		if (is_better(score, location, best_score, best_location))
+		{
+			best_score = score;
+			best_location = location;
+		}
+	}
+
+	return MatchResult{ best_location, best_score };
+}
+
+
+namespace {
+
+	class DirectMatcher : public MatcherEngine
+	{
+		public:
+			const char* get_name() const override
+			{
+				return "direct";
+			}
+
+			bool supports(const PreparedNeedle& needle, const cv::Size& frame_size) const override
+			{
+				return needle.image.cols <= frame_size.width && needle.image.rows <= frame_size.height;
+			}
+
+			MatchResult match(const cv::Mat& source, const PreparedNeedle& needle, const int match_method) override
+			{
+				return MatcherEngine::match_template(source, needle.image, cv::Mat{}, match_method);
+			}
+	};
+
+	class CompiledMatcher : public MatcherEngine
+	{
+		public:
+			const char* get_name() const override
+			{
+				return "compiled";
+			}
+
+			bool supports(const PreparedNeedle& needle, const cv::Size& frame_size) const override
+			{
+				return !needle.patch.empty() && needle.image.cols <= frame_size.width && needle.image.rows <= frame_size.height;
+			}
+
+			MatchResult match(const cv::Mat& source, const PreparedNeedle& needle, const int match_method) override
+			{
+				// A ROI of the needle, so nothing it's copied. Back to the corner of the whole needle from the one of the patch
+				MatchResult result = MatcherEngine::match_template(source, needle.image(needle.patch), needle.mask, match_method);
+				result.location -= needle.patch.tl();
+				result.path = MatchPath::Patch;
+				return result;
+			}
+	};
+
+	class PyramidMatcher : public MatcherEngine
+	{
+		private:
+			// Below this side, the half scale needle loses the details that tells it apart
+			static constexpr int min_needle_side = 24;
+
+			// Pixels around the coarse candidate (at full scale) where it's refined
+			static constexpr int refine_margin = 4;
+
+		public:
+			const char* get_name() const override
+			{
+				return "pyramid";
+			}
+
+			bool supports(const PreparedNeedle& needle, const cv::Size& frame_size) const override
+			{
+				return std::min(needle.image.cols, needle.image.rows) >= min_needle_side
+					&& needle.image.cols <= frame_size.width && needle.image.rows <= frame_size.height;
+			}
+
+			MatchResult match(const cv::Mat& source, const PreparedNeedle& needle, const int match_method) override
+			{
+				cv::Mat coarse_source, coarse_needle;
+				{
+					RUMBLE_TRACE_SCOPE("pyramid_downscale");
+					cv::resize(source, coarse_source, cv::Size{ source.cols / 2, source.rows / 2 }, 0, 0, cv::INTER_AREA);
+					cv::resize(needle.image, coarse_needle, cv::Size{ needle.image.cols / 2, needle.image.rows / 2 }, 0, 0, cv::INTER_AREA);
+				}
+				const MatchResult coarse = MatcherEngine::match_template(coarse_source, coarse_needle, cv::Mat{}, match_method);
+
+				// The full scale search, just around the coarse candidate. Its score it's the same that the direct one gives there
+				const cv::Rect refine_region = cv::Rect{
+					coarse.location * 2 - cv::Point{ refine_margin, refine_margin },
+					cv::Size{ needle.image.cols + 2 * refine_margin, needle.image.rows + 2 * refine_margin }
+				} & cv::Rect{ 0, 0, source.cols, source.rows };
+
+				MatchResult result = MatcherEngine::match_template(source(refine_region), needle.image, cv::Mat{}, match_method);
+				result.location += refine_region.tl();
+				return result;
+			}
+	};
+}
+
+
+MatcherEngine* MatcherEngines::direct()
+{
+	return new DirectMatcher;
+}
+
+MatcherEngine* MatcherEngines::compiled()
+{
+	return new CompiledMatcher;
+}
+
+MatcherEngine* MatcherEngines::pyramid()
+{
+	return new PyramidMatcher;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+/// <summary>
+/// A needle ready to be matched against a frame: on the channel mode and at the scale of the frame.
+/// The compiled data (if the needle has it) comes at the same scale.
+/// </summary>
+struct PreparedNeedle
+{
+	cv::Mat image;
+
+	// The discriminative patch, in coordinates of the image. Empty when the needle hasn't been compiled
+	cv::Rect patch;
+
+	// Single channel, the size of the patch. Zero for the unstable pixels. Empty when all of them are stable
+	cv::Mat mask;
+};
+
+// What the score of a search was measured on. The scores of both paths aren't comparable between them
+enum class MatchPath
+{
+	// The whole needle
+	Full,
+	// Only the compiled patch of the needle, without its masked pixels
+	Patch
+};
+
+// The best candidate of a search. The location it's the upper left corner of the whole needle, on the frame
+struct MatchResult
+{
+	cv::Point location;
+
+	// Normalized in the way that lower it's always better, as the scores of the vision engine
+	double score;
+
+	MatchPath path = MatchPath::Full;
+};
+
+/// <summary>
+/// One way of finding a needle on a frame. Every engine must find the same best candidate that the direct matching
+/// of the whole needle finds, just faster for some kind of needles (small icons, wide banners, compiled ones...).
+/// The engines are shared by every client of a language, so they must be safe to be used from several threads.
+/// </summary>
+class MatcherEngine
+{
+	public:
+		virtual ~MatcherEngine() = default;
+
+		// Identifies the engine on the persisted choices, so it must be stable across versions
+		virtual const char* get_name() const = 0;
+
+		// Whether the engine can search this needle on a frame of this size
+		virtual bool supports(const PreparedNeedle& needle, const cv::Size& frame_size) const = 0;
+
+		// One of the normalized OpenCV match methods: TM_SQDIFF_NORMED, TM_CCORR_NORMED or TM_CCOEFF_NORMED
+		virtual MatchResult match(const cv::Mat& source, const PreparedNeedle& needle, const int match_method) = 0;
+
+		/**
+		* Drops what the engine kept of the last frame searched from the calling thread, so its next match pays for
+		* the frame as a new one does. The calibration times the engines this way, as every poll brings a new frame
+		*/
+		virtual void forget_frame() {}
+
+		/**
+		* Runs the OpenCV template matching (masked, if there is a mask) over the source, and returns the best
+		* location of the template with its normalized score. The matching it's streamed by full width bands a few
+		* templates high, so the memory of the scores grows with the width of the source and the height of the template
+		* (1 MB for find_game at 1920x1080; the whole result, 8 MB, for tft_ranked at 2560x1440), not with the height of the source
+		*/
+		static MatchResult match_template(const cv::Mat& source, const cv::Mat& templ, const cv::Mat& mask, const int match_method);
+};
+
+/**
+* The built in engines. The caller owns them
+*/
+namespace MatcherEngines {
+
+	// The whole needle, with cv::matchTemplate. The reference that every other engine it's checked against
+	MatcherEngine* direct();
+
+	// Only the compiled patch of the needle, ignoring its masked pixels
+	MatcherEngine* compiled();
+
+	// Searches the needle on a half scale copy of the frame, and refines the best candidate at full scale
+	MatcherEngine* pyramid();
+
+	// Correlates the needle with the frame on the frequency domain, reusing the spectra of both (see SpectralMatcher)
+	MatcherEngine* spectral();
+}
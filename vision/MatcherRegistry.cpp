@@ -0,0 +1,250 @@
+#include <chrono>
+#include <cstdlib>
+
+#include "MatcherRegistry.hpp"
+#include "../logger/RumbleLogger.hpp"
+
+
+MatcherRegistry::MatcherRegistry()
+{
+	this->register_engine(MatcherEngines::direct());
+	this->register_engine(MatcherEngines::compiled());
+	this->register_engine(MatcherEngines::pyramid());
+	this->register_engine(MatcherEngines::spectral());
+}
+
+MatcherRegistry::~MatcherRegistry()
+{
+	for (MatcherEngine* engine : this->engines)
+		delete engine;
+}
+
+void MatcherRegistry::register_engine(MatcherEngine* engine)
+{
+	std::lock_guard<std::mutex> lock{ this->choices_mutex };
+	this->engines.push_back(engine);
+}
+
+
+MatchResult MatcherRegistry::match(
+	const std::string& key, const cv::Mat& source, const PreparedNeedle& needle, const int match_method, const double threshold
+) {
+	const std::string sized_key = key + "@" + std::to_string(source.cols) + "x" + std::to_string(source.rows);
+	MatcherEngine* engine = nullptr;
+	bool needs_calibration = false;
+
+	{
+		std::lock_guard<std::mutex> lock{ this->choices_mutex };
+
+		auto choice = this->choices.find(sized_key);
+		if (choice == this->choices.end())
+		{
+			// Chosen on a previous session. Trusted as long as its engine it's still registered and supports the needle
+			const auto loaded_choice = this->loaded_choices.find(sized_key);
+			const int index = (loaded_choice != this->loaded_choices.end()) ? this->engine_index(loaded_choice->second) : -1;
+			if (index >= 0 && this->engines[ index ]->supports(needle, source.size()))
+				choice = this->choices.emplace(sized_key, Choice{ index, false, 0, 0 }).first;
+		}
+
+		uint32_t calibrations = 0;
+		if (choice == this->choices.end())
+			needs_calibration = true;
+		else if (choice->second.provisional && choice->second.calibrations < MatcherRegistry::max_calibrations
+			&& ++choice->second.searches >= (MatcherRegistry::recalibration_interval << (choice->second.calibrations - 1)))
+		{
+			needs_calibration = true;
+			calibrations = choice->second.calibrations;
+			// The rest of the threads keeps searching with the direct engine meanwhile, instead of calibrating too
+			choice->second.searches = 0;
+		}
+		else
+			engine = this->engines[ choice->second.provisional ? 0 : choice->second.engine ];
+
+		if (needs_calibration && choice != this->choices.end())
+			choice->second.calibrations = calibrations + 1;
+	}
+
+	// Outside the lock, the other needles can still be searched meanwhile
+	if (needs_calibration)
+	{
+		MatchResult direct_result{};
+		Choice choice = this->calibrate(sized_key, source, needle, match_method, threshold, direct_result);
+
+		std::lock_guard<std::mutex> lock{ this->choices_mutex };
+		const auto previous = this->choices.find(sized_key);
+		choice.calibrations = (previous != this->choices.end()) ? previous->second.calibrations : 1;
+		this->choices[ sized_key ] = choice;
+
+		// The direct engine already searched this frame
+		engine = this->engines[ choice.provisional ? 0 : choice.engine ];
+		if (engine == this->engines[ 0 ] && engine->supports(needle, source.size()))
+			return direct_result;
+	}
+
+	return engine->match(source, needle, match_method);
+}
+
+
+MatcherRegistry::Choice MatcherRegistry::calibrate(
+	const std::string& key, const cv::Mat& source, const PreparedNeedle& needle, const int match_method, const double threshold,
+	MatchResult& direct_result
+) {
+	using Clock = std::chrono::steady_clock;
+
+	std::vector<MatcherEngine*> candidates;
+	{
+		std::lock_guard<std::mutex> lock{ this->choices_mutex };
+		candidates = this->engines;
+	}
+
+	MatchResult reference{};
+	double best_time = 0.0;
+	int best_engine = 0;
+
+	for (size_t i = 0; i < candidates.size(); i++)
+	{
+		if (!candidates[ i ]->supports(needle, source.size()))
+			continue;
+
+		MatchResult result{};
+		double fastest_run = 0.0;
+		for (int run = 0; run < MatcherRegistry::calibration_runs; run++)
+		{
+			// As on a new frame, every poll brings one. What the engine keeps of the needle stays warm after the first run
+			candidates[ i ]->forget_frame();
+
+			const Clock::time_point start = Clock::now();
+			result = candidates[ i ]->match(source, needle, match_method);
+			const double elapsed = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+			if (run == 0 || elapsed < fastest_run)
+				fastest_run = elapsed;
+		}
+
+		RUMBLE_LOG_DEBUG << "Calibration of " << key << ": " << candidates[ i ]->get_name() << " took "
+			<< fastest_run << "us, score " << result.score;
+
+		// The direct engine it's the first one, and the reference for the rest
+		if (i == 0)
+		{
+			reference = result;
+			direct_result = result;
+			best_time = fastest_run;
+			continue;
+		}
+
+		// The same decision than the direct engine, and when there is a match, on the same place
+		const bool reference_match = reference.score < threshold;
+		const bool agrees = (result.score < threshold) == reference_match && (!reference_match || (
+			std::abs(result.location.x - reference.location.x) <= MatcherRegistry::location_tolerance
+			&& std::abs(result.location.y - reference.location.y) <= MatcherRegistry::location_tolerance
+		));
+
+		if (!agrees)
+		{
+			RUMBLE_LOG_DEBUG << "Discarding " << candidates[ i ]->get_name() << " for " << key << ", it disagrees with the direct engine";
+			continue;
+		}
+
+		if (fastest_run < best_time)
+		{
+			best_time = fastest_run;
+			best_engine = static_cast<int>(i);
+		}
+	}
+
+	// Without the needle on the frame, the engines only agreed that there is nothing to find
+	const bool provisional = reference.score >= threshold;
+	if (!provisional)
+	{
+		RUMBLE_LOG_INFO << "Matcher engine for " << key << " -> " << candidates[ best_engine ]->get_name()
+			<< " (" << best_time << "us)";
+	}
+
+	return Choice{ best_engine, provisional, 0, 0 };
+}
+
+
+std::string MatcherRegistry::get_choice(const std::string& key)
+{
+	std::lock_guard<std::mutex> lock{ this->choices_mutex };
+
+	const auto choice = this->choices.find(key);
+	if (choice != this->choices.end())
+		return choice->second.provisional ? std::string{} : this->engines[ choice->second.engine ]->get_name();
+
+	const auto loaded_choice = this->loaded_choices.find(key);
+	return (loaded_choice != this->loaded_choices.end()) ? loaded_choice->second : std::string{};
+}
+
+int MatcherRegistry::engine_index(const std::string& engine_name) const
+{
+	for (size_t i = 0; i < this->engines.size(); i++)
+		if (engine_name == this->engines[ i ]->get_name())
+			return static_cast<int>(i);
+
+	return -1;
+}
+
+std::string MatcherRegistry::build_tag()
+{
+	return CV_VERSION;
+}
+
+
+bool MatcherRegistry::load(const std::string& path)
+{
+	cv::FileStorage storage;
+	try
+	{
+		if (!storage.open(path, cv::FileStorage::READ))
+			return false;
+	}
+	catch (const cv::Exception&)
+	{
+		return false;
+	}
+
+	if (static_cast<std::string>(storage[ "build" ]) != MatcherRegistry::build_tag())
+	{
+		RUMBLE_LOG_INFO << "Ignoring the matcher choices of " << path << ", they were calibrated with another OpenCV build";
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock{ this->choices_mutex };
+
+	const cv::FileNode choices_node = storage[ "choices" ];
+	for (auto it = choices_node.begin(); it != choices_node.end(); ++it)
+		this->loaded_choices[ static_cast<std::string>((*it)[ "key" ]) ] = static_cast<std::string>((*it)[ "engine" ]);
+
+	return true;
+}
+
+bool MatcherRegistry::save(const std::string& path)
+{
+	cv::FileStorage storage;
+	try
+	{
+		if (!storage.open(path, cv::FileStorage::WRITE))
+			return false;
+	}
+	catch (const cv::Exception&)
+	{
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock{ this->choices_mutex };
+
+	// The loaded choices that weren't used on this session are kept, with the final ones of this session over them
+	std::map<std::string, std::string> final_choices{ this->loaded_choices };
+	for (const auto& [key, choice] : this->choices)
+		if (!choice.provisional)
+			final_choices[ key ] = this->engines[ choice.engine ]->get_name();
+
+	storage << "build" << MatcherRegistry::build_tag();
+	storage << "choices" << "[";
+	for (const auto& [key, engine_name] : final_choices)
+		storage << "{" << "key" << key << "engine" << engine_name << "}";
+	storage << "]";
+
+	return true;
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "MatcherEngine.hpp"
+
+/// <summary>
+/// The matcher engines available to the vision engine, and the fastest correct one for every needle.
+///
+/// The first time that a needle it's searched (on a working format, with a match method and on a frame size),
+/// that frame becomes its calibration frame: every engine that supports the needle runs on it a few times, the ones
+/// that doesn't find the same candidate than the direct matching are discarded, and the fastest of the rest
+/// it's chosen. From there, the searches of the needle goes straight to its engine.
+///
+/// A calibration only proves that the engines agree when the needle it's on the frame. Otherwise the choice it's
+/// provisional: the direct engine it's used, and the calibration it's repeated a few times, each one after twice
+/// the searches than the previous one, until the needle shows up. A calibration runs inline on the search that
+/// triggers it, so a needle that never shows up stops paying them and keeps the direct engine for the session.
+/// The final choices can be saved, so the next sessions on the same machine skips the calibration.
+/// </summary>
+class MatcherRegistry
+{
+	private:
+		// Timed runs of every engine on a calibration. The fastest of them counts, as the others catches the noise
+		static constexpr int calibration_runs = 3;
+
+		// Searches until the first calibration again of a provisional choice. Doubled after every one of them
+		static constexpr uint32_t recalibration_interval = 32;
+
+		// Calibrations of a provisional choice, the first one included, before it stays on the direct engine
+		static constexpr uint32_t max_calibrations = 4;
+
+		// Distance (in pixels of the frame) that the candidate of an engine can be away from the direct one
+		static constexpr int location_tolerance = 2;
+
+		struct Choice
+		{
+			// Index on the engines. The provisional choices uses the direct one meanwhile
+			int engine;
+			bool provisional;
+			// Searches since the last calibration, for the provisional ones
+			uint32_t searches;
+			// Calibrations already run on this session
+			uint32_t calibrations;
+		};
+
+		// Owned. The first one it's the direct engine, the reference of the calibrations
+		std::vector<MatcherEngine*> engines;
+
+		std::map<std::string, Choice> choices;
+		// Engine names of the choices loaded from a file. Resolved on the first search of every key
+		std::map<std::string, std::string> loaded_choices;
+		std::mutex choices_mutex;
+
+		// Choices are only comparable on the same OpenCV build, so the persisted data it's tagged with its version
+		static std::string build_tag();
+
+		int engine_index(const std::string& engine_name) const;
+
+		// Times every engine on the frame and chooses the fastest one that agrees with the direct engine, whose result it's
+		// also given back, so the search that triggered the calibration doesn't have to run again
+		Choice calibrate(
+			const std::string& key, const cv::Mat& source, const PreparedNeedle& needle, const int match_method, const double threshold,
+			MatchResult& direct_result
+		);
+
+	public:
+		// The file, inside the assets folder of the language, where the choices are persisted
+		static constexpr const char* file_name = "matcher_choices.yml";
+
+		// Registers the built in engines
+		MatcherRegistry();
+		~MatcherRegistry();
+
+		MatcherRegistry(const MatcherRegistry&) = delete;
+		MatcherRegistry& operator=(const MatcherRegistry&) = delete;
+
+		// Takes the ownership of an engine. Must be registered before the first search
+		void register_engine(MatcherEngine* engine);
+
+		/**
+		* Searches the needle with the engine chosen for it, calibrating them first if there isn't a choice yet.
+		* The key identifies the needle, its working format and the match method. The frame size it's added to it
+		*/
+		MatchResult match(
+			const std::string& key, const cv::Mat& source, const PreparedNeedle& needle, const int match_method, const double threshold
+		);
+
+		// The name of the engine chosen for a key (with the frame size), or an empty string if there isn't a final choice
+		std::string get_choice(const std::string& key);
+
+		// Loads the choices of a previous session. Returns false if there is no (compatible) file
+		bool load(const std::string& path);
+
+		// Saves the final choices as an OpenCV YAML file
+		bool save(const std::string& path);
+};
@@ -0,0 +1,236 @@
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <fstream>
+#include <tuple>
+
+#include "NeedleAtlas.hpp"
+#include "../logger/RumbleLogger.hpp"
+
+
+namespace {
+
+	size_t align_up(const size_t value, const size_t alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	// The order of the index, so the lookups are a binary search
+	bool entry_less(const NeedleAtlas::AtlasEntry& lhs, const NeedleAtlas::AtlasEntry& rhs)
+	{
+		const int comparison = std::strncmp(lhs.id, rhs.id, NeedleAtlas::max_id_length);
+		return comparison < 0 || (comparison == 0 && lhs.channel_mode < rhs.channel_mode);
+	}
+
+	cv::Mat to_channel_mode(const cv::Mat& needle, const ChannelMode channel_mode)
+	{
+		cv::Mat converted;
+		switch (channel_mode)
+		{
+			case ChannelMode::BGR:
+				converted = needle;
+				break;
+			case ChannelMode::Gray:
+				cv::cvtColor(needle, converted, cv::COLOR_BGR2GRAY);
+				break;
+			default:
+				cv::cvtColor(needle, converted, cv::COLOR_BGR2BGRA);
+		}
+		return converted;
+	}
+}
+
+
+NeedleAtlas::NeedleAtlas() : entries{ nullptr }, entry_count{ 0 } {}
+
+bool NeedleAtlas::open(const std::string& path)
+{
+	this->entries = nullptr;
+	this->entry_count = 0;
+
+	if (!this->mapped_file.open(path))
+		return false;
+
+	if (!this->validate())
+	{
+		RUMBLE_LOG_WARNING << "Ignoring the needle atlas " << path << ", it's corrupted or from another version";
+		this->mapped_file.close();
+		return false;
+	}
+
+	const AtlasHeader* header = reinterpret_cast<const AtlasHeader*>(this->mapped_file.data());
+	this->entries = reinterpret_cast<const AtlasEntry*>(this->mapped_file.data() + header->index_offset);
+	this->entry_count = header->entry_count;
+
+	RUMBLE_LOG_DEBUG << "Mapped " << this->entry_count << " needles from " << path;
+	return true;
+}
+
+bool NeedleAtlas::validate() const
+{
+	const size_t file_size = this->mapped_file.size();
+	if (file_size < sizeof(AtlasHeader))
+		return false;
+
+	const AtlasHeader* header = reinterpret_cast<const AtlasHeader*>(this->mapped_file.data());
+	if (std::memcmp(header->magic, magic, sizeof(magic)) != 0 || header->version != version)
+		return false;
+
+	// The index goes right after the header, and the pixel data after the index. Every check can't overflow from here
+	const uint64_t index_end = header->index_offset + static_cast<uint64_t>(header->entry_count) * sizeof(AtlasEntry);
+	if (header->index_offset < sizeof(AtlasHeader) || header->index_offset % alignof(AtlasEntry) != 0
+		|| header->index_offset > file_size || index_end > file_size
+		|| header->data_offset < index_end || header->data_offset % image_alignment != 0 || header->data_offset > file_size)
+		return false;
+
+	const AtlasEntry* index = reinterpret_cast<const AtlasEntry*>(this->mapped_file.data() + header->index_offset);
+	uint64_t previous_end = header->data_offset;
+	for (uint32_t i = 0; i < header->entry_count; i++)
+	{
+		const AtlasEntry& entry = index[ i ];
+		if (entry.id[ max_id_length - 1 ] != '\0'
+			|| entry.channels == 0 || entry.channels > 4
+			|| entry.channel_mode > static_cast<uint8_t>(ChannelMode::Gray)
+			|| entry.width == 0 || entry.height == 0
+			|| entry.width > static_cast<uint32_t>(INT_MAX) || entry.height > static_cast<uint32_t>(INT_MAX)
+			|| entry.step < static_cast<uint64_t>(entry.width) * entry.channels)
+			return false;
+
+		// The SIMD loads relies on the alignment, and the matrices can't overlap the index nor each other
+		if (entry.offset % image_alignment != 0 || entry.step % row_alignment != 0 || entry.offset < previous_end
+			|| entry.offset > file_size || static_cast<uint64_t>(entry.step) * entry.height > file_size - entry.offset)
+			return false;
+		previous_end = entry.offset + static_cast<uint64_t>(entry.step) * entry.height;
+
+		if (i > 0 && !entry_less(index[ i - 1 ], entry))
+			return false;
+	}
+
+	return true;
+}
+
+bool NeedleAtlas::is_open() const
+{
+	return this->mapped_file.is_open();
+}
+
+size_t NeedleAtlas::size() const
+{
+	return this->entry_count;
+}
+
+cv::Mat NeedleAtlas::get(const std::string& needle_id, const ChannelMode channel_mode) const
+{
+	if (this->entries == nullptr || needle_id.size() >= max_id_length)
+		return cv::Mat{};
+
+	AtlasEntry key{};
+	std::memcpy(key.id, needle_id.c_str(), needle_id.size());
+	key.channel_mode = static_cast<uint8_t>(channel_mode);
+
+	const AtlasEntry* end = this->entries + this->entry_count;
+	const AtlasEntry* entry = std::lower_bound(this->entries, end, key, entry_less);
+	if (entry == end || entry_less(key, *entry))
+		return cv::Mat{};
+
+	// cv::Mat has no const data, but the view points straight to the read only pages: a write faults instead of
+	// corrupting the needle shared with the rest of the processes. Every caller gets it as a const reference
+	return cv::Mat(
+		static_cast<int>(entry->height),
+		static_cast<int>(entry->width),
+		CV_8UC(entry->channels),
+		const_cast<unsigned char*>(this->mapped_file.data() + entry->offset),
+		entry->step
+	);
+}
+
+
+bool NeedleAtlas::write(
+	const std::string& path,
+	const std::map<std::string, cv::Mat>& needles,
+	const std::vector<ChannelMode>& channel_modes
+)
+{
+	std::vector<AtlasEntry> index;
+	std::vector<cv::Mat> images;
+
+	for (const auto& [id, needle] : needles)
+	{
+		if (id.size() >= max_id_length)
+		{
+			RUMBLE_LOG_ERROR << "The needle id " << id << " it's too long for the atlas";
+			return false;
+		}
+
+		for (const ChannelMode channel_mode : channel_modes)
+		{
+			AtlasEntry entry{};
+			std::memcpy(entry.id, id.c_str(), id.size());
+			entry.channel_mode = static_cast<uint8_t>(channel_mode);
+			index.push_back(entry);
+			images.push_back(to_channel_mode(needle, channel_mode));
+		}
+	}
+
+	// The images follows the order of the index
+	std::vector<size_t> order(index.size());
+	for (size_t i = 0; i < order.size(); i++)
+		order[ i ] = i;
+	std::sort(order.begin(), order.end(), [&index](const size_t lhs, const size_t rhs) {
+		return entry_less(index[ lhs ], index[ rhs ]);
+	});
+
+	AtlasHeader header{};
+	std::memcpy(header.magic, magic, sizeof(magic));
+	header.version = version;
+	header.entry_count = static_cast<uint32_t>(index.size());
+	header.index_offset = sizeof(AtlasHeader);
+	header.data_offset = align_up(header.index_offset + index.size() * sizeof(AtlasEntry), image_alignment);
+
+	std::vector<AtlasEntry> sorted_index;
+	std::vector<const cv::Mat*> sorted_images;
+	uint64_t offset = header.data_offset;
+	for (const size_t i : order)
+	{
+		const cv::Mat& image = images[ i ];
+		AtlasEntry entry = index[ i ];
+		entry.width = static_cast<uint32_t>(image.cols);
+		entry.height = static_cast<uint32_t>(image.rows);
+		entry.channels = static_cast<uint8_t>(image.channels());
+		entry.step = static_cast<uint32_t>(align_up(image.cols * image.elemSize(), row_alignment));
+		entry.offset = offset;
+
+		offset = align_up(offset + static_cast<uint64_t>(entry.step) * entry.height, image_alignment);
+		sorted_index.push_back(entry);
+		sorted_images.push_back(&image);
+	}
+
+	std::ofstream file{ path, std::ios::binary | std::ios::trunc };
+	if (!file)
+		return false;
+
+	const auto pad_to = [&file](const uint64_t position) {
+		static const char zeros[ image_alignment ] = {};
+		while (static_cast<uint64_t>(file.tellp()) < position)
+			file.write(zeros, std::min<uint64_t>(image_alignment, position - static_cast<uint64_t>(file.tellp())));
+	};
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(sorted_index.data()), sorted_index.size() * sizeof(AtlasEntry));
+
+	for (size_t i = 0; i < sorted_index.size(); i++)
+	{
+		const AtlasEntry& entry = sorted_index[ i ];
+		const cv::Mat& image = *sorted_images[ i ];
+
+		pad_to(entry.offset);
+		for (int row = 0; row < image.rows; row++)
+		{
+			file.write(reinterpret_cast<const char*>(image.ptr(row)), image.cols * image.elemSize());
+			pad_to(entry.offset + static_cast<uint64_t>(entry.step) * (row + 1));
+		}
+	}
+	pad_to(offset);
+
+	return static_cast<bool>(file);
+}
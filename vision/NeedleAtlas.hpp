@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "RumbleVision.h"
+#include "../helpers/MappedFile.hpp"
+
+/// <summary>
+/// All the needles of a language packed on a single binary file, already decoded and converted to the channel
+/// modes of the vision engine. The file it's memory mapped, and the needles are handed out as cv::Mat headers
+/// over the mapped pages, so loading them doesn't decode nor copy anything, and every process running the
+/// extension on the same machine shares the same physical memory.
+///
+/// Layout (little endian, as the machines that runs the client):
+///     AtlasHeader | AtlasEntry[ entry_count ], sorted by (id, channel mode) | pixel data
+/// Every image starts on a 64 bytes boundary and every row on a 16 bytes one, so the SIMD loads are aligned.
+/// The atlas it's built by tools/atlas_packer.
+/// </summary>
+class NeedleAtlas
+{
+	public:
+		static constexpr char magic[ 8 ] = { 'R', 'L', 'E', 'A', 'T', 'L', 'A', 'S' };
+		static constexpr uint32_t version = 1;
+
+		// The file, inside the assets folder of the language, where the packer writes the atlas
+		static constexpr const char* file_name = "needles.atlas";
+
+		static constexpr size_t image_alignment = 64;
+		static constexpr size_t row_alignment = 16;
+
+		// Longest needle id that fits on the index, counting the null terminator
+		static constexpr size_t max_id_length = 40;
+
+		struct AtlasHeader
+		{
+			char magic[ 8 ];
+			uint32_t version;
+			uint32_t entry_count;
+			uint64_t index_offset;
+			uint64_t data_offset;
+			uint8_t reserved[ 32 ];
+		};
+
+		struct AtlasEntry
+		{
+			char id[ max_id_length ];
+			uint32_t width;
+			uint32_t height;
+			uint32_t step;
+			uint8_t channel_mode;
+			uint8_t channels;
+			uint8_t reserved[ 2 ];
+			uint64_t offset;
+		};
+
+		static_assert(sizeof(AtlasHeader) == 64 && sizeof(AtlasEntry) == 64, "The atlas layout must not have any padding");
+
+	private:
+		MappedFile mapped_file;
+
+		const AtlasEntry* entries;
+		size_t entry_count;
+
+		// Checks that the header and every entry of the index are inside the file, aligned and apart from each other
+		bool validate() const;
+
+	public:
+		NeedleAtlas();
+
+		// Maps an atlas file. Returns false if there is no (valid) atlas there
+		bool open(const std::string& path);
+
+		bool is_open() const;
+
+		// Number of images (a needle on every channel mode counts once per mode)
+		size_t size() const;
+
+		/**
+		* Returns the needle on the requested channel mode, as a read only view over the mapped file, or an empty
+		* matrix if the atlas doesn't have it. Valid while the atlas stays open.
+		* The pages are mapped read only, so writing on the view crashes: a caller that writes must clone it first.
+		*/
+		cv::Mat get(const std::string& needle_id, const ChannelMode channel_mode) const;
+
+		/**
+		* Packs the needles (BGR images, by id) on every one of the channel modes into a new atlas file
+		*/
+		static bool write(
+			const std::string& path,
+			const std::map<std::string, cv::Mat>& needles,
+			const std::vector<ChannelMode>& channel_modes
+		);
+};
@@ -0,0 +1,170 @@
+#include <algorithm>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "NeedleThresholds.hpp"
+#include "../logger/RumbleLogger.hpp"
+
+
+NeedleThresholds::NeedleThresholds(const double default_threshold, const int match_method, const double margin)
+	: default_threshold{ default_threshold },
+	margin{ margin },
+	match_method{ match_method } {}
+
+
+std::string NeedleThresholds::path_key(const std::string& needle_id, const MatchPath path)
+{
+	return (path == MatchPath::Patch) ? needle_id + "#patch" : needle_id;
+}
+
+
+double NeedleThresholds::get(const std::string& needle_id, const MatchPath path) const
+{
+	std::lock_guard<std::mutex> lock{ this->needles_mutex };
+
+	const auto stats = this->needles.find(NeedleThresholds::path_key(needle_id, path));
+	return (stats != this->needles.end()) ? stats->second.threshold : this->default_threshold;
+}
+
+void NeedleThresholds::record(const std::string& needle_id, const MatchPath path, const double score, const bool present)
+{
+	const std::string key = NeedleThresholds::path_key(needle_id, path);
+	std::lock_guard<std::mutex> lock{ this->needles_mutex };
+
+	auto stats = this->needles.find(key);
+	if (stats == this->needles.end())
+		stats = this->needles.emplace(key, NeedleStats{ {}, {}, this->default_threshold }).first;
+
+	std::deque<float>& scores = present ? stats->second.hits : stats->second.misses;
+	scores.push_back(static_cast<float>(score));
+	if (scores.size() > max_samples)
+		scores.pop_front();
+
+	// The labelled scores are few (one per confirmed click, at most), so every one of them updates the threshold
+	const double previous_threshold = stats->second.threshold;
+	this->update_threshold(stats->second);
+	if (stats->second.threshold != previous_threshold)
+	{
+		RUMBLE_LOG_DEBUG << "Threshold for " << key << " -> " << stats->second.threshold;
+	}
+}
+
+
+/**
+* Places the threshold between the slowest hits and the best misses. Without hits, the misses can only bring it
+* below the default one, when they get too close to it
+*/
+void NeedleThresholds::update_threshold(NeedleStats& stats) const
+{
+	std::vector<float> misses{ stats.misses.begin(), stats.misses.end() };
+	if (misses.size() < min_samples_per_group)
+		return;
+	std::sort(misses.begin(), misses.end());
+
+	// Robust lower extreme of the misses (5th percentile)
+	const double misses_lower = misses[ static_cast<size_t>((misses.size() - 1) * 0.05) ];
+
+	if (stats.hits.size() < min_samples_per_group)
+	{
+		stats.threshold = std::clamp(std::min(this->default_threshold, misses_lower - min_gap), min_threshold, this->default_threshold);
+		return;
+	}
+
+	std::vector<float> hits{ stats.hits.begin(), stats.hits.end() };
+	std::sort(hits.begin(), hits.end());
+
+	// Robust upper extreme of the hits (95th percentile)
+	const double hits_upper = hits[ static_cast<size_t>((hits.size() - 1) * 0.95) ];
+
+	// Overlapping groups means that the needle isn't reliable enough to move away from the default
+	if (misses_lower - hits_upper < min_gap)
+	{
+		stats.threshold = this->default_threshold;
+		return;
+	}
+
+	stats.threshold = std::clamp(hits_upper + this->margin * (misses_lower - hits_upper), min_threshold, max_threshold);
+}
+
+
+bool NeedleThresholds::load(const std::string& path)
+{
+	cv::FileStorage storage;
+	try
+	{
+		if (!storage.open(path, cv::FileStorage::READ))
+			return false;
+	}
+	catch (const cv::Exception&)
+	{
+		return false;
+	}
+
+	if (static_cast<int>(storage[ "version" ]) != NeedleThresholds::version)
+	{
+		RUMBLE_LOG_INFO << "Ignoring the thresholds of " << path << ", they were learned from unlabelled scores";
+		return false;
+	}
+
+	if (static_cast<int>(storage[ "match_method" ]) != this->match_method)
+	{
+		RUMBLE_LOG_WARNING << "Ignoring the thresholds of " << path << ", they were recorded with another match method";
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock{ this->needles_mutex };
+
+	const cv::FileNode needles_node = storage[ "needles" ];
+	for (auto it = needles_node.begin(); it != needles_node.end(); ++it)
+	{
+		const std::string id = static_cast<std::string>((*it)[ "id" ]);
+		std::vector<float> hits, misses;
+		(*it)[ "hits" ] >> hits;
+		(*it)[ "misses" ] >> misses;
+
+		NeedleStats stats{ { hits.begin(), hits.end() }, { misses.begin(), misses.end() }, this->default_threshold };
+		while (stats.hits.size() > max_samples)
+			stats.hits.pop_front();
+		while (stats.misses.size() > max_samples)
+			stats.misses.pop_front();
+
+		// Learned again from the scores, so a file edited by hand can't bring back a threshold that they don't back
+		this->update_threshold(stats);
+		this->needles[ id ] = std::move(stats);
+	}
+
+	return true;
+}
+
+bool NeedleThresholds::save(const std::string& path) const
+{
+	cv::FileStorage storage;
+	try
+	{
+		if (!storage.open(path, cv::FileStorage::WRITE))
+			return false;
+	}
+	catch (const cv::Exception&)
+	{
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock{ this->needles_mutex };
+
+	storage << "version" << NeedleThresholds::version;
+	storage << "match_method" << this->match_method;
+	storage << "needles" << "[";
+	for (const auto& [id, stats] : this->needles)
+	{
+		storage << "{"
+			<< "id" << id
+			<< "threshold" << stats.threshold
+			<< "hits" << std::vector<float>{ stats.hits.begin(), stats.hits.end() }
+			<< "misses" << std::vector<float>{ stats.misses.begin(), stats.misses.end() }
+			<< "}";
+	}
+	storage << "]";
+
+	return true;
+}
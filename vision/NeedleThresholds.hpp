@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+
+#include "MatcherEngine.hpp"
+
+/// <summary>
+/// Per needle match thresholds, learned from the scores of the searches whose outcome it's known for sure.
+///
+/// Only labelled scores are recorded: a hit it's the score of a needle whose click the client confirmed, and a miss
+/// it's the score of a needle on a frame where it's known not to be: the anchor of the screen where a click leads,
+/// searched on the frame of that click, once the client confirms it (see ClickVerifier). The polls of the watchers
+/// and of the verifications aren't labelled, so they never get here.
+/// The threshold it's placed inside the gap between the hits and the misses, at a margin from the hits.
+///
+/// The scores of the compiled patch and the ones of the whole needle aren't comparable, so every match path of a
+/// needle learns apart. A threshold only goes over the default one when there are hits that back it: the misses
+/// alone can only lower it. Needles without enough data, or without a clear gap yet, keep using the default threshold.
+///
+/// The learned data can be saved next to the assets of a language, so the next sessions starts already tuned.
+/// </summary>
+class NeedleThresholds
+{
+	private:
+		// Version of the saved data. The files of the unlabelled versions are ignored
+		static constexpr int version = 2;
+
+		// Last scores kept per needle and label. Older ones are forgotten, so the thresholds follows client updates
+		static constexpr size_t max_samples = 128;
+
+		// Scores needed on each label before trusting a learned threshold
+		static constexpr size_t min_samples_per_group = 5;
+
+		// Minimum distance between the hits and the misses to consider that they are really apart
+		static constexpr double min_gap = 0.05;
+
+		// The learned thresholds are clamped into this range
+		static constexpr double min_threshold = 0.01;
+		static constexpr double max_threshold = 0.35;
+
+		struct NeedleStats
+		{
+			std::deque<float> hits;
+			std::deque<float> misses;
+			double threshold;
+		};
+
+		double default_threshold;
+
+		// Fraction of the gap between hits and misses that the threshold sits above the hits
+		double margin;
+
+		// The scores are only comparable with the same match method, so the persisted data it's tagged with it
+		int match_method;
+
+		// By needle (with its working format) and match path
+		std::map<std::string, NeedleStats> needles;
+		mutable std::mutex needles_mutex;
+
+		// The key of a needle on a match path. The whole needle keeps the plain id, as the choices of the registry
+		static std::string path_key(const std::string& needle_id, const MatchPath path);
+
+		void update_threshold(NeedleStats& stats) const;
+
+	public:
+		// The file, inside the assets folder of the language, where the learned thresholds are persisted
+		static constexpr const char* file_name = "thresholds.yml";
+
+		NeedleThresholds(const double default_threshold, const int match_method, const double margin = 0.5);
+
+		// The threshold to use with a needle, for the scores of a match path
+		double get(const std::string& needle_id, const MatchPath path = MatchPath::Full) const;
+
+		// Adds the score of a search whose outcome it's known: "present" tells whether the needle really was on the frame
+		void record(const std::string& needle_id, const MatchPath path, const double score, const bool present);
+
+		// Loads the data saved by a previous session. Returns false if there is no (compatible) file
+		bool load(const std::string& path);
+
+		// Saves the labelled scores and the learned thresholds as an OpenCV YAML file
+		bool save(const std::string& path) const;
+};
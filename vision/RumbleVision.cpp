@@ -1,48 +1,428 @@
 #include "RumbleVision.h"
+#include "MatcherCascade.hpp"
+#include "../window_capture/FrameKernels.hpp"
+#include "../tracing/RumbleTrace.hpp"
 
 using namespace std;
 using namespace cv;
 
 
+// Default constructor. Keeps the original behaviour of the engine: four channels images and square differences
+RumbleLeagueVision::RumbleLeagueVision()
+    : RumbleLeagueVision{ ChannelMode::BGRA, TM_SQDIFF_NORMED } {}
+
+RumbleLeagueVision::RumbleLeagueVision(const ChannelMode channel_mode, const int match_method, const int downscale)
+    : channel_mode{ channel_mode },
+    match_method{ match_method },
+    downscale{ downscale },
+    matcher_registry{ nullptr },
+    match_cache{ nullptr },
+    needle_thresholds{ nullptr },
+    cascade{ true },
+    cascade_searches{ 0 },
+    last_score{ 1.0 },
+    last_score_exact{ true },
+    last_match_path{ MatchPath::Full }
+{
+    CV_Assert(match_method == TM_SQDIFF_NORMED || match_method == TM_CCORR_NORMED || match_method == TM_CCOEFF_NORMED);
+    CV_Assert(downscale == 1 || downscale == 2);
+}
+
+
 Point RumbleLeagueVision::find(Mat* video_src, Mat templ, double threshold, bool debug_mode)
+{
+    // A full resolution view of the video source. Nothing it's copied, and the debug drawings still lands on it
+    WorkingFrame frame{ *video_src, 1 };
+    return this->find(frame, templ, threshold, debug_mode);
+}
+
+
+Point RumbleLeagueVision::find(Mat* video_src, const Mat& templ, const CompiledNeedle& compiled_needle, double threshold, bool debug_mode)
+{
+    WorkingFrame frame{ *video_src, 1 };
+    return this->find(frame, templ, compiled_needle, threshold, debug_mode);
+}
+
+
+Point RumbleLeagueVision::find(WorkingFrame& frame, const Mat& templ, double threshold, bool debug_mode)
 {
     // Const data for this method
     const char* image_window = "Source Image";
-    const char* result_window = "Result window";
-    const int match_method = TM_SQDIFF_NORMED;
-    const int img_matrix_type = CV_8UC4;
-    
-    // Deferencing the video and bring it's value
-    Mat img = *video_src;
 
-    // The resulting matrix with the desired image
-    Mat result;
-    int result_cols = img.cols - templ.cols + 1;
-    int result_rows = img.rows - templ.rows + 1;
-    result.create(result_rows, result_cols, img_matrix_type);
+    // Moves both images to the color layout of this engine. No copies are made if they already are on it
+    Mat source = this->to_channel_mode(frame.image);
+    Mat needle = this->to_frame_scale(templ, frame.downscale);
+
+    Point matchLoc;
+    if (!this->cascade_match(frame, source, needle, threshold, matchLoc))
+        this->match(source, needle, Mat(), matchLoc);
+
+
+    const bool is_match = this->last_score < threshold;
+
+    // Only draws over the video source when debugging, so the caller's frame stays untouched and can be matched again
+    if (debug_mode)
+    {
+        if (is_match)
+            rectangle(frame.image, matchLoc, Point(matchLoc.x + needle.cols, matchLoc.y + needle.rows), CV_RGB(0, 255, 0), cv::BORDER_CONSTANT);
+        imshow(image_window, frame.image);
+    }
+
+    // Back to client coordinates from the scale of the frame
+    if (is_match)
+        return (matchLoc + (Point(matchLoc.x + needle.cols, matchLoc.y + needle.rows) - matchLoc) / 2) * frame.downscale;
+
+    return Point();
+}
+
+
+Point RumbleLeagueVision::find(WorkingFrame& frame, const Mat& templ, const CompiledNeedle& compiled_needle, double threshold, bool debug_mode)
+{
+    const char* image_window = "Source Image";
+    const int scale = frame.downscale;
+
+    // Just the patch of the needle, at the scale of the frame. A ROI, so nothing it's copied
+    Mat source = this->to_channel_mode(frame.image);
+    const PreparedNeedle prepared_needle = this->prepare_needle(templ, &compiled_needle, scale);
+    const Mat& needle = prepared_needle.image;
+    Mat patch = needle(prepared_needle.patch);
+
+    Point matchLoc;
+    this->match(source, patch, prepared_needle.mask, matchLoc);
+    this->last_match_path = MatchPath::Patch;
+
+    const bool is_match = this->last_score < threshold;
+
+    // From the patch location to the button location, so the debug rectangle covers the whole button. In client coordinates
+    const Point patch_center = (matchLoc + Point(patch.cols, patch.rows) / 2) * scale;
+    const Point button_center = patch_center + compiled_needle.center_offset;
+
+    if (debug_mode)
+    {
+        if (is_match)
+        {
+            const Point button_origin = (button_center - Point(compiled_needle.needle_size.width, compiled_needle.needle_size.height) / 2) / scale;
+            rectangle(frame.image, button_origin, button_origin + Point(needle.cols, needle.rows),
+                CV_RGB(0, 255, 0), cv::BORDER_CONSTANT);
+            rectangle(frame.image, matchLoc, matchLoc + Point(patch.cols, patch.rows), CV_RGB(255, 255, 0), cv::BORDER_CONSTANT);
+        }
+        imshow(image_window, frame.image);
+    }
+
+    if (is_match)
+        return button_center;
+
+    return Point();
+}
+
+
+Point RumbleLeagueVision::find(
+    WorkingFrame& frame, const std::string& needle_id, const Mat& templ, const CompiledNeedle* compiled_needle,
+    double threshold, bool debug_mode
+) {
+    // The compiled data only applies to the needle that it was compiled from
+    if (compiled_needle != nullptr && compiled_needle->needle_size != templ.size())
+        compiled_needle = nullptr;
+
+    if (this->matcher_registry == nullptr)
+    {
+        if (compiled_needle == nullptr)
+            return this->find(frame, templ, threshold, debug_mode);
+
+        // Only the patch it's scored, so it's decided by its own threshold
+        if (this->needle_thresholds != nullptr)
+            threshold = this->needle_thresholds->get(needle_id + this->get_format_tag(), MatchPath::Patch);
+        return this->find(frame, templ, *compiled_needle, threshold, debug_mode);
+    }
+
+    const char* image_window = "Source Image";
+    const int scale = frame.downscale;
+
+    Mat source = this->to_channel_mode(frame.image);
+    const PreparedNeedle needle = this->prepare_needle(templ, compiled_needle, scale);
+
+    // A needle bigger than the frame (or than the region of it) can't be on it. The worst score
+    if (needle.image.cols > source.cols || needle.image.rows > source.rows)
+    {
+        this->last_score = 1.0;
+        this->last_score_exact = true;
+        this->last_match_path = MatchPath::Full;
+        return Point();
+    }
+
+    // The engine of a needle it's chosen per working format and match method, as their speeds aren't comparable
+    const std::string key = needle_id + this->get_format_tag() + "/" + std::to_string(this->match_method);
+
+    // The registry can choose the compiled engine, that only scores the patch. Its scores goes against its own threshold
+    const auto path_threshold = [&](const MatchPath path) {
+        return (path == MatchPath::Patch && this->needle_thresholds != nullptr)
+            ? this->needle_thresholds->get(needle_id + this->get_format_tag(), MatchPath::Patch)
+            : threshold;
+    };
+
+    /**
+    * The misses are only answered by the exact same pixels: a small needle that appears can leave the coarse
+    * signature of the region as it was. A bounded miss only answers while the threshold stays under its bound.
+    * The hits are keyed by the signature, so the noise of the captures doesn't change their key, and they're
+    * only answered once their candidate it's scored again on this source
+    */
+    uint64_t exact_hash = 0, signature_hash = 0, needle_hash = 0;
+    bool cached = false;
+    MatchResult result;
+    if (this->match_cache != nullptr)
+    {
+        exact_hash = MatchCache::hash_image(source);
+        signature_hash = MatchCache::hash_signature(source);
+        needle_hash = MatchCache::hash_needle(key, needle.image);
+
+        bool exact = false;
+        if (this->match_cache->lookup(exact_hash, needle_hash, result, exact) && (exact || result.score >= threshold))
+            cached = true;
+        else if (this->match_cache->lookup(signature_hash, needle_hash, result, exact))
+            cached = this->verify_cached(source, needle, path_threshold(result.path), result, exact);
 
-    // Runs the OPENCV matching algorithm, storing the data into result
-    cv::matchTemplate(img, templ, result, match_method);
+        if (cached)
+        {
+            this->last_score = result.score;
+            this->last_score_exact = exact;
+        }
+    }
 
+    if (!cached)
+    {
+        // The cascade goes before any engine. The compiled patches are already a cheap match of their own
+        if (needle.patch.empty() && this->cascade_match(frame, source, needle.image, threshold, result.location))
+            result.score = this->last_score;
+        else
+        {
+            result = this->matcher_registry->match(key, source, needle, this->match_method, threshold);
+            this->last_score = result.score;
+            this->last_score_exact = true;
+        }
 
-    // Given a matrix, finds the best and worst (this is dependant on match method)
-    Point matchLoc; Point minLoc; Point maxLoc;
-    double minVal; double maxVal;
-    minMaxLoc(result, &minVal, &maxVal, &minLoc, &maxLoc, Mat());
+        if (this->match_cache != nullptr)
+        {
+            const bool hit = this->last_score < path_threshold(result.path);
+            this->match_cache->store(hit ? signature_hash : exact_hash, needle_hash, result, this->last_score_exact);
+        }
+    }
 
-    // For the first two methods(TM_SQDIFF and MT_SQDIFF_NORMED) the best match are the lowest values.For all the others,
-    // higher values represent better matches.So, we save the corresponding value in the matchLoc variable
-    (match_method == TM_SQDIFF || match_method == TM_SQDIFF_NORMED) ? matchLoc = minLoc : matchLoc = maxLoc;
+    this->last_match_path = result.path;
+    threshold = path_threshold(result.path);
 
+    const bool is_match = this->last_score < threshold;
 
-    if (minVal < threshold)
+    if (debug_mode)
     {
-        rectangle(img, matchLoc, Point(matchLoc.x + templ.cols, matchLoc.y + templ.rows), CV_RGB(0, 255, 0), cv::BORDER_CONSTANT);
-        return matchLoc + (Point(matchLoc.x + templ.cols, matchLoc.y + templ.rows) - matchLoc) / 2;
+        if (is_match)
+            rectangle(frame.image, result.location, result.location + Point(needle.image.cols, needle.image.rows), CV_RGB(0, 255, 0), cv::BORDER_CONSTANT);
+        imshow(image_window, frame.image);
     }
 
-    if (debug_mode) { imshow(image_window, img); }
+    // Center of the whole needle, back to client coordinates from the scale of the frame
+    if (is_match)
+        return (result.location + Point(needle.image.cols, needle.image.rows) / 2) * scale;
 
     return Point();
 }
 
+
+void RumbleLeagueVision::match(const Mat& source, const Mat& templ, const Mat& mask, Point& match_loc)
+{
+    const MatchResult result = MatcherEngine::match_template(source, templ, mask, this->match_method);
+    match_loc = result.location;
+    this->last_score = result.score;
+    this->last_score_exact = true;
+    this->last_match_path = MatchPath::Full;
+}
+
+
+bool RumbleLeagueVision::cascade_match(const WorkingFrame& frame, const Mat& source, const Mat& needle, const double threshold, Point& match_loc)
+{
+    // The integral images are the ones of the frame itself, so the source can't be a conversion of it
+    if (!this->cascade || this->match_method != TM_SQDIFF_NORMED || frame.integral.empty()
+        || source.data != frame.image.data || source.channels() != 1 || needle.channels() != 1)
+        return false;
+
+    if (++this->cascade_searches % RumbleLeagueVision::exact_search_interval == 0)
+        return false;
+
+    MatchResult result;
+    bool exact = false;
+    if (!MatcherCascade::match_sqdiff_normed(source, frame.integral, frame.squared_integral, needle, threshold, result, exact))
+        return false;
+
+    match_loc = result.location;
+    this->last_score = result.score;
+    this->last_score_exact = exact;
+    this->last_match_path = MatchPath::Full;
+    return true;
+}
+
+
+bool RumbleLeagueVision::verify_cached(const Mat& source, const PreparedNeedle& needle, const double threshold, MatchResult& result, bool& exact)
+{
+    RUMBLE_TRACE_SCOPE("cache_verification");
+
+    // Only the hits are verified. A miss of another threshold can't tell that the needle isn't somewhere else now
+    if (result.score >= threshold)
+        return false;
+
+    // The window of the candidate, of the patch when that's what the stored score was measured on
+    const bool patch = result.path == MatchPath::Patch && !needle.patch.empty();
+    if (result.path == MatchPath::Patch && !patch)
+        return false;
+
+    const Rect window = patch
+        ? Rect{ result.location + needle.patch.tl(), needle.patch.size() }
+        : Rect{ result.location, needle.image.size() };
+    if ((window & Rect{ 0, 0, source.cols, source.rows }) != window)
+        return false;
+
+    const double score = patch
+        ? MatcherEngine::match_template(source(window), needle.image(needle.patch), needle.mask, this->match_method).score
+        : MatcherEngine::match_template(source(window), needle.image, Mat{}, this->match_method).score;
+
+    // The needle was there, and still it's
+    if (score >= threshold)
+        return false;
+
+    result.score = score;
+    exact = true;
+    return true;
+}
+
+
+PreparedNeedle RumbleLeagueVision::prepare_needle(const Mat& templ, const CompiledNeedle* compiled_needle, const int frame_downscale) const
+{
+    PreparedNeedle needle{ this->to_frame_scale(templ, frame_downscale) };
+    if (compiled_needle == nullptr)
+        return needle;
+
+    const int scale = frame_downscale;
+    needle.patch = Rect{
+        compiled_needle->patch.x / scale, compiled_needle->patch.y / scale,
+        compiled_needle->patch.width / scale, compiled_needle->patch.height / scale
+    } & Rect{ 0, 0, needle.image.cols, needle.image.rows };
+
+    needle.mask = compiled_needle->mask;
+    if (!needle.mask.empty() && needle.mask.size() != needle.patch.size())
+        resize(compiled_needle->mask, needle.mask, needle.patch.size(), 0, 0, INTER_NEAREST);
+
+    return needle;
+}
+
+
+Mat RumbleLeagueVision::to_channel_mode(const Mat& image) const
+{
+    RUMBLE_TRACE_SCOPE("color_conversion");
+
+    Mat converted;
+    switch (this->channel_mode)
+    {
+        case ChannelMode::BGR:
+            if (image.channels() == 3) return image;
+            cvtColor(image, converted, COLOR_BGRA2BGR);
+            break;
+        case ChannelMode::Gray:
+            if (image.channels() == 1) return image;
+            cvtColor(image, converted, (image.channels() == 4) ? COLOR_BGRA2GRAY : COLOR_BGR2GRAY);
+            break;
+        default:
+            if (image.channels() == 4) return image;
+            cvtColor(image, converted, COLOR_BGR2BGRA);
+    }
+
+    return converted;
+}
+
+
+Mat RumbleLeagueVision::to_frame_scale(const Mat& needle, const int frame_downscale) const
+{
+    return FrameKernels::downscale_needle(this->to_channel_mode(needle), frame_downscale);
+}
+
+
+void RumbleLeagueVision::set_matcher_registry(MatcherRegistry* matcher_registry)
+{
+    this->matcher_registry = matcher_registry;
+}
+
+
+void RumbleLeagueVision::set_match_cache(MatchCache* match_cache)
+{
+    this->match_cache = match_cache;
+}
+
+
+void RumbleLeagueVision::set_needle_thresholds(NeedleThresholds* needle_thresholds)
+{
+    this->needle_thresholds = needle_thresholds;
+}
+
+
+void RumbleLeagueVision::set_cascade(const bool enabled)
+{
+    this->cascade = enabled;
+}
+
+
+void RumbleLeagueVision::set_working_format(const ChannelMode channel_mode, const int downscale)
+{
+    CV_Assert(downscale == 1 || downscale == 2);
+    this->channel_mode = channel_mode;
+    this->downscale = downscale;
+}
+
+
+/**
+* Getters
+*/
+WorkingFormat RumbleLeagueVision::get_working_format() const
+{
+    // The integral images of the frame are built by the capture itself, along with the conversion
+    return WorkingFormat{ this->channel_mode, this->downscale, this->cascade && this->channel_mode == ChannelMode::Gray };
+}
+
+std::string RumbleLeagueVision::get_format_tag() const
+{
+    if (this->channel_mode == ChannelMode::BGRA && this->downscale == 1)
+        return std::string{};
+
+    std::string tag{ "@" };
+    switch (this->channel_mode)
+    {
+        case ChannelMode::BGR: tag += "bgr"; break;
+        case ChannelMode::Gray: tag += "gray"; break;
+        default: tag += "bgra";
+    }
+    if (this->downscale != 1)
+        tag += "/" + std::to_string(this->downscale);
+
+    return tag;
+}
+
+ChannelMode RumbleLeagueVision::get_channel_mode() const
+{
+    return this->channel_mode;
+}
+
+int RumbleLeagueVision::get_match_method() const
+{
+    return this->match_method;
+}
+
+double RumbleLeagueVision::get_last_score() const
+{
+    return this->last_score;
+}
+
+bool RumbleLeagueVision::is_last_score_exact() const
+{
+    return this->last_score_exact;
+}
+
+MatchPath RumbleLeagueVision::get_last_match_path() const
+{
+    return this->last_match_path;
+}
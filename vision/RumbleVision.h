@@ -1,17 +1,155 @@
 #pragma once
 
+#include <cstdint>
+#include <string>
+
 #include <opencv2/opencv.hpp>
 
+#include "ChannelMode.hpp"
+#include "CompiledNeedles.hpp"
+#include "MatcherRegistry.hpp"
+#include "MatcherCascade.hpp"
+#include "MatchCache.hpp"
+#include "NeedleThresholds.hpp"
+#include "../window_capture/WorkingFrame.hpp"
+
 class RumbleLeagueVision
 {
 	private:
-		// pass
+		// One of every this number of searches that the cascade could take runs the full matching instead, so the
+		// misses keeps reporting their real scores (the labelled ones teach the learned thresholds)
+		static constexpr uint32_t exact_search_interval = 8;
+
+		// Color layout of the matching. BGRA it's the native layout of the Windows API captures
+		ChannelMode channel_mode;
+
+		// One of the normalized OpenCV match methods: TM_SQDIFF_NORMED, TM_CCORR_NORMED or TM_CCOEFF_NORMED
+		int match_method;
+
+		// Scale of the frames that this engine asks to the frame sources. 1 it's the full resolution, 2 the half of it
+		int downscale;
+
+		// Chooses the fastest engine for every needle. Borrowed. Without it, the needles are always matched directly
+		MatcherRegistry* matcher_registry;
+
+		// Borrowed. The results of the previous searches, by the signature of the frame. Null when they aren't cached
+		MatchCache* match_cache;
+
+		// Borrowed. Where the thresholds of the compiled patches are taken from, when a search ends up scoring one. Can be null
+		NeedleThresholds* needle_thresholds;
+
+		// Rejects with the integral images of the gray frames the windows that can't hold the needle, before matching them
+		bool cascade;
+		uint32_t cascade_searches;
+
+		/**
+		* The score of the best candidate found on the last call to find, normalized in the way that
+		* lower it's always better (1 - max for the correlation methods), so it's comparable against the threshold
+		*/
+		double last_score;
+
+		// False when the cascade rejected the best window of the last search, so its score it's just a lower bound
+		bool last_score_exact;
+
+		// Whether the last score was measured on the whole needle or on its compiled patch
+		MatchPath last_match_path;
+
+		// Converts an image (BGR or BGRA) to the channel mode selected for this engine
+		cv::Mat to_channel_mode(const cv::Mat& image) const;
+
+		// A needle on the channel mode of this engine and at the scale of a frame
+		cv::Mat to_frame_scale(const cv::Mat& needle, const int frame_downscale) const;
+
+		// Runs the template matching (masked, if there is a mask) and stores the best location and its score
+		void match(const cv::Mat& source, const cv::Mat& templ, const cv::Mat& mask, cv::Point& match_loc);
+
+		/**
+		* Searches a whole needle with the cascade, if the frame and the engine allows it. Returns false when it didn't,
+		* so the caller must run the full matching
+		*/
+		bool cascade_match(const WorkingFrame& frame, const cv::Mat& source, const cv::Mat& needle, const double threshold, cv::Point& match_loc);
+
+		/**
+		* Scores again, on this source, the candidate of a hit taken from the match cache by the coarse signature of
+		* the region, so it only stays a hit if the needle it's still there, with its new score. Returns false when it
+		* doesn't hold, and for the misses, that the signature can't answer
+		*/
+		bool verify_cached(const cv::Mat& source, const PreparedNeedle& needle, const double threshold, MatchResult& result, bool& exact);
+
+		// A needle (and its compiled data, if any) at the channel mode of this engine and at the scale of a frame
+		PreparedNeedle prepare_needle(const cv::Mat& templ, const CompiledNeedle* compiled_needle, const int frame_downscale) const;
 
 	public:
-		/** 
+		// Constructors
+		RumbleLeagueVision();
+		RumbleLeagueVision(const ChannelMode channel_mode, const int match_method, const int downscale = 1);
+
+		/**
 		 * Finds (if exists) an image inside another parent image.
 		 * The method's job it's to find an image inside a VideoStream, directly taken from the Windows API
-		 * and to return the left-upper coordinates where the match happens. 
+		 * and to return the left-upper coordinates where the match happens.
 		*/
 		cv::Point find(cv::Mat* video_src, cv::Mat templ, double threshold = 0.05, bool debug_mode = false);
-};
\ No newline at end of file
+
+		/**
+		 * Same as above, but only matches the discriminative patch of the needle, ignoring its masked pixels.
+		 * Returns the center of the whole button, as the plain find does.
+		*/
+		cv::Point find(
+			cv::Mat* video_src, const cv::Mat& templ, const CompiledNeedle& compiled_needle,
+			double threshold = 0.05, bool debug_mode = false
+		);
+
+		/**
+		 * The same searches, over a frame already on a working format. The needle (full resolution) it's brought
+		 * to the scale of the frame, and the returned center it's always on client coordinates.
+		*/
+		cv::Point find(WorkingFrame& frame, const cv::Mat& templ, double threshold = 0.05, bool debug_mode = false);
+		cv::Point find(
+			WorkingFrame& frame, const cv::Mat& templ, const CompiledNeedle& compiled_needle,
+			double threshold = 0.05, bool debug_mode = false
+		);
+
+		/**
+		 * Searches a needle of the assets with the engine that the matcher registry chose for it, using its compiled
+		 * data if it has any. Without a registry, it's the same as the searches above.
+		 * The threshold it's the one of the whole needle. When the search scores the compiled patch instead, the
+		 * threshold of the patch it's taken from the needle thresholds, if the engine has them
+		*/
+		cv::Point find(
+			WorkingFrame& frame, const std::string& needle_id, const cv::Mat& templ, const CompiledNeedle* compiled_needle,
+			double threshold = 0.05, bool debug_mode = false
+		);
+
+		void set_matcher_registry(MatcherRegistry* matcher_registry);
+
+		// The searches with a needle id (the ones dispatched by the registry) are looked up on the cache before matching
+		void set_match_cache(MatchCache* match_cache);
+
+		void set_needle_thresholds(NeedleThresholds* needle_thresholds);
+
+		// Enabled by default. Only used with TM_SQDIFF_NORMED over gray frames, that are captured with their integral images then
+		void set_cascade(const bool enabled);
+
+		// Changes the format of the frames that the engine asks for. Only the Gray channel mode has a fused capture kernel
+		void set_working_format(const ChannelMode channel_mode, const int downscale);
+
+		// Getters
+		WorkingFormat get_working_format() const;
+
+		/**
+		 * Tells apart the scores of the different working formats, which aren't comparable between them.
+		 * Empty for the default one (BGRA at full resolution), ie: "@gray/2"
+		*/
+		std::string get_format_tag() const;
+
+		ChannelMode get_channel_mode() const;
+		int get_match_method() const;
+		double get_last_score() const;
+
+		// Only the exact scores should teach the learned thresholds
+		bool is_last_score_exact() const;
+
+		// The learned thresholds of the two paths are apart, since their scores aren't comparable
+		MatchPath get_last_match_path() const;
+};
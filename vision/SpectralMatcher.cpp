@@ -0,0 +1,291 @@
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include "SpectralMatcher.hpp"
+#include "MatchCache.hpp"
+#include "../tracing/RumbleTrace.hpp"
+
+
+namespace {
+
+	// The spectra of the last frame searched by a thread, with its integral images
+	struct FrameSpectra
+	{
+		uint64_t hash = 0;
+		int type = -1;
+		cv::Size size;
+
+		std::vector<cv::Mat> spectra;
+		cv::Mat sum;
+		cv::Mat squared_sum;
+	};
+
+	// Everything that a search writes. Kept by the thread, so the buffers are only allocated when the frame size changes
+	struct Workspace
+	{
+		FrameSpectra frame;
+
+		std::vector<cv::Mat> channels;
+		cv::Mat padded;
+		cv::Mat product;
+		cv::Mat correlation_spectrum;
+		cv::Mat correlation;
+	};
+
+	thread_local Workspace workspace;
+
+	// Both sides padded to a size that the DFT factorizes well. The frame size only, so the windows never wraps around
+	inline cv::Size dft_size_of(const cv::Size& frame_size)
+	{
+		return cv::Size{ cv::getOptimalDFTSize(frame_size.width), cv::getOptimalDFTSize(frame_size.height) };
+	}
+
+	// Zero pads a single channel image to the DFT size and transforms it. Only its own rows are transformed, the rest are known zeros
+	void forward_dft(const cv::Mat& channel, const cv::Size& dft_size, cv::Mat& padded, cv::Mat& spectrum)
+	{
+		padded.create(dft_size, CV_32F);
+		padded.setTo(cv::Scalar::all(0));
+
+		cv::Mat channel_region = padded(cv::Rect{ 0, 0, channel.cols, channel.rows });
+		channel.convertTo(channel_region, CV_32F);
+
+		cv::dft(padded, spectrum, 0, channel.rows);
+	}
+
+	// The channels of an image, without copying it when it only has one
+	void split_channels(const cv::Mat& image, std::vector<cv::Mat>& channels)
+	{
+		if (image.channels() == 1)
+			channels.assign(1, image);
+		else
+			cv::split(image, channels);
+	}
+
+	// Sum of a channel over the box of an integral image with its upper left corner at (x, y)
+	inline double box_sum(const double* top, const double* bottom, const int x, const int width, const int channels, const int channel)
+	{
+		return bottom[ (x + width) * channels + channel ] - bottom[ x * channels + channel ]
+			- top[ (x + width) * channels + channel ] + top[ x * channels + channel ];
+	}
+}
+
+
+size_t SpectralMatcher::NeedleSpectrum::bytes() const
+{
+	size_t total = 0;
+	for (const cv::Mat& spectrum : this->spectra)
+		total += spectrum.total() * spectrum.elemSize();
+	return total;
+}
+
+
+SpectralMatcher::SpectralMatcher()
+	: needle_spectra_bytes{ 0 } {}
+
+
+const char* SpectralMatcher::get_name() const
+{
+	return "spectral";
+}
+
+bool SpectralMatcher::supports(const PreparedNeedle& needle, const cv::Size& frame_size) const
+{
+	return needle.image.type() == CV_8UC1 && needle.image.cols * needle.image.rows >= SpectralMatcher::min_needle_area
+		&& needle.image.cols <= frame_size.width && needle.image.rows <= frame_size.height;
+}
+
+
+std::shared_ptr<const SpectralMatcher::NeedleSpectrum> SpectralMatcher::get_needle_spectrum(const cv::Mat& needle, const cv::Size& dft_size)
+{
+	const uint64_t needle_hash = MatchCache::hash_image(needle);
+
+	{
+		std::lock_guard<std::mutex> lock{ this->spectra_mutex };
+		for (auto it = this->needle_spectra.begin(); it != this->needle_spectra.end(); ++it)
+			if ((*it)->needle_hash == needle_hash && (*it)->dft_size == dft_size)
+			{
+				this->needle_spectra.splice(this->needle_spectra.begin(), this->needle_spectra, it);
+				return this->needle_spectra.front();
+			}
+	}
+
+	// Outside the lock, the other threads can still search the needles that are already there
+	std::shared_ptr<NeedleSpectrum> needle_spectrum = std::make_shared<NeedleSpectrum>();
+	{
+		RUMBLE_TRACE_SCOPE("needle_spectrum");
+
+		needle_spectrum->needle_hash = needle_hash;
+		needle_spectrum->dft_size = dft_size;
+
+		std::vector<cv::Mat> channels;
+		split_channels(needle, channels);
+		needle_spectrum->spectra.resize(channels.size());
+
+		cv::Mat padded;
+		for (size_t c = 0; c < channels.size(); c++)
+			forward_dft(channels[ c ], dft_size, padded, needle_spectrum->spectra[ c ]);
+
+		// The same statistics that cv::matchTemplate normalizes with
+		cv::Scalar deviation;
+		cv::meanStdDev(needle, needle_spectrum->mean, deviation);
+
+		const double area = static_cast<double>(needle.total());
+		double variance = 0.0, squared_mean = 0.0;
+		for (int c = 0; c < needle.channels(); c++)
+		{
+			variance += deviation[ c ] * deviation[ c ];
+			squared_mean += needle_spectrum->mean[ c ] * needle_spectrum->mean[ c ];
+		}
+		needle_spectrum->centered_squared_sum = variance * area;
+		needle_spectrum->squared_sum = (variance + squared_mean) * area;
+	}
+
+	std::lock_guard<std::mutex> lock{ this->spectra_mutex };
+
+	// Another thread could have computed it meanwhile
+	for (const std::shared_ptr<const NeedleSpectrum>& cached : this->needle_spectra)
+		if (cached->needle_hash == needle_hash && cached->dft_size == dft_size)
+			return cached;
+
+	this->needle_spectra.push_front(needle_spectrum);
+	this->needle_spectra_bytes += needle_spectrum->bytes();
+
+	// The least recently used ones over the budget. The one just computed stays, even if it's over it on its own
+	while (this->needle_spectra_bytes > SpectralMatcher::max_spectra_bytes && this->needle_spectra.size() > 1)
+	{
+		this->needle_spectra_bytes -= this->needle_spectra.back()->bytes();
+		this->needle_spectra.pop_back();
+	}
+
+	return needle_spectrum;
+}
+
+
+MatchResult SpectralMatcher::match(const cv::Mat& source, const PreparedNeedle& needle, const int match_method)
+{
+	RUMBLE_TRACE_SCOPE("spectral_match");
+
+	const cv::Mat& templ = needle.image;
+	CV_Assert(source.depth() == CV_8U && source.type() == templ.type());
+
+	const int channels = source.channels();
+	const cv::Size dft_size = dft_size_of(source.size());
+	Workspace& thread_workspace = workspace;
+	FrameSpectra& frame = thread_workspace.frame;
+
+	// Once per frame. The rest of the needles searched on it from this thread reuses it
+	const uint64_t frame_hash = MatchCache::hash_image(source);
+	if (frame.hash != frame_hash || frame.type != source.type() || frame.size != source.size())
+	{
+		RUMBLE_TRACE_SCOPE("frame_spectrum");
+
+		split_channels(source, thread_workspace.channels);
+		frame.spectra.resize(channels);
+		for (int c = 0; c < channels; c++)
+			forward_dft(thread_workspace.channels[ c ], dft_size, thread_workspace.padded, frame.spectra[ c ]);
+
+		cv::integral(source, frame.sum, frame.squared_sum, CV_64F, CV_64F);
+
+		frame.hash = frame_hash;
+		frame.type = source.type();
+		frame.size = source.size();
+	}
+
+	const std::shared_ptr<const NeedleSpectrum> needle_spectrum = this->get_needle_spectrum(templ, dft_size);
+
+	const int result_cols = source.cols - templ.cols + 1;
+	const int result_rows = source.rows - templ.rows + 1;
+
+	// The correlation of every channel, added on the frequency domain so there is a single inverse transform
+	{
+		RUMBLE_TRACE_SCOPE("spectral_correlation");
+
+		for (int c = 0; c < channels; c++)
+		{
+			cv::Mat& product = (c == 0) ? thread_workspace.correlation_spectrum : thread_workspace.product;
+			cv::mulSpectrums(frame.spectra[ c ], needle_spectrum->spectra[ c ], product, 0, true);
+			if (c > 0)
+				cv::add(thread_workspace.correlation_spectrum, product, thread_workspace.correlation_spectrum);
+		}
+
+		// Only the rows where a window starts are needed
+		cv::dft(thread_workspace.correlation_spectrum, thread_workspace.correlation,
+			cv::DFT_INVERSE | cv::DFT_SCALE | cv::DFT_REAL_OUTPUT, result_rows);
+	}
+
+	const bool centered = match_method == cv::TM_CCOEFF_NORMED;
+	const bool squared_difference = match_method == cv::TM_SQDIFF_NORMED;
+
+	// A flat needle correlates the same with every window. cv::matchTemplate gives all of them the best score
+	if (centered && needle_spectrum->centered_squared_sum < DBL_EPSILON)
+		return MatchResult{ cv::Point{ 0, 0 }, 0.0 };
+
+	const double inverse_area = 1.0 / static_cast<double>(templ.total());
+	const double needle_norm = std::sqrt(centered ? needle_spectrum->centered_squared_sum : needle_spectrum->squared_sum);
+
+	RUMBLE_TRACE_SCOPE("spectral_normalization");
+
+	// Normalized as cv::matchTemplate does, clamps included, so the scores are comparable with the ones of the direct engine
+	double best_score = 2.0;
+	cv::Point best_location;
+	for (int y = 0; y < result_rows; y++)
+	{
+		const float* correlation_row = thread_workspace.correlation.ptr<float>(y);
+		const double* sum_top = frame.sum.ptr<double>(y);
+		const double* sum_bottom = frame.sum.ptr<double>(y + templ.rows);
+		const double* squared_top = frame.squared_sum.ptr<double>(y);
+		const double* squared_bottom = frame.squared_sum.ptr<double>(y + templ.rows);
+
+		for (int x = 0; x < result_cols; x++)
+		{
+			double numerator = correlation_row[ x ];
+			double window_squared_mean = 0.0, window_squared_sum = 0.0;
+			for (int c = 0; c < channels; c++)
+			{
+				if (centered)
+				{
+					const double window_sum = box_sum(sum_top, sum_bottom, x, templ.cols, channels, c);
+					window_squared_mean += window_sum * window_sum;
+					numerator -= window_sum * needle_spectrum->mean[ c ];
+				}
+				window_squared_sum += box_sum(squared_top, squared_bottom, x, templ.cols, channels, c);
+			}
+			window_squared_mean *= inverse_area;
+
+			if (squared_difference)
+				numerator = std::max(window_squared_sum - 2.0 * numerator + needle_spectrum->squared_sum, 0.0);
+
+			const double denominator = std::sqrt(std::max(window_squared_sum - window_squared_mean, 0.0)) * needle_norm;
+			if (std::fabs(numerator) < denominator)
+				numerator /= denominator;
+			else if (std::fabs(numerator) < denominator * 1.125)
+				numerator = (numerator > 0) ? 1.0 : -1.0;
+			else
+				numerator = squared_difference ? 1.0 : 0.0;
+
+			// Strictly better only, so the ties keeps the first one on raster order, as cv::minMaxLoc
+			const double score = squared_difference ? numerator : 1.0 - numerator;
+			if (score < best_score)
+			{
+				best_score = score;
+				best_location = cv::Point{ x, y };
+			}
+		}
+	}
+
+	return MatchResult{ best_location, best_score };
+}
+
+
+void SpectralMatcher::forget_frame()
+{
+	workspace.frame.hash = 0;
+	workspace.frame.type = -1;
+}
+
+
+MatcherEngine* MatcherEngines::spectral()
+{
+	return new SpectralMatcher;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "MatcherEngine.hpp"
+
+/// <summary>
+/// Matches the needle on the frequency domain: the correlation of the needle with every window of the frame it's
+/// the inverse DFT of the product of their spectra, and the normalization of every window comes from the integral
+/// images of the frame. Its cost barely depends on the size of the needle, so it pays off for the big ones (the
+/// game mode cards, like summoners_rift or teamfight_tactics), where the direct matching it's W * H * w * h.
+///
+/// Both spectra are padded to the (optimal) DFT size of the frame, so none of them depends on the other:
+/// - The spectrum of a frame, and its integral images, are computed once per frame (by the hash of its pixels) and
+///   reused by every needle searched on it from the same thread.
+/// - The spectrum of a needle it's computed once per DFT size, and shared by every thread. They are the size of a
+///   frame, so the cache of them it's bounded by bytes.
+/// Only gray frames are supported, and only the needles big enough to pay off: the game mode and training cards.
+/// A spectrum per channel it's 8 MB at 1920x1080, so a BGRA needle (33 MB) would leave room for a single one.
+/// The buffers of the transforms are kept per thread, so a poll doesn't allocate anything once they are sized.
+/// </summary>
+class SpectralMatcher : public MatcherEngine
+{
+	private:
+		// Below this area the needle it's cheap enough for the direct matching, that shares its work between windows.
+		// Only the cards of the choose game screen (7 needles on the EN assets) are over it at full scale
+		static constexpr int min_needle_area = 160 * 160;
+
+		// Bytes of needle spectra kept. Every supported needle at 1920x1080 (7 x 8 MB), or 8 of them at 2560x1440
+		static constexpr size_t max_spectra_bytes = 128 * 1024 * 1024;
+
+		struct NeedleSpectrum
+		{
+			uint64_t needle_hash;
+			cv::Size dft_size;
+
+			// One per channel, packed as cv::dft gives them for real inputs (CCS)
+			std::vector<cv::Mat> spectra;
+
+			// Per channel mean, and the sums that the normalization of every method needs
+			cv::Scalar mean;
+			double squared_sum;
+			double centered_squared_sum;
+
+			size_t bytes() const;
+		};
+
+		// The most recently used first
+		std::list<std::shared_ptr<const NeedleSpectrum>> needle_spectra;
+		size_t needle_spectra_bytes;
+		std::mutex spectra_mutex;
+
+		// Gets the spectrum of a needle from the cache, computing it if it isn't there (or if it's from another DFT size)
+		std::shared_ptr<const NeedleSpectrum> get_needle_spectrum(const cv::Mat& needle, const cv::Size& dft_size);
+
+	public:
+		SpectralMatcher();
+
+		const char* get_name() const override;
+		bool supports(const PreparedNeedle& needle, const cv::Size& frame_size) const override;
+		MatchResult match(const cv::Mat& source, const PreparedNeedle& needle, const int match_method) override;
+		void forget_frame() override;
+};
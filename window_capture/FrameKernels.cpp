@@ -0,0 +1,254 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#include "FrameKernels.hpp"
+#include "../tracing/RumbleTrace.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define RLE_FRAME_KERNELS_SSE2
+	#include <emmintrin.h>
+#endif
+
+
+namespace FrameKernels {
+
+	namespace {
+
+		// BT.601 luma weights in 8 bit fixed point. They add up to 256
+		constexpr int weight_b = 29;
+		constexpr int weight_g = 150;
+		constexpr int weight_r = 77;
+
+		inline int weighted_sum(const unsigned char* pixel)
+		{
+			return weight_b * pixel[ 0 ] + weight_g * pixel[ 1 ] + weight_r * pixel[ 2 ];
+		}
+
+#ifdef RLE_FRAME_KERNELS_SSE2
+		// The weights of two BGRA pixels widened to 16 bits. A madd leaves [ b * wb + g * wg, r * wr ] per pixel
+		inline __m128i pixel_weights()
+		{
+			return _mm_setr_epi16(weight_b, weight_g, weight_r, 0, weight_b, weight_g, weight_r, 0);
+		}
+
+		// Four 32 bit values, already on the 0 - 255 range, stored as four bytes
+		inline void store_four(unsigned char* out, const __m128i values)
+		{
+			const __m128i packed = _mm_packus_epi16(_mm_packs_epi32(values, values), _mm_setzero_si128());
+			const int four_bytes = _mm_cvtsi128_si32(packed);
+			std::memcpy(out, &four_bytes, sizeof(four_bytes));
+		}
+#endif
+
+		// One BGRA row into a gray one, at full scale
+		void gray_row(const unsigned char* row, unsigned char* out, const int width)
+		{
+			int x = 0;
+#ifdef RLE_FRAME_KERNELS_SSE2
+			const __m128i zero = _mm_setzero_si128();
+			const __m128i weights = pixel_weights();
+			const __m128i rounding = _mm_set1_epi32(1 << 7);
+
+			for (; x + 4 <= width; x += 4)
+			{
+				const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + 4 * x));
+				const __m128 low = _mm_castsi128_ps(_mm_madd_epi16(_mm_unpacklo_epi8(pixels, zero), weights));
+				const __m128 high = _mm_castsi128_ps(_mm_madd_epi16(_mm_unpackhi_epi8(pixels, zero), weights));
+
+				// The blue + green lanes of the four pixels, plus their red lanes
+				const __m128i sums = _mm_add_epi32(
+					_mm_castps_si128(_mm_shuffle_ps(low, high, _MM_SHUFFLE(2, 0, 2, 0))),
+					_mm_castps_si128(_mm_shuffle_ps(low, high, _MM_SHUFFLE(3, 1, 3, 1)))
+				);
+				store_four(out + x, _mm_srli_epi32(_mm_add_epi32(sums, rounding), 8));
+			}
+#endif
+			for (; x < width; x++)
+				out[ x ] = static_cast<unsigned char>((weighted_sum(row + 4 * x) + (1 << 7)) >> 8);
+		}
+
+		// Two BGRA rows into one gray row of half the width. Every output pixel it's the mean of a 2 x 2 block
+		void gray_half_row(const unsigned char* top, const unsigned char* bottom, unsigned char* out, const int out_width)
+		{
+			int x = 0;
+#ifdef RLE_FRAME_KERNELS_SSE2
+			const __m128i zero = _mm_setzero_si128();
+			const __m128i weights = pixel_weights();
+			const __m128i rounding = _mm_set1_epi32(1 << 9);
+
+			for (; x + 4 <= out_width; x += 4)
+			{
+				const __m128i top_a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(top + 8 * x));
+				const __m128i top_b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(top + 8 * x + 16));
+				const __m128i bottom_a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bottom + 8 * x));
+				const __m128i bottom_b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bottom + 8 * x + 16));
+
+				// Vertical sums, widened to 16 bits. Every register holds the two columns of one output pixel
+				const __m128i block_0 = _mm_add_epi16(_mm_unpacklo_epi8(top_a, zero), _mm_unpacklo_epi8(bottom_a, zero));
+				const __m128i block_1 = _mm_add_epi16(_mm_unpackhi_epi8(top_a, zero), _mm_unpackhi_epi8(bottom_a, zero));
+				const __m128i block_2 = _mm_add_epi16(_mm_unpacklo_epi8(top_b, zero), _mm_unpacklo_epi8(bottom_b, zero));
+				const __m128i block_3 = _mm_add_epi16(_mm_unpackhi_epi8(top_b, zero), _mm_unpackhi_epi8(bottom_b, zero));
+
+				// The four lanes of every weighted block adds up to its output pixel. Transposed and added at once
+				const __m128i weighted_0 = _mm_madd_epi16(block_0, weights);
+				const __m128i weighted_1 = _mm_madd_epi16(block_1, weights);
+				const __m128i weighted_2 = _mm_madd_epi16(block_2, weights);
+				const __m128i weighted_3 = _mm_madd_epi16(block_3, weights);
+
+				const __m128i pairs_01 = _mm_add_epi32(_mm_unpacklo_epi32(weighted_0, weighted_1), _mm_unpackhi_epi32(weighted_0, weighted_1));
+				const __m128i pairs_23 = _mm_add_epi32(_mm_unpacklo_epi32(weighted_2, weighted_3), _mm_unpackhi_epi32(weighted_2, weighted_3));
+				const __m128i sums = _mm_add_epi32(_mm_unpacklo_epi64(pairs_01, pairs_23), _mm_unpackhi_epi64(pairs_01, pairs_23));
+
+				// Four pixels with weights of 256: the mean it's the sum shifted by 10
+				store_four(out + x, _mm_srli_epi32(_mm_add_epi32(sums, rounding), 10));
+			}
+#endif
+			for (; x < out_width; x++)
+			{
+				const int sum = weighted_sum(top + 8 * x) + weighted_sum(top + 8 * x + 4)
+					+ weighted_sum(bottom + 8 * x) + weighted_sum(bottom + 8 * x + 4);
+				out[ x ] = static_cast<unsigned char>((sum + (1 << 9)) >> 10);
+			}
+		}
+
+		// Extends the integral images by the row that was just converted
+		void integral_row(
+			const unsigned char* gray,
+			const int width,
+			const int32_t* previous_sums,
+			int32_t* sums,
+			const double* previous_squares,
+			double* squares
+		) {
+			// Integer accumulators, exact and without the latency of the floating point adds on the dependency chain
+			int32_t row_sum = 0;
+			int64_t row_squares = 0;
+
+			sums[ 0 ] = 0;
+			squares[ 0 ] = 0.0;
+			for (int x = 0; x < width; x++)
+			{
+				row_sum += gray[ x ];
+				row_squares += gray[ x ] * gray[ x ];
+				sums[ x + 1 ] = previous_sums[ x + 1 ] + row_sum;
+				squares[ x + 1 ] = previous_squares[ x + 1 ] + static_cast<double>(row_squares);
+			}
+		}
+
+		// The formats that the fused kernel produces. Everything else goes through OpenCV
+		bool is_fused(const WorkingFormat& format)
+		{
+			return format.channel_mode == ChannelMode::Gray && (format.downscale == 1 || format.downscale == 2);
+		}
+
+		void convert_with_opencv(const cv::Mat& image, const WorkingFormat& format, WorkingFrame& frame)
+		{
+			cv::Mat converted;
+			switch (format.channel_mode)
+			{
+				case ChannelMode::BGR:
+					if (image.channels() == 3) converted = image;
+					else cv::cvtColor(image, converted, cv::COLOR_BGRA2BGR);
+					break;
+				case ChannelMode::Gray:
+					if (image.channels() == 1) converted = image;
+					else cv::cvtColor(image, converted, (image.channels() == 4) ? cv::COLOR_BGRA2GRAY : cv::COLOR_BGR2GRAY);
+					break;
+				default:
+					if (image.channels() == 4) converted = image;
+					else cv::cvtColor(image, converted, cv::COLOR_BGR2BGRA);
+			}
+
+			frame.downscale = std::max(1, format.downscale);
+			frame.image = downscale_needle(converted, frame.downscale);
+
+			if (format.with_integrals && frame.image.channels() == 1)
+				cv::integral(frame.image, frame.integral, frame.squared_integral, CV_32S, CV_64F);
+			else
+			{
+				frame.integral.release();
+				frame.squared_integral.release();
+			}
+		}
+	}
+
+
+	void from_bgra(
+		const unsigned char* bgra,
+		const size_t stride,
+		const int width,
+		const int height,
+		const WorkingFormat& format,
+		WorkingFrame& frame
+	) {
+		RUMBLE_TRACE_SCOPE("frame_conversion");
+
+		if (!is_fused(format))
+		{
+			convert_with_opencv(cv::Mat(height, width, CV_8UC4, const_cast<unsigned char*>(bgra), stride), format, frame);
+			return;
+		}
+
+		const int downscale = format.downscale;
+		const int out_width = width / downscale;
+		const int out_height = height / downscale;
+
+		frame.downscale = downscale;
+		frame.image.create(out_height, out_width, CV_8UC1);
+
+		if (format.with_integrals)
+		{
+			frame.integral.create(out_height + 1, out_width + 1, CV_32S);
+			frame.squared_integral.create(out_height + 1, out_width + 1, CV_64F);
+			frame.integral.row(0).setTo(0);
+			frame.squared_integral.row(0).setTo(0);
+		}
+		else
+		{
+			frame.integral.release();
+			frame.squared_integral.release();
+		}
+
+		for (int y = 0; y < out_height; y++)
+		{
+			const unsigned char* row = bgra + static_cast<size_t>(y) * downscale * stride;
+			unsigned char* out = frame.image.ptr<unsigned char>(y);
+
+			if (downscale == 1)
+				gray_row(row, out, out_width);
+			else
+				gray_half_row(row, row + stride, out, out_width);
+
+			// The gray row it's still on the L1 cache
+			if (format.with_integrals)
+				integral_row(
+					out, out_width,
+					frame.integral.ptr<int32_t>(y), frame.integral.ptr<int32_t>(y + 1),
+					frame.squared_integral.ptr<double>(y), frame.squared_integral.ptr<double>(y + 1)
+				);
+		}
+	}
+
+	void from_image(const cv::Mat& image, const WorkingFormat& format, WorkingFrame& frame)
+	{
+		if (image.type() == CV_8UC4 && is_fused(format))
+			from_bgra(image.data, image.step, image.cols, image.rows, format, frame);
+		else
+		{
+			RUMBLE_TRACE_SCOPE("frame_conversion");
+			convert_with_opencv(image, format, frame);
+		}
+	}
+
+	cv::Mat downscale_needle(const cv::Mat& needle, const int downscale)
+	{
+		if (downscale <= 1)
+			return needle;
+
+		// The area interpolation, on an integer factor, it's the mean of the blocks. The same that the kernel computes
+		cv::Mat scaled;
+		cv::resize(needle, scaled, cv::Size{ needle.cols / downscale, needle.rows / downscale }, 0, 0, cv::INTER_AREA);
+		return scaled;
+	}
+}
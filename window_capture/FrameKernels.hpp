@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+
+#include <opencv2/opencv.hpp>
+
+#include "WorkingFrame.hpp"
+
+/**
+* Conversions from the captured frames to the working format of the matcher.
+*
+* The gray formats, the hot ones, are produced by a fused kernel: a single pass over the BGRA pixels that averages
+* the 2 x 2 blocks (half scale), converts them to gray and accumulates the integral images, row by row, while the
+* source rows are still on the cache. The rest of the formats falls back to the OpenCV conversions.
+*
+* The gray weights are the ones of cv::cvtColor (BT.601), so the frames matches the needles converted by OpenCV,
+* with at most one level of difference by the rounding.
+*/
+namespace FrameKernels {
+
+	// Converts a top-down BGRA buffer, of "stride" bytes per row, into the working format
+	void from_bgra(
+		const unsigned char* bgra,
+		const size_t stride,
+		const int width,
+		const int height,
+		const WorkingFormat& format,
+		WorkingFrame& frame
+	);
+
+	// Same as above for any BGR or BGRA image, ie, the ones of a FrameSource that only provides whole frames
+	void from_image(const cv::Mat& image, const WorkingFormat& format, WorkingFrame& frame);
+
+	// Scales a needle the same way that the kernel scales the frames, so both are matched at the same scale
+	cv::Mat downscale_needle(const cv::Mat& needle, const int downscale);
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+#include "FrameKernels.hpp"
+
+/// <summary>
+/// Anything that can provide the frames of the League client to the vision engine.
+/// The WindowCapture it's the real one. The rest (recorded or synthetic frames) allows to run the engine
+/// without a client, or even without Windows.
+///
+/// The sources must be safe to be used from several threads, since the commands and the event watcher of a client
+/// captures its frames at the same time.
+/// </summary>
+class FrameSource
+{
+	public:
+		virtual ~FrameSource() = default;
+
+		// Returns the current frame of the client
+		virtual cv::Mat get_video_source() = 0;
+
+		// Transforms a point of a captured frame into the coordinates where the input events must be injected
+		virtual cv::Point client_to_screen(const cv::Point& client_point) = 0;
+
+		/**
+		* Returns the current frame already on the working format of the matcher. By default, the whole frame it's
+		* converted. The sources with access to the raw pixels can convert them while they're still on the cache
+		*/
+		virtual void get_working_frame(const WorkingFormat& format, WorkingFrame& frame)
+		{
+			FrameKernels::from_image(this->get_video_source(), format, frame);
+		}
+};
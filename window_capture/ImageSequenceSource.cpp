@@ -0,0 +1,68 @@
+#include <algorithm>
+#include <filesystem>
+#include <stdexcept>
+
+#include "ImageSequenceSource.hpp"
+#include "../tracing/RumbleTrace.hpp"
+
+
+ImageSequenceSource::ImageSequenceSource(std::vector<cv::Mat> frames, const cv::Point& screen_offset)
+    : frames{ std::move(frames) },
+    next_frame{ 0 },
+    screen_offset{ screen_offset }
+{
+    if (this->frames.empty())
+        throw std::invalid_argument("An ImageSequenceSource needs at least one frame");
+}
+
+ImageSequenceSource::ImageSequenceSource(ImageSequenceSource&& source) noexcept
+    : frames{ std::move(source.frames) },
+    next_frame{ source.next_frame },
+    screen_offset{ source.screen_offset } {}
+
+/// Recorded frames are converted to BGRA, the same layout that the WindowCapture delivers
+ImageSequenceSource ImageSequenceSource::from_directory(const std::string& directory, const cv::Point& screen_offset)
+{
+    std::vector<std::filesystem::path> paths;
+    for (const auto& entry : std::filesystem::directory_iterator(directory))
+    {
+        const auto extension = entry.path().extension();
+        if (extension == ".png" || extension == ".jpg")
+            paths.push_back(entry.path());
+    }
+    std::sort(paths.begin(), paths.end());
+
+    std::vector<cv::Mat> frames;
+    for (const auto& path : paths)
+    {
+        cv::Mat frame = cv::imread(path.string(), cv::IMREAD_COLOR);
+        if (frame.empty())
+            continue;
+
+        cv::Mat bgra_frame;
+        cv::cvtColor(frame, bgra_frame, cv::COLOR_BGR2BGRA);
+        frames.push_back(bgra_frame);
+    }
+
+    return ImageSequenceSource{ std::move(frames), screen_offset };
+}
+
+cv::Mat ImageSequenceSource::get_video_source()
+{
+    RUMBLE_TRACE_SCOPE("capture");
+
+    std::lock_guard<std::mutex> lock{ this->next_frame_mutex };
+    const cv::Mat& frame = this->frames[ this->next_frame ];
+    this->next_frame = (this->next_frame + 1) % this->frames.size();
+    return frame;
+}
+
+cv::Point ImageSequenceSource::client_to_screen(const cv::Point& client_point)
+{
+    return client_point + this->screen_offset;
+}
+
+size_t ImageSequenceSource::size() const
+{
+    return this->frames.size();
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "FrameSource.hpp"
+
+/// <summary>
+/// Frame source that replays a fixed sequence of frames, either recorded from a real client or synthetic ones.
+/// Every call to get_video_source returns the next frame, starting again from the first one after the last.
+/// </summary>
+class ImageSequenceSource : public FrameSource
+{
+	private:
+		std::vector<cv::Mat> frames;
+		size_t next_frame;
+		std::mutex next_frame_mutex;
+
+		// Offset of the replayed client inside the "screen". Zero means that client and screen coordinates are the same
+		cv::Point screen_offset;
+
+	public:
+		ImageSequenceSource(std::vector<cv::Mat> frames, const cv::Point& screen_offset = cv::Point{});
+
+		// The mutex isn't movable, the moved source gets a new one
+		ImageSequenceSource(ImageSequenceSource&& source) noexcept;
+
+		// Loads, sorted by file name, every .png or .jpg of a folder of recorded frames
+		static ImageSequenceSource from_directory(const std::string& directory, const cv::Point& screen_offset = cv::Point{});
+
+		cv::Mat get_video_source() override;
+		cv::Point client_to_screen(const cv::Point& client_point) override;
+
+		size_t size() const;
+};
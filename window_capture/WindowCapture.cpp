@@ -1,8 +1,15 @@
 #include "WindowCapture.h"
 #include "../helpers/StringHelper.hpp"
+#include "../tracing/RumbleTrace.hpp"
+#include "../logger/RumbleLogger.hpp"
 
 using namespace cv;
 
+// Declared by the newer SDKs only
+#ifndef PW_RENDERFULLCONTENT
+#define PW_RENDERFULLCONTENT 0x00000002
+#endif
+
 /*
     Find the handle for the window we want to capture.
     If no window name is given (by using the default constructor),
@@ -13,6 +20,7 @@ using namespace cv;
 ///  Default constructor
 /// </summary>
 WindowCapture::WindowCapture()
+    : memory_device_context{ NULL }, dib_section{ NULL }, dib_pixels{ nullptr }, render_window{ false }
 {
     this->window_name = { };
     this->hwnd = GetDesktopWindow();
@@ -23,17 +31,44 @@ WindowCapture::WindowCapture()
 /// </summary>
 /// <param name="window_name"></param>
 WindowCapture::WindowCapture(std::string window_name)
+    : memory_device_context{ NULL }, dib_section{ NULL }, dib_pixels{ nullptr }, render_window{ false }
 {
     // TODO Handle the exception if no window it's founded
     this->window_name = window_name;
-    wchar_t const* desired_window { StringHelper::to_wstring(this->window_name).c_str() };
+    // The wide string must outlive the call, the pointer of a temporary one would be dangling
+    const std::wstring desired_window { StringHelper::to_wstring(this->window_name) };
     this->hwnd = FindWindowW(
         NULL,
-        desired_window
+        desired_window.c_str()
     );
 
-    std::cout << "Current window name: " << this->window_name << std::endl;
-    std::cout << "this->hwnd: " << this->hwnd << std::endl;
+    RUMBLE_LOG_INFO << "Current window name: " << this->window_name;
+    RUMBLE_LOG_INFO << "this->hwnd: " << this->hwnd;
+}
+
+/// <summary>
+/// Captures the window with the provided handle, as returned by list_window_names
+/// </summary>
+/// <param name="hwnd"></param>
+/// <param name="render_window">Renders the window with PrintWindow, so it's captured even when it's covered</param>
+WindowCapture::WindowCapture(HWND hwnd, bool render_window)
+    : memory_device_context{ NULL }, dib_section{ NULL }, dib_pixels{ nullptr }, render_window{ render_window }
+{
+    this->hwnd = hwnd;
+
+    const int title_length = GetWindowTextLengthW(hwnd);
+    std::wstring title(title_length + 1, L'\0');
+    GetWindowTextW(hwnd, &title[0], title_length + 1);
+    title.resize(title_length);
+    this->window_name = StringHelper::to_string(title);
+
+    RUMBLE_LOG_INFO << "Current window name: " << this->window_name << " (" << this->hwnd << ")";
+}
+
+
+WindowCapture::~WindowCapture()
+{
+    this->release_dib_section();
 }
 
 
@@ -41,41 +76,124 @@ WindowCapture::WindowCapture(std::string window_name)
 /// the desktop screen or named window injected via constructor
 Mat WindowCapture::get_video_source()
 {
-    HDC deviceContext = GetDC(this->hwnd);
-    HDC memoryDeviceContext = CreateCompatibleDC(deviceContext);
-    SetStretchBltMode(memoryDeviceContext, COLORONCOLOR);
+    RUMBLE_TRACE_SCOPE("capture");
 
-    RECT windowRect;
-    GetClientRect(this->hwnd, &windowRect);
+    std::lock_guard<std::mutex> lock{ this->capture_mutex };
+    const cv::Size size = this->capture();
+    if (size.empty())
+        return Mat();
+
+    // The DIB section it's overwritten by the next capture, so the caller gets its own copy
+    return Mat(size, CV_8UC4, this->dib_pixels).clone();
+}
 
-    int height = windowRect.bottom;
-    int width = windowRect.right;
+void WindowCapture::get_working_frame(const WorkingFormat& format, WorkingFrame& frame)
+{
+    RUMBLE_TRACE_SCOPE("capture");
+
+    std::lock_guard<std::mutex> lock{ this->capture_mutex };
+    const cv::Size size = this->capture();
+    if (size.empty())
+    {
+        frame.image.release();
+        return;
+    }
+
+    // No copy at all into an intermediate full frame, the conversion reads the pixels that BitBlt just wrote
+    FrameKernels::from_bgra(this->dib_pixels, static_cast<size_t>(size.width) * 4, size.width, size.height, format, frame);
+
+    // The native format it's just a view of the DIB section. It must survive the next capture
+    if (frame.image.data == this->dib_pixels)
+        frame.image = frame.image.clone();
+}
 
-    HBITMAP bitmap = CreateCompatibleBitmap(deviceContext, width, height);
 
-    SelectObject(memoryDeviceContext, bitmap);
+cv::Size WindowCapture::capture()
+{
+    RECT windowRect;
+    GetClientRect(this->hwnd, &windowRect);
 
-    // Copy data into bitmap
-    BitBlt(memoryDeviceContext, 0, 0, width, height, deviceContext, 0, 0, SRCCOPY);
+    const cv::Size size{ windowRect.right, windowRect.bottom };
+    if (size.empty())
+        return cv::Size{};
 
+    HDC deviceContext = GetDC(this->hwnd);
 
-    // Specify format by using bitmapinfoheader!
-    BITMAPINFOHEADER bi;
-    BITMAPINFOHEADER* bi_ptr = &bi;
-    this->setup_bitmap(bi_ptr, width, height);
+    if (size != this->dib_size || this->dib_section == NULL)
+    {
+        this->release_dib_section();
+
+        // Specify format by using bitmapinfoheader! Top-down rows of 8 bit unsigned ints 4 Channels -> BGRA
+        BITMAPINFO bitmap_info{};
+        this->setup_bitmap(&bitmap_info.bmiHeader, size.width, size.height);
+
+        void* pixels = nullptr;
+        this->memory_device_context = CreateCompatibleDC(deviceContext);
+        this->dib_section = CreateDIBSection(deviceContext, &bitmap_info, DIB_RGB_COLORS, &pixels, NULL, 0);
+        if (this->dib_section == NULL)
+        {
+            RUMBLE_LOG_ERROR << "Unable to create the capture bitmap of " << size.width << "x" << size.height;
+            DeleteDC(this->memory_device_context);
+            this->memory_device_context = NULL;
+            ReleaseDC(this->hwnd, deviceContext);
+            return cv::Size{};
+        }
+
+        SelectObject(this->memory_device_context, this->dib_section);
+        this->dib_pixels = static_cast<unsigned char*>(pixels);
+        this->dib_size = size;
+    }
+
+    // The client it's drawn with the GPU, so only the full content rendering gives its pixels and not a black frame
+    if (this->render_window)
+    {
+        ReleaseDC(this->hwnd, deviceContext);
+        if (!PrintWindow(this->hwnd, this->memory_device_context, PW_CLIENTONLY | PW_RENDERFULLCONTENT))
+        {
+            RUMBLE_LOG_WARNING << "Unable to render the window " << this->hwnd;
+            return cv::Size{};
+        }
+    }
+    else
+    {
+        // Copy data into the bitmap. Nothing it's stretched, so there is no stretch mode to set
+        BitBlt(this->memory_device_context, 0, 0, size.width, size.height, deviceContext, 0, 0, SRCCOPY);
+        ReleaseDC(this->hwnd, deviceContext);
+    }
+
+    // The GDI batches its calls. The pixels must be there before reading them
+    GdiFlush();
+
+    return size;
+}
 
-    // Creates a new matrix to store the final result of 8 bit unsigned ints 4 Channels -> RGBA
-    cv::Mat mat = cv::Mat(height, width, CV_8UC4);
+void WindowCapture::release_dib_section()
+{
+    // Clean up! Delete, not release, the memory device context
+    if (this->memory_device_context != NULL)
+        DeleteDC(this->memory_device_context);
+    if (this->dib_section != NULL)
+        DeleteObject(this->dib_section);
+
+    this->memory_device_context = NULL;
+    this->dib_section = NULL;
+    this->dib_pixels = nullptr;
+    this->dib_size = cv::Size{};
+}
 
-    // Transform data and store into mat.data
-    GetDIBits(memoryDeviceContext, bitmap, 0, height, mat.data, (BITMAPINFO*)bi_ptr, DIB_RGB_COLORS);
 
-    // Clean up!
-    DeleteObject(bitmap);
-    DeleteDC(memoryDeviceContext);  // Delete, not release!
-    ReleaseDC(this->hwnd, deviceContext);
+/// Transforms the coordinates of a point inside the captured window into the relative coordinates
+/// of the current machine desktop screen
+/// Details: https://docs.microsoft.com/en-us/windows/win32/api/winuser/nf-winuser-clienttoscreen
+cv::Point WindowCapture::client_to_screen(const cv::Point& client_point)
+{
+    RUMBLE_TRACE_SCOPE("client_to_screen");
+
+    // Copy the data from the openCV Point type to the POINT type from the Windows API
+    POINT coords { client_point.x, client_point.y };
+    ::ClientToScreen(this->hwnd, &coords);
 
-    return mat;
+    return cv::Point{ coords.x, coords.y };
 }
 
 
@@ -96,10 +214,35 @@ void WindowCapture::setup_bitmap(BITMAPINFOHEADER* bi, int width, int height)
 }
 
 
-// TODO As a helper?
-void WindowCapture::list_window_names()
+/// Enumerates the visible top level windows of the desktop. Several League clients shares the same title,
+/// so they can only be told apart by their handles
+std::vector<WindowCapture::Window> WindowCapture::list_window_names(const string& window_name)
 {
-    // Impl pending
+    struct Enumeration
+    {
+        const string* window_name;
+        std::vector<Window> windows;
+    } enumeration{ &window_name, {} };
+
+    EnumWindows([](HWND hwnd, LPARAM lparam) -> BOOL {
+        Enumeration* enumeration = reinterpret_cast<Enumeration*>(lparam);
+
+        const int title_length = GetWindowTextLengthW(hwnd);
+        if (!IsWindowVisible(hwnd) || title_length == 0)
+            return TRUE;
+
+        std::wstring title(title_length + 1, L'\0');
+        GetWindowTextW(hwnd, &title[0], title_length + 1);
+        title.resize(title_length);
+
+        const string name = StringHelper::to_string(title);
+        if (enumeration->window_name->empty() || name == *enumeration->window_name)
+            enumeration->windows.push_back(Window{ hwnd, name });
+
+        return TRUE; // Keeps enumerating
+    }, reinterpret_cast<LPARAM>(&enumeration));
+
+    return enumeration.windows;
 }
 
 HWND WindowCapture::get_hwnd()
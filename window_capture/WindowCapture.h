@@ -1,29 +1,73 @@
 #pragma once
 
+#include <mutex>
 #include <string>
+#include <vector>
 #include <windows.h>
 #include <opencv2/opencv.hpp>
 
+#include "FrameSource.hpp"
+
 using namespace std;
 
 
-class WindowCapture
+class WindowCapture : public FrameSource
 {
 	private:
 		HWND hwnd;
 		string window_name;
 
+		// The capture target, reused between frames and recreated when the client area changes its size.
+		// A DIB section, so BitBlt writes the pixels straight into memory that it's readable from here
+		HDC memory_device_context;
+		HBITMAP dib_section;
+		unsigned char* dib_pixels;
+		cv::Size dib_size;
+
+		// Asks the window itself to render into the DIB section (PrintWindow), instead of copying its area of the screen.
+		// Slower, but the pixels are the ones of the window even when another one covers it
+		bool render_window;
+
+		// Guards the DIB section, from the capture until its pixels are copied out
+		std::mutex capture_mutex;
+
 		void setup_bitmap(BITMAPINFOHEADER* bi, int width, int height);
 
+		// Copies the client area into the DIB section (top-down BGRA rows). Returns its size, empty if there is nothing to capture
+		cv::Size capture();
+
+		void release_dib_section();
+
 	public:
+		// A top level window of the desktop
+		struct Window
+		{
+			HWND hwnd;
+			string name;
+		};
+
 		WindowCapture();
 		WindowCapture(string window_name);
+		// Captures a concrete window, ie, one of several League clients with the same title. Several clients overlaps
+		// each other, so each one has to render its own frames
+		explicit WindowCapture(HWND hwnd, bool render_window = false);
+
+		~WindowCapture();
+
+		WindowCapture(const WindowCapture&) = delete;
+		WindowCapture& operator=(const WindowCapture&) = delete;
 
 		/// Methods
-		cv::Mat get_video_source();
+		cv::Mat get_video_source() override;
+
+		// Converts the captured pixels straight from the DIB section, in a single pass
+		void get_working_frame(const WorkingFormat& format, WorkingFrame& frame) override;
+
+		// Converts a point of the captured client area into desktop screen coordinates
+		cv::Point client_to_screen(const cv::Point& client_point) override;
 		
-		// TODO Future impl as a helper to retrieve available windows names
-		void list_window_names();
+		// The visible top level windows with a title. Only the ones whose title it's exactly "window_name", if it isn't empty
+		static std::vector<Window> list_window_names(const string& window_name = "");
 
 		// Getters
 		HWND get_hwnd();
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+#include "../vision/ChannelMode.hpp"
+
+// The layout of the frames that the matcher works on
+struct WorkingFormat
+{
+	ChannelMode channel_mode;
+
+	// 1 for the full resolution, 2 for half of the width and the height
+	int downscale;
+
+	// Also builds the integral images of the frame. Only for the Gray channel mode
+	bool with_integrals;
+};
+
+// A captured frame, already on a working format
+struct WorkingFrame
+{
+	cv::Mat image;
+
+	// Client coordinates = image coordinates * downscale
+	int downscale = 1;
+
+	// The (rows + 1) x (cols + 1) sums of the pixels (CV_32S) and of their squares (CV_64F), as cv::integral
+	// builds them. Empty unless the format asked for them
+	cv::Mat integral;
+	cv::Mat squared_integral;
+};
+
+// A region of a frame, with the same region of its integral images (if it has them). Nothing it's copied
+inline WorkingFrame frame_region(const WorkingFrame& frame, const cv::Rect& region)
+{
+	WorkingFrame region_frame{ frame.image(region), frame.downscale };
+	if (!frame.integral.empty())
+	{
+		// The box sums are differences, so a region of the integral image still works as the integral of the region
+		const cv::Rect integral_region{ region.x, region.y, region.width + 1, region.height + 1 };
+		region_frame.integral = frame.integral(integral_region);
+		region_frame.squared_integral = frame.squared_integral(integral_region);
+	}
+	return region_frame;
+}